@@ -10,6 +10,8 @@
 
 #include "Platform.h"
 
+#include <vector>
+
 namespace Atl
 {
     struct EXPORTED AABB
@@ -18,12 +20,92 @@ namespace Atl
 
         //! @brief Returns the center point of the AABB.
         inline rvec3 center() const;
+
+        //! @brief Grows the AABB so it contains rhs.
+        inline void merge(const AABB& rhs);
+
+        //! @brief Returns the AABB containing this box transformed by the given affine matrix.
+        inline AABB transformed(const rmat4x4& matrix) const;
     };
 
     inline rvec3 AABB::center() const
     {
         return min + ((max - min) * rvec3(0.5, 0.5, 0.5));
     }
+
+    inline void AABB::merge(const AABB& rhs)
+    {
+        min = glm::min(min, rhs.min);
+        max = glm::max(max, rhs.max);
+    }
+
+    inline AABB AABB::transformed(const rmat4x4& matrix) const
+    {
+        // The center is transformed, and the half extent by the absolute value of the 
+        // rotation and scale part, which gives the extent of the rotated box on each axis.
+
+        const rvec3 halfExtent = (max - min) * rvec3(0.5, 0.5, 0.5);
+        const rvec3 newCenter = rvec3(matrix * rvec4(center(), 1.0));
+
+        const rmat3x3 absolute(glm::abs(rvec3(matrix[0])),
+                               glm::abs(rvec3(matrix[1])),
+                               glm::abs(rvec3(matrix[2])));
+
+        const rvec3 newHalfExtent = absolute * halfExtent;
+        return AABB{ newCenter - newHalfExtent, newCenter + newHalfExtent };
+    }
+
+    //! @brief A list of AABB stored as a structure of arrays.
+    //! Each component of the boxes is stored contiguously, so batch functions like
+    //! \ref Frustum::cullBoxes() can test multiple boxes at once with SIMD instructions.
+    struct EXPORTED AABBArray
+    {
+        std::vector < Real > minX, minY, minZ;
+        std::vector < Real > maxX, maxY, maxZ;
+
+        //! @brief Adds a box at the end of the arrays.
+        inline void add(const AABB& box);
+
+        //! @brief Removes every boxes, but keeps the allocated memory.
+        inline void clear();
+
+        //! @brief Reserves memory for count boxes.
+        inline void reserve(std::size_t count);
+
+        //! @brief Returns the number of boxes.
+        inline std::size_t size() const;
+
+        //! @brief Returns the box at index idx.
+        inline AABB at(std::size_t idx) const;
+    };
+
+    inline void AABBArray::add(const AABB& box)
+    {
+        minX.push_back(box.min.x); minY.push_back(box.min.y); minZ.push_back(box.min.z);
+        maxX.push_back(box.max.x); maxY.push_back(box.max.y); maxZ.push_back(box.max.z);
+    }
+
+    inline void AABBArray::clear()
+    {
+        minX.clear(); minY.clear(); minZ.clear();
+        maxX.clear(); maxY.clear(); maxZ.clear();
+    }
+
+    inline void AABBArray::reserve(std::size_t count)
+    {
+        minX.reserve(count); minY.reserve(count); minZ.reserve(count);
+        maxX.reserve(count); maxY.reserve(count); maxZ.reserve(count);
+    }
+
+    inline std::size_t AABBArray::size() const
+    {
+        return minX.size();
+    }
+
+    inline AABB AABBArray::at(std::size_t idx) const
+    {
+        return AABB{ rvec3(minX[idx], minY[idx], minZ[idx]), rvec3(maxX[idx], maxY[idx], maxZ[idx]) };
+    }
 }
 
 #endif // AABB_h
\ No newline at end of file
@@ -0,0 +1,53 @@
+//
+//  BindBufferCommand.h
+//  atlre
+//
+//  Created by jacques tronconi on 24/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#ifndef ATL_BINDBUFFERCOMMAND_H
+#define ATL_BINDBUFFERCOMMAND_H
+
+#include "RenderCommand.h"
+#include "RenderHdwBuffer.h"
+
+namespace Atl
+{
+    //! @brief Defines a \ref RenderCommand to bind a range of a buffer to a slot, like a uniform
+    //! block binding point. This is the RenderCommand counterpart of BindBufferPacket.
+    struct EXPORTED BindBufferCommand : public RenderCommandBase
+    {
+        using RenderCommandBase::RenderCommandBase;
+
+        //! @brief Destructor.
+        virtual ~BindBufferCommand() = default;
+
+        //! @brief Constructs the command.
+        //! @param slot The slot where to bind the buffer.
+        //! @param buffer The buffer to bind.
+        //! @param offset The first byte to bind.
+        //! @param size The number of bytes to bind.
+        virtual void construct(unsigned slot,
+                               const RenderHdwBufferPtr& buffer,
+                               std::size_t offset,
+                               std::size_t size) = 0;
+
+        //! @brief Returns the slot given to \ref construct().
+        virtual unsigned slot() const = 0;
+
+        //! @brief Returns the buffer given to \ref construct().
+        virtual RenderHdwBufferPtr buffer() const = 0;
+
+        //! @brief Returns the offset given to \ref construct().
+        virtual std::size_t offset() const = 0;
+
+        //! @brief Returns the size given to \ref construct().
+        virtual std::size_t size() const = 0;
+    };
+
+    //! @brief Defines a Pointer to the \ref BindBufferCommand.
+    typedef std::shared_ptr < BindBufferCommand > BindBufferCommandPtr;
+}
+
+#endif // ATL_BINDBUFFERCOMMAND_H
@@ -41,6 +41,12 @@ namespace Atl
         //! @brief Protects data over threads.
         mutable std::mutex mCachesMutex;
         
+        //! @brief Serializes the builds of the caches. Held before mCachesMutex.
+        mutable std::mutex mBuildMutex;
+        
+        //! @brief The number of calls to \ref touch().
+        std::atomic < std::uint64_t > mTouchCount { 0 };
+        
     public:
         //! @brief Destructor.
         virtual ~CachedRenderable() = default;
@@ -50,47 +56,79 @@ namespace Atl
         //! managed by this class. The returned value must not be null.
         virtual RenderCachePtr < T > makeNewCache(Renderer& rhs) = 0;
         
-        //! @brief Asynchroneously renders this object into a RenderCommand.
-        virtual std::future < void > render(RenderCommand& to) const {
-            return std::async(std::launch::async, [this, &to]()
+        //! @brief Renders this object into a RenderCommand, on the calling thread.
+        //! The caches mutex is not held while the cache builds or renders, as it may
+        //! be waited by other threads rendering this same object. A cache renders the
+        //! last state it published while it is rebuilt by another thread.
+        virtual void renderSync(RenderCommand& to) const {
+            cacheSync(to.renderer())->renderSync(to);
+        }
+        
+        //! @brief Returns the RenderCache for the given Renderer, on the calling thread. The 
+        //! cache is built if it doesn't exist yet, and rebuilt if it has been touched. The
+        //! builds are serialized by mBuildMutex, so a touched cache is rebuilt once.
+        virtual RenderCachePtr < T > cacheSync(Renderer& renderer) const {
+            RenderCachePtr < T > cache;
+            bool isTouched = false;
+            
+            {
+                std::lock_guard l(mCachesMutex);
+                cache = mCaches.cacheFor(renderer);
+                isTouched = cache && mCaches.isCacheTouched(cache);
+            }
+            
+            if (!cache)
+            {
+                // No cache found, just build it.
+                onCacheMiss(renderer);
+                return const_cast < CachedRenderable& >(*this).makeCacheSync(renderer);
+            }
+            
+            if (isTouched)
             {
-                Renderer& renderer = to.renderer();
+                // Another thread may have rebuilt it while we waited.
                 
-                mCachesMutex.lock();
-                RenderCachePtr < T > cache = mCaches.cacheFor(renderer);
+                std::lock_guard b(mBuildMutex);
                 
-                if (!cache)
                 {
-                    mCachesMutex.unlock();
-                    
-                    // No cache found, just build it.
-                    onCacheMiss(renderer);
-                    const_cast < CachedRenderable& >(*this).build(renderer);
+                    std::lock_guard l(mCachesMutex);
+                    isTouched = mCaches.isCacheTouched(cache);
                     
-                    return render(to).get();
-                }
-                
-                if (mCaches.isCacheTouched(cache))
-                {
-                    mCaches.cleanCache(cache);
-                    cache->build(renderer).get();
+                    if (isTouched)
+                        mCaches.cleanCache(cache);
                 }
                 
-                cache->render(to).get();
-                mCachesMutex.unlock();
-            });
+                if (isTouched)
+                    cache->buildSync(renderer);
+            }
+            
+            return cache;
         }
         
-        //! @brief Creates a RenderCache for this object.
-        virtual std::future < void > build(Renderer& renderer) {
-            return std::async(std::launch::async, [this, &renderer]() 
+        //! @brief Creates a RenderCache for this object, on the calling thread, or rebuilds
+        //! the existing one.
+        virtual void buildSync(Renderer& renderer) {
+            RenderCachePtr < T > cache;
+            
             {
-                RenderCachePtr < T > cache = makeNewCache(renderer);
-                cache->build(renderer).get();
-                
                 std::lock_guard l(mCachesMutex);
-                mCaches.addCache(cache);
-            });
+                cache = mCaches.cacheFor(renderer);
+            }
+            
+            if (!cache)
+            {
+                makeCacheSync(renderer);
+                return;
+            }
+            
+            std::lock_guard b(mBuildMutex);
+            
+            {
+                std::lock_guard l(mCachesMutex);
+                mCaches.cleanCache(cache);
+            }
+            
+            cache->buildSync(renderer);
         }
         
         //! @brief Returns true if this renderable has a cache for given renderer.
@@ -111,6 +149,12 @@ namespace Atl
         virtual void touch() {
             std::lock_guard l(mCachesMutex);
             mCaches.touchAllCaches();
+            mTouchCount++;
+        }
+        
+        //! @brief Returns the number of times the renderable has been touched.
+        virtual std::uint64_t touchCount() const {
+            return mTouchCount;
         }
         
         //! @brief Sets the renderable into a 'cleaned' state.
@@ -144,6 +188,26 @@ namespace Atl
         
         //! @brief Called when a Cache is asked but not found.
         virtual void onCacheMiss(Renderer& renderer) const {}
+        
+        //! @brief Creates and builds the RenderCache for the given Renderer, unless another
+        //! thread created it while we waited for mBuildMutex. Returns the cache.
+        RenderCachePtr < T > makeCacheSync(Renderer& renderer) {
+            std::lock_guard b(mBuildMutex);
+            
+            {
+                std::lock_guard l(mCachesMutex);
+                
+                if (RenderCachePtr < T > cache = mCaches.cacheFor(renderer))
+                    return cache;
+            }
+            
+            RenderCachePtr < T > cache = makeNewCache(renderer);
+            cache->buildSync(renderer);
+            
+            std::lock_guard l(mCachesMutex);
+            mCaches.addCache(cache);
+            return cache;
+        }
     };
 }
 
@@ -119,37 +119,31 @@ namespace Atl
         rotate(rvec3(0.0, 0.0, 1.0), angle);
     }
 
-    std::future < void > Camera::build(Renderer& renderer)
+    void Camera::buildSync(Renderer& renderer)
     {
-        return std::async(std::launch::async, [this, &renderer]()
-        {
-            std::lock_guard l(mMutex);
+        std::lock_guard l(mMutex);
 
-            // We have to make the Matrix4x4 from our Position and Quaternion, 
-            // and then we can set the matrix for the Transformation and use
-            // Transformation::build().
+        // We have to make the Matrix4x4 from our Position and Quaternion, 
+        // and then we can set the matrix for the Transformation and use
+        // Transformation::build().
 
-            const rmat4x4 Translation = glm::translate(mPosition);
-            const rmat4x4 Rotation = glm::toMat4(mOrientation);
-            const rmat4x4 ViewMatrix = Translation * Rotation;
+        const rmat4x4 Translation = glm::translate(mPosition);
+        const rmat4x4 Rotation = glm::toMat4(mOrientation);
+        const rmat4x4 ViewMatrix = Translation * Rotation;
 
-            mTransformation.setMatrix(ViewMatrix);
-            mTransformation.build(renderer).get();
+        mTransformation.setMatrix(ViewMatrix);
+        mTransformation.buildSync(renderer);
 
-            TimeTouchable::clean();
-        });
+        TimeTouchable::clean();
     }
 
-    std::future < void > Camera::render(RenderCommand& command) const
+    void Camera::renderSync(RenderCommand& command) const
     {
-        return std::async(std::launch::async, [this, &command]()
-        {
-            if (TimeTouchable::isTouched())
-                const_cast < Camera& >(*this).build(command.renderer()).get();
+        if (TimeTouchable::isTouched())
+            const_cast < Camera& >(*this).buildSync(command.renderer());
 
-            std::lock_guard l(mMutex);
-            mTransformation.render(command);
-        });
+        std::lock_guard l(mMutex);
+        mTransformation.renderSync(command);
     }
 
     std::size_t Camera::size(Renderer&) const
@@ -12,6 +12,7 @@
 #include "Touchable.h"
 #include "Emitter.h"
 #include "Transformation.h"
+#include "MakeUniqueIndex.h"
 
 namespace Atl
 {
@@ -29,7 +30,8 @@ namespace Atl
         virtual public std::enable_shared_from_this < Camera >,
         virtual public Renderable,
         virtual public TimeTouchable,
-        virtual public Emitter
+        virtual public Emitter,
+        public MakeUniqueIndex < Camera >
     {
         std::string mName;
 
@@ -88,9 +90,9 @@ namespace Atl
 
         virtual void rotateZ(Real angle);
 
-        virtual std::future < void > build(Renderer& renderer);
+        virtual void buildSync(Renderer& renderer);
 
-        virtual std::future < void > render(RenderCommand& command) const;
+        virtual void renderSync(RenderCommand& command) const;
 
         virtual std::size_t size(Renderer&) const;
 
@@ -0,0 +1,88 @@
+//
+//  CommandArena.cpp
+//  atlre
+//
+//  Created by jacques tronconi on 23/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#include "CommandArena.h"
+
+#include <algorithm>
+
+namespace Atl
+{
+    CommandArena::CommandArena(std::size_t blockSize)
+    : mCurrent(0), mBlockSize(std::max(AlignedSize(blockSize), Alignment))
+    {
+
+    }
+
+    void* CommandArena::allocate(std::size_t size)
+    {
+        size = AlignedSize(size);
+
+        if (mCurrent < mBlocks.size())
+        {
+            Block& block = mBlocks[mCurrent];
+
+            if (block.used + size <= block.capacity)
+            {
+                void* result = block.data.get() + block.used;
+                block.used += size;
+                return result;
+            }
+        }
+
+        // The current block is full: a new one is added after it.
+
+        const std::size_t capacity = std::max(mBlockSize, size);
+        mBlocks.push_back(Block{ std::unique_ptr < char[] >(new char[capacity]), capacity, size });
+        mCurrent = mBlocks.size() - 1;
+
+        return mBlocks.back().data.get();
+    }
+
+    void CommandArena::reset()
+    {
+        if (mBlocks.size() > 1)
+        {
+            const std::size_t total = capacity();
+
+            mBlocks.clear();
+            mBlocks.push_back(Block{ std::unique_ptr < char[] >(new char[total]), total, 0 });
+        }
+
+        else if (!mBlocks.empty())
+            mBlocks.front().used = 0;
+
+        mCurrent = 0;
+    }
+
+    std::size_t CommandArena::size() const
+    {
+        std::size_t total = 0;
+
+        forEachBlock([&total](const char*, std::size_t used)
+        {
+            total += used;
+        });
+
+        return total;
+    }
+
+    std::size_t CommandArena::capacity() const
+    {
+        std::size_t total = 0;
+
+        for (const Block& block : mBlocks)
+            total += block.capacity;
+
+        return total;
+    }
+
+    std::size_t CommandArena::blocksCount() const
+    {
+        return mBlocks.size();
+    }
+}
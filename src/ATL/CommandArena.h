@@ -0,0 +1,92 @@
+//
+//  CommandArena.h
+//  atlre
+//
+//  Created by jacques tronconi on 23/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#ifndef ATL_COMMANDARENA_H
+#define ATL_COMMANDARENA_H
+
+#include "Platform.h"
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace Atl
+{
+    //! @brief A linear allocator for the packets of a CommandBuffer.
+    //!
+    //! Memory is taken from blocks by moving a pointer forward, and is never freed one
+    //! allocation at a time: \ref reset() makes the whole arena available again. When a frame
+    //! needed more than one block, reset replaces them with a single block as large as all of
+    //! them, so the next frames record in one contiguous block and never allocate.
+    class EXPORTED CommandArena
+    {
+    public:
+
+        //! @brief Default size of a block, in bytes.
+        static constexpr std::size_t DefaultBlockSize = 64 * 1024;
+
+        //! @brief Alignment of every allocation.
+        static constexpr std::size_t Alignment = alignof(std::max_align_t);
+
+    private:
+
+        //! @brief A block of memory.
+        struct Block
+        {
+            std::unique_ptr < char[] > data;
+            std::size_t capacity;
+            std::size_t used;
+        };
+
+        //! @brief The blocks, in allocation order.
+        std::vector < Block > mBlocks;
+
+        //! @brief The block where the next allocation is tried. Blocks before it are full.
+        std::size_t mCurrent;
+
+        //! @brief Minimum size of a new block.
+        std::size_t mBlockSize;
+
+    public:
+
+        //! @brief Constructs an arena. The first block is allocated on the first allocation.
+        CommandArena(std::size_t blockSize = DefaultBlockSize);
+
+        //! @brief Returns size bytes aligned on Alignment. The memory stays valid until the next
+        //! \ref reset().
+        void* allocate(std::size_t size);
+
+        //! @brief Makes every block available again.
+        void reset();
+
+        //! @brief Returns the number of bytes allocated since the last reset.
+        std::size_t size() const;
+
+        //! @brief Returns the number of bytes of every block.
+        std::size_t capacity() const;
+
+        //! @brief Returns the number of blocks.
+        std::size_t blocksCount() const;
+
+        //! @brief Calls fn(data, used) for each used block, in allocation order.
+        template < typename Function >
+        void forEachBlock(Function&& fn) const
+        {
+            for (std::size_t i = 0; i < mBlocks.size() && i <= mCurrent; ++i)
+                fn(static_cast < const char* >(mBlocks[i].data.get()), mBlocks[i].used);
+        }
+
+        //! @brief Returns size rounded up to Alignment.
+        static constexpr std::size_t AlignedSize(std::size_t size)
+        {
+            return (size + Alignment - 1) & ~(Alignment - 1);
+        }
+    };
+}
+
+#endif // ATL_COMMANDARENA_H
@@ -0,0 +1,266 @@
+//
+//  CommandBuffer.cpp
+//  atlre
+//
+//  Created by jacques tronconi on 23/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#include "CommandBuffer.h"
+#include "Error.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Atl
+{
+    CommandBuffer::CommandBuffer(Renderer& rhs, std::size_t blockSize)
+    : RenderCommand(rhs), mArena(blockSize), mPacketsCount(0)
+    {
+
+    }
+
+    CommandBuffer* CommandBuffer::asCommandBuffer()
+    {
+        return this;
+    }
+
+    void CommandBuffer::addSubCommand(const RenderCommandBasePtr& subCommand)
+    {
+        if (!subCommand)
+            return;
+
+        LockableGuard l(*this);
+        mRetained.push_back(subCommand);
+        pushSubCommand(*subCommand);
+    }
+
+    void CommandBuffer::addSubCommands(const RenderCommandBaseList& subCommands, bool /*skipNulls*/)
+    {
+        // Null commands are skipped when rendering by RenderCommand too, so they are never
+        // recorded whatever skipNulls is.
+
+        LockableGuard l(*this);
+
+        for (auto const& command : subCommands)
+        {
+            if (!command)
+                continue;
+
+            mRetained.push_back(command);
+            pushSubCommand(*command);
+        }
+    }
+
+    void CommandBuffer::removeSubCommand(const RenderCommandBasePtr& subCommand)
+    {
+        LockableGuard l(*this);
+
+        auto it = std::find(mRetained.begin(), mRetained.end(), subCommand);
+
+        if (it == mRetained.end())
+            return;
+
+        mRetained.erase(it);
+
+        mArena.forEachBlock([&subCommand](const char* data, std::size_t used)
+        {
+            for (std::size_t offset = 0; offset < used; )
+            {
+                auto* header = reinterpret_cast < CommandPacket* >(const_cast < char* >(data + offset));
+                offset += header->size;
+
+                if (header->type != CommandPacketType::SubCommand)
+                    continue;
+
+                auto* packet = reinterpret_cast < SubCommandPacket* >(header);
+
+                if (packet->command == subCommand.get())
+                    packet->command = nullptr;
+            }
+        });
+    }
+
+    void CommandBuffer::removeAllSubCommands()
+    {
+        LockableGuard l(*this);
+        mArena.reset();
+        mRetained.clear();
+        mObjects.clear();
+        mPacketsCount = 0;
+    }
+
+    void CommandBuffer::render()
+    {
+        LockableGuard l(*this);
+        mTracker.reset();
+        renderWith(mTracker);
+        mStats = mTracker.stats();
+    }
+
+    void CommandBuffer::renderWith(RenderStateTracker& tracker)
+    {
+        LockableGuard l(*this);
+
+        mArena.forEachBlock([this, &tracker](const char* data, std::size_t used)
+        {
+            for (std::size_t offset = 0; offset < used; )
+            {
+                auto const& header = *reinterpret_cast < const CommandPacket* >(data + offset);
+                offset += header.size;
+
+                switch (header.type)
+                {
+                    case CommandPacketType::SubCommand:
+                        renderSubCommand(reinterpret_cast < const SubCommandPacket& >(header), tracker);
+                        break;
+
+                    case CommandPacketType::SetUniform:
+                    {
+                        auto const& packet = reinterpret_cast < const SetUniformPacket& >(header);
+
+                        if (tracker.setUniform(packet.index, packet.type, packet.value(), packet.valueSize))
+                            execute(header, tracker);
+
+                        break;
+                    }
+
+                    case CommandPacketType::BindBuffer:
+                    {
+                        auto const& packet = reinterpret_cast < const BindBufferPacket& >(header);
+
+                        if (tracker.bindBuffer(packet.slot, packet.buffer, packet.offset, packet.size))
+                            execute(header, tracker);
+
+                        break;
+                    }
+
+                    default:
+                        execute(header, tracker);
+                        break;
+                }
+            }
+        });
+    }
+
+    void CommandBuffer::addCachedCommand(RenderCommandBase& command, int uniform)
+    {
+        LockableGuard l(*this);
+        pushSubCommand(command, uniform);
+    }
+
+    void CommandBuffer::retain(const std::shared_ptr < const void >& object)
+    {
+        if (!object)
+            return;
+
+        LockableGuard l(*this);
+        mObjects.push_back(object);
+    }
+
+    void CommandBuffer::draw(const VertexInfos& infos)
+    {
+        LockableGuard l(*this);
+        push < DrawPacket >().infos = &infos;
+    }
+
+    void CommandBuffer::drawIndexed(const VertexInfos& infos, const IndexBufferData& indexes)
+    {
+        LockableGuard l(*this);
+        DrawIndexedPacket& packet = push < DrawIndexedPacket >();
+        packet.infos = &infos;
+        packet.indexes = &indexes;
+    }
+
+    void CommandBuffer::drawInstanced(const VertexInfos& infos, const IndexBufferData* indexes, const RenderHdwBuffer& instances,
+                                      std::size_t first, std::size_t count)
+    {
+        LockableGuard l(*this);
+        DrawInstancedPacket& packet = push < DrawInstancedPacket >();
+        packet.infos = &infos;
+        packet.indexes = indexes;
+        packet.instances = &instances;
+        packet.first = static_cast < std::uint32_t >(first);
+        packet.count = static_cast < std::uint32_t >(count);
+    }
+
+    void CommandBuffer::setUniform(int index, ShaderVariableType type, const void* value, std::size_t size)
+    {
+        if (!value && size)
+            throw NullError("CommandBuffer", "setUniform", "Null value passed for variable %i.", index);
+
+        LockableGuard l(*this);
+        SetUniformPacket& packet = push < SetUniformPacket >(size);
+        packet.index = static_cast < std::int32_t >(index);
+        packet.type = type;
+        packet.valueSize = static_cast < std::uint32_t >(size);
+
+        if (size)
+            std::memcpy(&packet + 1, value, size);
+    }
+
+    void CommandBuffer::bindBuffer(unsigned slot, const RenderHdwBuffer& buffer, std::size_t offset, std::size_t size)
+    {
+        LockableGuard l(*this);
+        BindBufferPacket& packet = push < BindBufferPacket >();
+        packet.buffer = &buffer;
+        packet.slot = static_cast < std::uint32_t >(slot);
+        packet.offset = offset;
+        packet.size = size;
+    }
+
+    std::size_t CommandBuffer::packetsCount() const
+    {
+        LockableGuard l(*this);
+        return mPacketsCount;
+    }
+
+    std::size_t CommandBuffer::arenaSize() const
+    {
+        LockableGuard l(*this);
+        return mArena.size();
+    }
+
+    RenderStateStats CommandBuffer::stats() const
+    {
+        LockableGuard l(*this);
+        return mStats;
+    }
+
+    void CommandBuffer::pushSubCommand(RenderCommandBase& command, int uniform)
+    {
+        // Looking for a CommandBuffer is done once here rather than for each render.
+
+        RenderCommand* asCommand = dynamic_cast < RenderCommand* >(&command);
+        SubCommandPacket& packet = push < SubCommandPacket >();
+
+        packet.command = &command;
+        packet.buffer = asCommand ? asCommand->asCommandBuffer() : nullptr;
+        packet.uniform = static_cast < std::int32_t >(uniform);
+    }
+
+    void CommandBuffer::renderSubCommand(const SubCommandPacket& packet, RenderStateTracker& tracker)
+    {
+        if (!packet.command)
+            return;
+
+        if (packet.buffer)
+        {
+            packet.buffer->prepare();
+            packet.buffer->renderWith(tracker);
+            packet.buffer->finish();
+            return;
+        }
+
+        packet.command->prepare();
+        packet.command->render();
+        packet.command->finish();
+
+        // The command bound its own state, which the tracker doesn't know.
+
+        if (packet.uniform >= 0)
+            tracker.invalidateUniform(packet.uniform);
+        else
+            tracker.invalidate();
+    }
+}
@@ -0,0 +1,181 @@
+//
+//  CommandBuffer.h
+//  atlre
+//
+//  Created by jacques tronconi on 23/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#ifndef ATL_COMMANDBUFFER_H
+#define ATL_COMMANDBUFFER_H
+
+#include "RenderCommand.h"
+#include "CommandArena.h"
+#include "CommandPacket.h"
+#include "RenderStateTracker.h"
+
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace Atl
+{
+    class CommandBuffer;
+
+    //! @brief Pointer to a CommandBuffer.
+    typedef std::shared_ptr < CommandBuffer > CommandBufferPtr;
+
+    //! @brief A RenderCommand recording plain packets in a CommandArena.
+    //!
+    //! RenderCaches check \ref RenderCommand::asCommandBuffer() and, when it isn't null, record
+    //! their draws and shader variables as packets instead of adding shared sub commands: the
+    //! packets only hold raw pointers to the data owned by the caches, so recording allocates
+    //! nothing once the arena is large enough, and touches no reference count.
+    //! \ref removeAllSubCommands() resets the arena for the next frame.
+    //!
+    //! When rendered, the buffer drops SetUniformPacket and BindBufferPacket which wouldn't
+    //! change the state remembered by its RenderStateTracker, and counts them in
+    //! \ref stats(). A CommandBuffer added as a sub command is rendered with the tracker of
+    //! the enclosing buffer, so state is filtered across the whole frame.
+    //!
+    //! The Renderer's module derives from this class and implements \ref execute() for every
+    //! packet but SubCommandPacket, which is handled here. When it registers its CommandBuffer as
+    //! the constructor of RenderCommand in the RenderCommandFactory, every RenderCommand created
+    //! with \ref Renderer::newCommand() records packets.
+    class EXPORTED CommandBuffer : public RenderCommand
+    {
+        //! @brief The packets.
+        CommandArena mArena;
+
+        //! @brief Sub commands added with \ref addSubCommand(), kept alive until the next reset.
+        RenderCommandBaseList mRetained;
+
+        //! @brief Objects added with \ref retain(), kept alive until the next reset.
+        std::vector < std::shared_ptr < const void > > mObjects;
+
+        //! @brief Number of packets recorded since the last reset.
+        std::size_t mPacketsCount;
+
+        //! @brief The state used when this buffer is rendered on its own.
+        RenderStateTracker mTracker;
+
+        //! @brief The counters of the last \ref render().
+        RenderStateStats mStats;
+
+    public:
+
+        //! @brief Constructs an empty buffer.
+        CommandBuffer(Renderer& rhs, std::size_t blockSize = CommandArena::DefaultBlockSize);
+
+        //! @brief Destructor.
+        virtual ~CommandBuffer() = default;
+
+        //! @brief Returns this.
+        virtual CommandBuffer* asCommandBuffer();
+
+        //! @brief Records a SubCommandPacket and keeps the command alive until the next reset.
+        //! Prefer \ref addCachedCommand() for commands owned by a cache.
+        virtual void addSubCommand(const RenderCommandBasePtr& subCommand);
+
+        //! @brief Records a SubCommandPacket for each command, kept alive until the next reset.
+        virtual void addSubCommands(const RenderCommandBaseList& subCommands, bool skipNulls = false);
+
+        //! @brief Removes a command added with \ref addSubCommand(). Its packets are kept but
+        //! skipped when rendering.
+        virtual void removeSubCommand(const RenderCommandBasePtr& subCommand);
+
+        //! @brief Removes every packet and resets the arena.
+        virtual void removeAllSubCommands();
+
+        //! @brief Renders every packet in order, from an unknown state.
+        virtual void render();
+
+        //! @brief Renders every packet in order, from the state known by tracker.
+        void renderWith(RenderStateTracker& tracker);
+
+        //! @brief Records a SubCommandPacket for a command which is not kept alive by the buffer.
+        //! @param uniform The index of the only uniform the command sets, or -1 if it may
+        //! change any state.
+        void addCachedCommand(RenderCommandBase& command, int uniform = -1);
+
+        //! @brief Keeps an object alive until the next reset, like the VertexInfos and the
+        //! IndexBufferData a draw packet points to.
+        void retain(const std::shared_ptr < const void >& object);
+
+        //! @brief Records a DrawPacket.
+        void draw(const VertexInfos& infos);
+
+        //! @brief Records a DrawIndexedPacket.
+        void drawIndexed(const VertexInfos& infos, const IndexBufferData& indexes);
+
+        //! @brief Records a DrawInstancedPacket. indexes may be null.
+        void drawInstanced(const VertexInfos& infos, const IndexBufferData* indexes, const RenderHdwBuffer& instances,
+                           std::size_t first, std::size_t count);
+
+        //! @brief Records a SetUniformPacket, copying size bytes of value.
+        void setUniform(int index, ShaderVariableType type, const void* value, std::size_t size);
+
+        //! @brief Records a BindBufferPacket.
+        void bindBuffer(unsigned slot, const RenderHdwBuffer& buffer, std::size_t offset, std::size_t size);
+
+        //! @brief Calls fn(packet) for each packet, in order. The buffer is locked meanwhile.
+        template < typename Function >
+        void forEachPacket(Function&& fn) const
+        {
+            LockableGuard l(*this);
+
+            mArena.forEachBlock([&fn](const char* data, std::size_t used)
+            {
+                for (std::size_t offset = 0; offset < used; )
+                {
+                    auto const& header = *reinterpret_cast < const CommandPacket* >(data + offset);
+                    offset += header.size;
+                    fn(header);
+                }
+            });
+        }
+
+        //! @brief Returns the number of packets recorded since the last reset.
+        std::size_t packetsCount() const;
+
+        //! @brief Returns the number of bytes used in the arena.
+        std::size_t arenaSize() const;
+
+        //! @brief Returns the counters of the last \ref render(), which tell how many state
+        //! changes were dropped in the frame.
+        RenderStateStats stats() const;
+
+    protected:
+
+        //! @brief Executes a packet, which is never a SubCommandPacket. Cast the packet to the
+        //! structure given by its type. SetUniformPacket and BindBufferPacket reach this
+        //! function only if they change the state; draws should check tracker's
+        //! \ref RenderStateTracker::bindVertexes() and \ref RenderStateTracker::bindIndexes()
+        //! before binding their data.
+        virtual void execute(const CommandPacket& packet, RenderStateTracker& tracker) = 0;
+
+    private:
+
+        //! @brief Records a SubCommandPacket. Must be called with the buffer locked.
+        void pushSubCommand(RenderCommandBase& command, int uniform = -1);
+
+        //! @brief Renders the command of a SubCommandPacket.
+        void renderSubCommand(const SubCommandPacket& packet, RenderStateTracker& tracker);
+
+        //! @brief Allocates a packet of type Packet, followed by extra bytes, and sets its header.
+        template < typename Packet >
+        Packet& push(std::size_t extra = 0)
+        {
+            const std::size_t size = CommandArena::AlignedSize(sizeof(Packet) + extra);
+            Packet* packet = new (mArena.allocate(size)) Packet();
+
+            packet->header.type = Packet::Type;
+            packet->header.size = static_cast < std::uint32_t >(size);
+
+            mPacketsCount++;
+            return *packet;
+        }
+    };
+}
+
+#endif // ATL_COMMANDBUFFER_H
@@ -0,0 +1,542 @@
+//
+//  CommandCapture.cpp
+//  atlre
+//
+//  Created by jacques tronconi on 26/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#include "CommandCapture.h"
+#include "CommandBuffer.h"
+#include "RenderPipeline.h"
+#include "ShaderVariableCommand.h"
+#include "VertexInfos.h"
+#include "IndexBufferData.h"
+#include "RenderHdwBuffer.h"
+#include "DrawVertexArraysCommand.h"
+#include "DrawIndexedArraysCommand.h"
+#include "DrawInstancedCommand.h"
+#include "BindBufferCommand.h"
+
+#include <algorithm>
+#include <typeinfo>
+#include <unordered_map>
+
+namespace Atl
+{
+    namespace
+    {
+        //! @brief Returns in index and generation the MemBuffer whose content buffer holds. Returns
+        //! false if buffer isn't a MemBuffer, nor a RenderHdwBuffer holding a copy of one.
+        bool SourceOf(const HardwareBuffer& buffer, std::uint64_t& index, std::uint64_t& generation)
+        {
+            if (buffer.isMemBuffer())
+            {
+                index = buffer.index();
+                generation = buffer.generation();
+                return true;
+            }
+
+            auto* hdwBuffer = dynamic_cast < const RenderHdwBuffer* >(&buffer);
+
+            if (!hdwBuffer)
+                return false;
+
+            index = hdwBuffer->relatedIndex();
+            generation = hdwBuffer->sourceGeneration();
+            return index && generation != HardwareBuffer::NoGeneration;
+        }
+
+        //! @brief Appends the type, size and content of buffer to data.
+        void AppendContent(std::string& data, const HardwareBuffer& buffer)
+        {
+            // MemBuffer::size() takes the buffer's mutex, so it is read before locking.
+
+            const std::size_t size = buffer.size();
+            HardwareBufferLockGuardCst l(buffer);
+            const void* bytes = buffer.data();
+            const std::uint8_t type = static_cast < std::uint8_t >(buffer.type());
+            const std::uint64_t written = bytes ? size : 0;
+
+            data.append(reinterpret_cast < const char* >(&type), sizeof(type));
+            data.append(reinterpret_cast < const char* >(&written), sizeof(written));
+
+            if (bytes && size)
+                data.append(static_cast < const char* >(bytes), size);
+
+            buffer.undata();
+        }
+    }
+
+    struct CommandCapture::FrameWriter
+    {
+        //! @brief A shared buffer used by the frame.
+        struct SharedUse
+        {
+            std::uint32_t sharedId;
+            std::uint64_t generation;
+            const HardwareBuffer* buffer;
+        };
+
+        //! @brief The capture.
+        CommandCapture& capture;
+
+        //! @brief The records of the frame.
+        std::string data;
+
+        //! @brief The shared buffers used by the frame. Their SharedBuffer records are written
+        //! with the frame, if their generation isn't in the file yet.
+        std::vector < SharedUse > shared;
+
+        //! @brief The ids of the objects already defined in the frame.
+        std::unordered_map < const void*, std::uint32_t > ids;
+
+        //! @brief The next id.
+        std::uint32_t nextId = 1;
+
+        template < typename T >
+        void put(const T& value)
+        {
+            data.append(reinterpret_cast < const char* >(&value), sizeof(T));
+        }
+
+        void putRecord(CaptureRecord record)
+        {
+            put(record);
+        }
+
+        void putString(const std::string& value)
+        {
+            put(static_cast < std::uint32_t >(value.size()));
+            data.append(value);
+        }
+
+        //! @brief Returns the id of object, and true if it was just given.
+        std::pair < std::uint32_t, bool > idOf(const void* object)
+        {
+            auto result = ids.emplace(object, nextId);
+
+            if (result.second)
+                nextId++;
+
+            return { result.first->second, result.second };
+        }
+
+        FrameWriter(CommandCapture& rhs)
+        : capture(rhs)
+        {
+
+        }
+
+        std::uint32_t defineBuffer(const HardwareBuffer* buffer)
+        {
+            if (!buffer)
+                return 0;
+
+            auto id = idOf(buffer);
+
+            if (!id.second)
+                return id.first;
+
+            std::uint64_t index = 0;
+            std::uint64_t generation = 0;
+
+            if (SourceOf(*buffer, index, generation))
+            {
+                const std::uint32_t sharedId = capture.sharedIdOf(index);
+
+                // Two generations of a MemBuffer drawn in the same frame can't share its id, so
+                // the second one is written in the frame.
+
+                auto it = std::find_if(shared.begin(), shared.end(), [sharedId](const SharedUse& use)
+                {
+                    return use.sharedId == sharedId;
+                });
+
+                if (it == shared.end() || it->generation == generation)
+                {
+                    if (it == shared.end())
+                        shared.push_back(SharedUse{ sharedId, generation, buffer });
+
+                    putRecord(CaptureRecord::UseSharedBuffer);
+                    put(id.first);
+                    put(sharedId);
+                    return id.first;
+                }
+            }
+
+            putRecord(CaptureRecord::Buffer);
+            put(id.first);
+            AppendContent(data, *buffer);
+            return id.first;
+        }
+
+        std::uint32_t defineInfos(const VertexInfos* infos)
+        {
+            if (!infos)
+                return 0;
+
+            auto id = idOf(infos);
+
+            if (!id.second)
+                return id.first;
+
+            // Buffers are defined first, as the VertexInfos record refers to them.
+
+            std::vector < std::pair < unsigned short, std::uint32_t > > bindings;
+
+            if (VertexBufferBindingPtr binding = infos->binding())
+            {
+                for (auto const& pair : binding->bindings())
+                    bindings.emplace_back(pair.first, defineBuffer(pair.second.get()));
+            }
+
+            VertexDeclarationPtr declaration = infos->declaration();
+            const std::size_t elementsCount = declaration ? declaration->elementsCount() : 0;
+
+            putRecord(CaptureRecord::VertexInfos);
+            put(id.first);
+            put(static_cast < std::uint64_t >(infos->baseVertex()));
+            put(static_cast < std::uint64_t >(infos->vertexesCount()));
+            put(static_cast < std::uint32_t >(elementsCount));
+
+            for (std::size_t i = 0; i < elementsCount; ++i)
+            {
+                const VertexElement& element = declaration->findElement(static_cast < unsigned >(i));
+                put(static_cast < std::uint16_t >(element.source()));
+                put(static_cast < std::uint64_t >(element.offset()));
+                put(static_cast < std::uint32_t >(element.type()));
+                putString(element.meaning());
+            }
+
+            put(static_cast < std::uint32_t >(bindings.size()));
+
+            for (auto const& pair : bindings)
+            {
+                put(static_cast < std::uint16_t >(pair.first));
+                put(pair.second);
+            }
+
+            return id.first;
+        }
+
+        std::uint32_t defineIndexes(const IndexBufferData* indexes)
+        {
+            if (!indexes)
+                return 0;
+
+            auto id = idOf(indexes);
+
+            if (!id.second)
+                return id.first;
+
+            const std::uint32_t buffer = defineBuffer(indexes->buffer().get());
+
+            putRecord(CaptureRecord::Indexes);
+            put(id.first);
+            put(static_cast < std::uint64_t >(indexes->elementsCount()));
+            put(static_cast < std::uint8_t >(indexes->type()));
+            put(buffer);
+            return id.first;
+        }
+
+        void writeUniform(int index, ShaderVariableType type, const void* value, std::size_t size)
+        {
+            putRecord(CaptureRecord::SetUniform);
+            put(static_cast < std::int32_t >(index));
+            put(static_cast < std::uint32_t >(type));
+            put(static_cast < std::uint32_t >(size));
+
+            if (value && size)
+                data.append(static_cast < const char* >(value), size);
+        }
+
+        void writeCommand(RenderCommandBase& command, int uniform)
+        {
+            if (RenderCommand* asCommand = dynamic_cast < RenderCommand* >(&command))
+            {
+                if (CommandBuffer* buffer = asCommand->asCommandBuffer())
+                {
+                    writePackets(*buffer);
+                    return;
+                }
+
+                for (const RenderCommandBasePtr& subCommand : asCommand->subCommands())
+                {
+                    if (subCommand)
+                        writeCommand(*subCommand, -1);
+                }
+
+                return;
+            }
+
+            if (auto* asVariable = dynamic_cast < ShaderVariableCommand* >(&command))
+            {
+                ShaderVariable variable = asVariable->variable();
+
+                if (!variable.isTexture() && variable.index() >= 0)
+                {
+                    writeUniform(variable.index(), variable.type(), variable.value(), variable.valueSize());
+                    return;
+                }
+            }
+
+            if (auto* asDraw = dynamic_cast < DrawVertexArraysCommand* >(&command))
+            {
+                if (VertexInfosPtr infos = asDraw->infos())
+                {
+                    writeDraw(infos.get());
+                    return;
+                }
+            }
+
+            if (auto* asDraw = dynamic_cast < DrawIndexedArraysCommand* >(&command))
+            {
+                VertexInfosPtr infos = asDraw->infos();
+                IndexBufferDataPtr indexes = asDraw->indexes();
+
+                if (infos && indexes)
+                {
+                    writeDrawIndexed(infos.get(), indexes.get());
+                    return;
+                }
+            }
+
+            if (auto* asDraw = dynamic_cast < DrawInstancedCommand* >(&command))
+            {
+                VertexInfosPtr infos = asDraw->infos();
+                RenderHdwBufferPtr instances = asDraw->instances();
+
+                if (infos && instances)
+                {
+                    writeDrawInstanced(infos.get(), asDraw->indexes().get(), instances.get(),
+                                       static_cast < std::uint32_t >(asDraw->first()),
+                                       static_cast < std::uint32_t >(asDraw->count()));
+                    return;
+                }
+            }
+
+            if (auto* asBind = dynamic_cast < BindBufferCommand* >(&command))
+            {
+                if (RenderHdwBufferPtr bound = asBind->buffer())
+                {
+                    writeBindBuffer(static_cast < std::uint32_t >(asBind->slot()), bound.get(), 
+                                    asBind->offset(), asBind->size());
+                    return;
+                }
+            }
+
+            putRecord(CaptureRecord::Opaque);
+            putString(typeid(command).name());
+            put(static_cast < std::int32_t >(uniform));
+        }
+
+        void writePackets(const CommandBuffer& buffer)
+        {
+            buffer.forEachPacket([this](const CommandPacket& header)
+            {
+                switch (header.type)
+                {
+                    case CommandPacketType::SubCommand:
+                    {
+                        auto const& packet = reinterpret_cast < const SubCommandPacket& >(header);
+
+                        if (packet.buffer)
+                            writePackets(*packet.buffer);
+                        else if (packet.command)
+                            writeCommand(*packet.command, packet.uniform);
+
+                        break;
+                    }
+
+                    case CommandPacketType::Draw:
+                    {
+                        auto const& packet = reinterpret_cast < const DrawPacket& >(header);
+                        writeDraw(packet.infos);
+                        break;
+                    }
+
+                    case CommandPacketType::DrawIndexed:
+                    {
+                        auto const& packet = reinterpret_cast < const DrawIndexedPacket& >(header);
+                        writeDrawIndexed(packet.infos, packet.indexes);
+                        break;
+                    }
+
+                    case CommandPacketType::DrawInstanced:
+                    {
+                        auto const& packet = reinterpret_cast < const DrawInstancedPacket& >(header);
+                        writeDrawInstanced(packet.infos, packet.indexes, packet.instances, packet.first, packet.count);
+                        break;
+                    }
+
+                    case CommandPacketType::SetUniform:
+                    {
+                        auto const& packet = reinterpret_cast < const SetUniformPacket& >(header);
+                        writeUniform(packet.index, packet.type, packet.value(), packet.valueSize);
+                        break;
+                    }
+
+                    case CommandPacketType::BindBuffer:
+                    {
+                        auto const& packet = reinterpret_cast < const BindBufferPacket& >(header);
+                        writeBindBuffer(packet.slot, packet.buffer, packet.offset, packet.size);
+                        break;
+                    }
+                }
+            });
+        }
+
+        void writeDraw(const VertexInfos* infos)
+        {
+            const std::uint32_t infosId = defineInfos(infos);
+
+            putRecord(CaptureRecord::Draw);
+            put(infosId);
+        }
+
+        void writeDrawIndexed(const VertexInfos* infos, const IndexBufferData* indexes)
+        {
+            const std::uint32_t infosId = defineInfos(infos);
+            const std::uint32_t indexesId = defineIndexes(indexes);
+
+            putRecord(CaptureRecord::DrawIndexed);
+            put(infosId);
+            put(indexesId);
+        }
+
+        void writeDrawInstanced(const VertexInfos* infos, const IndexBufferData* indexes, 
+                                const HardwareBuffer* instances, std::uint32_t first, std::uint32_t count)
+        {
+            const std::uint32_t infosId = defineInfos(infos);
+            const std::uint32_t indexesId = defineIndexes(indexes);
+            const std::uint32_t instancesId = defineBuffer(instances);
+
+            putRecord(CaptureRecord::DrawInstanced);
+            put(infosId);
+            put(indexesId);
+            put(instancesId);
+            put(first);
+            put(count);
+        }
+
+        void writeBindBuffer(std::uint32_t slot, const HardwareBuffer* buffer, std::size_t offset, std::size_t size)
+        {
+            const std::uint32_t bufferId = defineBuffer(buffer);
+
+            putRecord(CaptureRecord::BindBuffer);
+            put(slot);
+            put(bufferId);
+            put(static_cast < std::uint64_t >(offset));
+            put(static_cast < std::uint64_t >(size));
+        }
+    };
+
+    CommandCapture::CommandCapture(const std::string& filename)
+    : mStream(filename, std::ios::binary | std::ios::trunc), mFilename(filename), mFramesCount(0), mBytesCount(0)
+    {
+        if (!mStream)
+            throw CommandCaptureInvalid("CommandCapture", "CommandCapture", "Cannot open file %s.", filename.data());
+
+        mStream.write(reinterpret_cast < const char* >(&Magic), sizeof(Magic));
+        mStream.write(reinterpret_cast < const char* >(&Version), sizeof(Version));
+        mBytesCount = sizeof(Magic) + sizeof(Version);
+    }
+
+    CommandCapture::~CommandCapture()
+    {
+        close();
+    }
+
+    void CommandCapture::capture(RenderCommand& command, const RenderPipeline* pipeline)
+    {
+        // The frame is serialized without the lock, so frames captured on several threads only
+        // wait for each other when written.
+
+        FrameWriter writer(*this);
+
+        if (pipeline)
+        {
+            writer.putRecord(CaptureRecord::Pipeline);
+            writer.putString(pipeline->name());
+        }
+
+        writer.writeCommand(command, -1);
+
+        std::lock_guard l(mMutex);
+
+        if (!mStream.is_open())
+            return;
+
+        // The shared buffers are written here, in the order of the file, so a frame written
+        // before the one which defined a generation doesn't rely on it. Their content may be
+        // read here as the command keeps the buffers alive until it is captured.
+
+        std::string shared;
+
+        for (const FrameWriter::SharedUse& use : writer.shared)
+        {
+            auto it = mSharedGenerations.find(use.sharedId);
+
+            if (it != mSharedGenerations.end() && it->second == use.generation)
+                continue;
+
+            const CaptureRecord sharedRecord = CaptureRecord::SharedBuffer;
+            shared.append(reinterpret_cast < const char* >(&sharedRecord), sizeof(sharedRecord));
+            shared.append(reinterpret_cast < const char* >(&use.sharedId), sizeof(use.sharedId));
+            AppendContent(shared, *use.buffer);
+
+            mSharedGenerations[use.sharedId] = use.generation;
+        }
+
+        const CaptureRecord record = CaptureRecord::Frame;
+        const std::uint64_t index = mFramesCount;
+        const std::uint64_t size = shared.size() + writer.data.size();
+
+        mStream.write(reinterpret_cast < const char* >(&record), sizeof(record));
+        mStream.write(reinterpret_cast < const char* >(&index), sizeof(index));
+        mStream.write(reinterpret_cast < const char* >(&size), sizeof(size));
+        mStream.write(shared.data(), shared.size());
+        mStream.write(writer.data.data(), writer.data.size());
+
+        if (!mStream)
+            throw CommandCaptureInvalid("CommandCapture", "capture", "Cannot write frame %i in %s.",
+                                        static_cast < int >(index), mFilename.data());
+
+        mFramesCount++;
+        mBytesCount += sizeof(record) + sizeof(index) + sizeof(size) + size;
+    }
+
+    void CommandCapture::close()
+    {
+        std::lock_guard l(mMutex);
+
+        if (mStream.is_open())
+            mStream.close();
+    }
+
+    const std::string& CommandCapture::filename() const
+    {
+        return mFilename;
+    }
+
+    std::uint64_t CommandCapture::framesCount() const
+    {
+        std::lock_guard l(mMutex);
+        return mFramesCount;
+    }
+
+    std::uint64_t CommandCapture::bytesCount() const
+    {
+        std::lock_guard l(mMutex);
+        return mBytesCount;
+    }
+
+    std::uint32_t CommandCapture::sharedIdOf(std::uint64_t index)
+    {
+        std::lock_guard l(mSharedIdsMutex);
+
+        auto result = mSharedIds.emplace(index, static_cast < std::uint32_t >(mSharedIds.size() + 1));
+        return result.first->second;
+    }
+}
@@ -0,0 +1,183 @@
+//
+//  CommandCapture.h
+//  atlre
+//
+//  Created by jacques tronconi on 26/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#ifndef ATL_COMMANDCAPTURE_H
+#define ATL_COMMANDCAPTURE_H
+
+#include "Platform.h"
+#include "Error.h"
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace Atl
+{
+    class RenderCommand;
+    class RenderPipeline;
+
+    //! @brief Thrown when a capture file cannot be written or read.
+    struct EXPORTED CommandCaptureInvalid : public Error
+    { using Error::Error; };
+
+    //! @brief Enumerates the records of a capture file.
+    //!
+    //! A capture starts with \ref CommandCapture::Magic and \ref CommandCapture::Version, as
+    //! two std::uint32_t. Then each frame is a Frame record: its index and its size in bytes,
+    //! as two std::uint64_t, followed by the records of the frame. Every value is written in
+    //! the byte order of the capturing machine, and strings are a std::uint32_t size followed
+    //! by their characters.
+    //!
+    //! Buffers, VertexInfos and IndexBufferData are defined in the frame before the first
+    //! record using them, and referred to by their id, starting at one. Zero is no object.
+    //!
+    //! A buffer holding a copy of a MemBuffer is not written in every frame using it: the
+    //! capture gives each MemBuffer a shared id, and writes its content in a SharedBuffer
+    //! record only in the first frame using a generation of the MemBuffer. The frames then
+    //! bind their buffer id to the shared id with a UseSharedBuffer record. So the frames
+    //! must be replayed in order.
+    enum class CaptureRecord : std::uint8_t
+    {
+        //! @brief A frame: index, size, records.
+        Frame,
+
+        //! @brief The pipeline bound for the frame: name.
+        Pipeline,
+
+        //! @brief A buffer: id, HardwareBufferType, size, bytes.
+        Buffer,
+
+        //! @brief A VertexInfos: id, base vertex, vertexes count, elements count, then for each
+        //! element its source, offset, VertexElementType and meaning, then bindings count, and
+        //! for each binding its source and buffer id.
+        VertexInfos,
+
+        //! @brief An IndexBufferData: id, elements count, IndexType, buffer id.
+        Indexes,
+
+        //! @brief A DrawPacket: infos id.
+        Draw,
+
+        //! @brief A DrawIndexedPacket: infos id, indexes id.
+        DrawIndexed,
+
+        //! @brief A DrawInstancedPacket: infos id, indexes id, instances id, first, count.
+        DrawInstanced,
+
+        //! @brief A SetUniformPacket: index, ShaderVariableType, size, bytes.
+        SetUniform,
+
+        //! @brief A BindBufferPacket: slot, buffer id, offset, size.
+        BindBuffer,
+
+        //! @brief A command which cannot be captured: its type name, and the index of the only
+        //! uniform it sets or -1.
+        Opaque,
+
+        //! @brief A buffer kept for the next frames, replacing the previous content of its
+        //! shared id: shared id, HardwareBufferType, size, bytes. Written at the start of a
+        //! frame, before its other records.
+        SharedBuffer,
+
+        //! @brief A buffer of the frame which is a shared buffer: id, shared id.
+        UseSharedBuffer
+    };
+
+    //! @brief Writes the commands rendered by a Renderer in a capture file.
+    //!
+    //! Set the capture with \ref Renderer::setCapture(): each command rendered by the Renderer
+    //! is then written as a frame, right before it is prepared. Packets of a CommandBuffer are
+    //! written with the content of the buffers they use, so the frame is replayed without the
+    //! scene with \ref CommandReplay. A plain RenderCommand is walked through its sub commands,
+    //! a ShaderVariableCommand is written as a SetUniform record, and the draw and
+    //! BindBufferCommands as the records of the matching packets. Other commands are backend
+    //! specific: they are written as Opaque records, which are counted but not replayed.
+    //!
+    //! Frames may be captured from several threads. Each frame is serialized in memory, and
+    //! written to the file at once.
+    class EXPORTED CommandCapture
+    {
+    public:
+
+        //! @brief The first four bytes of a capture, 'ATLC'.
+        static constexpr std::uint32_t Magic = 0x434C5441;
+
+        //! @brief The version of the format.
+        static constexpr std::uint32_t Version = 2;
+
+    private:
+
+        //! @brief The serialization of one frame.
+        struct FrameWriter;
+
+        //! @brief The file.
+        std::ofstream mStream;
+
+        //! @brief The filename.
+        std::string mFilename;
+
+        //! @brief Number of frames written.
+        std::uint64_t mFramesCount;
+
+        //! @brief Number of bytes written.
+        std::uint64_t mBytesCount;
+
+        //! @brief The shared id of each MemBuffer, by index.
+        std::unordered_map < std::uint64_t, std::uint32_t > mSharedIds;
+
+        //! @brief The generation written for each shared id.
+        std::unordered_map < std::uint32_t, std::uint64_t > mSharedGenerations;
+
+        //! @brief Protects the file and mSharedGenerations.
+        mutable std::mutex mMutex;
+
+        //! @brief Protects mSharedIds.
+        std::mutex mSharedIdsMutex;
+
+    public:
+
+        //! @brief Opens filename and writes the header.
+        //! @throw CommandCaptureInvalid if the file cannot be opened.
+        CommandCapture(const std::string& filename);
+
+        //! @brief Closes the file.
+        ~CommandCapture();
+
+        CommandCapture(const CommandCapture&) = delete;
+        CommandCapture& operator = (const CommandCapture&) = delete;
+
+        //! @brief Writes command as a new frame.
+        //! @param pipeline The pipeline bound before the command, or null.
+        void capture(RenderCommand& command, const RenderPipeline* pipeline = nullptr);
+
+        //! @brief Flushes and closes the file. Frames captured afterwards are dropped.
+        void close();
+
+        //! @brief Returns the filename.
+        const std::string& filename() const;
+
+        //! @brief Returns the number of frames written.
+        std::uint64_t framesCount() const;
+
+        //! @brief Returns the number of bytes written, header included.
+        std::uint64_t bytesCount() const;
+
+    private:
+
+        //! @brief Returns the shared id of the MemBuffer of the given index.
+        std::uint32_t sharedIdOf(std::uint64_t index);
+    };
+
+    //! @brief Pointer to a CommandCapture.
+    typedef std::shared_ptr < CommandCapture > CommandCapturePtr;
+}
+
+#endif // ATL_COMMANDCAPTURE_H
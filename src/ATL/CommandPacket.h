@@ -0,0 +1,149 @@
+//
+//  CommandPacket.h
+//  atlre
+//
+//  Created by jacques tronconi on 23/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#ifndef ATL_COMMANDPACKET_H
+#define ATL_COMMANDPACKET_H
+
+#include "Platform.h"
+#include "ShaderVariable.h"
+
+#include <cstdint>
+#include <type_traits>
+
+namespace Atl
+{
+    class RenderCommandBase;
+    class CommandBuffer;
+    class VertexInfos;
+    class IndexBufferData;
+    class RenderHdwBuffer;
+
+    //! @brief Enumerates the packets recorded in a CommandBuffer.
+    enum class CommandPacketType : std::uint16_t
+    {
+        //! @brief Renders a RenderCommandBase. \see SubCommandPacket.
+        SubCommand,
+
+        //! @brief Draws a data set. \see DrawPacket.
+        Draw,
+
+        //! @brief Draws a data set with indexes. \see DrawIndexedPacket.
+        DrawIndexed,
+
+        //! @brief Draws a data set once per instance. \see DrawInstancedPacket.
+        DrawInstanced,
+
+        //! @brief Sets the value of a shader variable. \see SetUniformPacket.
+        SetUniform,
+
+        //! @brief Binds a range of a buffer to a slot. \see BindBufferPacket.
+        BindBuffer
+    };
+
+    //! @brief The header of every packet. Packets are plain structures starting with this header,
+    //! stored one after the other in a CommandArena. The objects they point to are not owned by
+    //! the packet and must stay alive until the CommandBuffer is rendered or reset.
+    struct CommandPacket
+    {
+        //! @brief The type of the packet.
+        CommandPacketType type;
+
+        //! @brief The size of the packet in the arena, including what follows its structure.
+        std::uint32_t size;
+    };
+
+    //! @brief Renders a RenderCommandBase with its prepare(), render() and finish() functions.
+    struct SubCommandPacket
+    {
+        static constexpr CommandPacketType Type = CommandPacketType::SubCommand;
+
+        CommandPacket header;
+        RenderCommandBase* command;
+
+        //! @brief The command as a CommandBuffer, rendered with the state of the enclosing
+        //! buffer, or null.
+        CommandBuffer* buffer;
+
+        //! @brief The index of the only uniform set by the command, or -1 if the command may
+        //! change any state.
+        std::int32_t uniform;
+    };
+
+    //! @brief Draws every vertex of a data set. \see DrawVertexArraysCommand.
+    struct DrawPacket
+    {
+        static constexpr CommandPacketType Type = CommandPacketType::Draw;
+
+        CommandPacket header;
+        const VertexInfos* infos;
+    };
+
+    //! @brief Draws a data set with indexes. \see DrawIndexedArraysCommand.
+    struct DrawIndexedPacket
+    {
+        static constexpr CommandPacketType Type = CommandPacketType::DrawIndexed;
+
+        CommandPacket header;
+        const VertexInfos* infos;
+        const IndexBufferData* indexes;
+    };
+
+    //! @brief Draws a data set once per instance. \see DrawInstancedCommand.
+    struct DrawInstancedPacket
+    {
+        static constexpr CommandPacketType Type = CommandPacketType::DrawInstanced;
+
+        CommandPacket header;
+        const VertexInfos* infos;
+
+        //! @brief The indexes, or null to draw the vertexes in order.
+        const IndexBufferData* indexes;
+
+        const RenderHdwBuffer* instances;
+        std::uint32_t first;
+        std::uint32_t count;
+    };
+
+    //! @brief Sets the value of a shader variable. The value is copied in the arena, right after
+    //! this structure, so it may change once recorded.
+    struct SetUniformPacket
+    {
+        static constexpr CommandPacketType Type = CommandPacketType::SetUniform;
+
+        CommandPacket header;
+        std::int32_t index;
+        ShaderVariableType type;
+
+        //! @brief The size of the value, in bytes.
+        std::uint32_t valueSize;
+
+        //! @brief Returns the value.
+        const void* value() const { return this + 1; }
+    };
+
+    //! @brief Binds size bytes of a buffer, from offset, to a slot.
+    struct BindBufferPacket
+    {
+        static constexpr CommandPacketType Type = CommandPacketType::BindBuffer;
+
+        CommandPacket header;
+        const RenderHdwBuffer* buffer;
+        std::uint32_t slot;
+        std::size_t offset;
+        std::size_t size;
+    };
+
+    static_assert(std::is_standard_layout < SubCommandPacket >::value && std::is_trivially_copyable < SubCommandPacket >::value, "Packets must be POD.");
+    static_assert(std::is_standard_layout < DrawPacket >::value && std::is_trivially_copyable < DrawPacket >::value, "Packets must be POD.");
+    static_assert(std::is_standard_layout < DrawIndexedPacket >::value && std::is_trivially_copyable < DrawIndexedPacket >::value, "Packets must be POD.");
+    static_assert(std::is_standard_layout < DrawInstancedPacket >::value && std::is_trivially_copyable < DrawInstancedPacket >::value, "Packets must be POD.");
+    static_assert(std::is_standard_layout < SetUniformPacket >::value && std::is_trivially_copyable < SetUniformPacket >::value, "Packets must be POD.");
+    static_assert(std::is_standard_layout < BindBufferPacket >::value && std::is_trivially_copyable < BindBufferPacket >::value, "Packets must be POD.");
+}
+
+#endif // ATL_COMMANDPACKET_H
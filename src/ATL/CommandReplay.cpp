@@ -0,0 +1,462 @@
+//
+//  CommandReplay.cpp
+//  atlre
+//
+//  Created by jacques tronconi on 26/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#include "CommandReplay.h"
+#include "CommandBuffer.h"
+#include "Renderer.h"
+#include "ShaderVariableCommand.h"
+#include "DrawVertexArraysCommand.h"
+#include "DrawIndexedArraysCommand.h"
+#include "DrawInstancedCommand.h"
+#include "BindBufferCommand.h"
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+
+namespace Atl
+{
+    namespace
+    {
+        //! @brief Reads the values of a frame, and throws if there are not enough bytes.
+        struct RecordReader
+        {
+            const char* cursor;
+            const char* end;
+
+            RecordReader(const std::string& data)
+            : cursor(data.data()), end(data.data() + data.size())
+            {
+
+            }
+
+            bool atEnd() const
+            {
+                return cursor >= end;
+            }
+
+            const char* bytes(std::size_t size)
+            {
+                if (static_cast < std::size_t >(end - cursor) < size)
+                    throw CommandCaptureInvalid("CommandReplay", "prepare", "Truncated record.");
+
+                const char* result = cursor;
+                cursor += size;
+                return result;
+            }
+
+            template < typename T >
+            T get()
+            {
+                T value;
+                std::memcpy(&value, bytes(sizeof(T)), sizeof(T));
+                return value;
+            }
+
+            std::string getString()
+            {
+                const std::uint32_t size = get < std::uint32_t >();
+                return std::string(bytes(size), size);
+            }
+        };
+
+        //! @brief Stores value at id in list.
+        template < typename T >
+        void StoreAt(std::vector < T >& list, std::uint32_t id, const T& value)
+        {
+            if (!id)
+                throw CommandCaptureInvalid("CommandReplay", "prepare", "Null id defined.");
+
+            if (list.size() < id)
+                list.resize(id);
+
+            list[id - 1] = value;
+        }
+
+        //! @brief Returns the object at id in list, or null if id is zero.
+        template < typename T >
+        T FindAt(const std::vector < T >& list, std::uint32_t id)
+        {
+            if (!id)
+                return T();
+
+            if (list.size() < id || !list[id - 1])
+                throw CommandCaptureInvalid("CommandReplay", "prepare", "Object %i used before its definition.",
+                                            static_cast < int >(id));
+
+            return list[id - 1];
+        }
+
+        //! @brief Reads the type, size and content of buffer id, and creates it in memBuffer and
+        //! hdwBuffer.
+        void ReadBuffer(Renderer& renderer, RecordReader& reader, std::uint32_t id, 
+                        MemBufferPtr& memBuffer, RenderHdwBufferPtr& hdwBuffer)
+        {
+            const auto type = static_cast < HardwareBufferType >(reader.get < std::uint8_t >());
+            const auto size = static_cast < std::size_t >(reader.get < std::uint64_t >());
+            const char* bytes = reader.bytes(size);
+
+            memBuffer = std::make_shared < MemBuffer >(type);
+            memBuffer->allocate(size, size ? bytes : nullptr);
+
+            hdwBuffer = renderer.hdwBufferManager().findOrCreateRelated(memBuffer);
+
+            if (!hdwBuffer)
+                throw NullError("CommandReplay", "prepare", "Null RenderHdwBuffer for buffer %i.",
+                                static_cast < int >(id));
+        }
+
+        //! @brief Returns the object at id in list, and throws if id is zero.
+        template < typename T >
+        T FindRequiredAt(const std::vector < T >& list, std::uint32_t id)
+        {
+            if (!id)
+                throw CommandCaptureInvalid("CommandReplay", "prepare", "Null object used.");
+
+            return FindAt(list, id);
+        }
+    }
+
+    CommandReplay::CommandReplay()
+    : mRenderer(nullptr)
+    {
+
+    }
+
+    void CommandReplay::load(const std::string& filename)
+    {
+        std::ifstream stream(filename, std::ios::binary);
+
+        if (!stream)
+            throw CommandCaptureInvalid("CommandReplay", "load", "Cannot open file %s.", filename.data());
+
+        load(stream);
+    }
+
+    void CommandReplay::load(std::istream& stream)
+    {
+        std::uint32_t magic = 0;
+        std::uint32_t version = 0;
+
+        stream.read(reinterpret_cast < char* >(&magic), sizeof(magic));
+        stream.read(reinterpret_cast < char* >(&version), sizeof(version));
+
+        if (!stream || magic != CommandCapture::Magic)
+            throw CommandCaptureInvalid("CommandReplay", "load", "Not a capture.");
+
+        if (version != CommandCapture::Version)
+            throw CommandCaptureInvalid("CommandReplay", "load", "Capture version %i is not supported.",
+                                        static_cast < int >(version));
+
+        std::vector < Frame > frames;
+        CaptureRecord record;
+
+        while (stream.read(reinterpret_cast < char* >(&record), sizeof(record)))
+        {
+            if (record != CaptureRecord::Frame)
+                throw CommandCaptureInvalid("CommandReplay", "load", "Frame record expected.");
+
+            Frame frame;
+            std::uint64_t size = 0;
+
+            stream.read(reinterpret_cast < char* >(&frame.index), sizeof(frame.index));
+            stream.read(reinterpret_cast < char* >(&size), sizeof(size));
+
+            if (!stream)
+                throw CommandCaptureInvalid("CommandReplay", "load", "Truncated frame header.");
+
+            frame.data.resize(size);
+            stream.read(&frame.data[0], static_cast < std::streamsize >(size));
+
+            if (!stream)
+                throw CommandCaptureInvalid("CommandReplay", "load", "Truncated frame %i.",
+                                            static_cast < int >(frame.index));
+
+            frames.push_back(std::move(frame));
+        }
+
+        mFrames = std::move(frames);
+        mRenderer = nullptr;
+    }
+
+    std::size_t CommandReplay::framesCount() const
+    {
+        return mFrames.size();
+    }
+
+    void CommandReplay::prepare(Renderer& renderer)
+    {
+        mSharedMemBuffers.clear();
+        mSharedBuffers.clear();
+
+        for (Frame& frame : mFrames)
+            prepare(renderer, frame);
+
+        mRenderer = &renderer;
+    }
+
+    CommandReplayStats CommandReplay::replay(RenderTarget& target, unsigned loops)
+    {
+        if (!mRenderer)
+            throw NullError("CommandReplay", "replay", "No Renderer prepared.");
+
+        typedef std::chrono::high_resolution_clock Clock;
+
+        CommandReplayStats stats;
+        const Clock::time_point start = Clock::now();
+
+        for (unsigned loop = 0; loop < loops; ++loop)
+        {
+            for (Frame& frame : mFrames)
+            {
+                if (frame.pass)
+                    mRenderer->render(target, *frame.pass).get();
+                else
+                    mRenderer->render(target, *frame.command).get();
+
+                stats.frames++;
+                stats.records += frame.records;
+                stats.opaques += frame.opaques;
+            }
+        }
+
+        stats.seconds = std::chrono::duration < double >(Clock::now() - start).count();
+        return stats;
+    }
+
+    void CommandReplay::prepare(Renderer& renderer, Frame& frame)
+    {
+        frame.records = 0;
+        frame.opaques = 0;
+        frame.pass = nullptr;
+        frame.memBuffers.clear();
+        frame.buffers.clear();
+        frame.infos.clear();
+        frame.indexes.clear();
+
+        frame.command = renderer.newCommand < RenderCommand >();
+
+        if (!frame.command)
+            throw NullError("CommandReplay", "prepare", "Null RenderCommand created.");
+
+        CommandBuffer* buffer = frame.command->asCommandBuffer();
+        RecordReader reader(frame.data);
+
+        while (!reader.atEnd())
+        {
+            const CaptureRecord record = reader.get < CaptureRecord >();
+
+            switch (record)
+            {
+                case CaptureRecord::Pipeline:
+                {
+                    const std::string name = reader.getString();
+                    RenderPipelinePtr pipeline = renderer.pipelineManager().findName(name);
+
+                    if (pipeline)
+                        frame.pass = RenderPass::New(renderer, name, pipeline, frame.command);
+
+                    break;
+                }
+
+                case CaptureRecord::Buffer:
+                {
+                    const auto id = reader.get < std::uint32_t >();
+                    MemBufferPtr memBuffer;
+                    RenderHdwBufferPtr hdwBuffer;
+
+                    ReadBuffer(renderer, reader, id, memBuffer, hdwBuffer);
+                    StoreAt(frame.memBuffers, id, memBuffer);
+                    StoreAt(frame.buffers, id, hdwBuffer);
+                    break;
+                }
+
+                case CaptureRecord::SharedBuffer:
+                {
+                    const auto sharedId = reader.get < std::uint32_t >();
+                    MemBufferPtr memBuffer;
+                    RenderHdwBufferPtr hdwBuffer;
+
+                    ReadBuffer(renderer, reader, sharedId, memBuffer, hdwBuffer);
+                    StoreAt(mSharedMemBuffers, sharedId, memBuffer);
+                    StoreAt(mSharedBuffers, sharedId, hdwBuffer);
+                    break;
+                }
+
+                case CaptureRecord::UseSharedBuffer:
+                {
+                    const auto id = reader.get < std::uint32_t >();
+                    const auto sharedId = reader.get < std::uint32_t >();
+
+                    StoreAt(frame.memBuffers, id, FindRequiredAt(mSharedMemBuffers, sharedId));
+                    StoreAt(frame.buffers, id, FindRequiredAt(mSharedBuffers, sharedId));
+                    break;
+                }
+
+                case CaptureRecord::VertexInfos:
+                {
+                    const auto id = reader.get < std::uint32_t >();
+                    VertexInfosPtr infos = VertexInfos::New();
+
+                    infos->setBaseVertex(static_cast < std::size_t >(reader.get < std::uint64_t >()));
+                    infos->setVertexesCount(static_cast < std::size_t >(reader.get < std::uint64_t >()));
+
+                    const auto elementsCount = reader.get < std::uint32_t >();
+
+                    for (std::uint32_t i = 0; i < elementsCount; ++i)
+                    {
+                        const auto source = reader.get < std::uint16_t >();
+                        const auto offset = static_cast < std::size_t >(reader.get < std::uint64_t >());
+                        const auto type = static_cast < VertexElementType >(reader.get < std::uint32_t >());
+                        infos->addElement(source, offset, type, reader.getString());
+                    }
+
+                    const auto bindingsCount = reader.get < std::uint32_t >();
+
+                    for (std::uint32_t i = 0; i < bindingsCount; ++i)
+                    {
+                        const auto source = reader.get < std::uint16_t >();
+                        infos->binding()->set(source, FindAt(frame.buffers, reader.get < std::uint32_t >()));
+                    }
+
+                    StoreAt(frame.infos, id, infos);
+                    break;
+                }
+
+                case CaptureRecord::Indexes:
+                {
+                    const auto id = reader.get < std::uint32_t >();
+                    const auto count = static_cast < std::size_t >(reader.get < std::uint64_t >());
+                    const auto type = static_cast < IndexType >(reader.get < std::uint8_t >());
+                    RenderHdwBufferPtr indexBuffer = FindAt(frame.buffers, reader.get < std::uint32_t >());
+
+                    StoreAt(frame.indexes, id, IndexBufferData::New(count, indexBuffer, type));
+                    break;
+                }
+
+                case CaptureRecord::Draw:
+                {
+                    VertexInfosPtr infos = FindRequiredAt(frame.infos, reader.get < std::uint32_t >());
+
+                    if (buffer)
+                        buffer->draw(*infos);
+
+                    else
+                    {
+                        DrawVertexArraysCommandPtr command = renderer.newCommand < DrawVertexArraysCommand >();
+                        command->construct(infos);
+                        frame.command->addSubCommand(command);
+                    }
+
+                    frame.records++;
+                    break;
+                }
+
+                case CaptureRecord::DrawIndexed:
+                {
+                    VertexInfosPtr infos = FindRequiredAt(frame.infos, reader.get < std::uint32_t >());
+                    IndexBufferDataPtr indexes = FindRequiredAt(frame.indexes, reader.get < std::uint32_t >());
+
+                    if (buffer)
+                        buffer->drawIndexed(*infos, *indexes);
+
+                    else
+                    {
+                        DrawIndexedArraysCommandPtr command = renderer.newCommand < DrawIndexedArraysCommand >();
+                        command->construct(infos, indexes);
+                        frame.command->addSubCommand(command);
+                    }
+
+                    frame.records++;
+                    break;
+                }
+
+                case CaptureRecord::DrawInstanced:
+                {
+                    VertexInfosPtr infos = FindRequiredAt(frame.infos, reader.get < std::uint32_t >());
+                    IndexBufferDataPtr indexes = FindAt(frame.indexes, reader.get < std::uint32_t >());
+                    RenderHdwBufferPtr instances = FindRequiredAt(frame.buffers, reader.get < std::uint32_t >());
+                    const auto first = reader.get < std::uint32_t >();
+                    const auto count = reader.get < std::uint32_t >();
+
+                    if (buffer)
+                        buffer->drawInstanced(*infos, indexes.get(), *instances, first, count);
+
+                    else
+                    {
+                        DrawInstancedCommandPtr command = renderer.newCommand < DrawInstancedCommand >();
+                        command->construct(infos, indexes, instances, first, count);
+                        frame.command->addSubCommand(command);
+                    }
+
+                    frame.records++;
+                    break;
+                }
+
+                case CaptureRecord::SetUniform:
+                {
+                    const auto index = reader.get < std::int32_t >();
+                    const auto type = static_cast < ShaderVariableType >(reader.get < std::uint32_t >());
+                    const auto size = reader.get < std::uint32_t >();
+                    const char* value = reader.bytes(size);
+
+                    if (buffer)
+                        buffer->setUniform(index, type, value, size);
+
+                    else
+                    {
+                        const std::size_t typeSize = ShaderVariable::SizeOfType(type);
+                        const unsigned count = typeSize ? static_cast < unsigned >(size / typeSize) : 1;
+
+                        ShaderVariableCommandPtr command = renderer.newCommand < ShaderVariableCommand >();
+                        command->setShaderVariable(ShaderVariable("", index, value, type, count));
+                        frame.command->addSubCommand(command);
+                    }
+
+                    frame.records++;
+                    break;
+                }
+
+                case CaptureRecord::BindBuffer:
+                {
+                    const auto slot = reader.get < std::uint32_t >();
+                    RenderHdwBufferPtr bound = FindRequiredAt(frame.buffers, reader.get < std::uint32_t >());
+                    const auto offset = static_cast < std::size_t >(reader.get < std::uint64_t >());
+                    const auto size = static_cast < std::size_t >(reader.get < std::uint64_t >());
+
+                    if (buffer)
+                        buffer->bindBuffer(slot, *bound, offset, size);
+
+                    else
+                    {
+                        BindBufferCommandPtr command = renderer.newCommand < BindBufferCommand >();
+                        command->construct(slot, bound, offset, size);
+                        frame.command->addSubCommand(command);
+                    }
+
+                    frame.records++;
+                    break;
+                }
+
+                case CaptureRecord::Opaque:
+                {
+                    // The command was backend specific: it cannot be created again.
+
+                    reader.getString();
+                    reader.get < std::int32_t >();
+                    frame.opaques++;
+                    break;
+                }
+
+                default:
+                    throw CommandCaptureInvalid("CommandReplay", "prepare", "Unknown record %i in frame %i.",
+                                                static_cast < int >(record), static_cast < int >(frame.index));
+            }
+        }
+    }
+}
@@ -0,0 +1,130 @@
+//
+//  CommandReplay.h
+//  atlre
+//
+//  Created by jacques tronconi on 26/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#ifndef ATL_COMMANDREPLAY_H
+#define ATL_COMMANDREPLAY_H
+
+#include "CommandCapture.h"
+#include "RenderCommand.h"
+#include "RenderPipeline.h"
+#include "RenderPass.h"
+#include "RenderHdwBuffer.h"
+#include "VertexInfos.h"
+#include "IndexBufferData.h"
+
+#include <string>
+#include <vector>
+
+namespace Atl
+{
+    class RenderTarget;
+
+    //! @brief The counters of \ref CommandReplay::replay().
+    struct CommandReplayStats
+    {
+        //! @brief Number of frames submitted.
+        std::uint64_t frames = 0;
+
+        //! @brief Number of records submitted, Opaque records excluded.
+        std::uint64_t records = 0;
+
+        //! @brief Number of Opaque records, which were not submitted.
+        std::uint64_t opaques = 0;
+
+        //! @brief Time spent in Renderer::render(), in seconds.
+        double seconds = 0.0;
+
+        //! @brief Returns the number of frames submitted per second.
+        double framesPerSecond() const { return seconds > 0.0 ? frames / seconds : 0.0; }
+
+        //! @brief Returns the number of records submitted per second.
+        double recordsPerSecond() const { return seconds > 0.0 ? records / seconds : 0.0; }
+    };
+
+    //! @brief Submits the frames of a capture file to a Renderer.
+    //!
+    //! \ref load() reads a file written by \ref CommandCapture. \ref prepare() then creates,
+    //! for a Renderer, the buffers of each frame and records its command: a CommandBuffer if
+    //! the Renderer creates one for RenderCommand, and sub commands created with
+    //! \ref Renderer::newCommand() otherwise. This is done once, so \ref replay() only measures
+    //! the submission of the frames with \ref Renderer::render(), which is what the backend
+    //! costs without the scene. The frames are prepared in order, as a frame may use the
+    //! shared buffers defined by the previous ones.
+    class EXPORTED CommandReplay
+    {
+        //! @brief A frame of the capture.
+        struct Frame
+        {
+            //! @brief The index of the frame when captured.
+            std::uint64_t index = 0;
+
+            //! @brief The records of the frame.
+            std::string data;
+
+            //! @brief Number of records, Opaque records excluded.
+            std::uint64_t records = 0;
+
+            //! @brief Number of Opaque records.
+            std::uint64_t opaques = 0;
+
+            //! @brief The command recorded by \ref prepare().
+            RenderCommandPtr command;
+
+            //! @brief The pass rendering command with the pipeline found in the Renderer, or
+            //! null if the frame has no pipeline or the Renderer doesn't know it.
+            RenderPassPtr pass;
+
+            //! @brief The objects of the frame, by id minus one. The packets of a CommandBuffer
+            //! don't keep them alive.
+            std::vector < MemBufferPtr > memBuffers;
+            std::vector < RenderHdwBufferPtr > buffers;
+            std::vector < VertexInfosPtr > infos;
+            std::vector < IndexBufferDataPtr > indexes;
+        };
+
+        //! @brief The frames loaded.
+        std::vector < Frame > mFrames;
+
+        //! @brief The current content of each shared buffer, by shared id minus one. The frames
+        //! using a shared buffer keep it alive once it is replaced.
+        std::vector < MemBufferPtr > mSharedMemBuffers;
+        std::vector < RenderHdwBufferPtr > mSharedBuffers;
+
+        //! @brief The Renderer given to \ref prepare(), or null.
+        Renderer* mRenderer;
+
+    public:
+
+        //! @brief Constructs an empty replay.
+        CommandReplay();
+
+        //! @brief Loads the frames of a capture file, and forgets the previous ones.
+        //! @throw CommandCaptureInvalid if the file cannot be read or is not a capture.
+        void load(const std::string& filename);
+
+        //! @brief Loads the frames of a capture, and forgets the previous ones.
+        void load(std::istream& stream);
+
+        //! @brief Returns the number of frames loaded.
+        std::size_t framesCount() const;
+
+        //! @brief Creates the objects and the command of every frame for renderer.
+        void prepare(Renderer& renderer);
+
+        //! @brief Renders every frame in target, loops times, and returns the counters.
+        //! \ref prepare() must have been called.
+        CommandReplayStats replay(RenderTarget& target, unsigned loops = 1);
+
+    private:
+
+        //! @brief Creates the objects and the command of frame.
+        void prepare(Renderer& renderer, Frame& frame);
+    };
+}
+
+#endif // ATL_COMMANDREPLAY_H
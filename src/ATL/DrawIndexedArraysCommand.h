@@ -24,6 +24,12 @@ namespace Atl
 
         //! @brief Constructs the command.
         virtual void construct(const VertexInfosPtr& infos, const IndexBufferDataPtr& indexes) = 0;
+
+        //! @brief Returns the data set given to \ref construct().
+        virtual VertexInfosPtr infos() const = 0;
+
+        //! @brief Returns the indexes given to \ref construct().
+        virtual IndexBufferDataPtr indexes() const = 0;
     };
 
     //! @brief Defines a Pointer to the \ref DrawVertexArraysCommand.
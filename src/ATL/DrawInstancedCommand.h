@@ -0,0 +1,69 @@
+//
+//  DrawInstancedCommand.h
+//  atlre
+//
+//  Created by jacques tronconi on 21/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#ifndef ATL_DRAWINSTANCEDCOMMAND_H
+#define ATL_DRAWINSTANCEDCOMMAND_H
+
+#include "RenderCommand.h"
+#include "VertexInfos.h"
+#include "IndexBufferData.h"
+#include "RenderHdwBuffer.h"
+
+namespace Atl
+{
+    //! @brief Defines a \ref RenderCommand to draw the same data set several times, once per
+    //! instance. Each instance reads its model matrix from an instance buffer, holding
+    //! InstanceStride bytes per instance: a 4x4 matrix of floats, in column major order.
+    //! The Renderer's module binds it as per-instance vertex attributes.
+    struct EXPORTED DrawInstancedCommand : public RenderCommandBase
+    {
+        using RenderCommandBase::RenderCommandBase;
+
+        //! @brief Number of bytes used by one instance in the instance buffer.
+        static constexpr std::size_t InstanceStride = 16 * sizeof(float);
+
+        //! @brief Destructor.
+        virtual ~DrawInstancedCommand() = default;
+
+        //! @brief Constructs the command.
+        //! @param infos The data set to draw.
+        //! @param indexes The indexes to draw the data set with, or null to draw its vertexes
+        //! in order.
+        //! @param instances The instance buffer.
+        //! @param first The first instance to draw in the instance buffer.
+        //! @param count The number of instances to draw.
+        virtual void construct(const VertexInfosPtr& infos,
+                               const IndexBufferDataPtr& indexes,
+                               const RenderHdwBufferPtr& instances,
+                               std::size_t first,
+                               std::size_t count) = 0;
+
+        //! @brief Returns the data set given to \ref construct().
+        virtual VertexInfosPtr infos() const = 0;
+
+        //! @brief Returns the indexes given to \ref construct(), or null.
+        virtual IndexBufferDataPtr indexes() const = 0;
+
+        //! @brief Returns the instance buffer given to \ref construct().
+        virtual RenderHdwBufferPtr instances() const = 0;
+
+        //! @brief Returns the first instance given to \ref construct().
+        virtual std::size_t first() const = 0;
+
+        //! @brief Returns the number of instances given to \ref construct().
+        virtual std::size_t count() const = 0;
+    };
+
+    //! @brief Defines a Pointer to the \ref DrawInstancedCommand.
+    typedef std::shared_ptr < DrawInstancedCommand > DrawInstancedCommandPtr;
+
+    //! @brief Defines a list of commands.
+    typedef std::vector < DrawInstancedCommandPtr > DrawInstancedCommandList;
+}
+
+#endif // ATL_DRAWINSTANCEDCOMMAND_H
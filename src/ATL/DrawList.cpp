@@ -0,0 +1,209 @@
+//
+//  DrawList.cpp
+//  atlre
+//
+//  Created by jacques tronconi on 17/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#include "DrawList.h"
+
+#include <cstring>
+#include <cmath>
+
+namespace Atl
+{
+    // ------------------------------------------------------------------------------------
+    // DrawKey
+
+    std::uint64_t DrawKey::Make(std::uint32_t pass, std::uint32_t pipeline, std::uint32_t material,
+                                std::uint32_t depth, bool transparent)
+    {
+        const std::uint64_t passBits = pass & ((1u << PassBits) - 1);
+        const std::uint64_t pipelineBits = pipeline & ((1u << PipelineBits) - 1);
+        const std::uint64_t materialBits = material & ((1u << MaterialBits) - 1);
+        const std::uint64_t state = (pipelineBits << MaterialBits) | materialBits;
+        const unsigned stateBits = PipelineBits + MaterialBits;
+
+        if (!transparent)
+        {
+            return (passBits << (stateBits + DepthBits))
+                 | (state << DepthBits)
+                 | static_cast < std::uint64_t >(depth);
+        }
+
+        const std::uint64_t invertedDepth = static_cast < std::uint32_t >(~depth);
+
+        return (std::uint64_t(1) << 63)
+             | (passBits << (DepthBits + stateBits))
+             | (invertedDepth << stateBits)
+             | state;
+    }
+
+    bool DrawKey::IsTransparent(std::uint64_t key)
+    {
+        return (key >> 63) != 0;
+    }
+
+    std::uint64_t DrawKey::State(std::uint64_t key)
+    {
+        const std::uint64_t depthMask = (std::uint64_t(1) << DepthBits) - 1;
+
+        if (!IsTransparent(key))
+            return key & ~depthMask;
+
+        return key & ~(depthMask << (PipelineBits + MaterialBits));
+    }
+
+    std::uint32_t DrawKey::Depth(Real distance)
+    {
+        // Positive IEEE floats keep their order when read as unsigned integers. Doubles are
+        // first converted to float, as we only keep 32 bits.
+
+        float value = static_cast < float >(distance);
+
+        if (std::isnan(value) || value <= 0.0f)
+            return 0;
+
+        std::uint32_t bits = 0;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    // ------------------------------------------------------------------------------------
+    // DrawList
+
+    void DrawList::add(std::uint64_t key, const RenderNodePtr& node)
+    {
+        if (!node)
+            throw NullError("DrawList", "add", "Null RenderNode passed.");
+
+        mItems.push_back(Item{ key, static_cast < std::uint32_t >(mNodes.size()) });
+        mNodes.push_back(node);
+    }
+
+    void DrawList::add(std::uint64_t key, const RenderNodePtr& node, const AABB& bounds)
+    {
+        mBoundsItems.push_back(static_cast < std::uint32_t >(mItems.size()));
+        add(key, node);
+        mBounds.add(bounds);
+    }
+
+    void DrawList::cull(const Frustum& frustum)
+    {
+        const std::size_t count = mBounds.size();
+
+        if (!count)
+            return;
+
+        mVisibility.resize((count + 63) / 64);
+        frustum.cullBoxes(mBounds, mVisibility.data());
+
+        // Compacts mItems in place. Culled entries are flagged with an out of range index
+        // and the remaining ones keep their order. Nodes are not moved.
+
+        const std::uint32_t culled = static_cast < std::uint32_t >(-1);
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            if (!(mVisibility[i >> 6] & (std::uint64_t(1) << (i & 63))))
+                mItems[mBoundsItems[i]].index = culled;
+        }
+
+        std::size_t kept = 0;
+
+        for (std::size_t i = 0; i < mItems.size(); ++i)
+        {
+            if (mItems[i].index != culled)
+                mItems[kept++] = mItems[i];
+        }
+
+        mItems.resize(kept);
+        mBounds.clear();
+        mBoundsItems.clear();
+    }
+
+    void DrawList::sort()
+    {
+        const std::size_t count = mItems.size();
+
+        if (count < 2)
+            return;
+
+        mScratch.resize(count);
+
+        Item* source = mItems.data();
+        Item* dest = mScratch.data();
+
+        // One pass per byte, from the least significant one. A pass is skipped when every
+        // key has the same byte, which is common for the pass and pipeline bytes.
+
+        for (unsigned shift = 0; shift < 64; shift += 8)
+        {
+            std::size_t histogram[256] = { 0 };
+
+            for (std::size_t i = 0; i < count; ++i)
+                histogram[(source[i].key >> shift) & 0xFF]++;
+
+            if (histogram[(source[0].key >> shift) & 0xFF] == count)
+                continue;
+
+            std::size_t offset = 0;
+
+            for (std::size_t& bucket : histogram)
+            {
+                const std::size_t bucketCount = bucket;
+                bucket = offset;
+                offset += bucketCount;
+            }
+
+            for (std::size_t i = 0; i < count; ++i)
+                dest[histogram[(source[i].key >> shift) & 0xFF]++] = source[i];
+
+            std::swap(source, dest);
+        }
+
+        if (source != mItems.data())
+            mItems.swap(mScratch);
+    }
+
+    void DrawList::clear()
+    {
+        mItems.clear();
+        mNodes.clear();
+        mBounds.clear();
+        mBoundsItems.clear();
+    }
+
+    void DrawList::reserve(std::size_t count)
+    {
+        mItems.reserve(count);
+        mNodes.reserve(count);
+    }
+
+    std::size_t DrawList::size() const
+    {
+        return mItems.size();
+    }
+
+    bool DrawList::empty() const
+    {
+        return mItems.empty();
+    }
+
+    std::uint64_t DrawList::keyAt(std::size_t idx) const
+    {
+        if (idx >= mItems.size())
+            throw OutOfRange("DrawList", "keyAt", "Index %i out of range.", (int)idx);
+
+        return mItems[idx].key;
+    }
+
+    const RenderNodePtr& DrawList::nodeAt(std::size_t idx) const
+    {
+        if (idx >= mItems.size())
+            throw OutOfRange("DrawList", "nodeAt", "Index %i out of range.", (int)idx);
+
+        return mNodes[mItems[idx].index];
+    }
+}
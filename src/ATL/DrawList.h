@@ -0,0 +1,154 @@
+//
+//  DrawList.h
+//  atlre
+//
+//  Created by jacques tronconi on 17/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#ifndef ATL_DRAWLIST_H
+#define ATL_DRAWLIST_H
+
+#include "Platform.h"
+#include "RenderNode.h"
+#include "AABB.h"
+#include "Frustum.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace Atl
+{
+    //! @brief Builds packed 64 bits sort keys for a DrawList.
+    //!
+    //! Keys are sorted in ascending order. The most significant bit is the transparency
+    //! bit, so every opaque draw comes before the transparent ones. The layout is:
+    //! - opaque:      [ 0 | pass:7 | pipeline:12 | material:12 | depth:32 ]
+    //! - transparent: [ 1 | pass:7 | ~depth:32 | pipeline:12 | material:12 ]
+    //!
+    //! Opaque draws are grouped by pass, pipeline and material to reduce state changes,
+    //! then sorted front to back. Transparent draws must be blended in order, so their
+    //! depth is inverted (back to front) and comes before the pipeline and the material.
+    struct EXPORTED DrawKey
+    {
+        //! @brief Number of bits for the pass index.
+        static constexpr unsigned PassBits = 7;
+
+        //! @brief Number of bits for the pipeline index.
+        static constexpr unsigned PipelineBits = 12;
+
+        //! @brief Number of bits for the material index.
+        static constexpr unsigned MaterialBits = 12;
+
+        //! @brief Number of bits for the depth.
+        static constexpr unsigned DepthBits = 32;
+
+        //! @brief Packs a key. Indexes are truncated to their number of bits.
+        //! @param pass The pass index.
+        //! @param pipeline The pipeline index.
+        //! @param material The material index.
+        //! @param depth The quantized depth, usually from \ref Depth().
+        //! @param transparent True if the draw must be sorted back to front, after every
+        //! opaque draws.
+        static std::uint64_t Make(std::uint32_t pass, std::uint32_t pipeline, std::uint32_t material,
+                                  std::uint32_t depth, bool transparent);
+
+        //! @brief Returns true if the key was made with transparent set.
+        static bool IsTransparent(std::uint64_t key);
+
+        //! @brief Returns the key without its depth: two keys with the same state have the same
+        //! transparency, pass, pipeline and material.
+        static std::uint64_t State(std::uint64_t key);
+
+        //! @brief Quantizes a distance into DepthBits. Negative distances are clamped to
+        //! zero and the order of positive distances is kept (INFINITY is the greatest one).
+        static std::uint32_t Depth(Real distance);
+    };
+
+    //! @brief A flat list of RenderNode to draw, sorted by their DrawKey.
+    //!
+    //! The list is filled by \ref RenderTechnique::sort() and sorted once with an LSD radix
+    //! sort on the 64 bits keys. Only the keys and an index are moved during the sort, the
+    //! nodes pointers stay where they have been added. The sort is stable, so draws with
+    //! the same key are drawn in the order they have been added.
+    class EXPORTED DrawList
+    {
+    public:
+
+        //! @brief A sorted entry.
+        struct Item
+        {
+            //! @brief The sort key.
+            std::uint64_t key;
+
+            //! @brief Index of the node in \ref DrawList::mNodes.
+            std::uint32_t index;
+        };
+
+    private:
+
+        //! @brief The entries to sort.
+        std::vector < Item > mItems;
+
+        //! @brief A scratch buffer for the radix sort, kept between frames.
+        std::vector < Item > mScratch;
+
+        //! @brief The nodes, in the order they have been added.
+        RenderNodeList mNodes;
+
+        //! @brief Bounds of the entries added with \ref add(key, node, bounds), in SoA
+        //! layout for \ref Frustum::cullBoxes().
+        AABBArray mBounds;
+
+        //! @brief Position in mItems of the entry for each box in mBounds.
+        std::vector < std::uint32_t > mBoundsItems;
+
+        //! @brief Visibility mask written by \ref cull(), kept between frames.
+        std::vector < std::uint64_t > mVisibility;
+
+    public:
+
+        //! @brief Adds a node with its key.
+        void add(std::uint64_t key, const RenderNodePtr& node);
+
+        //! @brief Adds a node with its key and its world bounds. The entry is removed by
+        //! \ref cull() if the bounds are outside the frustum.
+        void add(std::uint64_t key, const RenderNodePtr& node, const AABB& bounds);
+
+        //! @brief Removes every entries whose bounds are outside the given frustum, in one
+        //! batch. Entries added without bounds are kept. Must be called before \ref sort().
+        void cull(const Frustum& frustum);
+
+        //! @brief Sorts the entries by key.
+        void sort();
+
+        //! @brief Removes every entries but keeps the allocated memory.
+        void clear();
+
+        //! @brief Reserves memory for count entries.
+        void reserve(std::size_t count);
+
+        //! @brief Returns the number of entries.
+        std::size_t size() const;
+
+        //! @brief Returns true if the list is empty.
+        bool empty() const;
+
+        //! @brief Returns the key of the entry at position idx.
+        std::uint64_t keyAt(std::size_t idx) const;
+
+        //! @brief Returns the node of the entry at position idx. Once sorted, entries are
+        //! in the draw order.
+        const RenderNodePtr& nodeAt(std::size_t idx) const;
+
+        //! @brief Calls fn for each node, in the entries order.
+        template < typename Function >
+        void forEach(Function&& fn) const
+        {
+            for (const Item& item : mItems)
+                fn(*mNodes[item.index]);
+        }
+    };
+}
+
+#endif // ATL_DRAWLIST_H
@@ -23,6 +23,9 @@ namespace Atl
 
         //! @brief Constructs the command.
         virtual void construct(const VertexInfosPtr& infos) = 0;
+
+        //! @brief Returns the data set given to \ref construct().
+        virtual VertexInfosPtr infos() const = 0;
     };
 
     //! @brief Defines a Pointer to the \ref DrawVertexArraysCommand.
@@ -53,6 +53,9 @@ namespace Atl
     //! a void return type. If your event does require an answer, you can return anything
     //! you want from the listener's function, but the type must be storable in a std::vector.
     //! What the emitter will do with this function depends on the implementation.
+    //! Listeners are called on the thread calling \ref send(), and the returned future
+    //! is already ready: callers used to rely on it being waited anyway, and spawning a
+    //! task for a handful of virtual calls costs more than the calls themselves.
     class Emitter
     {
         //! @brief The list of listeners for this emitter.
@@ -78,7 +81,7 @@ namespace Atl
         std::future < std::vector < Return > > 
         send(Return(T::*callback)(Args...), Args&&... args) const
         {
-            return std::async(std::launch::async, [this, &callback, &args...]()
+            std::packaged_task < std::vector < Return >(void) > task([this, &callback, &args...]()
             {
                 std::lock_guard l(mMutex);
                 std::vector < Return > results;
@@ -101,6 +104,10 @@ namespace Atl
 
                 return results;
             });
+
+            std::future < std::vector < Return > > result = task.get_future();
+            task();
+            return result;
         }
 
         //! @brief Sends an event through registered listeners.
@@ -111,25 +118,38 @@ namespace Atl
         std::future < void > 
         send(void(T::*callback)(Args...), Args&&... args) const
         {
-            return std::async(std::launch::async, [this, &callback, &args...]()
+            std::packaged_task < void(void) > task([this, &callback, &args...]()
             {
-                std::lock_guard l(mMutex);
+                notify(callback, std::forward < Args >(args)...);
+            });
 
-                for (const ListenerBaseWeak& listener : mListeners)
-                {
-                    ListenerBasePtr listenerPtr = listener.lock();
+            std::future < void > result = task.get_future();
+            task();
+            return result;
+        }
 
-                    if (listenerPtr)
-                    {
-                        T* derivedPtr = dynamic_cast < T* >(listenerPtr.get());
+        //! @brief Sends an event through registered listeners, without any shared state.
+        //! This is the version used by synchroneous render paths, where a std::future 
+        //! per event is not affordable. Errors are thrown directly to the caller.
+        template < typename T, typename... Args >
+        void notify(void(T::*callback)(Args...), Args&&... args) const
+        {
+            std::lock_guard l(mMutex);
 
-                        if (!derivedPtr)
-                            throw ListenerBadCast("Emitter", "send", "Listener is not a %s.", typeid(T).name());
-                        
-                        (derivedPtr->*callback)(std::forward < Args >(args)...);
-                    }
+            for (const ListenerBaseWeak& listener : mListeners)
+            {
+                ListenerBasePtr listenerPtr = listener.lock();
+
+                if (listenerPtr)
+                {
+                    T* derivedPtr = dynamic_cast < T* >(listenerPtr.get());
+
+                    if (!derivedPtr)
+                        throw ListenerBadCast("Emitter", "notify", "Listener is not a %s.", typeid(T).name());
+                    
+                    (derivedPtr->*callback)(std::forward < Args >(args)...);
                 }
-            });
+            }
         }
 
         //! @brief Adds a listener derived from ListenerBase.
@@ -9,30 +9,29 @@
 
 namespace Atl
 {
-    std::size_t FarthestTechnique::sort(const RenderNode& node, const Camera& camera, const Frustum& frustum, RenderTechnique::NodesMap& nodes) const
+    std::size_t FarthestTechnique::sort(const RenderNode& node, const Camera& camera, const Frustum& frustum, Frustum::PlaneMask mask, DrawList& nodes) const
     {
         if (!node.isVisible())
             return 0;
         
-        if (node.isCulledFromFrustum(frustum))
+        // The whole subtree is rejected at once if its AABB is outside the frustum. Otherwise the
+        // planes it is fully inside of are removed from the mask given to the children.
+        
+        if (node.isSubtreeCulledFromFrustum(frustum, mask))
             return 0;
         
         const bool isRenderRenderablesFirst = node.renderRenderablesFirst();
-        rvec3 distance = rvec3(INFINITY, INFINITY, INFINITY);
         RenderNodePtr renderNode = std::dynamic_pointer_cast < RenderNode >(const_cast < RenderNode& >(node).shared_from_this());
         
         if (!renderNode)
             throw NullError("NodeTraversalRenderTechnique", "sort", "Node isn't castable to RenderNode.");
         
-        if (node.hasAABB())
-        {
-            AABB bbox = node.aabb();
-            const rvec3 center = bbox.center();
-            distance = - camera.distance(center);
-        }
+        // Every node is sorted back to front, whatever its Material.
+        
+        const std::uint64_t key = DrawKey::Make(0, 0, 0, DrawKey::Depth(Distance(node, camera)), true);
         
         if (isRenderRenderablesFirst)
-            nodes[distance.length()].push_back(renderNode);
+            AddNode(nodes, key, renderNode, mask != 0);
         
         std::size_t childrenCount = node.childrenCount();
         std::size_t nodesAdded = 1;
@@ -40,12 +39,18 @@ namespace Atl
         for (unsigned i = 0; i < childrenCount; ++i)
         {
             const RenderNode& iNode = dynamic_cast < const RenderNode& >(node.childAt(i));
-            nodesAdded += sort(iNode, camera, frustum, nodes);
+            nodesAdded += sort(iNode, camera, frustum, mask, nodes);
         }
         
         if (!isRenderRenderablesFirst)
-            nodes[distance.length()].push_back(renderNode);
+            AddNode(nodes, key, renderNode, mask != 0);
         
         return nodesAdded;
     }
+    
+    bool FarthestTechnique::makeEntryKey(const SceneBVH::Entry& entry, const Camera& camera, std::uint64_t& key) const
+    {
+        key = DrawKey::Make(0, 0, 0, DrawKey::Depth(Distance(entry, camera)), true);
+        return true;
+    }
 }
@@ -22,7 +22,10 @@ namespace Atl
     protected:
         ATL_SHAREABLE(FarthestTechnique)
         
-        virtual std::size_t sort(const RenderNode& node, const Camera& camera, const Frustum& frustum, NodesMap& nodes) const;
+        virtual std::size_t sort(const RenderNode& node, const Camera& camera, const Frustum& frustum, Frustum::PlaneMask mask, DrawList& nodes) const;
+        
+        //! @brief Keys every entry from back to front.
+        virtual bool makeEntryKey(const SceneBVH::Entry& entry, const Camera& camera, std::uint64_t& key) const;
     };
 }
 
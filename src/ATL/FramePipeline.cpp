@@ -0,0 +1,226 @@
+//
+//  FramePipeline.cpp
+//  atlre
+//
+//  Created by jacques tronconi on 25/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#include "FramePipeline.h"
+#include "Renderer.h"
+#include "RenderTarget.h"
+#include "Renderable.h"
+#include "JobSystem.h"
+
+#include <thread>
+
+namespace Atl
+{
+    FramePipeline::FramePipeline(Renderer& renderer, std::size_t framesInFlight, const std::type_index& commandType)
+    : mTransientRing(renderer.transientRing()), mRenderer(renderer), mFrameIndex(0), mCurrent(nullptr), mIsSubmitting(false)
+    {
+        if (!framesInFlight || framesInFlight > MaxFramesInFlight)
+            throw OutOfRange("FramePipeline", "FramePipeline", "%i frames in flight requested, but "
+                             "it must be from 1 to %i.", static_cast < int >(framesInFlight),
+                             static_cast < int >(MaxFramesInFlight));
+
+        mFrames.resize(framesInFlight);
+
+        for (Frame& frame : mFrames)
+        {
+            frame.command = std::dynamic_pointer_cast < RenderCommand >(
+                renderer.commandFactory().construct(commandType, renderer));
+
+            if (!frame.command)
+                throw NullError("FramePipeline", "FramePipeline", "Null RenderCommand created.");
+
+            if (framesInFlight > 1 && !frame.command->asCommandBuffer())
+                throw FramePipelineInvalidCommand("FramePipeline", "FramePipeline", "%i frames in flight "
+                                                  "require a CommandBuffer.", static_cast < int >(framesInFlight));
+        }
+    }
+
+    FramePipeline::~FramePipeline()
+    {
+        // Submissions reference the pipeline, so they must be done before it is destroyed.
+
+        try { flush(); }
+        catch (...) {}
+
+        // The job may still be looking for another submission after the last fence.
+
+        while (true)
+        {
+            {
+                std::lock_guard l(mSubmissionsMutex);
+
+                if (!mIsSubmitting)
+                    break;
+            }
+
+            if (!JobSystem::Get().executeOne())
+                std::this_thread::yield();
+        }
+    }
+
+    std::shared_future < void > FramePipeline::submit(RenderTarget& target, const RecordFunction& function)
+    {
+        if (!function)
+            throw NullError("FramePipeline", "submit", "Null function passed.");
+
+        Frame& frame = mFrames[mFrameIndex % mFrames.size()];
+        retire(frame);
+
+        {
+            std::lock_guard l(mReleasesMutex);
+            mCurrent = &frame;
+        }
+
+        RenderCommand& command = *frame.command;
+
+        {
+            LockableGuard l(command);
+            command.removeAllSubCommands();
+        }
+
+        function(command, mFrameIndex);
+
+        // The transient ranges of this frame are released with the command.
+
+        const std::uint64_t transientFrame = mTransientRing.endFrame();
+
+        {
+            std::lock_guard l(mReleasesMutex);
+            frame.releases.push_back([&ring = mTransientRing, transientFrame](){ ring.retire(transientFrame); });
+        }
+
+        std::promise < void > promise;
+        frame.fence = promise.get_future().share();
+        mFrameIndex++;
+
+        bool isSubmitting;
+
+        {
+            std::lock_guard l(mSubmissionsMutex);
+            mSubmissions.push_back({ &target, &command, std::move(promise) });
+
+            isSubmitting = mIsSubmitting;
+            mIsSubmitting = true;
+        }
+
+        // A single job submits the frames, so they are submitted in order. Without worker the
+        // job is executed here, and submit() waits for the frame like Renderer::render().
+
+        if (!isSubmitting)
+            JobSystem::Get().submit([this](){ submitQueued(); });
+
+        return frame.fence;
+    }
+
+    std::shared_future < void > FramePipeline::submit(RenderTarget& target, const Renderable& renderable)
+    {
+        return submit(target, [&renderable](RenderCommand& command, std::uint64_t){
+            renderable.renderSync(command);
+        });
+    }
+
+    void FramePipeline::defer(Release release)
+    {
+        if (!release)
+            throw NullError("FramePipeline", "defer", "Null release passed.");
+
+        {
+            std::lock_guard l(mReleasesMutex);
+
+            if (mCurrent)
+            {
+                mCurrent->releases.push_back(std::move(release));
+                return;
+            }
+        }
+
+        release();
+    }
+
+    void FramePipeline::flush()
+    {
+        std::exception_ptr error;
+
+        // Fences are signaled in order, so the frames are retired from the oldest one.
+
+        for (std::size_t i = 0; i < mFrames.size(); ++i)
+        {
+            try { retire(mFrames[(mFrameIndex + i) % mFrames.size()]); }
+            catch (...) { if (!error) error = std::current_exception(); }
+        }
+
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    std::size_t FramePipeline::framesInFlight() const
+    {
+        return mFrames.size();
+    }
+
+    std::uint64_t FramePipeline::frameIndex() const
+    {
+        return mFrameIndex;
+    }
+
+    void FramePipeline::retire(Frame& frame)
+    {
+        std::exception_ptr error;
+
+        try { JobSystem::Get().wait(frame.fence); }
+        catch (...) { error = std::current_exception(); }
+
+        // The fence is dropped, so its error is rethrown only once.
+
+        frame.fence = std::shared_future < void >();
+
+        std::vector < Release > releases;
+
+        {
+            std::lock_guard l(mReleasesMutex);
+            releases.swap(frame.releases);
+        }
+
+        for (Release& release : releases)
+            release();
+
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    void FramePipeline::submitQueued()
+    {
+        while (true)
+        {
+            Submission submission;
+
+            {
+                std::lock_guard l(mSubmissionsMutex);
+
+                if (mSubmissions.empty())
+                {
+                    mIsSubmitting = false;
+                    return;
+                }
+
+                submission = std::move(mSubmissions.front());
+                mSubmissions.pop_front();
+            }
+
+            try
+            {
+                mRenderer.submit(*submission.target, *submission.command);
+                submission.promise.set_value();
+            }
+            catch (...)
+            {
+                submission.promise.set_exception(std::current_exception());
+            }
+        }
+    }
+}
@@ -0,0 +1,178 @@
+//
+//  FramePipeline.h
+//  atlre
+//
+//  Created by jacques tronconi on 25/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#ifndef ATL_FRAMEPIPELINE_H
+#define ATL_FRAMEPIPELINE_H
+
+#include "Platform.h"
+#include "RenderCommand.h"
+
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <typeindex>
+#include <vector>
+
+namespace Atl
+{
+    class Renderer;
+    class Renderable;
+    class RenderTarget;
+    class TransientRing;
+
+    //! @brief Launched when a FramePipeline with several frames in flight creates commands
+    //! which don't record packets.
+    struct FramePipelineInvalidCommand : public Error
+    { using Error::Error; };
+
+    //! @brief Records a frame while the previous ones are submitted.
+    //!
+    //! The pipeline owns one RenderCommand per frame in flight. \ref submit() records a frame
+    //! on the calling thread, and queues its submission: frames are submitted in order, one at
+    //! a time, by a job of the JobSystem. So the next frame is updated, culled and recorded
+    //! while the backend still submits the previous ones.
+    //!
+    //! Each frame has a fence, signaled once its submission is done. A RenderCommand is
+    //! recorded again only when the fence of the frame that last used it is signaled, and the
+    //! releases deferred with \ref defer() run at this moment. This is how per frame resources
+    //! are recycled without being used by a frame still in flight. The ranges allocated in
+    //! the Renderer's TransientRing while a frame is recorded are retired the same way.
+    //!
+    //! With several frames in flight, the commands must be CommandBuffers. A shared sub command,
+    //! like a cache's ShaderVariableCommand, is changed by the next frame while the previous one
+    //! still renders it, whereas a SetUniformPacket holds a copy of the value. The objects the
+    //! draw packets point to are released by the caches through TransientRing::defer(), so
+    //! they live until the frames recorded with them retire.
+    //!
+    //! \ref submit() must always be called from the same thread.
+    class EXPORTED FramePipeline
+    {
+    public:
+
+        //! @brief The function recording a frame. Its second argument is the frame index.
+        typedef std::function < void(RenderCommand&, std::uint64_t) > RecordFunction;
+
+        //! @brief A release deferred until a frame retires.
+        typedef std::function < void(void) > Release;
+
+        //! @brief The maximum number of frames in flight.
+        static constexpr std::size_t MaxFramesInFlight = 3;
+
+    private:
+
+        //! @brief A frame in flight.
+        struct Frame
+        {
+            //! @brief The command recorded for this frame.
+            RenderCommandPtr command;
+
+            //! @brief Signaled when the frame is submitted. Invalid if never submitted.
+            std::shared_future < void > fence;
+
+            //! @brief The releases to run when the frame retires.
+            std::vector < Release > releases;
+        };
+
+        //! @brief A frame waiting for its submission.
+        struct Submission
+        {
+            //! @brief The target to render into.
+            RenderTarget* target;
+
+            //! @brief The command to render.
+            RenderCommand* command;
+
+            //! @brief Signals the frame's fence.
+            std::promise < void > promise;
+        };
+
+        //! @brief The Renderer's ring, whose frames follow the pipeline's ones.
+        TransientRing& mTransientRing;
+
+        //! @brief The Renderer submitting the frames with Renderer::submit().
+        Renderer& mRenderer;
+
+        //! @brief The frames, used in turn.
+        std::vector < Frame > mFrames;
+
+        //! @brief The index of the next frame to record.
+        std::uint64_t mFrameIndex;
+
+        //! @brief The frame receiving the deferred releases: the one being recorded, or the last
+        //! one submitted. Null before the first frame.
+        Frame* mCurrent;
+
+        //! @brief Protects the releases, as \ref defer() may be called by recording jobs.
+        std::mutex mReleasesMutex;
+
+        //! @brief The frames waiting for their submission.
+        std::deque < Submission > mSubmissions;
+
+        //! @brief True while a job submits mSubmissions.
+        bool mIsSubmitting;
+
+        //! @brief Protects mSubmissions and mIsSubmitting.
+        std::mutex mSubmissionsMutex;
+
+    public:
+
+        //! @brief Constructs a pipeline.
+        //! @param renderer The Renderer used to create the commands.
+        //! @param framesInFlight The number of frames in flight, from 1 to \ref MaxFramesInFlight.
+        //! One makes \ref submit() wait for the previous frame, as Renderer::render() does.
+        //! @param commandType The type of the commands, as registered in the Renderer's
+        //! RenderCommandFactory. It must derive from RenderCommand, and be a CommandBuffer if
+        //! framesInFlight is more than one. The default type is a CommandBuffer once the module
+        //! registered its CommandBuffer as the constructor of RenderCommand.
+        //! @throw FramePipelineInvalidCommand if several frames are in flight and the commands
+        //! are not CommandBuffers.
+        FramePipeline(Renderer& renderer, std::size_t framesInFlight = 2,
+                      const std::type_index& commandType = typeid(RenderCommand));
+
+        //! @brief Waits for every frame in flight, and runs the deferred releases.
+        ~FramePipeline();
+
+        FramePipeline(const FramePipeline&) = delete;
+        FramePipeline& operator = (const FramePipeline&) = delete;
+
+        //! @brief Records a frame with function, and queues its submission into target. Waits
+        //! first for the frame that last used the same command to retire. Returns the frame's
+        //! fence, which rethrows the errors of its submission.
+        //! The target must live until the fence is signaled.
+        std::shared_future < void > submit(RenderTarget& target, const RecordFunction& function);
+
+        //! @brief Records a frame by rendering renderable, and queues its submission into target.
+        std::shared_future < void > submit(RenderTarget& target, const Renderable& renderable);
+
+        //! @brief Defers release until the frame being recorded, or the last one submitted,
+        //! retires. Runs it directly if no frame was submitted yet.
+        void defer(Release release);
+
+        //! @brief Waits for every frame in flight, and runs the deferred releases. Rethrows the
+        //! first error of a submission.
+        void flush();
+
+        //! @brief Returns the number of frames in flight.
+        std::size_t framesInFlight() const;
+
+        //! @brief Returns the index of the next frame to record.
+        std::uint64_t frameIndex() const;
+
+    private:
+
+        //! @brief Waits for the fence of a frame, and runs its releases. The errors of the
+        //! submission are rethrown after the releases.
+        void retire(Frame& frame);
+
+        //! @brief Submits the queued frames until the queue is empty.
+        void submitQueued();
+    };
+}
+
+#endif // ATL_FRAMEPIPELINE_H
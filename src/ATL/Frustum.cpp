@@ -6,6 +6,20 @@
 //
 
 #include "Frustum.h"
+#include "Error.h"
+
+// Batch culling uses AVX2 when the compiler targets it (-mavx2 or /arch:AVX2, see the 
+// ATL_ENABLE_AVX2 CMake option), SSE2 on every x86-64 target, and a scalar loop otherwise.
+
+#if !defined(ATL_REAL_AS_DOUBLE)
+#   if defined(__AVX2__)
+#       define ATL_FRUSTUM_AVX2
+#       include <immintrin.h>
+#   elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#       define ATL_FRUSTUM_SSE2
+#       include <emmintrin.h>
+#   endif
+#endif
 
 namespace Atl
 {
@@ -78,4 +92,136 @@ namespace Atl
 
         return true;
     }
-}
\ No newline at end of file
+
+    bool Frustum::isBoxVisible(const rvec3& minp, const rvec3& maxp, PlaneMask& mask) const
+    {
+        for (int i = 0; i < Count; ++i)
+        {
+            const PlaneMask bit = static_cast < PlaneMask >(1 << i);
+
+            if (!(mask & bit))
+                continue;
+
+            const rvec4& plane = m_planes[i];
+
+            // The farthest corner along the normal is behind the plane: the box is outside.
+
+            const rvec3 farthest(plane.x >= 0 ? maxp.x : minp.x,
+                                 plane.y >= 0 ? maxp.y : minp.y,
+                                 plane.z >= 0 ? maxp.z : minp.z);
+
+            if (glm::dot(rvec3(plane), farthest) + plane.w < 0)
+                return false;
+
+            // The nearest corner is in front of the plane: the box is fully inside it.
+
+            const rvec3 nearest(plane.x >= 0 ? minp.x : maxp.x,
+                                plane.y >= 0 ? minp.y : maxp.y,
+                                plane.z >= 0 ? minp.z : maxp.z);
+
+            if (glm::dot(rvec3(plane), nearest) + plane.w >= 0)
+                mask &= static_cast < PlaneMask >(~bit);
+        }
+
+        return true;
+    }
+
+    void Frustum::cullBoxes(const AABBArray& boxes, std::uint64_t* visibility) const
+    {
+        cullBoxes(boxes.minX.data(), boxes.minY.data(), boxes.minZ.data(),
+                  boxes.maxX.data(), boxes.maxY.data(), boxes.maxZ.data(),
+                  boxes.size(), visibility);
+    }
+
+    void Frustum::cullBoxes(const Real* minX, const Real* minY, const Real* minZ,
+                            const Real* maxX, const Real* maxY, const Real* maxZ,
+                            std::size_t count, std::uint64_t* visibility) const
+    {
+        if (!count)
+            return;
+
+        if (!visibility)
+            throw NullError("Frustum", "cullBoxes", "Null visibility mask passed.");
+
+        const std::size_t words = (count + 63) / 64;
+
+        for (std::size_t w = 0; w < words; ++w)
+            visibility[w] = 0;
+
+        // For each plane, the corner the farthest along the normal is made of the max
+        // component when the normal's component is positive, and of the min one otherwise.
+        // This is constant for the whole batch, so we select the arrays only once.
+
+        const Real* px[Count];
+        const Real* py[Count];
+        const Real* pz[Count];
+
+        for (int p = 0; p < Count; ++p)
+        {
+            px[p] = m_planes[p].x >= 0 ? maxX : minX;
+            py[p] = m_planes[p].y >= 0 ? maxY : minY;
+            pz[p] = m_planes[p].z >= 0 ? maxZ : minZ;
+        }
+
+        std::size_t i = 0;
+
+#if defined(ATL_FRUSTUM_AVX2)
+        const __m256 zero = _mm256_setzero_ps();
+
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+            for (int p = 0; p < Count; ++p)
+            {
+                __m256 d = _mm256_mul_ps(_mm256_set1_ps(m_planes[p].x), _mm256_loadu_ps(px[p] + i));
+                d = _mm256_add_ps(d, _mm256_mul_ps(_mm256_set1_ps(m_planes[p].y), _mm256_loadu_ps(py[p] + i)));
+                d = _mm256_add_ps(d, _mm256_mul_ps(_mm256_set1_ps(m_planes[p].z), _mm256_loadu_ps(pz[p] + i)));
+                d = _mm256_add_ps(d, _mm256_set1_ps(m_planes[p].w));
+                visible = _mm256_and_ps(visible, _mm256_cmp_ps(d, zero, _CMP_GE_OQ));
+            }
+
+            const std::uint64_t bits = static_cast < std::uint32_t >(_mm256_movemask_ps(visible));
+            visibility[i >> 6] |= bits << (i & 63);
+        }
+#elif defined(ATL_FRUSTUM_SSE2)
+        const __m128 zero = _mm_setzero_ps();
+
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+            for (int p = 0; p < Count; ++p)
+            {
+                __m128 d = _mm_mul_ps(_mm_set1_ps(m_planes[p].x), _mm_loadu_ps(px[p] + i));
+                d = _mm_add_ps(d, _mm_mul_ps(_mm_set1_ps(m_planes[p].y), _mm_loadu_ps(py[p] + i)));
+                d = _mm_add_ps(d, _mm_mul_ps(_mm_set1_ps(m_planes[p].z), _mm_loadu_ps(pz[p] + i)));
+                d = _mm_add_ps(d, _mm_set1_ps(m_planes[p].w));
+                visible = _mm_and_ps(visible, _mm_cmpge_ps(d, zero));
+            }
+
+            const std::uint64_t bits = static_cast < std::uint32_t >(_mm_movemask_ps(visible));
+            visibility[i >> 6] |= bits << (i & 63);
+        }
+#endif
+
+        // Scalar path for the remaining boxes (or all of them without SIMD).
+
+        for (; i < count; ++i)
+        {
+            bool visible = true;
+
+            for (int p = 0; p < Count && visible; ++p)
+            {
+                const Real d = m_planes[p].x * px[p][i] 
+                             + m_planes[p].y * py[p][i] 
+                             + m_planes[p].z * pz[p][i] 
+                             + m_planes[p].w;
+                visible = d >= 0;
+            }
+
+            if (visible)
+                visibility[i >> 6] |= std::uint64_t(1) << (i & 63);
+        }
+    }
+}
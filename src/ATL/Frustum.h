@@ -9,12 +9,22 @@
 #define Frustum_h
 
 #include "Platform.h"
+#include "AABB.h"
+
+#include <cstdint>
 
 namespace Atl
 {
     class Frustum
     {
     public:
+        //! @brief A mask of planes, one bit per plane in the Planes order. A cleared bit
+        //! means the tested volume is fully in front of this plane.
+        typedef std::uint8_t PlaneMask;
+
+        //! @brief The mask with every planes.
+        static constexpr PlaneMask AllPlanes = 0x3F;
+
         Frustum() {}
 
         // m = ProjectionMatrix * ViewMatrix 
@@ -23,6 +33,31 @@ namespace Atl
         // http://iquilezles.org/www/articles/frustumcorrect/frustumcorrect.htm
         bool isBoxVisible(const rvec3& minp, const rvec3& maxp) const;
 
+        //! @brief Tests a box only against the planes set in mask, for hierarchical culling.
+        //! Returns false if the box is fully behind one of those planes. Otherwise, the planes
+        //! the box is fully in front of are removed from mask: as children are contained in
+        //! their parent's box, they don't have to be tested against those planes again, and a
+        //! mask of zero means the whole subtree is inside the frustum.
+        //! @note Like \ref cullBoxes(), only the nearest and farthest corners along each plane's
+        //! normal are tested, which is conservative.
+        bool isBoxVisible(const rvec3& minp, const rvec3& maxp, PlaneMask& mask) const;
+
+        //! @brief Tests multiple boxes against the frustum's planes at once.
+        //! For each plane, only the corner of the box the farthest along the plane's normal
+        //! is tested: the box is culled if this corner is behind one plane. This test is
+        //! conservative, some boxes near the frustum corners may be kept.
+        //! @param boxes The boxes to test.
+        //! @param visibility A bitmask of at least (boxes.size() + 63) / 64 words. Bit i is 
+        //! set if box i is visible, cleared otherwise.
+        //! @note Uses AVX2 when compiled with it, SSE2 otherwise, and a scalar loop on other
+        //! platforms or when Real is a double.
+        void cullBoxes(const AABBArray& boxes, std::uint64_t* visibility) const;
+
+        //! @brief Same as \ref cullBoxes(), with raw component arrays of count elements.
+        void cullBoxes(const Real* minX, const Real* minY, const Real* minZ,
+                       const Real* maxX, const Real* maxY, const Real* maxZ,
+                       std::size_t count, std::uint64_t* visibility) const;
+
     private:
         enum Planes
         {
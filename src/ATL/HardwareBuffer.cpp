@@ -8,13 +8,16 @@
 #include "HardwareBuffer.h"
 #include "Error.h"
 
+#include <algorithm>
+#include <cstring>
+
 namespace Atl
 {
     // ------------------------------------------------------------------------------------
     // HardwareBuffer
 
     HardwareBuffer::HardwareBuffer(const HBT& type)
-    : mType(type)
+    : mType(type), mGeneration(0), mForgottenGeneration(0)
     {
 
     }
@@ -31,10 +34,13 @@ namespace Atl
 
     void HardwareBuffer::copy(const HardwareBuffer& rhs)
     {
+        // MemBuffer::size() takes the buffer's mutex, so it is read before locking.
+
+        const std::size_t _size = rhs.size();
+
         HardwareBufferLockGuard l(*this);
         HardwareBufferLockGuardCst ll(rhs);
 
-        const std::size_t _size = rhs.size();
         const void* _data = rhs.data();
 
         if (!_data)
@@ -44,6 +50,98 @@ namespace Atl
         rhs.undata();
     }
 
+    void HardwareBuffer::markDirty(std::size_t offset, std::size_t size)
+    {
+        if (!size)
+            return;
+
+        std::lock_guard l(mDirtyMutex);
+        mGeneration++;
+
+        // A range covering the last one replaces it, like a buffer written again and again.
+        // Merging any other range would give the new generation to bytes a copy already has.
+
+        if (!mDirtyRanges.empty())
+        {
+            auto& last = mDirtyRanges.back();
+
+            if (offset <= last.second.offset && last.second.offset + last.second.size <= offset + size)
+            {
+                last.first = mGeneration;
+                last.second.offset = offset;
+                last.second.size = size;
+                return;
+            }
+        }
+
+        HardwareBufferRange range;
+        range.offset = offset;
+        range.size = size;
+        mDirtyRanges.emplace_back(mGeneration, range);
+
+        if (mDirtyRanges.size() > MaxDirtyRanges)
+        {
+            mForgottenGeneration = mDirtyRanges.front().first;
+            mDirtyRanges.pop_front();
+        }
+    }
+
+    std::uint64_t HardwareBuffer::generation() const
+    {
+        std::lock_guard l(mDirtyMutex);
+        return mGeneration;
+    }
+
+    bool HardwareBuffer::dirtyRangesSince(std::uint64_t generation, std::vector < HardwareBufferRange >& ranges) const
+    {
+        ranges.clear();
+
+        if (generation == NoGeneration)
+            return false;
+
+        {
+            std::lock_guard l(mDirtyMutex);
+
+            if (generation < mForgottenGeneration)
+                return false;
+
+            for (const auto& pair : mDirtyRanges)
+            {
+                if (pair.first > generation)
+                    ranges.push_back(pair.second);
+            }
+        }
+
+        std::sort(ranges.begin(), ranges.end(), [](const HardwareBufferRange& lhs, const HardwareBufferRange& rhs)
+        {
+            return lhs.offset < rhs.offset;
+        });
+
+        // Merges the ranges overlapping or close to each other, in place.
+
+        std::size_t count = 0;
+
+        for (const HardwareBufferRange& range : ranges)
+        {
+            if (count)
+            {
+                HardwareBufferRange& last = ranges[count - 1];
+                const std::size_t lastEnd = last.offset + last.size;
+
+                if (range.offset <= lastEnd + DirtyMergeGap)
+                {
+                    last.size = std::max(lastEnd, range.offset + range.size) - last.offset;
+                    continue;
+                }
+            }
+
+            ranges[count++] = range;
+        }
+
+        ranges.resize(count);
+        return true;
+    }
+
     // ------------------------------------------------------------------------------------
     // MemBuffer
 
@@ -89,6 +187,8 @@ namespace Atl
 
         if (ptr)
             memcpy(&mBuffer[0], ptr, sz);
+
+        markDirty(0, sz);
     }
     
     void MemBuffer::lock() const
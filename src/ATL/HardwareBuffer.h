@@ -12,6 +12,7 @@
 #include "Touchable.h"
 #include "MakeUniqueIndex.h"
 
+#include <deque>
 #include <vector>
 #include <mutex>
 
@@ -27,6 +28,9 @@ namespace Atl
         //! @brief Should contain Indexes data set.
         Index,
 
+        //! @brief Should contain a uniform block.
+        Uniform,
+
         //! @brief Other containers.
         Misc
     };
@@ -34,15 +38,55 @@ namespace Atl
     //! @brief Shortcut for HardwareBufferType.
     using HBT = HardwareBufferType;
 
+    //! @brief A range of bytes in a HardwareBuffer.
+    struct HardwareBufferRange
+    {
+        //! @brief The first byte.
+        std::size_t offset = 0;
+
+        //! @brief The number of bytes.
+        std::size_t size = 0;
+    };
+
     //! @brief A base class for every buffer that may hold renderable data.
+    //!
+    //! @section Dirty ranges
+    //! A buffer records the ranges modified with \ref markDirty(). Each one gets a generation,
+    //! so several copies of the buffer, like the RenderHdwBuffers of several Renderers, update
+    //! only what changed since the \ref generation() they hold, with \ref dirtyRangesSince().
+    //! Only the last \ref MaxDirtyRanges ranges are remembered: a copy older than them must
+    //! copy the whole buffer.
     class EXPORTED HardwareBuffer : public TimeTouchable
     {
         //! @brief The type used to initialize this HardwareBuffer.
         std::atomic < HBT > mType;
 
+        //! @brief The ranges modified, with their generation, from the oldest one.
+        std::deque < std::pair < std::uint64_t, HardwareBufferRange > > mDirtyRanges;
+
+        //! @brief The generation of the last range modified.
+        std::uint64_t mGeneration;
+
+        //! @brief The ranges of this generation and older ones are forgotten.
+        std::uint64_t mForgottenGeneration;
+
+        //! @brief Protects the dirty ranges. This is not the buffer's lock, so \ref markDirty()
+        //! can be called while the buffer is locked.
+        mutable std::mutex mDirtyMutex;
+
     public:
         typedef std::shared_ptr < HardwareBuffer > pointer_type;
 
+        //! @brief A generation no buffer has, for a copy which was never updated.
+        static constexpr std::uint64_t NoGeneration = ~std::uint64_t(0);
+
+        //! @brief The number of dirty ranges remembered.
+        static constexpr std::size_t MaxDirtyRanges = 256;
+
+        //! @brief Dirty ranges closer than this number of bytes are merged by
+        //! \ref dirtyRangesSince(), as copying the gap is cheaper than another copy.
+        static constexpr std::size_t DirtyMergeGap = 64;
+
         //! @brief Constructs a HardwareBuffer.
         //! @param type The type for this buffer. Default value to HBT::Vertex, 
         //! but you should set it to what you need.
@@ -74,6 +118,8 @@ namespace Atl
         virtual void* data() = 0;
         
         //! @brief Returns a pointer to the internal data.
+        //! Code only reading the buffer should call this one: the non const data() of a
+        //! MappedMemBuffer copies its mapped region.
         //! @note You should use \ref lock() before using this function.
         virtual const void* data() const = 0;
         
@@ -98,6 +144,19 @@ namespace Atl
         //! Both HardwareBuffers are locked during the process. \ref allocate(), \ref size, 
         //! \ref data() and \ref undata() are used to copy given buffer.
         virtual void copy(const HardwareBuffer& rhs);
+
+        //! @brief Records that size bytes from offset were modified. \ref allocate() does it for
+        //! the whole buffer, but writes through \ref data() must call it. Does nothing if size
+        //! is zero.
+        void markDirty(std::size_t offset, std::size_t size);
+
+        //! @brief Returns the generation of the last modification, zero if none.
+        std::uint64_t generation() const;
+
+        //! @brief Returns the ranges modified after a generation, sorted and merged.
+        //! @return False if the ranges are forgotten, or if generation is \ref NoGeneration:
+        //! the whole buffer must be copied.
+        bool dirtyRangesSince(std::uint64_t generation, std::vector < HardwareBufferRange >& ranges) const;
     };
     
     typedef HardwareBuffer::pointer_type HardwareBufferPtr;
@@ -0,0 +1,208 @@
+//
+//  InstanceBatcher.cpp
+//  atlre
+//
+//  Created by jacques tronconi on 21/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#include "InstanceBatcher.h"
+#include "ModelRenderNode.h"
+#include "SubModelRenderCache.h"
+#include "Transformation.h"
+#include "Renderer.h"
+#include "CommandBuffer.h"
+
+#include <functional>
+
+namespace Atl
+{
+    bool InstanceBatcher::GroupKey::operator == (const GroupKey& rhs) const
+    {
+        return infos == rhs.infos
+            && indexes == rhs.indexes
+            && material == rhs.material
+            && nodeMaterial == rhs.nodeMaterial;
+    }
+
+    std::size_t InstanceBatcher::GroupKeyHash::operator () (const GroupKey& key) const
+    {
+        std::hash < const void* > hasher;
+        std::size_t result = hasher(key.infos);
+
+        for (const void* ptr : { (const void*)key.indexes, (const void*)key.material, (const void*)key.nodeMaterial })
+            result ^= hasher(ptr) + 0x9e3779b9 + (result << 6) + (result >> 2);
+
+        return result;
+    }
+
+    InstanceBatcher::InstanceBatcher(): mInstancesCount(0)
+    {
+
+    }
+
+    bool InstanceBatcher::add(const RenderNode& node, std::size_t lod)
+    {
+        const ModelRenderNode* modelNode = dynamic_cast < const ModelRenderNode* >(&node);
+
+        if (!modelNode)
+            return false;
+
+        ModelPtr model = modelNode->model();
+
+        if (!model)
+            return false;
+
+        // Any other renderable may change the state between two nodes, so only the Model, the
+        // Transformations (replaced by the instance matrix) and one Material are accepted.
+
+        const Material* nodeMaterial = nullptr;
+        const std::size_t renderablesCount = node.renderablesCount();
+
+        for (std::size_t i = 0; i < renderablesCount; ++i)
+        {
+            const Renderable& renderable = node.renderableAt(i);
+
+            if (&renderable == model.get() || dynamic_cast < const Transformation* >(&renderable))
+                continue;
+
+            const Material* material = dynamic_cast < const Material* >(&renderable);
+
+            if (!material || nodeMaterial || material->isTransparent())
+                return false;
+
+            nodeMaterial = material;
+        }
+
+        const SubModelList subModels = model->lodSubModels(std::min(lod, model->lodsCount() - 1));
+        const rmat4x4 matrix = node.worldMatrix();
+
+        for (const SubModelPtr& subModel : subModels)
+        {
+            if (!subModel)
+                continue;
+
+            MaterialPtr material = subModel->material();
+
+            GroupKey key;
+            key.infos = &subModel->vertexInfos();
+            key.indexes = subModel->hasIndexes() ? &subModel->indexes() : nullptr;
+            key.material = material.get();
+            key.nodeMaterial = nodeMaterial;
+
+            auto it = mGroupsIndex.find(key);
+
+            if (it == mGroupsIndex.end())
+            {
+                it = mGroupsIndex.emplace(key, mGroups.size()).first;
+                mGroups.push_back(Group{ subModel, nodeMaterial, {} });
+            }
+
+            mGroups[it->second].matrices.push_back(matrix);
+            mInstancesCount++;
+        }
+
+        return true;
+    }
+
+    std::size_t InstanceBatcher::flush(RenderCommand& command)
+    {
+        if (mGroups.empty())
+            return 0;
+
+        Renderer& renderer = command.renderer();
+
+        // Every matrix goes in the same range, group after group, converted to floats. The
+        // range is aligned on an instance, so the draws address it by instance index.
+
+        TransientRange range = renderer.transientRing().allocate(HBT::Vertex, mInstancesCount * InstanceSize, InstanceSize);
+
+        if (!range.isValid())
+            throw NullError("InstanceBatcher", "flush", "Null range allocated for %i instances.",
+                            static_cast < int >(mInstancesCount));
+
+        float* data = static_cast < float* >(range.data);
+
+        for (const Group& group : mGroups)
+        {
+            for (const rmat4x4& matrix : group.matrices)
+            {
+                for (int column = 0; column < 4; ++column)
+                {
+                    for (int row = 0; row < 4; ++row)
+                        *data++ = static_cast < float >(matrix[column][row]);
+                }
+            }
+        }
+
+        const RenderHdwBufferPtr& buffer = range.buffer;
+
+        CommandBuffer* commandBuffer = command.asCommandBuffer();
+        std::size_t first = range.offset / InstanceSize;
+        std::size_t drawsCount = 0;
+
+        for (const Group& group : mGroups)
+        {
+            SubModelRenderCachePtr cache = std::dynamic_pointer_cast < SubModelRenderCache >(group.subModel->cacheSync(renderer));
+
+            if (!cache)
+                throw NullError("InstanceBatcher", "flush", "SubModel's cache isn't a SubModelRenderCache.");
+
+            // Like SubModelRenderCache::renderSync(), nothing is drawn until the buffers hold
+            // the SubModel's data.
+
+            VertexInfosPtr infos;
+            IndexBufferDataPtr indexes;
+
+            if (!cache->drawn(infos, indexes))
+            {
+                first += group.matrices.size();
+                continue;
+            }
+
+            if (group.nodeMaterial)
+                group.nodeMaterial->renderSync(command);
+
+            if (commandBuffer)
+            {
+                commandBuffer->retain(infos);
+                commandBuffer->retain(indexes);
+                commandBuffer->drawInstanced(*infos, indexes.get(), *buffer, first, group.matrices.size());
+            }
+
+            else
+            {
+                DrawInstancedCommandPtr draw = renderer.newCommand < DrawInstancedCommand >();
+
+                if (!draw)
+                    throw NullError("InstanceBatcher", "flush", "Null DrawInstancedCommand created.");
+
+                draw->construct(infos, indexes, buffer, first, group.matrices.size());
+                command.addSubCommand(draw);
+            }
+
+            first += group.matrices.size();
+            drawsCount++;
+        }
+
+        clear();
+        return drawsCount;
+    }
+
+    void InstanceBatcher::clear()
+    {
+        mGroupsIndex.clear();
+        mGroups.clear();
+        mInstancesCount = 0;
+    }
+
+    std::size_t InstanceBatcher::groupsCount() const
+    {
+        return mGroups.size();
+    }
+
+    std::size_t InstanceBatcher::instancesCount() const
+    {
+        return mInstancesCount;
+    }
+}
@@ -0,0 +1,111 @@
+//
+//  InstanceBatcher.h
+//  atlre
+//
+//  Created by jacques tronconi on 21/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#ifndef ATL_INSTANCEBATCHER_H
+#define ATL_INSTANCEBATCHER_H
+
+#include "Platform.h"
+#include "RenderNode.h"
+#include "SubModel.h"
+#include "DrawInstancedCommand.h"
+
+#include <vector>
+#include <unordered_map>
+
+namespace Atl
+{
+    class InstanceBatcher;
+
+    //! @brief Pointer to an InstanceBatcher.
+    typedef std::shared_ptr < InstanceBatcher > InstanceBatcherPtr;
+
+    //! @brief Groups the SubModels of the nodes rendered in a frame to draw them with instancing.
+    //!
+    //! \ref add() takes the SubModels of a ModelRenderNode at the given level of detail, and
+    //! puts each of them in a group with the SubModels sharing its VertexInfos, IndexBufferData
+    //! and Material, along with the node's world matrix. \ref flush() then writes the matrices
+    //! of every group in one range of the Renderer's TransientRing, and renders each group with
+    //! a single DrawInstancedCommand: the number of draws grows with the number of different
+    //! meshes, not with the number of nodes.
+    //!
+    //! Each flush allocates its own range, valid until the frame retires, so the draws recorded
+    //! by a previous flush of the same frame keep their matrices. A batcher is not thread safe,
+    //! each rendering thread must have its own.
+    class EXPORTED InstanceBatcher
+    {
+        //! @brief What SubModels must share to be drawn together.
+        struct GroupKey
+        {
+            const VertexInfos* infos;
+            const IndexBufferData* indexes;
+            const Material* material;
+            const Material* nodeMaterial;
+
+            bool operator == (const GroupKey& rhs) const;
+        };
+
+        //! @brief Hashes a GroupKey.
+        struct GroupKeyHash
+        {
+            std::size_t operator () (const GroupKey& key) const;
+        };
+
+        //! @brief SubModels drawn with the same command.
+        struct Group
+        {
+            //! @brief The first SubModel added, whose cache is drawn.
+            SubModelPtr subModel;
+
+            //! @brief The Material renderable of the nodes, rendered before the draw. May be null.
+            const Material* nodeMaterial;
+
+            //! @brief The world matrix of each instance.
+            std::vector < rmat4x4 > matrices;
+        };
+
+        //! @brief Index of each group in mGroups.
+        std::unordered_map < GroupKey, std::size_t, GroupKeyHash > mGroupsIndex;
+
+        //! @brief The groups, in the order they were created.
+        std::vector < Group > mGroups;
+
+        //! @brief Number of SubModels added since the last flush.
+        std::size_t mInstancesCount;
+
+    public:
+        ATL_SHAREABLE(InstanceBatcher)
+
+        //! @brief The size of an instance's data: its world matrix, as 16 floats.
+        static constexpr std::size_t InstanceSize = 16 * sizeof(float);
+
+        //! @brief Constructs an empty batcher.
+        InstanceBatcher();
+
+        //! @brief Adds the SubModels of a node at a level of detail returned by
+        //! \ref RenderNode::selectLOD(). Returns false if the node can't be instanced,
+        //! in which case it must be rendered normally: only ModelRenderNodes whose renderables
+        //! are their Model, Transformations and at most one opaque Material are instanced.
+        bool add(const RenderNode& node, std::size_t lod = 0);
+
+        //! @brief Renders every group into a command, and removes them. Returns the number of
+        //! DrawInstancedCommands added.
+        //! @throw NotEnoughMemory if the TransientRing has no room for the matrices.
+        std::size_t flush(RenderCommand& command);
+
+        //! @brief Removes every group without rendering it.
+        void clear();
+
+        //! @brief Returns the number of groups added since the last flush.
+        std::size_t groupsCount() const;
+
+        //! @brief Returns the number of SubModels added since the last flush.
+        std::size_t instancesCount() const;
+    };
+}
+
+#endif // ATL_INSTANCEBATCHER_H
@@ -0,0 +1,212 @@
+//
+//  JobSystem.cpp
+//  atlre
+//
+//  Created by jacques tronconi on 16/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#include "JobSystem.h"
+
+namespace Atl
+{
+    //! @brief Index of the worker running on this thread, or npos for foreign threads.
+    static thread_local std::size_t tWorkerIndex = std::string::npos;
+
+    JobSystem::JobSystem(): mPending(0), mNextQueue(0), mStop(false)
+    {
+        std::unique_lock l(mWorkersMutex);
+        startWorkers(DefaultWorkerCount());
+    }
+
+    JobSystem::~JobSystem()
+    {
+        stopWorkers();
+    }
+
+    std::size_t JobSystem::DefaultWorkerCount()
+    {
+        const std::size_t hardware = std::thread::hardware_concurrency();
+        return hardware > 1 ? hardware - 1 : 1;
+    }
+
+    void JobSystem::setWorkerCount(std::size_t count)
+    {
+        std::lock_guard c(mConfigMutex);
+        stopWorkers();
+
+        std::vector < Job > orphans;
+
+        {
+            std::unique_lock l(mWorkersMutex);
+
+            for (std::unique_ptr < WorkerQueue >& queue : mQueues)
+            {
+                for (Job& job : queue->mJobs)
+                    orphans.push_back(std::move(job));
+            }
+
+            mQueues.clear();
+            mStop = false;
+            startWorkers(count);
+
+            if (!mQueues.empty())
+            {
+                for (Job& job : orphans)
+                    mQueues[0]->mJobs.push_back(std::move(job));
+
+                orphans.clear();
+            }
+        }
+
+        // With no workers, jobs submitted while we were restarting are executed here.
+
+        mPending -= orphans.size();
+
+        for (Job& job : orphans)
+            job();
+
+        mSleepCondition.notify_all();
+    }
+
+    std::size_t JobSystem::workerCount() const
+    {
+        std::shared_lock l(mWorkersMutex);
+        return mThreads.size();
+    }
+
+    void JobSystem::submit(Job job)
+    {
+        if (!job)
+            throw NullError("JobSystem", "submit", "Null job submitted.");
+
+        {
+            std::shared_lock l(mWorkersMutex);
+
+            if (!mQueues.empty())
+            {
+                const std::size_t index = tWorkerIndex < mQueues.size() ?
+                    tWorkerIndex : mNextQueue++ % mQueues.size();
+
+                {
+                    std::lock_guard ls(mSleepMutex);
+                    mPending++;
+                }
+
+                {
+                    std::lock_guard lq(mQueues[index]->mMutex);
+                    mQueues[index]->mJobs.push_back(std::move(job));
+                }
+
+                mSleepCondition.notify_one();
+                return;
+            }
+        }
+
+        // No worker: the job is executed directly.
+
+        job();
+    }
+
+    bool JobSystem::executeOne()
+    {
+        Job job;
+
+        {
+            std::shared_lock l(mWorkersMutex);
+
+            if (!pop(tWorkerIndex, job))
+                return false;
+        }
+
+        job();
+        return true;
+    }
+
+    bool JobSystem::pop(std::size_t index, Job& job)
+    {
+        const std::size_t count = mQueues.size();
+
+        if (!count)
+            return false;
+
+        // Our own deque first, from the back.
+
+        if (index < count)
+        {
+            WorkerQueue& queue = *mQueues[index];
+            std::lock_guard l(queue.mMutex);
+
+            if (!queue.mJobs.empty())
+            {
+                job = std::move(queue.mJobs.back());
+                queue.mJobs.pop_back();
+                mPending--;
+                return true;
+            }
+        }
+
+        // Then steal from the front of the other deques.
+
+        const std::size_t start = index < count ? index + 1 : mNextQueue.load();
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            WorkerQueue& queue = *mQueues[(start + i) % count];
+            std::lock_guard l(queue.mMutex);
+
+            if (!queue.mJobs.empty())
+            {
+                job = std::move(queue.mJobs.front());
+                queue.mJobs.pop_front();
+                mPending--;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void JobSystem::startWorkers(std::size_t count)
+    {
+        for (std::size_t i = 0; i < count; ++i)
+            mQueues.push_back(std::make_unique < WorkerQueue >());
+
+        for (std::size_t i = 0; i < count; ++i)
+            mThreads.emplace_back(&JobSystem::workerMain, this, i);
+    }
+
+    void JobSystem::stopWorkers()
+    {
+        {
+            std::lock_guard l(mSleepMutex);
+            mStop = true;
+        }
+
+        mSleepCondition.notify_all();
+
+        std::vector < std::thread > threads;
+
+        {
+            std::unique_lock l(mWorkersMutex);
+            threads.swap(mThreads);
+        }
+
+        for (std::thread& thread : threads)
+            thread.join();
+    }
+
+    void JobSystem::workerMain(std::size_t index)
+    {
+        tWorkerIndex = index;
+
+        while (!mStop)
+        {
+            if (executeOne())
+                continue;
+
+            std::unique_lock l(mSleepMutex);
+            mSleepCondition.wait(l, [this](){ return mStop.load() || mPending.load() > 0; });
+        }
+    }
+}
@@ -0,0 +1,194 @@
+//
+//  JobSystem.h
+//  atlre
+//
+//  Created by jacques tronconi on 16/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#ifndef ATL_JOBSYSTEM_H
+#define ATL_JOBSYSTEM_H
+
+#include "Error.h"
+#include "Singleton.h"
+
+#include <chrono>
+#include <deque>
+#include <future>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+#include <shared_mutex>
+#include <type_traits>
+
+namespace Atl
+{
+    //! @brief Defines a work-stealing scheduler used by the whole engine instead of
+    //! spawning a new thread with std::async() for every asynchroneous call.
+    //!
+    //! Each worker owns a deque of jobs. A job submitted from a worker is pushed to
+    //! the back of its own deque and is popped back by this worker (LIFO, which keeps
+    //! the data hot), while idle workers steal jobs from the front of the other deques.
+    //! Jobs submitted from a foreign thread are distributed over the workers.
+    //!
+    //! Waiting on a job must be done with \ref wait() when inside a job: the waiting
+    //! thread executes other jobs until the waited one is done, so a blocked worker
+    //! never starves the scheduler.
+    class EXPORTED JobSystem : public Singleton < JobSystem >
+    {
+    public:
+
+        //! @brief Defines a job.
+        typedef std::function < void(void) > Job;
+
+    private:
+
+        //! @brief Defines the deque owned by one worker.
+        struct WorkerQueue
+        {
+            //! @brief The jobs to execute.
+            std::deque < Job > mJobs;
+
+            //! @brief Protects mJobs.
+            std::mutex mMutex;
+        };
+
+        //! @brief The workers deques, one per worker.
+        std::vector < std::unique_ptr < WorkerQueue > > mQueues;
+
+        //! @brief The workers threads.
+        std::vector < std::thread > mThreads;
+
+        //! @brief Protects mQueues and mThreads while workers are restarted.
+        mutable std::shared_mutex mWorkersMutex;
+
+        //! @brief Serializes calls to \ref setWorkerCount().
+        std::mutex mConfigMutex;
+
+        //! @brief Number of jobs pushed but not yet popped.
+        std::atomic < std::size_t > mPending;
+
+        //! @brief Used to distribute jobs submitted from foreign threads.
+        std::atomic < std::size_t > mNextQueue;
+
+        //! @brief True when workers must exit.
+        std::atomic < bool > mStop;
+
+        //! @brief Mutex used by idle workers.
+        std::mutex mSleepMutex;
+
+        //! @brief Condition used to wake idle workers.
+        std::condition_variable mSleepCondition;
+
+        //! @brief The longest time \ref wait() blocks on a future when no job is pending,
+        //! before looking for jobs submitted meanwhile.
+        static constexpr std::chrono::milliseconds WaitSlice = std::chrono::milliseconds(1);
+
+    public:
+
+        //! @brief Constructs the JobSystem with \ref DefaultWorkerCount() workers.
+        JobSystem();
+
+        //! @brief Stops and joins every worker. Remaining jobs are not executed.
+        ~JobSystem();
+
+        //! @brief Returns the number of workers used by default, which is the number
+        //! of hardware threads minus one (the calling thread helps when waiting).
+        static std::size_t DefaultWorkerCount();
+
+        //! @brief Changes the number of workers. Jobs already submitted are kept and
+        //! executed by the new workers. A count of zero makes \ref async() execute the
+        //! jobs directly on the calling thread.
+        void setWorkerCount(std::size_t count);
+
+        //! @brief Returns the number of workers.
+        std::size_t workerCount() const;
+
+        //! @brief Submits a function to the scheduler and returns a future on its result.
+        //! @note Contrary to std::async(), the returned future does not wait in its
+        //! destructor. Every data referenced by the function must live until the job
+        //! has been executed.
+        template < typename Function >
+        std::future < std::invoke_result_t < Function > > async(Function&& fun)
+        {
+            typedef std::invoke_result_t < Function > Return;
+            typedef std::packaged_task < Return(void) > PackagedTask;
+
+            auto task = std::make_shared < PackagedTask >(std::forward < Function >(fun));
+            std::future < Return > result = task->get_future();
+
+            submit([task](){ (*task)(); });
+            return result;
+        }
+
+        //! @brief Waits for the given future by executing other jobs until it is ready,
+        //! and returns its value. Exceptions thrown by the job are rethrown here.
+        //! An invalid std::future < void > (returned by renderables having nothing to do)
+        //! returns immediately.
+        template < typename Return >
+        Return wait(std::future < Return > future)
+        {
+            return waitFuture(future);
+        }
+
+        //! @brief Waits for the given shared future like \ref wait(), without consuming it.
+        template < typename Return >
+        decltype(auto) wait(const std::shared_future < Return >& future)
+        {
+            return waitFuture(future);
+        }
+
+        //! @brief Submits a job.
+        void submit(Job job);
+
+        //! @brief Executes one pending job on the calling thread, taken from the calling
+        //! worker's deque first and stolen from another deque otherwise. Returns false
+        //! if no job was available.
+        bool executeOne();
+
+    private:
+
+        //! @brief Executes other jobs until the future is ready, and returns its value. When
+        //! no job is pending, the thread blocks on the future for at most WaitSlice instead of
+        //! spinning.
+        template < typename Future >
+        decltype(auto) waitFuture(Future& future)
+        {
+            typedef decltype(future.get()) Return;
+
+            if (!future.valid())
+            {
+                if constexpr (std::is_void_v < Return >)
+                    return;
+                else
+                    throw NullError("JobSystem", "wait", "Invalid future.");
+            }
+
+            while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            {
+                if (!executeOne())
+                    future.wait_for(WaitSlice);
+            }
+
+            return future.get();
+        }
+
+        //! @brief Pops a job from the back of the deque at index, or steals one from the
+        //! front of the other deques. Must be called with mWorkersMutex shared locked.
+        bool pop(std::size_t index, Job& job);
+
+        //! @brief Starts count workers. Must be called with mWorkersMutex locked.
+        void startWorkers(std::size_t count);
+
+        //! @brief Stops and joins every worker. Must not be called with mWorkersMutex locked.
+        void stopWorkers();
+
+        //! @brief The function executed by each worker.
+        void workerMain(std::size_t index);
+    };
+}
+
+#endif // ATL_JOBSYSTEM_H
@@ -0,0 +1,433 @@
+//
+//  LooseOctree.cpp
+//  atlre
+//
+//  Created by jacques tronconi on 19/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#include "LooseOctree.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Atl
+{
+    //! @brief Number of bits of each coordinate in a cell's key.
+    static constexpr unsigned CoordinateBits = 20;
+
+    //! @brief Mask of a coordinate in a cell's key.
+    static constexpr std::uint64_t CoordinateMask = (std::uint64_t(1) << CoordinateBits) - 1;
+
+    //! @brief Packs a cell's key.
+    static std::uint64_t MakeCellKey(unsigned depth, std::uint64_t x, std::uint64_t y, std::uint64_t z)
+    {
+        return (std::uint64_t(depth) << (3 * CoordinateBits))
+             | (x << (2 * CoordinateBits))
+             | (y << CoordinateBits)
+             | z;
+    }
+
+    //! @brief Returns the depth of a cell from its key.
+    static unsigned CellDepth(std::uint64_t key)
+    {
+        return static_cast < unsigned >(key >> (3 * CoordinateBits));
+    }
+
+    //! @brief Returns the coordinate of a cell on the given axis from its key.
+    static std::uint64_t CellCoordinate(std::uint64_t key, int axis)
+    {
+        return (key >> ((2 - axis) * CoordinateBits)) & CoordinateMask;
+    }
+
+    //! @brief Returns the key of a cell's parent. The root cell must not be given.
+    static std::uint64_t ParentCellKey(std::uint64_t key)
+    {
+        return MakeCellKey(CellDepth(key) - 1,
+                           CellCoordinate(key, 0) >> 1,
+                           CellCoordinate(key, 1) >> 1,
+                           CellCoordinate(key, 2) >> 1);
+    }
+
+    LooseOctree::LooseOctree(const AABB& world, unsigned maxDepth)
+    : mOrigin(world.min), mSize(0), mMaxDepth(std::min(maxDepth, MaxDepthLimit)), mRoot(nullptr), mStructureVersion(0)
+    {
+        const rvec3 extent = world.max - world.min;
+        mSize = std::max(extent.x, std::max(extent.y, extent.z));
+
+        if (!(mSize > 0))
+            throw NullError("LooseOctree", "LooseOctree", "World AABB has no volume.");
+    }
+
+    void LooseOctree::build(const RenderNodePtr& root)
+    {
+        clear();
+        mRoot = root.get();
+
+        if (!root)
+            return;
+
+        // The version is read before walking the tree, so a change happening meanwhile makes
+        // the next comparison fail.
+
+        mStructureVersion = root->structureVersion();
+        SceneBVH::Collect(root, mEntries);
+
+        mPlacements.resize(mEntries.size(), Placement{ OutsideCell, 0 });
+
+        for (std::uint32_t i = 0; i < mEntries.size(); ++i)
+            insert(i, locate(mEntries[i].bounds, mEntries[i].hasBounds));
+    }
+
+    std::size_t LooseOctree::sync()
+    {
+        std::size_t moved = 0;
+
+        for (std::uint32_t i = 0; i < mEntries.size(); ++i)
+        {
+            Entry& entry = mEntries[i];
+            const std::uint32_t version = entry.node->aabbVersion();
+
+            if (version == entry.version)
+                continue;
+
+            entry.version = version;
+
+            const bool hasBounds = entry.node->hasAABB();
+            update(i, hasBounds ? entry.node->aabb() : AABB(), hasBounds);
+
+            moved++;
+        }
+
+        return moved;
+    }
+
+    void LooseOctree::update(std::uint32_t idx, const AABB& bounds, bool hasBounds)
+    {
+        if (idx >= mEntries.size())
+            throw OutOfRange("LooseOctree", "update", "Index %i out of range.", (int)idx);
+
+        mEntries[idx].bounds = bounds;
+        mEntries[idx].hasBounds = hasBounds;
+
+        // Most moves stay in the same cell, where there is nothing else to do.
+
+        const std::uint64_t key = locate(bounds, hasBounds);
+
+        if (key == mPlacements[idx].cell)
+            return;
+
+        remove(idx);
+        insert(idx, key);
+    }
+
+    void LooseOctree::clear()
+    {
+        mEntries.clear();
+        mPlacements.clear();
+        mCells.clear();
+        mOutside.clear();
+        mRoot = nullptr;
+        mStructureVersion = 0;
+    }
+
+    template < typename Test >
+    void LooseOctree::queryCell(std::uint64_t key, Frustum::PlaneMask mask, const Test& test,
+                                std::vector < std::uint32_t >& visible) const
+    {
+        auto it = mCells.find(key);
+
+        if (it == mCells.end())
+            return;
+
+        // A cell fully inside the frustum clears the mask, and its content isn't tested anymore.
+
+        if (mask && !test(looseBounds(key), mask))
+            return;
+
+        const Cell& cell = it->second;
+
+        for (std::uint32_t idx : cell.entries)
+        {
+            const Entry& entry = mEntries[idx];
+            Frustum::PlaneMask entryMask = mask;
+
+            if (mask && !test(entry.bounds, entryMask))
+                continue;
+
+            if (SceneBVH::IsEntryVisible(mEntries, idx))
+                visible.push_back(idx);
+        }
+
+        const unsigned depth = CellDepth(key);
+
+        if (depth == mMaxDepth || cell.count == cell.entries.size())
+            return;
+
+        const std::uint64_t x = CellCoordinate(key, 0) << 1;
+        const std::uint64_t y = CellCoordinate(key, 1) << 1;
+        const std::uint64_t z = CellCoordinate(key, 2) << 1;
+
+        for (unsigned child = 0; child < 8; ++child)
+        {
+            queryCell(MakeCellKey(depth + 1, x | (child & 1), y | ((child >> 1) & 1), z | ((child >> 2) & 1)),
+                      mask, test, visible);
+        }
+    }
+
+    void LooseOctree::query(const Frustum& frustum, std::vector < std::uint32_t >& visible) const
+    {
+        auto test = [&frustum](const AABB& bounds, Frustum::PlaneMask& mask)
+        {
+            return frustum.isBoxVisible(bounds.min, bounds.max, mask);
+        };
+
+        for (std::uint32_t idx : mOutside)
+        {
+            const Entry& entry = mEntries[idx];
+            Frustum::PlaneMask mask = Frustum::AllPlanes;
+
+            if (entry.hasBounds && !test(entry.bounds, mask))
+                continue;
+
+            if (SceneBVH::IsEntryVisible(mEntries, idx))
+                visible.push_back(idx);
+        }
+
+        queryCell(0, Frustum::AllPlanes, test, visible);
+    }
+
+    void LooseOctree::querySphere(const rvec3& center, Real radius, std::vector < std::uint32_t >& visible) const
+    {
+        const Real squaredRadius = radius * radius;
+
+        auto test = [&center, squaredRadius](const AABB& bounds, Frustum::PlaneMask&)
+        {
+            const rvec3 nearest = glm::clamp(center, bounds.min, bounds.max);
+            const rvec3 delta = nearest - center;
+            return glm::dot(delta, delta) <= squaredRadius;
+        };
+
+        for (std::uint32_t idx : mOutside)
+        {
+            const Entry& entry = mEntries[idx];
+            Frustum::PlaneMask mask = Frustum::AllPlanes;
+
+            if (entry.hasBounds && test(entry.bounds, mask) && SceneBVH::IsEntryVisible(mEntries, idx))
+                visible.push_back(idx);
+        }
+
+        queryCell(0, Frustum::AllPlanes, test, visible);
+    }
+
+    void LooseOctree::queryRay(const rvec3& origin, const rvec3& direction, Real maxDistance,
+                               std::vector < std::uint32_t >& visible) const
+    {
+        // Slabs test. An axis parallel to the ray only checks the origin is between the slabs.
+
+        auto test = [&origin, &direction, maxDistance](const AABB& bounds, Frustum::PlaneMask&)
+        {
+            Real enter = 0;
+            Real exit = maxDistance;
+
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                const Real o = origin[axis];
+                const Real d = direction[axis];
+
+                if (d == 0)
+                {
+                    if (o < bounds.min[axis] || o > bounds.max[axis])
+                        return false;
+
+                    continue;
+                }
+
+                Real t0 = (bounds.min[axis] - o) / d;
+                Real t1 = (bounds.max[axis] - o) / d;
+
+                if (t0 > t1)
+                    std::swap(t0, t1);
+
+                enter = std::max(enter, t0);
+                exit = std::min(exit, t1);
+
+                if (enter > exit)
+                    return false;
+            }
+
+            return true;
+        };
+
+        for (std::uint32_t idx : mOutside)
+        {
+            const Entry& entry = mEntries[idx];
+            Frustum::PlaneMask mask = Frustum::AllPlanes;
+
+            if (entry.hasBounds && test(entry.bounds, mask) && SceneBVH::IsEntryVisible(mEntries, idx))
+                visible.push_back(idx);
+        }
+
+        queryCell(0, Frustum::AllPlanes, test, visible);
+    }
+
+    void LooseOctree::queryAll(std::vector < std::uint32_t >& visible) const
+    {
+        for (std::uint32_t idx = 0; idx < mEntries.size(); ++idx)
+        {
+            if (SceneBVH::IsEntryVisible(mEntries, idx))
+                visible.push_back(idx);
+        }
+    }
+
+    const LooseOctree::Entry& LooseOctree::entryAt(std::size_t idx) const
+    {
+        if (idx >= mEntries.size())
+            throw OutOfRange("LooseOctree", "entryAt", "Index %i out of range.", (int)idx);
+
+        return mEntries[idx];
+    }
+
+    std::size_t LooseOctree::size() const
+    {
+        return mEntries.size();
+    }
+
+    std::size_t LooseOctree::cellsCount() const
+    {
+        return mCells.size();
+    }
+
+    AABB LooseOctree::world() const
+    {
+        return AABB{ mOrigin, mOrigin + rvec3(mSize, mSize, mSize) };
+    }
+
+    unsigned LooseOctree::maxDepth() const
+    {
+        return mMaxDepth;
+    }
+
+    const RenderNode* LooseOctree::root() const
+    {
+        return mRoot;
+    }
+
+    std::uint32_t LooseOctree::structureVersion() const
+    {
+        return mStructureVersion;
+    }
+
+    std::uint64_t LooseOctree::locate(const AABB& bounds, bool hasBounds) const
+    {
+        if (!hasBounds)
+            return OutsideCell;
+
+        const rvec3 position = bounds.center() - mOrigin;
+        const rvec3 extent = bounds.max - bounds.min;
+        const Real size = std::max(extent.x, std::max(extent.y, extent.z));
+
+        if (!(size <= mSize))
+            return OutsideCell;
+
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            if (!(position[axis] >= 0 && position[axis] < mSize))
+                return OutsideCell;
+        }
+
+        // The deepest cell whose size is at least the entry's size: 2^depth <= mSize / size.
+        // Its loose bounds overflow the cell by half its size, which holds the entry as long
+        // as its center is in the cell.
+
+        unsigned depth = mMaxDepth;
+
+        if (size > 0)
+        {
+            const int exponent = std::ilogb(mSize / size);
+            depth = static_cast < unsigned >(std::max(0, std::min(exponent, static_cast < int >(mMaxDepth))));
+        }
+
+        const std::uint64_t cells = std::uint64_t(1) << depth;
+        const Real scale = static_cast < Real >(cells) / mSize;
+
+        auto coordinate = [&](int axis)
+        {
+            const std::uint64_t value = static_cast < std::uint64_t >(position[axis] * scale);
+            return std::min(value, cells - 1);
+        };
+
+        return MakeCellKey(depth, coordinate(0), coordinate(1), coordinate(2));
+    }
+
+    AABB LooseOctree::looseBounds(std::uint64_t key) const
+    {
+        const Real cellSize = mSize / static_cast < Real >(std::uint64_t(1) << CellDepth(key));
+        const rvec3 cell(static_cast < Real >(CellCoordinate(key, 0)),
+                         static_cast < Real >(CellCoordinate(key, 1)),
+                         static_cast < Real >(CellCoordinate(key, 2)));
+
+        const rvec3 min = mOrigin + (cell - rvec3(0.5, 0.5, 0.5)) * cellSize;
+        return AABB{ min, min + rvec3(2 * cellSize, 2 * cellSize, 2 * cellSize) };
+    }
+
+    void LooseOctree::insert(std::uint32_t idx, std::uint64_t key)
+    {
+        if (key == OutsideCell)
+        {
+            mPlacements[idx] = Placement{ OutsideCell, static_cast < std::uint32_t >(mOutside.size()) };
+            mOutside.push_back(idx);
+            return;
+        }
+
+        Cell& cell = mCells[key];
+        mPlacements[idx] = Placement{ key, static_cast < std::uint32_t >(cell.entries.size()) };
+        cell.entries.push_back(idx);
+        cell.count++;
+
+        // Parents count the entry too, so queries know which children to visit.
+
+        while (CellDepth(key) > 0)
+        {
+            key = ParentCellKey(key);
+            mCells[key].count++;
+        }
+    }
+
+    void LooseOctree::remove(std::uint32_t idx)
+    {
+        const Placement placement = mPlacements[idx];
+
+        // The last entry of the list takes the place of the removed one.
+
+        auto swapRemove = [this, &placement](std::vector < std::uint32_t >& entries)
+        {
+            const std::uint32_t last = entries.back();
+            entries[placement.slot] = last;
+            mPlacements[last].slot = placement.slot;
+            entries.pop_back();
+        };
+
+        if (placement.cell == OutsideCell)
+        {
+            swapRemove(mOutside);
+            return;
+        }
+
+        std::uint64_t key = placement.cell;
+        swapRemove(mCells[key].entries);
+
+        for (;;)
+        {
+            auto it = mCells.find(key);
+
+            if (!--it->second.count)
+                mCells.erase(it);
+
+            if (!CellDepth(key))
+                break;
+
+            key = ParentCellKey(key);
+        }
+    }
+}
@@ -0,0 +1,195 @@
+//
+//  LooseOctree.h
+//  atlre
+//
+//  Created by jacques tronconi on 19/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#ifndef ATL_LOOSEOCTREE_H
+#define ATL_LOOSEOCTREE_H
+
+#include "Platform.h"
+#include "SceneBVH.h"
+
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+
+namespace Atl
+{
+    class LooseOctree;
+
+    //! @brief Pointer to a LooseOctree.
+    typedef std::shared_ptr < LooseOctree > LooseOctreePtr;
+
+    //! @brief A loose octree over the world AABB of every RenderNode in a tree.
+    //!
+    //! The octree covers a fixed cubic region of the world. Each cell at depth d has a size of
+    //! worldSize / 2^d, and its loose bounds are twice as large, centered on it. An entry is
+    //! stored in the deepest cell whose size is at least its extent, chosen from the center of
+    //! its AABB: as the entry then always fits in the loose bounds, its cell is computed in
+    //! constant time, without descending the tree. When a node moves, \ref sync() only moves
+    //! its entry from one cell to another.
+    //!
+    //! Cells are kept in a hash map and created only when an entry is stored in them or in one
+    //! of their children. Entries without AABB, outside the world or larger than it are kept
+    //! in a separate list tested one by one.
+    //!
+    //! Queries write the index of the matching entries in a flat array, to be read with
+    //! \ref entryAt(). Entries are the same as \ref SceneBVH::Entry, so a RenderTechnique
+    //! renders both the same way.
+    class EXPORTED LooseOctree
+    {
+    public:
+
+        //! @brief An entry of the octree.
+        typedef SceneBVH::Entry Entry;
+
+        //! @brief Default maximum depth of the cells.
+        static constexpr unsigned DefaultMaxDepth = 8;
+
+        //! @brief Greatest maximum depth allowed, bound by the size of the cells keys.
+        static constexpr unsigned MaxDepthLimit = 15;
+
+    private:
+
+        //! @brief Key of the list of entries which are not in a cell.
+        static constexpr std::uint64_t OutsideCell = ~std::uint64_t(0);
+
+        //! @brief A cell of the octree.
+        struct Cell
+        {
+            //! @brief Index of the entries stored in this cell.
+            std::vector < std::uint32_t > entries;
+
+            //! @brief Number of entries stored in this cell and all its children.
+            std::uint32_t count = 0;
+        };
+
+        //! @brief Where an entry is stored.
+        struct Placement
+        {
+            //! @brief Key of the cell, or OutsideCell.
+            std::uint64_t cell;
+
+            //! @brief Position of the entry in the cell's entries, or in mOutside.
+            std::uint32_t slot;
+        };
+
+        //! @brief Every RenderNode of the tree.
+        std::vector < Entry > mEntries;
+
+        //! @brief Placement of each entry.
+        std::vector < Placement > mPlacements;
+
+        //! @brief The non empty cells, by key. A key packs the depth on 4 bits and the cell's
+        //! coordinates at this depth on 20 bits each.
+        std::unordered_map < std::uint64_t, Cell > mCells;
+
+        //! @brief Index of the entries without AABB, or not fitting in the root cell.
+        std::vector < std::uint32_t > mOutside;
+
+        //! @brief Minimum corner of the root cell.
+        rvec3 mOrigin;
+
+        //! @brief Size of the root cell on each axis.
+        Real mSize;
+
+        //! @brief Depth of the smallest cells.
+        unsigned mMaxDepth;
+
+        //! @brief The root RenderNode, used only to compare with the scene's root.
+        const RenderNode* mRoot;
+
+        //! @brief The \ref RenderNode::structureVersion() of the root when built.
+        std::uint32_t mStructureVersion;
+
+    public:
+        ATL_SHAREABLE(LooseOctree)
+
+        //! @brief Constructs an empty octree.
+        //! @param world The region covered by the octree. It is extended to a cube on its
+        //! largest axis.
+        //! @param maxDepth Depth of the smallest cells, clamped to MaxDepthLimit.
+        LooseOctree(const AABB& world, unsigned maxDepth = DefaultMaxDepth);
+
+        //! @brief Collects every RenderNode in the tree and stores them in the cells. Previous
+        //! entries are removed.
+        void build(const RenderNodePtr& root);
+
+        //! @brief Moves the entries of the RenderNodes whose \ref RenderNode::aabbVersion()
+        //! changed to their new cell. Returns the number of moved entries.
+        std::size_t sync();
+
+        //! @brief Changes the bounds of the entry at idx and moves it to its new cell.
+        void update(std::uint32_t idx, const AABB& bounds, bool hasBounds);
+
+        //! @brief Removes every entry.
+        void clear();
+
+        //! @brief Adds to visible the index of every visible entry whose AABB is in the
+        //! frustum, and every visible entry without AABB.
+        void query(const Frustum& frustum, std::vector < std::uint32_t >& visible) const;
+
+        //! @brief Adds to visible the index of every visible entry whose AABB intersects the
+        //! sphere. Entries without AABB are not returned.
+        void querySphere(const rvec3& center, Real radius, std::vector < std::uint32_t >& visible) const;
+
+        //! @brief Adds to visible the index of every visible entry whose AABB is hit by the
+        //! ray, up to maxDistance. Entries without AABB are not returned.
+        //! @param origin The origin of the ray.
+        //! @param direction The direction of the ray. It doesn't need to be normalized, in
+        //! which case maxDistance is in units of its length.
+        //! @param maxDistance The distance after which boxes are not hit anymore.
+        void queryRay(const rvec3& origin, const rvec3& direction, Real maxDistance,
+                      std::vector < std::uint32_t >& visible) const;
+
+        //! @brief Adds to visible the index of every visible entry.
+        void queryAll(std::vector < std::uint32_t >& visible) const;
+
+        //! @brief Returns the entry at given index.
+        const Entry& entryAt(std::size_t idx) const;
+
+        //! @brief Returns the number of entries.
+        std::size_t size() const;
+
+        //! @brief Returns the number of non empty cells.
+        std::size_t cellsCount() const;
+
+        //! @brief Returns the region covered by the root cell.
+        AABB world() const;
+
+        //! @brief Returns the depth of the smallest cells.
+        unsigned maxDepth() const;
+
+        //! @brief Returns the root RenderNode the octree has been built from.
+        const RenderNode* root() const;
+
+        //! @brief Returns the \ref RenderNode::structureVersion() of the root when built.
+        std::uint32_t structureVersion() const;
+
+    private:
+
+        //! @brief Returns the key of the cell where bounds must be stored, or OutsideCell.
+        std::uint64_t locate(const AABB& bounds, bool hasBounds) const;
+
+        //! @brief Returns the loose bounds of the cell with the given key.
+        AABB looseBounds(std::uint64_t key) const;
+
+        //! @brief Stores the entry at idx in the cell with the given key.
+        void insert(std::uint32_t idx, std::uint64_t key);
+
+        //! @brief Removes the entry at idx from its cell.
+        void remove(std::uint32_t idx);
+
+        //! @brief Adds the visible entries of the cell with the given key and its children.
+        //! test(bounds, mask) returns false if bounds must be rejected, and clears mask when
+        //! the content of bounds doesn't need to be tested anymore.
+        template < typename Test >
+        void queryCell(std::uint64_t key, Frustum::PlaneMask mask, const Test& test,
+                       std::vector < std::uint32_t >& visible) const;
+    };
+}
+
+#endif // ATL_LOOSEOCTREE_H
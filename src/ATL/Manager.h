@@ -13,6 +13,7 @@
 #include "Error.h"
 #include "Singleton.h"
 #include "Emitter.h"
+#include "JobSystem.h"
 
 #include <memory>
 #include <vector>
@@ -105,11 +106,11 @@ namespace Atl
         template < typename... Args >
         PromRes loadOrGet(const std::string& name, Args&&... args)
         {
-            return std::async(std::launch::async, [this, &name, &args...]()
+            return JobSystem::Get().async([this, &name, &args...]()
             {
                 // Tries to find the resource by name.
-                auto resource = find(name).get();
-                return resource ? resource : load(name, std::forward < Args >(args)...).get();
+                auto resource = JobSystem::Get().wait(find(name));
+                return resource ? resource : JobSystem::Get().wait(load(name, std::forward < Args >(args)...));
             });
         }
         
@@ -119,7 +120,7 @@ namespace Atl
         //! pointer is returned.
         PromRes find(const std::string& name)
         {
-            return std::async(std::launch::async, [this, &name]()
+            return JobSystem::Get().async([this, &name]()
             {
                 std::lock_guard l(mMutex);
                 
@@ -143,7 +144,7 @@ namespace Atl
         template < typename... Args >
         PromRes load(const std::string& name, Args&&... args)
         {
-            return std::async(std::launch::async, [this, &name, &args...]()
+            return JobSystem::Get().async([this, &name, &args...]()
             {
                 // Tries to create a resource with this manager.
                 ShRes resource = std::make_shared < Res >((ManagerClass&)*this, name);
@@ -158,7 +159,7 @@ namespace Atl
                 resource->addListener(this->shared_from_this());
                 
                 // Now let the loader loads itself (synchroneously to this function).
-                resource->load(std::forward < Args >(args)...).get();
+                JobSystem::Get().wait(resource->load(std::forward < Args >(args)...));
                 
                 // Adds the resource to this manager.
                 {
@@ -186,17 +187,17 @@ namespace Atl
         template < typename... Args >
         std::future < void > unload(const std::string& name, Args&&... args)
         {
-            return std::async(std::launch::async, [this, &name, &args...]()
+            return JobSystem::Get().async([this, &name, &args...]()
             {
                 // Tries to find the resource.
-                auto resource = find(name);
+                auto resource = JobSystem::Get().wait(find(name));
                 
                 if (!resource)
                     throw NoResourceFound("Manager", "unload", "Resource %s not found.",
                                           name.data());
                 
                 // Calls T::unload() with args.
-                resource->unload(std::forward < Args >(args)...);
+                JobSystem::Get().wait(resource->unload(std::forward < Args >(args)...));
             });
         }
         
@@ -207,16 +208,16 @@ namespace Atl
         //! want to wait for the future, please use \ref std::future::get().
         std::future < void > remove(const std::string& name)
         {
-            return std::async(std::launch::async, [this, &name]()
+            return JobSystem::Get().async([this, &name]()
             {
                 // Tries to find the resource.
-                auto resource = find(name).get();
+                auto resource = JobSystem::Get().wait(find(name));
                 
                 if (!resource)
                     throw NoResourceFound("Manager", "unload", "Resource %s not found.",
                                           name.data());
                 
-                return remove(resource).get();
+                return JobSystem::Get().wait(remove(resource));
             });
         }
         
@@ -226,7 +227,7 @@ namespace Atl
         //! want to wait for the future, please use \ref std::future::get().
         std::future < void > remove(const ShRes& resource)
         {
-            return std::async(std::launch::async, [this, &resource]()
+            return JobSystem::Get().async([this, &resource]()
             {
                 bool didRemove = false;
 
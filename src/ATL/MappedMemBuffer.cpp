@@ -0,0 +1,273 @@
+//
+//  MappedMemBuffer.cpp
+//  atlre
+//
+//  Created by jacques tronconi on 30/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#include "MappedMemBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(_WIN32)
+#   ifndef NOMINMAX
+#       define NOMINMAX
+#   endif
+#   include <windows.h>
+#else
+#   include <cerrno>
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+
+namespace Atl
+{
+    namespace
+    {
+        //! @brief Returns the alignment of a view's offset in its file.
+        std::size_t Granularity()
+        {
+#if defined(_WIN32)
+            SYSTEM_INFO infos;
+            GetSystemInfo(&infos);
+            return static_cast < std::size_t >(infos.dwAllocationGranularity);
+#else
+            return static_cast < std::size_t >(sysconf(_SC_PAGESIZE));
+#endif
+        }
+
+        //! @brief Returns size, or the rest of the file if zero, after checking the region is in
+        //! the file.
+        std::size_t RegionSize(const std::string& path, std::uint64_t fileSize, std::size_t offset, std::size_t size)
+        {
+            if (offset > fileSize || size > fileSize - offset)
+                throw OutOfRange("MappedMemBuffer", "MappedMemBuffer", "Region of %i bytes at %i out of file '%s' of %i bytes.",
+                                 static_cast < int >(size), static_cast < int >(offset), path.c_str(),
+                                 static_cast < int >(fileSize));
+
+            return size ? size : static_cast < std::size_t >(fileSize - offset);
+        }
+    }
+
+    MappedMemBuffer::MappedMemBuffer(const std::string& path, std::size_t offset, std::size_t size,
+                                     MappedMemBufferMode mode, const HBT& type)
+    : MemBuffer(type), mMode(mode), mView(nullptr), mViewSize(0), mData(nullptr), mSize(0), mIsMapped(false)
+    {
+        // A view starts on the system's granularity, so the region is at delta in it.
+
+        const std::size_t delta = offset % Granularity();
+        const bool isCopyOnWrite = mode == MappedMemBufferMode::CopyOnWrite;
+
+#if defined(_WIN32)
+        HANDLE file = CreateFileW(fs::path(path).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+        if (file == INVALID_HANDLE_VALUE)
+            throw MappedMemBufferError("MappedMemBuffer", "MappedMemBuffer", "Cannot open file '%s' (error %i).",
+                                       path.c_str(), static_cast < int >(GetLastError()));
+
+        LARGE_INTEGER fileSize;
+
+        if (!GetFileSizeEx(file, &fileSize))
+        {
+            const DWORD error = GetLastError();
+            CloseHandle(file);
+            throw MappedMemBufferError("MappedMemBuffer", "MappedMemBuffer", "Cannot get size of file '%s' (error %i).",
+                                       path.c_str(), static_cast < int >(error));
+        }
+
+        try
+        {
+            size = RegionSize(path, static_cast < std::uint64_t >(fileSize.QuadPart), offset, size);
+        }
+
+        catch (...)
+        {
+            CloseHandle(file);
+            throw;
+        }
+
+        if (size)
+        {
+            // The view holds a reference on the mapping, so both handles are closed once it
+            // is created.
+
+            HANDLE mapping = CreateFileMappingW(file, nullptr, isCopyOnWrite ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, nullptr);
+            const DWORD error = mapping ? 0 : GetLastError();
+            CloseHandle(file);
+
+            if (!mapping)
+                throw MappedMemBufferError("MappedMemBuffer", "MappedMemBuffer", "Cannot map file '%s' (error %i).",
+                                           path.c_str(), static_cast < int >(error));
+
+            const std::uint64_t viewOffset = static_cast < std::uint64_t >(offset - delta);
+            mViewSize = delta + size;
+            mView = MapViewOfFile(mapping, isCopyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ,
+                                  static_cast < DWORD >(viewOffset >> 32), static_cast < DWORD >(viewOffset & 0xFFFFFFFF),
+                                  mViewSize);
+
+            const DWORD viewError = mView ? 0 : GetLastError();
+            CloseHandle(mapping);
+
+            if (!mView)
+                throw MappedMemBufferError("MappedMemBuffer", "MappedMemBuffer", "Cannot map %i bytes of file '%s' (error %i).",
+                                           static_cast < int >(mViewSize), path.c_str(), static_cast < int >(viewError));
+        }
+
+        else
+        {
+            CloseHandle(file);
+        }
+#else
+        const int file = ::open(path.c_str(), O_RDONLY);
+
+        if (file < 0)
+            throw MappedMemBufferError("MappedMemBuffer", "MappedMemBuffer", "Cannot open file '%s': %s.",
+                                       path.c_str(), std::strerror(errno));
+
+        struct stat infos;
+
+        if (::fstat(file, &infos) != 0)
+        {
+            const int error = errno;
+            ::close(file);
+            throw MappedMemBufferError("MappedMemBuffer", "MappedMemBuffer", "Cannot get size of file '%s': %s.",
+                                       path.c_str(), std::strerror(error));
+        }
+
+        try
+        {
+            size = RegionSize(path, static_cast < std::uint64_t >(infos.st_size), offset, size);
+        }
+
+        catch (...)
+        {
+            ::close(file);
+            throw;
+        }
+
+        if (size)
+        {
+            // The mapping keeps the file open, so the descriptor is closed once it is created.
+
+            mViewSize = delta + size;
+            void* view = ::mmap(nullptr, mViewSize, isCopyOnWrite ? PROT_READ | PROT_WRITE : PROT_READ, MAP_PRIVATE,
+                                file, static_cast < off_t >(offset - delta));
+
+            const int error = errno;
+            ::close(file);
+
+            if (view == MAP_FAILED)
+                throw MappedMemBufferError("MappedMemBuffer", "MappedMemBuffer", "Cannot map %i bytes of file '%s': %s.",
+                                           static_cast < int >(mViewSize), path.c_str(), std::strerror(error));
+
+            // The region is read once, from the first byte to the last, by the upload.
+
+            mView = view;
+            ::madvise(mView, mViewSize, MADV_WILLNEED);
+        }
+
+        else
+        {
+            ::close(file);
+        }
+#endif
+
+        mData = mView ? static_cast < char* >(mView) + delta : nullptr;
+        mSize.store(size);
+        mIsMapped.store(mView != nullptr);
+    }
+
+    MappedMemBuffer::~MappedMemBuffer()
+    {
+        unmap();
+    }
+
+    MappedMemBufferMode MappedMemBuffer::mode() const
+    {
+        return mMode;
+    }
+
+    bool MappedMemBuffer::isMapped() const
+    {
+        return mIsMapped.load();
+    }
+
+    std::size_t MappedMemBuffer::size() const
+    {
+        return mIsMapped.load() ? mSize.load() : MemBuffer::size();
+    }
+
+    void MappedMemBuffer::allocate(const std::size_t& sz, const void* ptr)
+    {
+        if (mIsMapped.load())
+            detach(sz, ptr);
+        else
+            MemBuffer::allocate(sz, ptr);
+    }
+
+    void* MappedMemBuffer::data()
+    {
+        if (mIsMapped.load() && mMode == MappedMemBufferMode::ReadOnly)
+            detach(mSize.load(), nullptr);
+
+        return mIsMapped.load() ? mData : MemBuffer::data();
+    }
+
+    const void* MappedMemBuffer::data() const
+    {
+        return mIsMapped.load() ? mData : MemBuffer::data();
+    }
+
+    HardwareBufferPtr MappedMemBuffer::copy() const
+    {
+        if (!mIsMapped.load())
+            return MemBuffer::copy();
+
+        MemBufferPtr buffer = std::make_shared < MemBuffer >(mData, mSize.load());
+        buffer->setType(type());
+        return buffer;
+    }
+
+    void MappedMemBuffer::detach(std::size_t sz, const void* ptr)
+    {
+        // ptr may point in the region, so it is copied before unmapping.
+
+        if (ptr)
+        {
+            MemBuffer::allocate(sz, ptr);
+        }
+
+        else
+        {
+            const std::size_t kept = std::min(sz, mSize.load());
+            MemBuffer::allocate(sz);
+
+            if (kept)
+                std::memcpy(MemBuffer::data(), mData, kept);
+        }
+
+        mIsMapped.store(false);
+        unmap();
+    }
+
+    void MappedMemBuffer::unmap()
+    {
+        if (!mView)
+            return;
+
+#if defined(_WIN32)
+        UnmapViewOfFile(mView);
+#else
+        ::munmap(mView, mViewSize);
+#endif
+
+        mView = nullptr;
+        mViewSize = 0;
+        mData = nullptr;
+    }
+}
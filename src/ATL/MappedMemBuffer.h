@@ -0,0 +1,130 @@
+//
+//  MappedMemBuffer.h
+//  atlre
+//
+//  Created by jacques tronconi on 30/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#ifndef ATL_MAPPEDMEMBUFFER_H
+#define ATL_MAPPEDMEMBUFFER_H
+
+#include "HardwareBuffer.h"
+#include "Error.h"
+
+#include <atomic>
+#include <string>
+
+namespace Atl
+{
+    //! @brief Launched when a file cannot be mapped by a MappedMemBuffer.
+    struct EXPORTED MappedMemBufferError : public Error
+    { using Error::Error; };
+
+    //! @brief Enumerates the ways a MappedMemBuffer maps its file.
+    enum class MappedMemBufferMode
+    {
+        //! @brief The pages are read only. The first non const data() copies the region in
+        //! memory.
+        ReadOnly,
+
+        //! @brief The pages are private and writable. A page written is copied by the system,
+        //! and the file is never modified.
+        CopyOnWrite
+    };
+
+    //! @brief A MemBuffer reading its data directly from a region of a mapped file.
+    //!
+    //! A MemBuffer loaded from a file holds a zero initialized copy of its bytes, which is
+    //! copied again into the RenderHdwBuffer. A MappedMemBuffer maps the region instead: the
+    //! pages are read from the disk when the upload touches them, and no heap memory is used.
+    //! As it is a MemBuffer, it is accepted by VertexBufferBinding, IndexBufferData,
+    //! \ref RenderHdwBufferManager::findOrCreateRelated() and UploadQueue.
+    //!
+    //! The readers must use the const data(), like UploadQueue and findOrCreateRelated() do.
+    //! With \ref MappedMemBufferMode::ReadOnly, the non const data() copies the region in the
+    //! MemBuffer's memory, and unmaps the file. \ref allocate() does the same in both modes,
+    //! keeping the content if no data is given. \ref isMapped() tells if the mapping is still
+    //! used.
+    //!
+    //! The file may be closed, but must not be truncated while the region is mapped.
+    class EXPORTED MappedMemBuffer : public MemBuffer
+    {
+        //! @brief The mode of the mapping.
+        MappedMemBufferMode mMode;
+
+        //! @brief The mapped view, aligned on the system's granularity, or null.
+        void* mView;
+
+        //! @brief The size of mView.
+        std::size_t mViewSize;
+
+        //! @brief The region in mView.
+        char* mData;
+
+        //! @brief The size of the region.
+        std::atomic < std::size_t > mSize;
+
+        //! @brief True while the region is used instead of the MemBuffer's memory.
+        std::atomic < bool > mIsMapped;
+
+    public:
+
+        //! @brief Maps a region of a file.
+        //! @param path The file to map.
+        //! @param offset The first byte of the region in the file. It doesn't need to be aligned.
+        //! @param size The size of the region, or zero for the rest of the file.
+        //! @param mode How the region is mapped.
+        //! @param type The type of the buffer.
+        //! @throw MappedMemBufferError if the file cannot be opened or mapped.
+        //! @throw OutOfRange if the region is not in the file.
+        MappedMemBuffer(const std::string& path, std::size_t offset = 0, std::size_t size = 0,
+                        MappedMemBufferMode mode = MappedMemBufferMode::ReadOnly,
+                        const HBT& type = HBT::Vertex);
+
+        //! @brief Unmaps the region.
+        ~MappedMemBuffer();
+
+        MappedMemBuffer(const MappedMemBuffer&) = delete;
+        MappedMemBuffer& operator = (const MappedMemBuffer&) = delete;
+
+        //! @brief Returns the mode of the mapping.
+        MappedMemBufferMode mode() const;
+
+        //! @brief Returns true while the region is used instead of the MemBuffer's memory.
+        bool isMapped() const;
+
+        //! @brief Returns the buffer's size, in bytes. Doesn't lock the buffer while mapped.
+        std::size_t size() const;
+
+        //! @brief Copies the region in the MemBuffer's memory if it is mapped, unmaps it, and
+        //! allocates the memory like MemBuffer.
+        void allocate(const std::size_t& sz, const void* ptr = nullptr);
+
+        //! @brief Returns a writable pointer to the data. With MappedMemBufferMode::ReadOnly,
+        //! the region is copied and unmapped first.
+        //! @note You should use \ref lock() before using this function.
+        void* data();
+
+        //! @brief Returns a pointer to the data, in the mapping if it is used.
+        //! @note You should use \ref lock() before using this function.
+        const void* data() const;
+
+        //! @brief Creates a MemBuffer holding a copy of the data.
+        pointer_type copy() const;
+
+    private:
+
+        //! @brief Copies the region in the MemBuffer's memory and unmaps it. The buffer must be
+        //! locked.
+        void detach(std::size_t sz, const void* ptr);
+
+        //! @brief Unmaps mView, if any.
+        void unmap();
+    };
+
+    //! @brief Pointer to a MappedMemBuffer.
+    typedef std::shared_ptr < MappedMemBuffer > MappedMemBufferPtr;
+}
+
+#endif // ATL_MAPPEDMEMBUFFER_H
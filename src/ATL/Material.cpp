@@ -35,7 +35,7 @@ namespace Atl
     // Material
 
     Material::Material(Manager& rhs, const std::string& name)
-    : CachedRenderable(), TResource(rhs, name), mIsTransparent(false)
+    : CachedRenderable(), TResource(rhs, name), mIsTransparent(false), mIsUsingBlock(false)
     {
 
     }
@@ -67,6 +67,8 @@ namespace Atl
                     SVT::Float4);
             }
 
+            mBlock.write(MaterialElement::ColorAmbient, &color.values[0]);
+
             if (color.alpha < 1.0)
                 mIsTransparent = true;
         }
@@ -102,6 +104,8 @@ namespace Atl
                     SVT::Float4);   
             }
 
+            mBlock.write(MaterialElement::ColorDiffuse, &color.values[0]);
+
             if (color.alpha < 1.0)
                 mIsTransparent = true;
         }
@@ -137,6 +141,8 @@ namespace Atl
                     SVT::Float4);   
             }
 
+            mBlock.write(MaterialElement::ColorSpecular, &color.values[0]);
+
             if (color.alpha < 1.0)
                 mIsTransparent = true;
         }
@@ -172,6 +178,8 @@ namespace Atl
                     SVT::Float4);
             }
 
+            mBlock.write(MaterialElement::ColorEmissive, &color.values[0]);
+
             if (color.alpha < 1.0)
                 mIsTransparent = true;
         }
@@ -349,13 +357,18 @@ namespace Atl
             {
                 ShaderVariable& variable = findShaderVariableRef(MaterialElement::Shininess);
                 variable.setValue(&value);
-                return;
             }
 
-            mElements[MaterialElement::Shininess] = ShaderVariable(
-                kMaterialElementShininess,
-                &value,
-                SVT::Float1);
+            else
+            {
+                mElements[MaterialElement::Shininess] = ShaderVariable(
+                    kMaterialElementShininess,
+                    &value,
+                    SVT::Float1);
+            }
+
+            const float shininess = static_cast < float >(value);
+            mBlock.write(MaterialElement::Shininess, &shininess);
         }
 
         send(&Listener::onMaterialElementModified, *this, MaterialElement::Shininess);
@@ -454,4 +467,20 @@ namespace Atl
     {
         mIsTransparent = rhs;
     }
+
+    const MaterialBlock& Material::block() const
+    {
+        return mBlock;
+    }
+
+    void Material::setUsingBlock(bool value)
+    {
+        mIsUsingBlock = value;
+        CachedRenderable::touch();
+    }
+
+    bool Material::isUsingBlock() const
+    {
+        return mIsUsingBlock;
+    }
 }
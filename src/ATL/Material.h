@@ -11,9 +11,11 @@
 #include "CachedRenderable.h"
 #include "Resource.h"
 #include "MaterialElement.h"
+#include "MaterialBlock.h"
 #include "ShaderVariable.h"
 #include "Color.h"
 #include "Texture.h"
+#include "MakeUniqueIndex.h"
 
 namespace Atl
 {
@@ -40,12 +42,14 @@ namespace Atl
     //! in the ShaderProgram.
     //! A Material is also loadable, because you can have your own Material file format, or you
     //! can use other file formats.
+    //! Each Material has a unique index, used by RenderTechnique to group draws by Material.
     class Material : 
     virtual public CachedRenderable <
     Material >,
     virtual public TResource <
     Material,
-    MaterialManager >
+    MaterialManager >,
+    public MakeUniqueIndex < Material >
     {
     public:
         ATL_SHAREABLE(Material)
@@ -65,6 +69,13 @@ namespace Atl
         //! using set*() functions. You can also use \ref setIsTransparent() to force transparency.
         std::atomic < bool > mIsTransparent;
 
+        //! @brief The colors and the shininess, packed in a uniform block by the set*() functions.
+        MaterialBlock mBlock;
+
+        //! @brief True if MaterialCache binds \ref mBlock instead of one ShaderVariable per
+        //! color. Default is false, as the Renderer's shaders must declare the block.
+        std::atomic < bool > mIsUsingBlock;
+
         //! @brief The mutex.
         mutable std::mutex mMutex;
 
@@ -186,6 +197,17 @@ namespace Atl
 
         //! @brief Forces transparency support by setting \ref mIsTransparent to true.
         void setIsTransparent(bool rhs);
+
+        //! @brief Returns \ref mBlock. The Material must be locked with MaterialLockGuardCst as no
+        //! mutex locking is done in this function. Elements modified directly in \ref elements()
+        //! are not in the block.
+        const MaterialBlock& block() const;
+
+        //! @brief Sets \ref mIsUsingBlock.
+        void setUsingBlock(bool value);
+
+        //! @brief Returns \ref mIsUsingBlock.
+        bool isUsingBlock() const;
     };
     
     ATL_BASE_RESOURCE(Material)
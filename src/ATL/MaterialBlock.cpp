@@ -0,0 +1,111 @@
+//
+//  MaterialBlock.cpp
+//  atlre
+//
+//  Created by jacques tronconi on 24/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#include "MaterialBlock.h"
+#include "Error.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Atl
+{
+    MaterialBlock::MaterialBlock()
+    : mGeneration(0)
+    {
+        std::memset(mData, 0, Size);
+        mWritten.fill(0);
+
+        const float shininess = 1.0f;
+        std::memcpy(mData + OffsetOf(MaterialElement::Shininess), &shininess, sizeof(float));
+    }
+
+    bool MaterialBlock::HasElement(MaterialElement element)
+    {
+        switch (element)
+        {
+            case MaterialElement::ColorAmbient:
+            case MaterialElement::ColorDiffuse:
+            case MaterialElement::ColorSpecular:
+            case MaterialElement::ColorEmissive:
+            case MaterialElement::Shininess:
+                return true;
+
+            default:
+                return false;
+        }
+    }
+
+    std::size_t MaterialBlock::OffsetOf(MaterialElement element)
+    {
+        switch (element)
+        {
+            case MaterialElement::ColorAmbient: return 0;
+            case MaterialElement::ColorDiffuse: return 16;
+            case MaterialElement::ColorSpecular: return 32;
+            case MaterialElement::ColorEmissive: return 48;
+            case MaterialElement::Shininess: return 64;
+
+            default:
+                throw OutOfRange("MaterialBlock", "OffsetOf", "MaterialElement %i is not in the block.",
+                                 static_cast < int >(element));
+        }
+    }
+
+    std::size_t MaterialBlock::CountOf(MaterialElement element)
+    {
+        if (!HasElement(element))
+            throw OutOfRange("MaterialBlock", "CountOf", "MaterialElement %i is not in the block.",
+                             static_cast < int >(element));
+
+        return element == MaterialElement::Shininess ? 1 : 4;
+    }
+
+    void MaterialBlock::write(MaterialElement element, const float* values)
+    {
+        if (!values)
+            throw NullError("MaterialBlock", "write", "Null values passed.");
+
+        std::memcpy(mData + OffsetOf(element), values, CountOf(element) * sizeof(float));
+        mWritten[static_cast < std::size_t >(element)] = ++mGeneration;
+    }
+
+    const void* MaterialBlock::data() const
+    {
+        return mData;
+    }
+
+    std::uint64_t MaterialBlock::generation() const
+    {
+        return mGeneration;
+    }
+
+    bool MaterialBlock::dirtyRange(std::uint64_t since, std::size_t& offset, std::size_t& size) const
+    {
+        std::size_t first = Size;
+        std::size_t last = 0;
+
+        for (std::size_t i = 0; i < mWritten.size(); ++i)
+        {
+            if (mWritten[i] <= since)
+                continue;
+
+            const MaterialElement element = static_cast < MaterialElement >(i);
+            const std::size_t begin = OffsetOf(element);
+
+            first = std::min(first, begin);
+            last = std::max(last, begin + CountOf(element) * sizeof(float));
+        }
+
+        if (first >= last)
+            return false;
+
+        offset = first;
+        size = last - first;
+        return true;
+    }
+}
@@ -0,0 +1,87 @@
+//
+//  MaterialBlock.h
+//  atlre
+//
+//  Created by jacques tronconi on 24/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#ifndef ATL_MATERIALBLOCK_H
+#define ATL_MATERIALBLOCK_H
+
+#include "Platform.h"
+#include "MaterialElement.h"
+
+#include <array>
+#include <cstdint>
+
+namespace Atl
+{
+    //! @brief The values of a Material, packed in one uniform block.
+    //!
+    //! The layout is the same in std140 and std430, and matches this GLSL block:
+    //! @code
+    //! layout(std140) uniform MaterialBlock {
+    //!     vec4 ambient;     // offset 0
+    //!     vec4 diffuse;     // offset 16
+    //!     vec4 specular;    // offset 32
+    //!     vec4 emissive;    // offset 48
+    //!     float shininess;  // offset 64
+    //! };
+    //! @endcode
+    //!
+    //! Textures are not in the block. Each write increments the block's generation and stamps
+    //! the written element with it, so each MaterialCache uploads only the range written since
+    //! the generation it last uploaded, whatever the other caches did.
+    class EXPORTED MaterialBlock
+    {
+    public:
+
+        //! @brief The size of the block, rounded up to a vec4 as std140 requires.
+        static constexpr std::size_t Size = 80;
+
+        //! @brief The slot the block is bound to.
+        static constexpr unsigned Slot = 0;
+
+    private:
+
+        //! @brief The block's data.
+        alignas(16) unsigned char mData[Size];
+
+        //! @brief The generation of the last write.
+        std::uint64_t mGeneration;
+
+        //! @brief The generation of the last write of each element, zero if never written.
+        std::array < std::uint64_t, static_cast < std::size_t >(MaterialElement::Max) > mWritten;
+
+    public:
+
+        //! @brief Constructs a block with null colors and a shininess of 1.
+        MaterialBlock();
+
+        //! @brief Returns true if the element is in the block.
+        static bool HasElement(MaterialElement element);
+
+        //! @brief Returns the offset of an element. Throws OutOfRange if it is not in the block.
+        static std::size_t OffsetOf(MaterialElement element);
+
+        //! @brief Returns the number of floats of an element. Throws OutOfRange if it is not in
+        //! the block.
+        static std::size_t CountOf(MaterialElement element);
+
+        //! @brief Writes the floats of an element. Throws OutOfRange if it is not in the block.
+        void write(MaterialElement element, const float* values);
+
+        //! @brief Returns the block's data.
+        const void* data() const;
+
+        //! @brief Returns the generation of the last write.
+        std::uint64_t generation() const;
+
+        //! @brief Returns the range of bytes written after the given generation. Returns false
+        //! if nothing has been written since.
+        bool dirtyRange(std::uint64_t since, std::size_t& offset, std::size_t& size) const;
+    };
+}
+
+#endif // ATL_MATERIALBLOCK_H
@@ -7,58 +7,86 @@
 
 #include "MaterialCache.h"
 #include "Material.h"
+#include "CommandBuffer.h"
+#include "Renderer.h"
 
 namespace Atl
 {
     MaterialCache::MaterialCache(Renderer& rhs, Material& material)
-    : RenderCache(rhs, material)
+    : RenderCache(rhs, material), mIsUsingBlock(false), mBlockGeneration(0)
     {
         mCommands.resize(static_cast < int >(MaterialElement::Max), nullptr);
     }
 
-    std::future < void > MaterialCache::build(Renderer& rhs)
+    void MaterialCache::buildSync(Renderer& rhs)
     {
-        return std::async(std::launch::async, [this, &rhs]()
+        notify(&Listener::onRenderableWillBuild, (Renderable&)*this, rhs);
+
         {
-            send(&Listener::onRenderableWillBuild, (Renderable&)*this, rhs).get();
+            std::lock_guard l(mMutex);
+            MaterialLockGuard ll(mOwner);
+            Material::ElementMap& elements = mOwner.elements();
+
+            mIsUsingBlock = mOwner.isUsingBlock();
 
+            for (auto& pair : elements)
             {
-                std::lock_guard l(mMutex);
-                MaterialLockGuard ll(mOwner);
-                Material::ElementMap& elements = mOwner.elements();
+                ShaderVariableCommandPtr& command = mCommands[static_cast < int >(pair.first)];
 
-                for (auto& pair : elements)
-                {
-                    ShaderVariableCommandPtr& command = mCommands[static_cast < int >(pair.first)];
+                // Values in the block are bound all at once.
 
-                    if (command)
-                        command->setVariableValue(pair.second.value());
+                if (mIsUsingBlock && MaterialBlock::HasElement(pair.first))
+                    command = nullptr;
+
+                else if (command)
+                    command->setVariableValue(pair.second.value());
 
-                    else
-                    {
-                        command = rhs.newCommand < ShaderVariableCommand >();
-                        command->setShaderVariable(pair.second);
-                    }
+                else
+                {
+                    command = rhs.newCommand < ShaderVariableCommand >();
+                    command->setShaderVariable(pair.second);
                 }
             }
 
-            send(&Listener::onRenderableDidBuild, (Renderable&)*this, rhs).get();
-        });
+            if (mIsUsingBlock)
+                buildBlock(rhs);
+        }
+
+        notify(&Listener::onRenderableDidBuild, (Renderable&)*this, rhs);
     }
 
-    std::future < void > MaterialCache::render(RenderCommand& cmd) const
+    void MaterialCache::renderSync(RenderCommand& cmd) const
     {
-        return std::async(std::launch::async, [this, &cmd]()
+        notify(&Listener::onRenderableWillRender, (const Renderable&)*this, (RenderCommand&)cmd);
+
         {
-            send(&Listener::onRenderableWillRender, (const Renderable&)*this, (RenderCommand&)cmd).get();
+            std::lock_guard l(mMutex);
 
+            if (CommandBuffer* buffer = cmd.asCommandBuffer())
             {
-                std::lock_guard l(mMutex);
+                if (mIsUsingBlock && mBlockBuffer)
+                {
+                    buffer->retain(mBlockBuffer);
+                    buffer->bindBuffer(MaterialBlock::Slot, *mBlockBuffer, 0, MaterialBlock::Size);
+                }
+
+                for (auto const& command : mCommands)
+                {
+                    if (command)
+                        command->recordTo(*buffer);
+                }
+            }
+
+            else
+            {
+                if (mIsUsingBlock && mBindBlock)
+                    cmd.addSubCommand(mBindBlock);
+
                 cmd.addSubCommands(mCommands, true);
             }
+        }
 
-            send(&Listener::onRenderableDidRender, (const Renderable&)*this, (RenderCommand&)cmd).get();
-        });
+        notify(&Listener::onRenderableDidRender, (const Renderable&)*this, (RenderCommand&)cmd);
     }
 
     std::size_t MaterialCache::size(Renderer&) const
@@ -74,6 +102,40 @@ namespace Atl
             total += command->variableValueSize();
         }
 
+        if (mBlockBuffer)
+            total += mBlockBuffer->size();
+
         return total;
     }
+
+    void MaterialCache::buildBlock(Renderer& rhs)
+    {
+        const MaterialBlock& block = mOwner.block();
+
+        if (mBlockBuffer && mBlockGeneration == block.generation())
+            return;
+
+        // The block is small, so it is uploaded whole into a new buffer rather than written in
+        // the one the frames in flight bind. The previous buffer and its command are released
+        // once these frames retire.
+
+        RenderHdwBufferPtr blockBuffer = rhs.hdwBufferManager().allocate(HBT::Uniform, MaterialBlock::Size, block.data());
+
+        if (!blockBuffer)
+            throw NullError("MaterialCache", "buildBlock", "Null RenderHdwUniformBuffer created.");
+
+        BindBufferCommandPtr bindBlock = rhs.newCommand < BindBufferCommand >();
+
+        if (!bindBlock)
+            throw NullError("MaterialCache", "buildBlock", "Null BindBufferCommand created.");
+
+        bindBlock->construct(MaterialBlock::Slot, blockBuffer, 0, MaterialBlock::Size);
+
+        if (mBlockBuffer)
+            rhs.transientRing().defer([buffer = mBlockBuffer, command = mBindBlock](){});
+
+        mBlockBuffer = blockBuffer;
+        mBindBlock = bindBlock;
+        mBlockGeneration = block.generation();
+    }
 }
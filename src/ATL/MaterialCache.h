@@ -10,6 +10,7 @@
 
 #include "RenderCache.h"
 #include "ShaderVariableCommand.h"
+#include "BindBufferCommand.h"
 
 namespace Atl
 {
@@ -19,11 +20,28 @@ namespace Atl
     //! This cache creates a list of ShaderVariableCommands. The list has a reserved size of the maximum 
     //! number of elements the Material can hold. However, only the elements used in the Material are used
     //! and are filled with a non null ShaderVariableCommand.
+    //! When the Material \ref Material::isUsingBlock(), its colors and shininess are uploaded in one
+    //! uniform buffer, and bound with a single command: only textures keep a ShaderVariableCommand.
+    //! A build changing the block uploads it into a new buffer, as the frames in flight may still
+    //! bind the previous one, which is released through the Renderer's TransientRing::defer().
     class MaterialCache : public RenderCache < Material >
     {
         //! @brief List of RenderCommands.
         ShaderVariableCommandList mCommands;
 
+        //! @brief True if the Material was using its MaterialBlock at the last build.
+        bool mIsUsingBlock;
+
+        //! @brief The uniform buffer holding the MaterialBlock, or null. Never written once bound.
+        RenderHdwBufferPtr mBlockBuffer;
+
+        //! @brief The generation of the MaterialBlock uploaded in mBlockBuffer.
+        std::uint64_t mBlockGeneration;
+
+        //! @brief The command binding mBlockBuffer, used when rendering to a RenderCommand which
+        //! isn't a CommandBuffer.
+        BindBufferCommandPtr mBindBlock;
+
         //! @brief The cache mutex.
         mutable std::mutex mMutex;
 
@@ -39,13 +57,19 @@ namespace Atl
         MaterialCache(Renderer& rhs, Material& material);
 
         //! @brief Builds the cache.
-        std::future < void > build(Renderer& rhs);
+        void buildSync(Renderer& rhs);
 
         //! @brief Renders the cache.
-        std::future < void > render(RenderCommand& cmd) const;
+        void renderSync(RenderCommand& cmd) const;
 
-        //! @brief Returns the sum of all values.
+        //! @brief Returns the sum of all values, and the size of the uniform buffer.
         std::size_t size(Renderer&) const;
+
+    private:
+
+        //! @brief Creates mBlockBuffer and mBindBlock again if the block changed. Must be called
+        //! with the cache and the Material locked.
+        void buildBlock(Renderer& rhs);
     };
 }
 
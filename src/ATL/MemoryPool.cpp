@@ -12,38 +12,49 @@
 namespace Atl
 {
     MemoryPool::MemoryPool(std::size_t maxSize)
-    : mCurrSize(0), mMaxSize(0)
+    : mCurrSize(0), mMaxSize(maxSize)
     {
         
     }
     
+    void MemoryPool::setMaxSize(std::size_t maxSize)
+    {
+        mMaxSize = maxSize;
+    }
+    
     void MemoryPool::change(std::size_t oldsz, std::size_t newsz)
     {
-        if (!newsz)
-            mCurrSize -= oldsz;
+        if (oldsz >= newsz)
+        {
+            mCurrSize -= oldsz - newsz;
+            return;
+        }
         
-        if (oldsz < newsz)
+        // The growth is reserved with a compare and swap, so two threads cannot both take the
+        // last available bytes.
+        
+        const std::size_t delta = newsz - oldsz;
+        std::size_t current = mCurrSize.load();
+        
+        do
         {
-            const std::size_t delta = newsz - oldsz;
-            if (mCurrSize + delta > mMaxSize && mMaxSize > 0)
+            const std::size_t maxSize = mMaxSize.load();
+            
+            if (maxSize > 0 && current + delta > maxSize)
                 throw NotEnoughMemory("MemoryPool", "change", "Memory limit of %i bytes exceeded. (%i)",
-                                      mMaxSize.load(), mCurrSize + delta);
-            mCurrSize = mCurrSize + delta;
-
-            if (/*Settings::Get().isSet("mLowProfile") &&*/ mMaxSize > 0)
-            {
-                const float lowProfile = 80.0f; // std::any_cast < float >(Settings::Get().get("mLowProfile"));
-                const float currProfile = (float)mCurrSize.load() / (float)mMaxSize.load();
-
-                if (currProfile > lowProfile)
-                    send(&Listener::onMemoryLow, *this);
-            }
+                                      maxSize, current + delta);
         }
+        while (!mCurrSize.compare_exchange_weak(current, current + delta));
+        
+        const std::size_t maxSize = mMaxSize.load();
         
-        else
+        if (/*Settings::Get().isSet("mLowProfile") &&*/ maxSize > 0)
         {
-            const std::size_t delta = oldsz - newsz;
-            mCurrSize = mCurrSize - delta;
+            const float lowProfile = 0.8f; // std::any_cast < float >(Settings::Get().get("mLowProfile"));
+            const float currProfile = (float)(current + delta) / (float)maxSize;
+            
+            if (currProfile > lowProfile)
+                send(&Listener::onMemoryLow, *this);
         }
     }
     
@@ -44,6 +44,9 @@ namespace Atl
         //! @brief Constructs a new memory pool.
         MemoryPool(std::size_t maxSize = 0);
         
+        //! @brief Changes the maximum size, zero for no limit. The current size is not checked.
+        void setMaxSize(std::size_t maxSize);
+        
         //! @brief Changes the size used by an object in this pool.
         //! @param oldsz The size previously used by this object. If zero, it means
         //! the object has been constructed.
@@ -52,6 +55,7 @@ namespace Atl
         //! The currently used size is updated in consequence: if the size is growing,
         //! an assertion is made with the maximum size in this pool. If the size
         //! is minimizing, then the current size is only updated without assertion.
+        //! Listeners are told when more than 80% of the maximum size is used.
         void change(std::size_t oldsz, std::size_t newsz);
         
         //! @brief Returns true if the delta size between the old and new size of
@@ -67,7 +71,12 @@ namespace Atl
         inline std::size_t maxSize() const { return mMaxSize; }
         
         //! @brief Returns the available size in this pool, in bytes.
-        inline std::size_t availableSize() const { return mMaxSize - mCurrSize; }
+        //! Returns zero if the pool has no limit or is over its limit.
+        inline std::size_t availableSize() const 
+        {
+            const std::size_t maxSize = mMaxSize, currSize = mCurrSize;
+            return maxSize > currSize ? maxSize - currSize : 0;
+        }
     };
 }
 
@@ -7,6 +7,8 @@
 
 #include "Model.h"
 
+#include <algorithm>
+
 namespace Atl
 {
     // ------------------------------------------------------------------------------------
@@ -63,6 +65,7 @@ namespace Atl
         {
             std::lock_guard l(mMutex);
             mSubModels.push_back(subModel);
+            mTouchCount++;
         }
 
         send(&Listener::onModelDidAddSubModel, *this, (SubModel&)*subModel);
@@ -84,6 +87,7 @@ namespace Atl
             std::advance(it, index);
             
             mSubModels.insert(it, subModel);
+            mTouchCount++;
         }
 
         send(&Listener::onModelDidAddSubModel, *this, (SubModel&)*subModel);
@@ -98,7 +102,12 @@ namespace Atl
             std::lock_guard l(mMutex);
             
             auto it = std::find(mSubModels.begin(), mSubModels.end(), subModel);
-            if (it != mSubModels.end()) mSubModels.erase(it);
+            
+            if (it != mSubModels.end())
+            {
+                touchRemoved({ subModel });
+                mSubModels.erase(it);
+            }
         }   
 
         send(&Listener::onModelDidRemoveSubModel, *this, (SubModel&)*subModel);
@@ -108,6 +117,7 @@ namespace Atl
     {
         {
             std::lock_guard l(mMutex);
+            touchRemoved(mSubModels);
             mSubModels.clear();
         }
 
@@ -123,6 +133,7 @@ namespace Atl
     void Model::setSubModels(const SubModelList &subModels)
     {
         std::lock_guard l(mMutex);
+        touchRemoved(mSubModels);
         mSubModels = subModels;
     }
     
@@ -164,40 +175,121 @@ namespace Atl
         mMutex.unlock();
     }
     
-    std::future < void > Model::render(RenderCommand& to) const
-    {   
-        return std::async(std::launch::async, [this, &to]()
+    void Model::addLOD(const SubModelList& subModels, Real maxScreenSize)
+    {
+        for (const SubModelPtr& subModel : subModels)
         {
-            send(&Listener::onRenderableWillRender, (const Renderable&)*this, to).get();
+            if (!subModel)
+                throw NullError("Model", "addLOD", "Null SubModel for Model %s.", name().data());
+        }
+        
+        std::lock_guard l(mMutex);
+        
+        if (!mLODs.empty() && !(maxScreenSize < mLODs.back().maxScreenSize))
+            throw OutOfRange("Model", "addLOD", "LOD threshold %f of Model %s isn't lower than the previous one.",
+                             (double)maxScreenSize, name().data());
+        
+        mLODs.push_back(ModelLOD{ subModels, maxScreenSize });
+        mTouchCount++;
+    }
+    
+    void Model::removeAllLODs()
+    {
+        std::lock_guard l(mMutex);
+        
+        for (const ModelLOD& lod : mLODs)
+            touchRemoved(lod.subModels);
+        
+        mLODs.clear();
+    }
+    
+    std::size_t Model::lodsCount() const
+    {
+        std::lock_guard l(mMutex);
+        return mLODs.size() + 1;
+    }
+    
+    SubModelList Model::lodSubModels(std::size_t lod) const
+    {
+        std::lock_guard l(mMutex);
+        
+        if (lod > mLODs.size())
+            throw OutOfRange("Model", "lodSubModels", "No LOD %i in Model %s.", (int)lod, name().data());
+        
+        return lod ? mLODs[lod - 1].subModels : mSubModels;
+    }
+    
+    Real Model::lodMaxScreenSize(std::size_t lod) const
+    {
+        std::lock_guard l(mMutex);
+        
+        if (lod > mLODs.size())
+            throw OutOfRange("Model", "lodMaxScreenSize", "No LOD %i in Model %s.", (int)lod, name().data());
+        
+        return lod ? mLODs[lod - 1].maxScreenSize : INFINITY;
+    }
+    
+    std::size_t Model::selectLOD(Real screenSize, std::size_t current, Real hysteresis) const
+    {
+        std::lock_guard l(mMutex);
+        
+        // mLODs[i] holds level i + 1.
+        
+        std::size_t lod = std::min(current, mLODs.size());
+        
+        while (lod < mLODs.size() && screenSize < mLODs[lod].maxScreenSize * (1 - hysteresis))
+            lod++;
+        
+        while (lod > 0 && screenSize > mLODs[lod - 1].maxScreenSize * (1 + hysteresis))
+            lod--;
+        
+        return lod;
+    }
+    
+    void Model::renderSync(RenderCommand& to) const
+    {
+        renderLODSync(to, 0);
+    }
+    
+    void Model::renderLODSync(RenderCommand& to, std::size_t lod) const
+    {
+        notify(&Listener::onRenderableWillRender, (const Renderable&)*this, to);
 
-            SubModelList subModels = this->subModels();
-            
-            for (const SubModelPtr& subModel : subModels)
-            {
-                if (!subModel) continue;
-                subModel->render(to).get();
-            }
+        SubModelList subModels;
+        
+        {
+            std::lock_guard l(mMutex);
+            lod = std::min(lod, mLODs.size());
+            subModels = lod ? mLODs[lod - 1].subModels : mSubModels;
+        }
+        
+        for (const SubModelPtr& subModel : subModels)
+        {
+            if (!subModel) continue;
+            subModel->renderSync(to);
+        }
 
-            send(&Listener::onRenderableDidRender, (const Renderable&)*this, to);
-        });
+        notify(&Listener::onRenderableDidRender, (const Renderable&)*this, to);
     }
     
-    std::future < void > Model::build(Renderer &rhs)
+    void Model::buildSync(Renderer &rhs)
     {
-        return std::async(std::launch::async, [this, &rhs]()
-        {
-            send(&Listener::onRenderableWillBuild, (Renderable&)*this, rhs).get();
+        notify(&Listener::onRenderableWillBuild, (Renderable&)*this, rhs);
 
-            SubModelList subModels = this->subModels();
-            
-            for (const SubModelPtr& subModel : subModels)
-            {
-                if (!subModel) continue;
-                subModel->build(rhs).get();
-            }
+        SubModelList subModels;
+        
+        {
+            std::lock_guard l(mMutex);
+            subModels = allSubModels();
+        }
+        
+        for (const SubModelPtr& subModel : subModels)
+        {
+            if (!subModel) continue;
+            subModel->buildSync(rhs);
+        }
 
-            send(&Listener::onRenderableDidBuild, (Renderable&)*this, rhs);
-        });
+        notify(&Listener::onRenderableDidBuild, (Renderable&)*this, rhs);
     }
     
     std::size_t Model::size(Renderer& rhs) const
@@ -208,6 +300,129 @@ namespace Atl
         for (const SubModelPtr& subModel : mSubModels)
             totalSize += subModel->size(rhs);
         
+        for (const ModelLOD& lod : mLODs)
+        {
+            for (const SubModelPtr& subModel : lod.subModels)
+                totalSize += subModel->size(rhs);
+        }
+        
         return totalSize;
     }
+    
+    bool Model::hasAABB() const
+    {
+        SubModelList subModels = this->subModels();
+        
+        for (const SubModelPtr& subModel : subModels)
+        {
+            if (subModel && subModel->hasAABB())
+                return true;
+        }
+        
+        return false;
+    }
+    
+    AABB Model::aabb() const
+    {
+        SubModelList subModels = this->subModels();
+        AABB result;
+        bool hasResult = false;
+        
+        for (const SubModelPtr& subModel : subModels)
+        {
+            if (!subModel || !subModel->hasAABB())
+                continue;
+            
+            if (!hasResult)
+            {
+                result = subModel->aabb();
+                hasResult = true;
+            }
+            
+            else
+            {
+                result.merge(subModel->aabb());
+            }
+        }
+        
+        return result;
+    }
+    
+    bool Model::isTouched() const
+    {
+        SubModelList subModels;
+        
+        {
+            std::lock_guard l(mMutex);
+            subModels = allSubModels();
+        }
+        
+        return std::any_of(subModels.begin(), subModels.end(), [](const SubModelPtr& subModel){
+            return subModel && subModel->isTouched();
+        });
+    }
+    
+    void Model::touch()
+    {
+        SubModelList subModels;
+        
+        {
+            std::lock_guard l(mMutex);
+            subModels = allSubModels();
+            mTouchCount++;
+        }
+        
+        for (const SubModelPtr& subModel : subModels)
+        {
+            if (subModel) subModel->touch();
+        }
+    }
+    
+    void Model::clean() const
+    {
+        SubModelList subModels;
+        
+        {
+            std::lock_guard l(mMutex);
+            subModels = allSubModels();
+        }
+        
+        for (const SubModelPtr& subModel : subModels)
+        {
+            if (subModel) subModel->clean();
+        }
+    }
+    
+    std::uint64_t Model::touchCount() const
+    {
+        std::lock_guard l(mMutex);
+        std::uint64_t count = mTouchCount;
+        
+        for (const SubModelPtr& subModel : allSubModels())
+        {
+            if (subModel) count += subModel->touchCount();
+        }
+        
+        return count;
+    }
+    
+    SubModelList Model::allSubModels() const
+    {
+        SubModelList subModels = mSubModels;
+        
+        for (const ModelLOD& lod : mLODs)
+            subModels.insert(subModels.end(), lod.subModels.begin(), lod.subModels.end());
+        
+        return subModels;
+    }
+    
+    void Model::touchRemoved(const SubModelList& removed)
+    {
+        for (const SubModelPtr& subModel : removed)
+        {
+            if (subModel) mTouchCount += subModel->touchCount();
+        }
+        
+        mTouchCount++;
+    }
 }
@@ -12,6 +12,9 @@
 #include "Resource.h"
 #include "SubModel.h"
 #include "Emitter.h"
+#include "Touchable.h"
+
+#include <atomic>
 
 namespace Atl
 {
@@ -82,18 +85,45 @@ namespace Atl
         virtual ModelList loadModels(const std::string& dir, const Params& params);
     };
 
+    //! @brief A level of detail of a Model, rendered instead of the Model's SubModels when the
+    //! Model is small enough on the screen.
+    struct ModelLOD
+    {
+        //! @brief The SubModels rendered at this level.
+        SubModelList subModels;
+        
+        //! @brief The level is used when the projected size of the Model is below this value.
+        //! \see Model::selectLOD().
+        Real maxScreenSize;
+    };
+    
     //! @brief Defines a 3d Model.
+    //!
+    //! A Model may have a chain of levels of detail. Level 0 is the Model's SubModels, and each
+    //! level added with \ref addLOD() replaces them when the Model's projected size is below
+    //! its threshold. Thresholds must decrease from one level to the next.
+    //!
+    //! \ref touchCount() changes whenever a SubModel of any level is touched, added or
+    //! removed, so a RenderNode recording the Model in a Bundle records it again.
     class EXPORTED Model :
     virtual public TResource <
     Model,
     ModelManager >,
-    virtual public Renderable
+    virtual public Renderable,
+    virtual public Touchable
     {
         mutable std::mutex mMutex;
         
         //! @brief The list of SubModels.
         SubModelList mSubModels;
         
+        //! @brief The levels of detail after level 0, from the most to the least detailed.
+        std::vector < ModelLOD > mLODs;
+        
+        //! @brief The changes of the levels, plus the touch counts of the SubModels removed,
+        //! so \ref touchCount() never goes back to a previous value.
+        std::atomic < std::uint64_t > mTouchCount { 0 };
+        
     public:
         //! @brief Defines the listener's type for this resource.
         typedef ModelListener Listener;
@@ -137,11 +167,44 @@ namespace Atl
         //! @brief Unlocks the Model.
         void unlock() const;
         
+        //! @brief Adds a level of detail after the last one.
+        //! @param subModels The SubModels to render at this level.
+        //! @param maxScreenSize The projected size under which this level is used. It must be
+        //! lower than the previous level's one.
+        void addLOD(const SubModelList& subModels, Real maxScreenSize);
+        
+        //! @brief Removes every level of detail but level 0.
+        void removeAllLODs();
+        
+        //! @brief Returns the number of levels of detail, including level 0.
+        std::size_t lodsCount() const;
+        
+        //! @brief Returns the SubModels of a level of detail. Level 0 is \ref subModels().
+        SubModelList lodSubModels(std::size_t lod) const;
+        
+        //! @brief Returns the threshold of a level of detail. Level 0 has no threshold and 
+        //! returns INFINITY.
+        Real lodMaxScreenSize(std::size_t lod) const;
+        
+        //! @brief Returns the level of detail for a projected size.
+        //! A level is left for a less detailed one when screenSize goes below the next level's
+        //! threshold times (1 - hysteresis), and for a more detailed one when screenSize goes
+        //! above its own threshold times (1 + hysteresis), so objects near a threshold don't
+        //! switch levels every frame.
+        //! @param screenSize The projected size of the Model.
+        //! @param current The level used until now.
+        //! @param hysteresis The relative margin around thresholds, usually around 0.1.
+        std::size_t selectLOD(Real screenSize, std::size_t current, Real hysteresis) const;
+        
         //! @brief Renders each SubModels into the RenderCommand.
-        std::future < void > render(RenderCommand& to) const;
+        void renderSync(RenderCommand& to) const;
+        
+        //! @brief Renders the SubModels of a level of detail into the RenderCommand. Levels
+        //! past the last one render the last one.
+        void renderLODSync(RenderCommand& to, std::size_t lod) const;
         
-        //! @brief Calls \ref SubModel::build() on each SubModels.
-        std::future < void > build(Renderer& rhs);
+        //! @brief Calls \ref SubModel::build() on each SubModels, of every level of detail.
+        void buildSync(Renderer& rhs);
         
         //! @brief Returns, in bytes, the memory used on the GPU RAM for this cache and for
         //! the given renderer.
@@ -149,6 +212,33 @@ namespace Atl
         
         //! @brief Returns the size used for this resource.
         inline std::size_t usedSize() const { return 0; }
+        
+        //! @brief Returns true if at least one SubModel has an AABB.
+        bool hasAABB() const;
+        
+        //! @brief Returns the AABB containing every SubModel's AABB, in model space.
+        //! Weither this AABB is relevant or not is given by \ref hasAABB().
+        AABB aabb() const;
+        
+        //! @brief Returns true if a SubModel of any level is touched.
+        bool isTouched() const;
+        
+        //! @brief Touches every SubModel of every level.
+        void touch();
+        
+        //! @brief Cleans every SubModel of every level.
+        void clean() const;
+        
+        //! @brief Returns the sum of the SubModels' touch counts and of \ref mTouchCount.
+        std::uint64_t touchCount() const;
+        
+    private:
+        //! @brief Returns the SubModels of every level. mMutex must be locked.
+        SubModelList allSubModels() const;
+        
+        //! @brief Adds the touch counts of SubModels about to be removed to mTouchCount, and
+        //! counts the change. mMutex must be locked.
+        void touchRemoved(const SubModelList& removed);
     };
 }
 
@@ -6,6 +6,7 @@
 //
 
 #include "ModelRenderNode.h"
+#include "Camera.h"
 
 namespace Atl
 {
@@ -26,6 +27,85 @@ namespace Atl
     void ModelRenderNode::setModel(const ModelPtr& model)
     {
         std::atomic_store(&mModel, model);
+        updateAABB();
+
         send(&Listener::onModelModified, *this, (const Model&)*model);
     }
-}
\ No newline at end of file
+
+    bool ModelRenderNode::localAABB(AABB& result) const
+    {
+        ModelPtr model = std::atomic_load(&mModel);
+
+        if (!model || !model->hasAABB())
+            return false;
+
+        result = model->aabb();
+        return true;
+    }
+
+    std::size_t ModelRenderNode::selectLOD(const Camera& camera, Real screenSize, Real hysteresis) const
+    {
+        ModelPtr model = std::atomic_load(&mModel);
+
+        if (!model)
+            return 0;
+
+        std::lock_guard l(mLODMutex);
+
+        // Removes the levels of the Cameras destroyed since the last selection. A Camera not
+        // held by a shared_ptr can't be watched, and loses its hysteresis here.
+
+        for (auto it = mLODs.begin(); it != mLODs.end();)
+        {
+            if (it->first != camera.index() && it->second.camera.expired())
+                it = mLODs.erase(it);
+            else
+                ++it;
+        }
+
+        CameraLOD& entry = mLODs[camera.index()];
+
+        if (entry.camera.expired())
+            entry.camera = camera.weak_from_this();
+
+        entry.lod = model->selectLOD(screenSize, entry.lod, hysteresis);
+        return entry.lod;
+    }
+
+    void ModelRenderNode::renderLODSync(RenderCommand& command, std::size_t lod) const
+    {
+        RenderCommand& target = prepareRenderSync(command);
+
+        if (isBundled())
+            renderBundle(target, lod);
+        else
+            recordSync(target, lod);
+    }
+
+    std::size_t ModelRenderNode::lod(const Camera& camera) const
+    {
+        std::lock_guard l(mLODMutex);
+
+        auto it = mLODs.find(camera.index());
+        return it != mLODs.end() ? it->second.lod : 0;
+    }
+
+    void ModelRenderNode::recordSync(RenderCommand& command, std::uint64_t variant) const
+    {
+        ModelPtr model = std::atomic_load(&mModel);
+        RenderableList renderables;
+
+        {
+            std::lock_guard l(mMutex);
+            renderables = mRenderables;
+        }
+
+        for (const RenderablePtr& renderable : renderables)
+        {
+            if (model && renderable == model)
+                model->renderLODSync(command, static_cast < std::size_t >(variant));
+            else if (renderable)
+                renderable->renderSync(command);
+        }
+    }
+}
@@ -11,6 +11,8 @@
 #include "RenderNode.h"
 #include "Model.h"
 
+#include <unordered_map>
+
 namespace Atl
 {
     class ModelRenderNode;
@@ -27,11 +29,31 @@ namespace Atl
     };
 
     //! @brief Defines a RenderNode with a Model.
+    //! If the Model has levels of detail, \ref selectLOD() returns the level to render for a
+    //! Camera, and the RenderTechnique gives it back to \ref renderLODSync(). The level is kept
+    //! per Camera, so each Camera has its own hysteresis.
     class EXPORTED ModelRenderNode : virtual public RenderNode 
     {
+        //! @brief The level of detail selected for a Camera.
+        struct CameraLOD
+        {
+            //! @brief The Camera, to remove the entry once it is destroyed.
+            std::weak_ptr < const Camera > camera;
+
+            //! @brief The level of detail.
+            std::size_t lod = 0;
+        };
+
         //! @brief The Model in this Node.
         ModelPtr mModel;
 
+        //! @brief The level of detail selected for each Camera, by Camera index. Entries of
+        //! destroyed Cameras are removed by the next \ref selectLOD().
+        mutable std::unordered_map < std::uint64_t, CameraLOD > mLODs;
+
+        //! @brief Protects mLODs.
+        mutable std::mutex mLODMutex;
+
     public:
         ATL_SHAREABLE(ModelRenderNode)
 
@@ -58,6 +80,27 @@ namespace Atl
 
         //! @brief Changes the model in this Node.
         virtual void setModel(const ModelPtr& model);
+
+        //! @brief Returns the AABB of the Model, aggregated from its SubModels.
+        virtual bool localAABB(AABB& result) const;
+
+        //! @brief Selects the Model's level of detail for the Camera from its previous level,
+        //! and returns it. \see Model::selectLOD().
+        virtual std::size_t selectLOD(const Camera& camera, Real screenSize, Real hysteresis) const;
+
+        //! @brief Renders the Model at the given level of detail, and other renderables
+        //! normally. When bundled, each level has its own Bundle.
+        virtual void renderLODSync(RenderCommand& command, std::size_t lod) const;
+
+        //! @brief Returns the level of detail selected for a Camera, or zero if none has been
+        //! selected yet.
+        virtual std::size_t lod(const Camera& camera) const;
+
+    protected:
+
+        //! @brief Renders the Model at the level of detail variant, and other renderables
+        //! normally.
+        virtual void recordSync(RenderCommand& command, std::uint64_t variant) const;
     };
 
     //! @brief Pointer to ModelRenderNode.
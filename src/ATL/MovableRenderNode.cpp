@@ -25,6 +25,7 @@ namespace Atl
     {
         Transformation& trans = *std::atomic_load(&mTransformation);
         trans = Transformation::LookAt(trans.name(), trans.translation(), target, up);
+        updateAABB();
         return *this;
     }
 
@@ -46,18 +47,38 @@ namespace Atl
 
     void MovableRenderNode::setTransformation(const TransformationPtr& rhs)
     {
-        std::atomic_store(&mTransformation, rhs);
+        if (!rhs)
+            throw NullError("MovableRenderNode", "setTransformation", "Null Transformation.");
+
+        TransformationPtr previous = std::atomic_exchange(&mTransformation, rhs);
+
+        // The Transformation is the first renderable, so it is bound before the others. The
+        // node is touched, so its tasks and Bundles are recorded again.
+
+        if (previous != rhs)
+        {
+            removeRenderable(previous);
+
+            if (renderablesCount())
+                insertRenderable(0, rhs);
+            else
+                addRenderable(rhs);
+        }
+
+        updateAABB();
     }
 
     void MovableRenderNode::setPosition(const rvec3& rhs)
     {
         TransformationPtr tran = std::atomic_load(&mTransformation);
         tran->translate(rhs - tran->translation());
+        updateAABB();
     }
 
     void MovableRenderNode::translate(const rvec3& rhs)
     {
         TransformationPtr tran = std::atomic_load(&mTransformation);
         tran->translate(rhs);
+        updateAABB();
     }
 }
\ No newline at end of file
@@ -45,7 +45,8 @@ namespace Atl
         //! @brief Returns the position of this node.
         rvec3 position() const;
 
-        //! @brief Changes the Transformation applied to this node.
+        //! @brief Changes the Transformation applied to this node. It replaces the previous one
+        //! in the node's renderables.
         void setTransformation(const TransformationPtr& rhs);
 
         //! @brief Sets the position for this node.
@@ -9,30 +9,30 @@
 
 namespace Atl
 {
-    std::size_t NearestTechnique::sort(const RenderNode& node, const Camera& camera, const Frustum& frustum, RenderTechnique::NodesMap& nodes) const
+    std::size_t NearestTechnique::sort(const RenderNode& node, const Camera& camera, const Frustum& frustum, Frustum::PlaneMask mask, DrawList& nodes) const
     {
         if (!node.isVisible())
             return 0;
         
-        if (node.isCulledFromFrustum(frustum))
+        // The whole subtree is rejected at once if its AABB is outside the frustum. Otherwise the
+        // planes it is fully inside of are removed from the mask given to the children.
+        
+        if (node.isSubtreeCulledFromFrustum(frustum, mask))
             return 0;
         
         const bool isRenderRenderablesFirst = node.renderRenderablesFirst();
-        rvec3 distance = rvec3(INFINITY, INFINITY, INFINITY);
         RenderNodePtr renderNode = std::dynamic_pointer_cast < RenderNode >(const_cast < RenderNode& >(node).shared_from_this());
         
         if (!renderNode)
             throw NullError("NodeTraversalRenderTechnique", "sort", "Node isn't castable to RenderNode.");
         
-        if (node.hasAABB())
-        {
-            AABB bbox = node.aabb();
-            const rvec3 center = bbox.center();
-            distance = camera.distance(center);
-        }
+        // Opaque nodes are grouped by Material and sorted front to back, transparent ones
+        // are drawn back to front after them (see RenderTechnique::makeKey()).
+        
+        const std::uint64_t key = makeKey(node, Distance(node, camera));
         
         if (isRenderRenderablesFirst)
-            nodes[distance.length()].push_back(renderNode);
+            AddNode(nodes, key, renderNode, mask != 0);
         
         std::size_t childrenCount = node.childrenCount();
         std::size_t nodesAdded = 1;
@@ -40,11 +40,11 @@ namespace Atl
         for (unsigned i = 0; i < childrenCount; ++i)
         {
             const RenderNode& iNode = dynamic_cast < const RenderNode& >(node.childAt(i));
-            nodesAdded += sort(iNode, camera, frustum, nodes);
+            nodesAdded += sort(iNode, camera, frustum, mask, nodes);
         }
         
         if (!isRenderRenderablesFirst)
-            nodes[distance.length()].push_back(renderNode);
+            AddNode(nodes, key, renderNode, mask != 0);
         
         return nodesAdded;
     }
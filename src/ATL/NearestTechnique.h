@@ -24,8 +24,9 @@ namespace Atl
         
     protected:
         //! @brief Sorts nodes nearest first.
-        //! Nodes are added in the map upon their distance to the camera.
-        virtual std::size_t sort(const RenderNode& node, const Camera& camera, const Frustum& frustum, NodesMap& nodes) const;
+        //! Opaque nodes are grouped by Material and added front to back, transparent nodes
+        //! are added back to front after them.
+        virtual std::size_t sort(const RenderNode& node, const Camera& camera, const Frustum& frustum, Frustum::PlaneMask mask, DrawList& nodes) const;
     };
 }
 
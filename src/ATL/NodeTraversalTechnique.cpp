@@ -15,14 +15,15 @@ namespace Atl
         
     }
     
-    std::size_t NodeTraversalTechnique::sort(const RenderNode& node, const Camera& camera, const Frustum& frustum, RenderTechnique::NodesMap& nodes) const
+    std::size_t NodeTraversalTechnique::sort(const RenderNode& node, const Camera& camera, const Frustum& frustum, Frustum::PlaneMask mask, DrawList& nodes) const
     {
-        // In this technique we only render node if node is visible && not culled out, or visible
-        // && doesn't have any AABB. Then we iterate through its children.
+        // In this technique we only render node if node is visible. If mCullNodes is true, subtrees
+        // outside the frustum are rejected here and nodes with an AABB whose parent intersects the
+        // frustum are culled afterwards by the DrawList. Then we iterate through its children.
         
         if (node.isVisible())
         {
-            if (mCullNodes && node.isCulledFromFrustum(frustum))
+            if (mCullNodes && node.isSubtreeCulledFromFrustum(frustum, mask))
                 return 0;
             
             const bool isRenderRenderablesFirst = node.renderRenderablesFirst();
@@ -33,8 +34,10 @@ namespace Atl
             if (!renderNode)
                 throw NullError("NodeTraversalTechnique", "sort", "Node isn't castable to RenderNode.");
             
+            // Every node has the same key: the sort is stable, so the traversal order is kept.
+            
             if (isRenderRenderablesFirst)
-                nodes[0.0].push_back(renderNode);
+                AddNode(nodes, 0, renderNode, mCullNodes && mask != 0);
             
             std::size_t childrenCount = node.childrenCount();
             std::size_t nodesAdded = 1;
@@ -42,15 +45,26 @@ namespace Atl
             for (unsigned i = 0; i < childrenCount; ++i)
             {
                 const RenderNode& iNode = dynamic_cast < const RenderNode& >(node.childAt(i));
-                nodesAdded += sort(iNode, camera, frustum, nodes);
+                nodesAdded += sort(iNode, camera, frustum, mask, nodes);
             }
             
             if (!isRenderRenderablesFirst)
-                nodes[0.0].push_back(renderNode);
+                AddNode(nodes, 0, renderNode, mCullNodes && mask != 0);
             
             return nodesAdded;
         }
         
         return 0;
     }
+    
+    bool NodeTraversalTechnique::makeEntryKey(const SceneBVH::Entry& entry, const Camera&, std::uint64_t& key) const
+    {
+        key = entry.order;
+        return true;
+    }
+    
+    bool NodeTraversalTechnique::isCullingNodes() const
+    {
+        return mCullNodes;
+    }
 }
@@ -33,7 +33,14 @@ namespace Atl
     protected:
         
         //! @brief Adds all nodes one by one into nodes.
-        virtual std::size_t sort(const RenderNode& node, const Camera& camera, const Frustum& frustum, NodesMap& nodes) const;
+        virtual std::size_t sort(const RenderNode& node, const Camera& camera, const Frustum& frustum, Frustum::PlaneMask mask, DrawList& nodes) const;
+        
+        //! @brief Keys each entry with its position in the tree, so nodes are drawn in the
+        //! traversal order.
+        virtual bool makeEntryKey(const SceneBVH::Entry& entry, const Camera& camera, std::uint64_t& key) const;
+        
+        //! @brief Returns \ref mCullNodes.
+        virtual bool isCullingNodes() const;
     };
 }
 
@@ -0,0 +1,294 @@
+//
+//  NullRenderer.cpp
+//  atlre
+//
+//  Created by jacques tronconi on 27/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#include "NullRenderer.h"
+
+namespace Atl
+{
+    // --------------------------------------------------------------------------------------------
+    // NullCommandBuffer
+
+    NullCommandBuffer::NullCommandBuffer(Renderer& rhs)
+    : CommandBuffer(rhs), mExecutedCount(0)
+    {
+
+    }
+
+    std::uint64_t NullCommandBuffer::executedCount() const
+    {
+        return mExecutedCount;
+    }
+
+    void NullCommandBuffer::execute(const CommandPacket&, RenderStateTracker&)
+    {
+        mExecutedCount++;
+    }
+
+    // --------------------------------------------------------------------------------------------
+    // NullDrawVertexArraysCommand
+
+    void NullDrawVertexArraysCommand::construct(const VertexInfosPtr& infos)
+    {
+        mInfos = infos;
+    }
+
+    VertexInfosPtr NullDrawVertexArraysCommand::infos() const
+    {
+        return mInfos;
+    }
+
+    void NullDrawVertexArraysCommand::prepare()
+    {
+
+    }
+
+    void NullDrawVertexArraysCommand::render()
+    {
+
+    }
+
+    void NullDrawVertexArraysCommand::finish()
+    {
+
+    }
+
+    void NullDrawVertexArraysCommand::recycle()
+    {
+        mInfos = nullptr;
+    }
+
+    // --------------------------------------------------------------------------------------------
+    // NullDrawIndexedArraysCommand
+
+    void NullDrawIndexedArraysCommand::construct(const VertexInfosPtr& infos, const IndexBufferDataPtr& indexes)
+    {
+        mInfos = infos;
+        mIndexes = indexes;
+    }
+
+    VertexInfosPtr NullDrawIndexedArraysCommand::infos() const
+    {
+        return mInfos;
+    }
+
+    IndexBufferDataPtr NullDrawIndexedArraysCommand::indexes() const
+    {
+        return mIndexes;
+    }
+
+    void NullDrawIndexedArraysCommand::prepare()
+    {
+
+    }
+
+    void NullDrawIndexedArraysCommand::render()
+    {
+
+    }
+
+    void NullDrawIndexedArraysCommand::finish()
+    {
+
+    }
+
+    void NullDrawIndexedArraysCommand::recycle()
+    {
+        mInfos = nullptr;
+        mIndexes = nullptr;
+    }
+
+    // --------------------------------------------------------------------------------------------
+    // NullDrawInstancedCommand
+
+    void NullDrawInstancedCommand::construct(const VertexInfosPtr& infos, const IndexBufferDataPtr& indexes,
+                                             const RenderHdwBufferPtr& instances, std::size_t first, std::size_t count)
+    {
+        mInfos = infos;
+        mIndexes = indexes;
+        mInstances = instances;
+        mFirst = first;
+        mCount = count;
+    }
+
+    VertexInfosPtr NullDrawInstancedCommand::infos() const
+    {
+        return mInfos;
+    }
+
+    IndexBufferDataPtr NullDrawInstancedCommand::indexes() const
+    {
+        return mIndexes;
+    }
+
+    RenderHdwBufferPtr NullDrawInstancedCommand::instances() const
+    {
+        return mInstances;
+    }
+
+    std::size_t NullDrawInstancedCommand::first() const
+    {
+        return mFirst;
+    }
+
+    std::size_t NullDrawInstancedCommand::count() const
+    {
+        return mCount;
+    }
+
+    void NullDrawInstancedCommand::prepare()
+    {
+
+    }
+
+    void NullDrawInstancedCommand::render()
+    {
+
+    }
+
+    void NullDrawInstancedCommand::finish()
+    {
+
+    }
+
+    void NullDrawInstancedCommand::recycle()
+    {
+        mInfos = nullptr;
+        mIndexes = nullptr;
+        mInstances = nullptr;
+        mFirst = 0;
+        mCount = 0;
+    }
+
+    // --------------------------------------------------------------------------------------------
+    // NullBindBufferCommand
+
+    void NullBindBufferCommand::construct(unsigned slot, const RenderHdwBufferPtr& buffer, std::size_t offset, std::size_t size)
+    {
+        mSlot = slot;
+        mBuffer = buffer;
+        mOffset = offset;
+        mSize = size;
+    }
+
+    unsigned NullBindBufferCommand::slot() const
+    {
+        return mSlot;
+    }
+
+    RenderHdwBufferPtr NullBindBufferCommand::buffer() const
+    {
+        return mBuffer;
+    }
+
+    std::size_t NullBindBufferCommand::offset() const
+    {
+        return mOffset;
+    }
+
+    std::size_t NullBindBufferCommand::size() const
+    {
+        return mSize;
+    }
+
+    void NullBindBufferCommand::prepare()
+    {
+
+    }
+
+    void NullBindBufferCommand::render()
+    {
+
+    }
+
+    void NullBindBufferCommand::finish()
+    {
+
+    }
+
+    void NullBindBufferCommand::recycle()
+    {
+        mSlot = 0;
+        mBuffer = nullptr;
+        mOffset = 0;
+        mSize = 0;
+    }
+
+    // --------------------------------------------------------------------------------------------
+    // NullRenderTarget
+
+    void NullRenderTarget::bind()
+    {
+
+    }
+
+    void NullRenderTarget::lock() const
+    {
+        mMutex.lock();
+    }
+
+    void NullRenderTarget::unlock() const
+    {
+        mMutex.unlock();
+    }
+
+    // --------------------------------------------------------------------------------------------
+    // NullRenderer
+
+    namespace
+    {
+        //! @brief Registers NullHdwBuffer < T > as the buffer created for T.
+        template < typename T >
+        void AddNullHdwBuffer(RenderHdwBufferManager& manager)
+        {
+            manager.addClass(typeid(T), [](Renderer& rhs, const RenderHdwBufferObserverPtr& observer)
+            {
+                return RenderHdwBufferPtr(std::make_shared < NullHdwBuffer < T > >(rhs, observer));
+            });
+        }
+    }
+
+    NullRenderer::NullRenderer(Manager& manager, const std::string& name)
+    : Renderer(manager, name)
+    {
+        setCommandConstructor < RenderCommand, NullCommandBuffer >();
+        setCommandConstructor < DrawVertexArraysCommand, NullDrawVertexArraysCommand >();
+        setCommandConstructor < DrawIndexedArraysCommand, NullDrawIndexedArraysCommand >();
+        setCommandConstructor < DrawInstancedCommand, NullDrawInstancedCommand >();
+        setCommandConstructor < BindBufferCommand, NullBindBufferCommand >();
+
+        AddNullHdwBuffer < RenderHdwVertexBuffer >(hdwBufferManager());
+        AddNullHdwBuffer < RenderHdwIndexBuffer >(hdwBufferManager());
+        AddNullHdwBuffer < RenderHdwUniformBuffer >(hdwBufferManager());
+        AddNullHdwBuffer < RenderHdwBuffer >(hdwBufferManager());
+    }
+
+    NullRenderer::~NullRenderer()
+    {
+        closeCommandPools();
+    }
+
+    void NullRenderer::lock() const
+    {
+        mMutex.lock();
+    }
+
+    void NullRenderer::unlock() const
+    {
+        mMutex.unlock();
+    }
+
+    ShaderPtr NullRenderer::_createShader(Renderer&, const std::string&) const
+    {
+        return nullptr;
+    }
+
+    RenderPipelinePtr NullRenderer::_createPipeline(Renderer&, const std::string&) const
+    {
+        return nullptr;
+    }
+}
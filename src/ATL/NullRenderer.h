@@ -0,0 +1,353 @@
+//
+//  NullRenderer.h
+//  atlre
+//
+//  Created by jacques tronconi on 27/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#ifndef ATL_NULLRENDERER_H
+#define ATL_NULLRENDERER_H
+
+#include "Renderer.h"
+#include "RenderTarget.h"
+#include "CommandBuffer.h"
+#include "DrawVertexArraysCommand.h"
+#include "DrawIndexedArraysCommand.h"
+#include "DrawInstancedCommand.h"
+#include "BindBufferCommand.h"
+
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+namespace Atl
+{
+    //! @brief A CommandBuffer which executes nothing, and counts the packets it executes.
+    class EXPORTED NullCommandBuffer : public CommandBuffer
+    {
+        //! @brief Number of packets executed since the buffer was created.
+        std::atomic < std::uint64_t > mExecutedCount;
+
+    public:
+
+        //! @brief Constructs an empty buffer.
+        NullCommandBuffer(Renderer& rhs);
+
+        //! @brief Returns \ref mExecutedCount.
+        std::uint64_t executedCount() const;
+
+    protected:
+
+        //! @brief Counts the packet.
+        void execute(const CommandPacket& packet, RenderStateTracker& tracker);
+    };
+
+    //! @brief A RenderHdwBuffer holding its data in memory, for a \ref NullRenderer.
+    template < typename Base >
+    class NullHdwBuffer : public Base
+    {
+        //! @brief The data.
+        std::vector < char > mData;
+
+        //! @brief The observer given by the RenderHdwBufferManager.
+        RenderHdwBufferObserverPtr mObserver;
+
+        //! @brief Locked by \ref lock().
+        mutable std::mutex mMutex;
+
+    public:
+
+        //! @brief Constructs an empty buffer.
+        NullHdwBuffer(Renderer& rhs, const RenderHdwBufferObserverPtr& observer)
+        : Base(rhs, observer), mObserver(observer)
+        {
+
+        }
+
+        //! @brief Reports the release of the data to the observer.
+        ~NullHdwBuffer()
+        {
+            mObserver->change(mData.size(), 0);
+        }
+
+        //! @brief Returns false.
+        bool isMemBuffer() const { return false; }
+
+        //! @brief Returns the size of the data.
+        std::size_t size() const
+        {
+            std::lock_guard l(mMutex);
+            return mData.size();
+        }
+
+        //! @brief Resizes the data, copies ptr if not null, and reports the change to the
+        //! observer.
+        //! @throw NotEnoughMemory if the observer doesn't accept the new size.
+        void allocate(const std::size_t& sz, const void* ptr = nullptr)
+        {
+            std::lock_guard l(mMutex);
+
+            if (!mObserver->isAvailable(mData.size(), sz))
+                throw NotEnoughMemory("NullHdwBuffer", "allocate", "Memory limit reached for %i bytes.",
+                                      static_cast < int >(sz));
+
+            mObserver->change(mData.size(), sz);
+            mData.resize(sz);
+
+            if (ptr && sz)
+                std::memcpy(mData.data(), ptr, sz);
+        }
+
+        //! @brief Locks the buffer.
+        void lock() const { mMutex.lock(); }
+
+        //! @brief Unlocks the buffer.
+        void unlock() const { mMutex.unlock(); }
+
+        //! @brief Returns the data.
+        void* data() { return mData.data(); }
+
+        //! @brief Returns the data.
+        const void* data() const { return mData.data(); }
+
+        //! @brief Does nothing.
+        void undata() const {}
+
+        //! @brief Allocates a copy of this buffer from the Renderer's RenderHdwBufferManager.
+        HardwareBufferPtr copy() const
+        {
+            std::vector < char > content;
+
+            {
+                std::lock_guard l(mMutex);
+                content = mData;
+            }
+
+            Renderer& renderer = const_cast < Renderer& >(RenderObject::renderer());
+            return renderer.hdwBufferManager().allocate(HardwareBuffer::type(), content.size(),
+                                                        content.empty() ? nullptr : content.data());
+        }
+
+        //! @brief Returns zero.
+        std::uint64_t index() const { return 0; }
+    };
+
+    //! @brief A DrawVertexArraysCommand which draws nothing.
+    class EXPORTED NullDrawVertexArraysCommand : public DrawVertexArraysCommand
+    {
+        //! @brief The data set.
+        VertexInfosPtr mInfos;
+
+    public:
+        using DrawVertexArraysCommand::DrawVertexArraysCommand;
+
+        //! @brief Stores the arguments.
+        void construct(const VertexInfosPtr& infos);
+
+        //! @brief Returns the argument given to \ref construct().
+        VertexInfosPtr infos() const;
+
+        //! @brief Does nothing.
+        void prepare();
+
+        //! @brief Does nothing.
+        void render();
+
+        //! @brief Does nothing.
+        void finish();
+
+        //! @brief Releases the arguments.
+        void recycle();
+    };
+
+    //! @brief A DrawIndexedArraysCommand which draws nothing.
+    class EXPORTED NullDrawIndexedArraysCommand : public DrawIndexedArraysCommand
+    {
+        //! @brief The data set.
+        VertexInfosPtr mInfos;
+
+        //! @brief The indexes.
+        IndexBufferDataPtr mIndexes;
+
+    public:
+        using DrawIndexedArraysCommand::DrawIndexedArraysCommand;
+
+        //! @brief Stores the arguments.
+        void construct(const VertexInfosPtr& infos, const IndexBufferDataPtr& indexes);
+
+        //! @brief Returns the argument given to \ref construct().
+        VertexInfosPtr infos() const;
+
+        //! @brief Returns the argument given to \ref construct().
+        IndexBufferDataPtr indexes() const;
+
+        //! @brief Does nothing.
+        void prepare();
+
+        //! @brief Does nothing.
+        void render();
+
+        //! @brief Does nothing.
+        void finish();
+
+        //! @brief Releases the arguments.
+        void recycle();
+    };
+
+    //! @brief A DrawInstancedCommand which draws nothing.
+    class EXPORTED NullDrawInstancedCommand : public DrawInstancedCommand
+    {
+        //! @brief The data set.
+        VertexInfosPtr mInfos;
+
+        //! @brief The indexes, or null.
+        IndexBufferDataPtr mIndexes;
+
+        //! @brief The instance buffer.
+        RenderHdwBufferPtr mInstances;
+
+        //! @brief The first instance.
+        std::size_t mFirst = 0;
+
+        //! @brief The number of instances.
+        std::size_t mCount = 0;
+
+    public:
+        using DrawInstancedCommand::DrawInstancedCommand;
+
+        //! @brief Stores the arguments.
+        void construct(const VertexInfosPtr& infos, const IndexBufferDataPtr& indexes,
+                       const RenderHdwBufferPtr& instances, std::size_t first, std::size_t count);
+
+        //! @brief Returns the argument given to \ref construct().
+        VertexInfosPtr infos() const;
+
+        //! @brief Returns the argument given to \ref construct().
+        IndexBufferDataPtr indexes() const;
+
+        //! @brief Returns the argument given to \ref construct().
+        RenderHdwBufferPtr instances() const;
+
+        //! @brief Returns the argument given to \ref construct().
+        std::size_t first() const;
+
+        //! @brief Returns the argument given to \ref construct().
+        std::size_t count() const;
+
+        //! @brief Does nothing.
+        void prepare();
+
+        //! @brief Does nothing.
+        void render();
+
+        //! @brief Does nothing.
+        void finish();
+
+        //! @brief Releases the arguments.
+        void recycle();
+    };
+
+    //! @brief A BindBufferCommand which binds nothing.
+    class EXPORTED NullBindBufferCommand : public BindBufferCommand
+    {
+        //! @brief The slot.
+        unsigned mSlot = 0;
+
+        //! @brief The buffer.
+        RenderHdwBufferPtr mBuffer;
+
+        //! @brief The first byte.
+        std::size_t mOffset = 0;
+
+        //! @brief The number of bytes.
+        std::size_t mSize = 0;
+
+    public:
+        using BindBufferCommand::BindBufferCommand;
+
+        //! @brief Stores the arguments.
+        void construct(unsigned slot, const RenderHdwBufferPtr& buffer, std::size_t offset, std::size_t size);
+
+        //! @brief Returns the argument given to \ref construct().
+        unsigned slot() const;
+
+        //! @brief Returns the argument given to \ref construct().
+        RenderHdwBufferPtr buffer() const;
+
+        //! @brief Returns the argument given to \ref construct().
+        std::size_t offset() const;
+
+        //! @brief Returns the argument given to \ref construct().
+        std::size_t size() const;
+
+        //! @brief Does nothing.
+        void prepare();
+
+        //! @brief Does nothing.
+        void render();
+
+        //! @brief Does nothing.
+        void finish();
+
+        //! @brief Releases the arguments.
+        void recycle();
+    };
+
+    //! @brief A RenderTarget which binds nothing.
+    class EXPORTED NullRenderTarget : public RenderTarget
+    {
+        //! @brief Locked by \ref lock().
+        mutable std::mutex mMutex;
+
+    public:
+        using RenderTarget::RenderTarget;
+
+        //! @brief Does nothing.
+        void bind();
+
+        //! @brief Locks the target.
+        void lock() const;
+
+        //! @brief Unlocks the target.
+        void unlock() const;
+    };
+
+    //! @brief A Renderer which renders nothing.
+    //!
+    //! Its RenderCommands are NullCommandBuffers, its buffers hold their data in memory, and
+    //! its commands only keep what they are constructed with. It has no Shader nor
+    //! RenderPipeline. So what it costs to submit a frame is what the engine costs, without
+    //! any backend: \see CommandReplay to submit captured frames to it.
+    class EXPORTED NullRenderer : public Renderer
+    {
+        //! @brief Locked by \ref lock().
+        mutable std::recursive_mutex mMutex;
+
+    public:
+
+        //! @brief Constructs the Renderer, and registers its commands and buffers.
+        NullRenderer(Manager& manager, const std::string& name);
+
+        //! @brief Closes the command pools.
+        ~NullRenderer();
+
+        //! @brief Locks the Renderer.
+        void lock() const;
+
+        //! @brief Unlocks the Renderer.
+        void unlock() const;
+
+        //! @brief Returns null.
+        ShaderPtr _createShader(Renderer& renderer, const std::string& name) const;
+
+        //! @brief Returns null.
+        RenderPipelinePtr _createPipeline(Renderer& renderer, const std::string& name) const;
+    };
+
+    //! @brief Pointer to a NullRenderer.
+    typedef std::shared_ptr < NullRenderer > NullRendererPtr;
+}
+
+#endif // ATL_NULLRENDERER_H
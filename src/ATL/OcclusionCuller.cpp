@@ -0,0 +1,442 @@
+//
+//  OcclusionCuller.cpp
+//  atlre
+//
+//  Created by jacques tronconi on 20/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#include "OcclusionCuller.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <future>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   define ATL_OCCLUSION_SSE
+#   include <emmintrin.h>
+#endif
+
+namespace Atl
+{
+    //! @brief Smallest clip space w of a rasterized vertex. Vertexes behind it are considered
+    //! on the other side of the near plane.
+    static constexpr Real MinClipW = Real(1e-5);
+
+    //! @brief Returns the size of a HZB level on one axis.
+    static std::size_t LevelSize(std::size_t size, std::size_t level)
+    {
+        return std::max < std::size_t >(1, (size + (std::size_t(1) << level) - 1) >> level);
+    }
+
+    // ------------------------------------------------------------------------------------
+    // OccluderMesh
+
+    OccluderMeshPtr OccluderMesh::FromAABB(const AABB& box)
+    {
+        OccluderMeshPtr mesh = std::make_shared < OccluderMesh >();
+
+        for (unsigned i = 0; i < 8; ++i)
+        {
+            mesh->positions.push_back(rvec3(i & 1 ? box.max.x : box.min.x,
+                                            i & 2 ? box.max.y : box.min.y,
+                                            i & 4 ? box.max.z : box.min.z));
+        }
+
+        // Two triangles per face. Occluders are not backface culled, so winding doesn't matter.
+
+        mesh->indexes = {
+            0, 1, 3, 0, 3, 2,   4, 5, 7, 4, 7, 6,
+            0, 1, 5, 0, 5, 4,   2, 3, 7, 2, 7, 6,
+            0, 2, 6, 0, 6, 4,   1, 3, 7, 1, 7, 5
+        };
+
+        return mesh;
+    }
+
+    // ------------------------------------------------------------------------------------
+    // OcclusionCuller
+
+    OcclusionCuller::OcclusionCuller(std::size_t width, std::size_t height)
+    : mWidth((width + 3) & ~std::size_t(3)), mHeight(height), mViewProjection(1.0), mIsReady(false)
+    {
+        if (!mWidth || !mHeight)
+            throw NullError("OcclusionCuller", "OcclusionCuller", "Null depth buffer size.");
+
+        // Levels are allocated once: level i is half the size of level i - 1, down to 1x1.
+
+        for (std::size_t level = 0; ; ++level)
+        {
+            const std::size_t levelWidth = LevelSize(mWidth, level);
+            const std::size_t levelHeight = LevelSize(mHeight, level);
+
+            mLevels.push_back(std::vector < float >(levelWidth * levelHeight, 1.0f));
+
+            if (levelWidth == 1 && levelHeight == 1)
+                break;
+        }
+    }
+
+    void OcclusionCuller::addOccluder(const RenderNodePtr& node, const OccluderMeshPtr& mesh)
+    {
+        if (!mesh)
+            throw NullError("OcclusionCuller", "addOccluder", "Null OccluderMesh passed.");
+
+        if (mesh->indexes.size() % 3)
+            throw OutOfRange("OcclusionCuller", "addOccluder", "%i indexes don't make triangles.",
+                             (int)mesh->indexes.size());
+
+        for (std::uint32_t index : mesh->indexes)
+        {
+            if (index >= mesh->positions.size())
+                throw OutOfRange("OcclusionCuller", "addOccluder", "Index %i out of range.", (int)index);
+        }
+
+        std::lock_guard l(mMutex);
+        mOccluders.push_back(Occluder{ node, mesh });
+    }
+
+    void OcclusionCuller::removeOccluder(const RenderNodePtr& node)
+    {
+        std::lock_guard l(mMutex);
+
+        mOccluders.erase(std::remove_if(mOccluders.begin(), mOccluders.end(),
+                                        [&node](const Occluder& rhs){ return rhs.node == node; }),
+                         mOccluders.end());
+    }
+
+    void OcclusionCuller::clearOccluders()
+    {
+        std::lock_guard l(mMutex);
+        mOccluders.clear();
+    }
+
+    std::size_t OcclusionCuller::occludersCount() const
+    {
+        std::lock_guard l(mMutex);
+        return mOccluders.size();
+    }
+
+    void OcclusionCuller::update(const rmat4x4& viewProjection)
+    {
+        mViewProjection = viewProjection;
+        setupTriangles();
+
+        // Bands don't share any row, so they are cleared and rasterized without locking.
+
+        JobSystem& jobs = JobSystem::Get();
+        std::vector < std::future < void > > bands;
+
+        for (std::size_t first = 0; first < mHeight; first += BandHeight)
+        {
+            const std::size_t last = std::min(first + BandHeight, mHeight);
+            bands.push_back(jobs.async([this, first, last](){ rasterizeBand(first, last); }));
+        }
+
+        for (std::future < void >& band : bands)
+            jobs.wait(std::move(band));
+
+        buildLevels();
+        mIsReady = true;
+    }
+
+    bool OcclusionCuller::isOccluded(const AABB& box) const
+    {
+        if (!mIsReady)
+            return false;
+
+        Real minX = INFINITY, minY = INFINITY, minZ = INFINITY;
+        Real maxX = -INFINITY, maxY = -INFINITY;
+
+        for (unsigned i = 0; i < 8; ++i)
+        {
+            const rvec4 clip = mViewProjection * rvec4(i & 1 ? box.max.x : box.min.x,
+                                                       i & 2 ? box.max.y : box.min.y,
+                                                       i & 4 ? box.max.z : box.min.z,
+                                                       1.0);
+
+            if (clip.w <= MinClipW)
+                return false;
+
+            const Real x = (clip.x / clip.w * 0.5 + 0.5) * mWidth;
+            const Real y = (clip.y / clip.w * 0.5 + 0.5) * mHeight;
+            const Real z = clip.z / clip.w * 0.5 + 0.5;
+
+            minX = std::min(minX, x); maxX = std::max(maxX, x);
+            minY = std::min(minY, y); maxY = std::max(maxY, y);
+            minZ = std::min(minZ, z);
+        }
+
+        // Boxes outside the screen are left to frustum culling.
+
+        if (maxX < 0 || maxY < 0 || minX >= mWidth || minY >= mHeight)
+            return false;
+
+        const std::size_t x0 = static_cast < std::size_t >(std::max < Real >(minX, 0));
+        const std::size_t y0 = static_cast < std::size_t >(std::max < Real >(minY, 0));
+        const std::size_t x1 = static_cast < std::size_t >(std::min < Real >(maxX, mWidth - 1));
+        const std::size_t y1 = static_cast < std::size_t >(std::min < Real >(maxY, mHeight - 1));
+
+        // The first level where the rectangle covers at most 2x2 texels.
+
+        std::size_t level = 0;
+
+        while (level + 1 < mLevels.size() && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1))
+            level++;
+
+        const std::size_t levelWidth = LevelSize(mWidth, level);
+        const std::vector < float >& depths = mLevels[level];
+        float farthest = 0.0f;
+
+        for (std::size_t y = y0 >> level; y <= y1 >> level; ++y)
+        {
+            for (std::size_t x = x0 >> level; x <= x1 >> level; ++x)
+                farthest = std::max(farthest, depths[y * levelWidth + x]);
+        }
+
+        return minZ > farthest;
+    }
+
+    std::size_t OcclusionCuller::width() const
+    {
+        return mWidth;
+    }
+
+    std::size_t OcclusionCuller::height() const
+    {
+        return mHeight;
+    }
+
+    std::size_t OcclusionCuller::levelsCount() const
+    {
+        return mLevels.size();
+    }
+
+    float OcclusionCuller::depthAt(std::size_t level, std::size_t x, std::size_t y) const
+    {
+        if (level >= mLevels.size())
+            throw OutOfRange("OcclusionCuller", "depthAt", "Level %i out of range.", (int)level);
+
+        const std::size_t levelWidth = LevelSize(mWidth, level);
+        const std::size_t levelHeight = LevelSize(mHeight, level);
+
+        if (x >= levelWidth || y >= levelHeight)
+            throw OutOfRange("OcclusionCuller", "depthAt", "Texel (%i, %i) out of range.", (int)x, (int)y);
+
+        return mLevels[level][y * levelWidth + x];
+    }
+
+    void OcclusionCuller::setupTriangles()
+    {
+        mTriangles.clear();
+
+        std::lock_guard l(mMutex);
+
+        std::vector < rvec4 > clip;
+        std::vector < rvec3 > screen;
+
+        for (const Occluder& occluder : mOccluders)
+        {
+            const rmat4x4 matrix = occluder.node ? mViewProjection * occluder.node->worldMatrix() : mViewProjection;
+            const OccluderMesh& mesh = *occluder.mesh;
+
+            clip.resize(mesh.positions.size());
+            screen.resize(mesh.positions.size());
+
+            for (std::size_t i = 0; i < mesh.positions.size(); ++i)
+            {
+                clip[i] = matrix * rvec4(mesh.positions[i], 1.0);
+
+                if (clip[i].w > MinClipW)
+                {
+                    screen[i] = rvec3((clip[i].x / clip[i].w * 0.5 + 0.5) * mWidth,
+                                      (clip[i].y / clip[i].w * 0.5 + 0.5) * mHeight,
+                                      clip[i].z / clip[i].w * 0.5 + 0.5);
+                }
+            }
+
+            for (std::size_t i = 0; i < mesh.indexes.size(); i += 3)
+            {
+                std::uint32_t v[3] = { mesh.indexes[i], mesh.indexes[i + 1], mesh.indexes[i + 2] };
+
+                // Triangles crossing the near plane are skipped instead of clipped: an occluder
+                // hiding less than it should is always correct.
+
+                if (clip[v[0]].w <= MinClipW || clip[v[1]].w <= MinClipW || clip[v[2]].w <= MinClipW)
+                    continue;
+
+                const rvec3& a = screen[v[0]];
+                const rvec3& b = screen[v[1]];
+                const rvec3& c = screen[v[2]];
+
+                Real area = (b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y);
+
+                if (std::abs(area) < Real(1e-6))
+                    continue;
+
+                // Counter-clockwise triangles have positive edge functions inside.
+
+                if (area < 0)
+                {
+                    std::swap(v[1], v[2]);
+                    area = -area;
+                }
+
+                const rvec3* p[3] = { &screen[v[0]], &screen[v[1]], &screen[v[2]] };
+
+                Triangle triangle;
+                Real minX = INFINITY, minY = INFINITY, minZ = INFINITY, maxX = -INFINITY, maxY = -INFINITY;
+
+                for (int k = 0; k < 3; ++k)
+                {
+                    minX = std::min(minX, p[k]->x); maxX = std::max(maxX, p[k]->x);
+                    minY = std::min(minY, p[k]->y); maxY = std::max(maxY, p[k]->y);
+                    minZ = std::min(minZ, p[k]->z);
+                }
+
+                if (maxX < 0 || maxY < 0 || minX >= mWidth || minY >= mHeight || minZ > 1)
+                    continue;
+
+                // Edge k is opposite to vertex k, its function is the weight of vertex k times
+                // the area: E(x, y) = (b.x - a.x) * (y - a.y) - (b.y - a.y) * (x - a.x).
+
+                Real depthPlane[3] = { 0, 0, 0 };
+
+                for (int k = 0; k < 3; ++k)
+                {
+                    const rvec3& from = *p[(k + 1) % 3];
+                    const rvec3& to = *p[(k + 2) % 3];
+
+                    const Real ea = from.y - to.y;
+                    const Real eb = to.x - from.x;
+                    const Real ec = -(ea * from.x + eb * from.y);
+
+                    triangle.edges[k][0] = static_cast < float >(ea);
+                    triangle.edges[k][1] = static_cast < float >(eb);
+                    triangle.edges[k][2] = static_cast < float >(ec);
+
+                    depthPlane[0] += p[k]->z * ea / area;
+                    depthPlane[1] += p[k]->z * eb / area;
+                    depthPlane[2] += p[k]->z * ec / area;
+                }
+
+                for (int k = 0; k < 3; ++k)
+                    triangle.depth[k] = static_cast < float >(depthPlane[k]);
+
+                triangle.minX = std::max(0, static_cast < int >(std::floor(minX)));
+                triangle.minY = std::max(0, static_cast < int >(std::floor(minY)));
+                triangle.maxX = std::min(static_cast < int >(mWidth) - 1, static_cast < int >(std::ceil(maxX)));
+                triangle.maxY = std::min(static_cast < int >(mHeight) - 1, static_cast < int >(std::ceil(maxY)));
+
+                mTriangles.push_back(triangle);
+            }
+        }
+    }
+
+    void OcclusionCuller::rasterizeBand(std::size_t first, std::size_t last)
+    {
+        std::vector < float >& depths = mLevels[0];
+
+        std::fill(depths.begin() + first * mWidth, depths.begin() + last * mWidth, 1.0f);
+
+        const int bandMin = static_cast < int >(first);
+        const int bandMax = static_cast < int >(last) - 1;
+
+        for (const Triangle& triangle : mTriangles)
+        {
+            const int minY = std::max(triangle.minY, bandMin);
+            const int maxY = std::min(triangle.maxY, bandMax);
+
+            if (minY > maxY)
+                continue;
+
+            // Pixels are processed four by four from an aligned column. The width is a multiple
+            // of 4, so the last group never goes past the end of the row.
+
+            const int minX = triangle.minX & ~3;
+            const int maxX = triangle.maxX;
+
+            const float (&e)[3][3] = triangle.edges;
+            const float (&d)[3] = triangle.depth;
+
+            for (int y = minY; y <= maxY; ++y)
+            {
+                const float py = y + 0.5f;
+                float* row = depths.data() + y * mWidth;
+
+                const float e0y = e[0][1] * py + e[0][2];
+                const float e1y = e[1][1] * py + e[1][2];
+                const float e2y = e[2][1] * py + e[2][2];
+                const float dy = d[1] * py + d[2];
+
+#if defined(ATL_OCCLUSION_SSE)
+                const __m128 zero = _mm_setzero_ps();
+                const __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+
+                for (int x = minX; x <= maxX; x += 4)
+                {
+                    const __m128 px = _mm_add_ps(_mm_set1_ps(static_cast < float >(x)), offsets);
+
+                    const __m128 w0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(e[0][0]), px), _mm_set1_ps(e0y));
+                    const __m128 w1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(e[1][0]), px), _mm_set1_ps(e1y));
+                    const __m128 w2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(e[2][0]), px), _mm_set1_ps(e2y));
+
+                    const __m128 inside = _mm_and_ps(_mm_cmpge_ps(w0, zero),
+                                                     _mm_and_ps(_mm_cmpge_ps(w1, zero), _mm_cmpge_ps(w2, zero)));
+
+                    if (!_mm_movemask_ps(inside))
+                        continue;
+
+                    const __m128 depth = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(d[0]), px), _mm_set1_ps(dy));
+                    const __m128 previous = _mm_loadu_ps(row + x);
+                    const __m128 nearest = _mm_min_ps(previous, depth);
+
+                    _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, previous)));
+                }
+#else
+                for (int x = minX; x <= maxX; ++x)
+                {
+                    const float px = x + 0.5f;
+
+                    if (e[0][0] * px + e0y < 0 || e[1][0] * px + e1y < 0 || e[2][0] * px + e2y < 0)
+                        continue;
+
+                    row[x] = std::min(row[x], d[0] * px + dy);
+                }
+#endif
+            }
+        }
+    }
+
+    void OcclusionCuller::buildLevels()
+    {
+        for (std::size_t level = 1; level < mLevels.size(); ++level)
+        {
+            const std::vector < float >& source = mLevels[level - 1];
+            std::vector < float >& dest = mLevels[level];
+
+            const std::size_t sourceWidth = LevelSize(mWidth, level - 1);
+            const std::size_t sourceHeight = LevelSize(mHeight, level - 1);
+            const std::size_t destWidth = LevelSize(mWidth, level);
+            const std::size_t destHeight = LevelSize(mHeight, level);
+
+            // Odd sizes make the last texel cover one texel of the previous level only.
+
+            for (std::size_t y = 0; y < destHeight; ++y)
+            {
+                const std::size_t y0 = 2 * y;
+                const std::size_t y1 = std::min(y0 + 1, sourceHeight - 1);
+
+                for (std::size_t x = 0; x < destWidth; ++x)
+                {
+                    const std::size_t x0 = 2 * x;
+                    const std::size_t x1 = std::min(x0 + 1, sourceWidth - 1);
+
+                    dest[y * destWidth + x] = std::max(std::max(source[y0 * sourceWidth + x0], source[y0 * sourceWidth + x1]),
+                                                       std::max(source[y1 * sourceWidth + x0], source[y1 * sourceWidth + x1]));
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,166 @@
+//
+//  OcclusionCuller.h
+//  atlre
+//
+//  Created by jacques tronconi on 20/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#ifndef ATL_OCCLUSIONCULLER_H
+#define ATL_OCCLUSIONCULLER_H
+
+#include "Platform.h"
+#include "RenderNode.h"
+#include "AABB.h"
+
+#include <cstdint>
+#include <vector>
+#include <mutex>
+
+namespace Atl
+{
+    struct OccluderMesh;
+
+    //! @brief Pointer to an OccluderMesh.
+    typedef std::shared_ptr < OccluderMesh > OccluderMeshPtr;
+
+    class OcclusionCuller;
+
+    //! @brief Pointer to an OcclusionCuller.
+    typedef std::shared_ptr < OcclusionCuller > OcclusionCullerPtr;
+
+    //! @brief A simplified triangle mesh rasterized by the OcclusionCuller. It should be smaller
+    //! than the object it stands for, so it never hides something the object doesn't hide.
+    struct EXPORTED OccluderMesh
+    {
+        //! @brief The vertexes, in model space.
+        std::vector < rvec3 > positions;
+
+        //! @brief Three indexes in positions per triangle.
+        std::vector < std::uint32_t > indexes;
+
+        //! @brief Returns a mesh made of the twelve triangles of a box.
+        static OccluderMeshPtr FromAABB(const AABB& box);
+    };
+
+    //! @brief A software occlusion culler, working on the CPU only.
+    //!
+    //! Each frame, \ref update() rasterizes the occluder meshes at low resolution in a depth
+    //! buffer, and builds a hierarchical depth buffer (HZB) from it where each texel keeps
+    //! the farthest depth of the four texels below it. The rows of the depth buffer are split
+    //! in bands rasterized in parallel by the JobSystem, four pixels at once with SSE.
+    //!
+    //! \ref isOccluded() projects an AABB on the screen and compares its nearest depth with
+    //! the farthest depth of the HZB texels under it, at the level where they are at most two
+    //! by two. Triangles crossing the near plane are not rasterized and boxes crossing it are
+    //! never occluded, so the culler only rejects boxes which are really hidden (up to the
+    //! resolution of the depth buffer, as depth is sampled at the center of the pixels).
+    class EXPORTED OcclusionCuller
+    {
+    public:
+
+        //! @brief Default width of the depth buffer.
+        static constexpr std::size_t DefaultWidth = 256;
+
+        //! @brief Default height of the depth buffer.
+        static constexpr std::size_t DefaultHeight = 128;
+
+        //! @brief Number of rows in a band rasterized by one job.
+        static constexpr std::size_t BandHeight = 16;
+
+    private:
+
+        //! @brief An occluder mesh and the node giving its world matrix.
+        struct Occluder
+        {
+            RenderNodePtr node;
+            OccluderMeshPtr mesh;
+        };
+
+        //! @brief A triangle ready to be rasterized. Edge functions and depth are planes in
+        //! screen space: value = a * x + b * y + c.
+        struct Triangle
+        {
+            float edges[3][3];
+            float depth[3];
+            int minX, maxX, minY, maxY;
+        };
+
+        //! @brief Protects mOccluders.
+        mutable std::mutex mMutex;
+
+        //! @brief The occluders.
+        std::vector < Occluder > mOccluders;
+
+        //! @brief Width of the depth buffer, a multiple of 4.
+        std::size_t mWidth;
+
+        //! @brief Height of the depth buffer.
+        std::size_t mHeight;
+
+        //! @brief The HZB levels. The first one is the depth buffer, and each level is half
+        //! the size of the previous one, down to one texel.
+        std::vector < std::vector < float > > mLevels;
+
+        //! @brief Triangles of the current frame, kept between frames.
+        std::vector < Triangle > mTriangles;
+
+        //! @brief The matrix given to the last \ref update().
+        rmat4x4 mViewProjection;
+
+        //! @brief True once \ref update() has been called.
+        bool mIsReady;
+
+    public:
+        ATL_SHAREABLE(OcclusionCuller)
+
+        //! @brief Constructs the culler. The width is rounded up to a multiple of 4.
+        OcclusionCuller(std::size_t width = DefaultWidth, std::size_t height = DefaultHeight);
+
+        //! @brief Adds an occluder. Its world matrix is \ref RenderNode::worldMatrix() of the
+        //! given node, or identity if node is null.
+        void addOccluder(const RenderNodePtr& node, const OccluderMeshPtr& mesh);
+
+        //! @brief Removes every occluder using the given node.
+        void removeOccluder(const RenderNodePtr& node);
+
+        //! @brief Removes every occluder.
+        void clearOccluders();
+
+        //! @brief Returns the number of occluders.
+        std::size_t occludersCount() const;
+
+        //! @brief Rasterizes the occluders for the given view-projection matrix and builds
+        //! the HZB.
+        void update(const rmat4x4& viewProjection);
+
+        //! @brief Returns true if the box is hidden by the occluders rasterized by the last
+        //! \ref update(). Returns false before the first update.
+        bool isOccluded(const AABB& box) const;
+
+        //! @brief Returns the width of the depth buffer.
+        std::size_t width() const;
+
+        //! @brief Returns the height of the depth buffer.
+        std::size_t height() const;
+
+        //! @brief Returns the number of HZB levels.
+        std::size_t levelsCount() const;
+
+        //! @brief Returns the depth at given texel of a HZB level, between 0 (near) and 1 (far).
+        float depthAt(std::size_t level, std::size_t x, std::size_t y) const;
+
+    private:
+
+        //! @brief Projects the triangles of every occluder in mTriangles.
+        void setupTriangles();
+
+        //! @brief Clears and rasterizes the rows [first, last) of the depth buffer.
+        void rasterizeBand(std::size_t first, std::size_t last);
+
+        //! @brief Builds every HZB level from the depth buffer.
+        void buildLevels();
+    };
+}
+
+#endif // ATL_OCCLUSIONCULLER_H
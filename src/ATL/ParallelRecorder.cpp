@@ -0,0 +1,89 @@
+//
+//  ParallelRecorder.cpp
+//  atlre
+//
+//  Created by jacques tronconi on 23/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#include "ParallelRecorder.h"
+#include "Renderer.h"
+#include "JobSystem.h"
+
+namespace Atl
+{
+    ParallelRecorder::~ParallelRecorder()
+    {
+        // Jobs reference the recorder, so they must be done before it is destroyed.
+
+        wait();
+    }
+
+    void ParallelRecorder::launch(Renderer& renderer, std::size_t count, RecordFunction function)
+    {
+        if (!mCommands.empty())
+            throw OutOfRange("ParallelRecorder", "launch", "Recorder already launched.");
+
+        if (!function)
+            throw NullError("ParallelRecorder", "launch", "Null function passed.");
+
+        mCommands.reserve(count);
+        mResults.reserve(count);
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            RenderCommandPtr command = renderer.newCommand < RenderCommand >();
+
+            if (!command)
+                throw NullError("ParallelRecorder", "launch", "Null RenderCommand created.");
+
+            mCommands.push_back(command);
+        }
+
+        mFunction = std::move(function);
+
+        for (std::size_t i = 1; i < count; ++i)
+        {
+            RenderCommand* command = mCommands[i].get();
+            mResults.push_back(JobSystem::Get().async([this, command, i](){ mFunction(*command, i); }));
+        }
+    }
+
+    void ParallelRecorder::merge(RenderCommand& command)
+    {
+        wait();
+
+        if (mError)
+            std::rethrow_exception(mError);
+
+        LockableGuard l(command);
+
+        for (const RenderCommandPtr& subCommand : mCommands)
+            command.addSubCommand(subCommand);
+    }
+
+    std::size_t ParallelRecorder::jobsCount() const
+    {
+        return mCommands.size();
+    }
+
+    void ParallelRecorder::wait()
+    {
+        if (!mFunction || mCommands.empty())
+            return;
+
+        try { mFunction(*mCommands.front(), 0); }
+        catch (...) { mError = std::current_exception(); }
+
+        // Every job is waited, even after an error, as they all reference the recorder.
+
+        for (std::future < void >& result : mResults)
+        {
+            try { JobSystem::Get().wait(std::move(result)); }
+            catch (...) { if (!mError) mError = std::current_exception(); }
+        }
+
+        mResults.clear();
+        mFunction = nullptr;
+    }
+}
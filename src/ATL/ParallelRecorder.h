@@ -0,0 +1,82 @@
+//
+//  ParallelRecorder.h
+//  atlre
+//
+//  Created by jacques tronconi on 23/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#ifndef ATL_PARALLELRECORDER_H
+#define ATL_PARALLELRECORDER_H
+
+#include "Platform.h"
+#include "RenderCommand.h"
+
+#include <functional>
+#include <future>
+#include <vector>
+
+namespace Atl
+{
+    //! @brief Records RenderCommands in parallel and merges them in a deterministic order.
+    //!
+    //! \ref launch() creates one sub command per job with \ref Renderer::newCommand(), and
+    //! submits the jobs to the JobSystem. Each job records only in its own sub command, so jobs
+    //! never wait for each other. \ref merge() waits for every job and adds the sub commands to
+    //! the destination in job order: the recorded frame doesn't depend on which job finishes
+    //! first.
+    //!
+    //! The destination keeps the sub commands alive until its next reset, so a recorder is
+    //! meant to be used once, on the stack of the recording function.
+    class EXPORTED ParallelRecorder
+    {
+    public:
+
+        //! @brief The function recording a job. Its second argument is the job index.
+        typedef std::function < void(RenderCommand&, std::size_t) > RecordFunction;
+
+    private:
+
+        //! @brief The function recording each job.
+        RecordFunction mFunction;
+
+        //! @brief The sub commands, one per job.
+        RenderCommandList mCommands;
+
+        //! @brief The jobs results, one per job.
+        std::vector < std::future < void > > mResults;
+
+        //! @brief The first error thrown by a job, once waited.
+        std::exception_ptr mError;
+
+    public:
+
+        //! @brief Constructs an empty recorder.
+        ParallelRecorder() = default;
+
+        //! @brief Waits for the jobs still running.
+        ~ParallelRecorder();
+
+        ParallelRecorder(const ParallelRecorder&) = delete;
+        ParallelRecorder& operator = (const ParallelRecorder&) = delete;
+
+        //! @brief Submits count jobs calling function, each with its own sub command. The first
+        //! job is executed on the calling thread by \ref merge(), so a single job never goes
+        //! through the JobSystem.
+        void launch(Renderer& renderer, std::size_t count, RecordFunction function);
+
+        //! @brief Waits for every job, and adds their sub commands to command in job order.
+        //! If a job threw, nothing is added and the first error is rethrown.
+        void merge(RenderCommand& command);
+
+        //! @brief Returns the number of jobs launched.
+        std::size_t jobsCount() const;
+
+    private:
+
+        //! @brief Executes the first job and waits for the others. Errors are kept in mError.
+        void wait();
+    };
+}
+
+#endif // ATL_PARALLELRECORDER_H
@@ -15,12 +15,22 @@ namespace Atl
         
     }
     
+    void RenderCommandBase::recycle()
+    {
+        
+    }
+    
     RenderCommand::RenderCommand(Renderer& rhs)
     : RenderCommandBase(rhs)
     {
         
     }
     
+    CommandBuffer* RenderCommand::asCommandBuffer()
+    {
+        return nullptr;
+    }
+    
     void RenderCommand::addSubCommand(const RenderCommandBasePtr &subCommand)
     {
         std::lock_guard l(mMutex);
@@ -64,6 +74,17 @@ namespace Atl
         mSubCommands.clear();
     }
     
+    RenderCommandBaseList RenderCommand::subCommands() const
+    {
+        std::lock_guard l(mMutex);
+        return mSubCommands;
+    }
+    
+    void RenderCommand::recycle()
+    {
+        removeAllSubCommands();
+    }
+    
     void RenderCommand::prepare()
     {
         
@@ -21,6 +21,7 @@
 namespace Atl
 {
     class Renderer;
+    class CommandBuffer;
     
     //! @brief Interface for a basic rendering command.
     //! A rendering command can be any rendering operation, from rendering multiple child
@@ -59,6 +60,11 @@ namespace Atl
         
         //! @brief Finishes all operations from this command.
         virtual void finish() = 0;
+
+        //! @brief Called when the command returns to its Renderer's RenderCommandPool. Must
+        //! release what the command references, as it may stay in the pool for a long time.
+        //! The next user calls construct() again. Does nothing by default.
+        virtual void recycle();
     };
     
     typedef std::shared_ptr < RenderCommandBase > RenderCommandBasePtr;
@@ -84,6 +90,10 @@ namespace Atl
         //! @brief Default destructor.
         virtual ~RenderCommand() = default;
         
+        //! @brief Returns this command as a CommandBuffer, or null if it isn't one. RenderCaches
+        //! record packets in the returned buffer instead of adding sub commands.
+        virtual CommandBuffer* asCommandBuffer();
+        
         //! @brief Adds a sub command.
         virtual void addSubCommand(const RenderCommandBasePtr& subCommand);
         
@@ -109,6 +119,12 @@ namespace Atl
         
         //! @brief Removes all sub commands.
         virtual void removeAllSubCommands();
+
+        //! @brief Returns a copy of the sub commands.
+        RenderCommandBaseList subCommands() const;
+
+        //! @brief Removes all sub commands.
+        virtual void recycle();
         
         //! @brief Does nothing. \see render().
         virtual void prepare();
@@ -0,0 +1,44 @@
+//
+//  RenderCommandPool.cpp
+//  atlre
+//
+//  Created by jacques tronconi on 25/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#include "RenderCommandPool.h"
+
+namespace Atl
+{
+    RenderCommandPools::RenderCommandPools()
+    {
+        for (std::atomic < RenderCommandPoolBase* >& slot : mSlots)
+            slot.store(nullptr, std::memory_order_relaxed);
+    }
+
+    RenderCommandPools::~RenderCommandPools()
+    {
+        close();
+    }
+
+    void RenderCommandPools::close()
+    {
+        std::lock_guard l(mMutex);
+
+        for (std::atomic < RenderCommandPoolBase* >& slot : mSlots)
+            slot.store(nullptr, std::memory_order_release);
+
+        // Pools still referenced by a command live until it is released, but keep nothing.
+
+        for (const std::shared_ptr < RenderCommandPoolBase >& pool : mPools)
+            pool->close();
+
+        mPools.clear();
+    }
+
+    std::size_t RenderCommandPools::NextTypeIndex()
+    {
+        static std::atomic < std::size_t > next(0);
+        return next++;
+    }
+}
@@ -0,0 +1,346 @@
+//
+//  RenderCommandPool.h
+//  atlre
+//
+//  Created by jacques tronconi on 25/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#ifndef ATL_RENDERCOMMANDPOOL_H
+#define ATL_RENDERCOMMANDPOOL_H
+
+#include "Platform.h"
+#include "Error.h"
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace Atl
+{
+    class Renderer;
+
+    //! @brief Base of \ref RenderCommandPool, so the pools of every type are closed together.
+    class EXPORTED RenderCommandPoolBase
+    {
+    public:
+
+        //! @brief Destructor.
+        virtual ~RenderCommandPoolBase() = default;
+
+        //! @brief Destroys the free commands. Commands released afterwards are destroyed instead
+        //! of being kept.
+        virtual void close() = 0;
+
+        //! @brief Returns the number of free commands.
+        virtual std::size_t freeCount() const = 0;
+    };
+
+    //! @brief Recycles the commands of type T created by a Renderer.
+    //!
+    //! \ref acquire() returns a free command if any, and constructs one otherwise. When the
+    //! last reference to the command is released, RenderCommandBase::recycle() is called and the
+    //! command returns to the pool. The control blocks of the std::shared_ptr are recycled too,
+    //! so a command acquired from the pool doesn't allocate.
+    //!
+    //! The pool is kept alive by the commands it created, and may be destroyed after its
+    //! Renderer: \ref close() destroys the free commands while the Renderer is still alive.
+    template < typename T >
+    class RenderCommandPool : public RenderCommandPoolBase,
+                              public std::enable_shared_from_this < RenderCommandPool < T > >
+    {
+    public:
+
+        //! @brief Constructs a new command of the derived type registered for T.
+        typedef std::function < T*(Renderer&) > Constructor;
+
+        //! @brief The default maximum number of free commands, and of free control blocks.
+        static constexpr std::size_t DefaultCapacity = 256;
+
+    private:
+
+        //! @brief Returns a released command to its pool.
+        struct Recycler
+        {
+            RenderCommandPool* pool;
+
+            void operator()(T* command) const
+            {
+                pool->recycle(command);
+            }
+        };
+
+        //! @brief Allocates the control blocks from the pool. It holds the pool, as the control
+        //! block is deallocated after the Recycler is destroyed.
+        template < typename U >
+        struct BlockAllocator
+        {
+            typedef U value_type;
+
+            template < typename V >
+            struct rebind { typedef BlockAllocator < V > other; };
+
+            std::shared_ptr < RenderCommandPool > pool;
+
+            BlockAllocator(const std::shared_ptr < RenderCommandPool >& rhs) : pool(rhs) {}
+
+            template < typename V >
+            BlockAllocator(const BlockAllocator < V >& rhs) : pool(rhs.pool) {}
+
+            U* allocate(std::size_t n)
+            {
+                return static_cast < U* >(pool->allocateBlock(n * sizeof(U)));
+            }
+
+            void deallocate(U* block, std::size_t n)
+            {
+                pool->deallocateBlock(block, n * sizeof(U));
+            }
+
+            template < typename V >
+            bool operator == (const BlockAllocator < V >& rhs) const { return pool == rhs.pool; }
+
+            template < typename V >
+            bool operator != (const BlockAllocator < V >& rhs) const { return pool != rhs.pool; }
+        };
+
+        //! @brief Constructs the commands when the pool is empty.
+        Constructor mConstructor;
+
+        //! @brief The free commands.
+        std::vector < T* > mCommands;
+
+        //! @brief The free control blocks, all of mBlockSize bytes.
+        std::vector < void* > mBlocks;
+
+        //! @brief The size of a control block, known once the first one is allocated.
+        std::size_t mBlockSize;
+
+        //! @brief The maximum number of free commands, and of free control blocks.
+        std::size_t mCapacity;
+
+        //! @brief True once \ref close() is called.
+        bool mIsClosed;
+
+        //! @brief Protects the free lists.
+        mutable std::mutex mMutex;
+
+    public:
+
+        //! @brief Constructs a pool.
+        RenderCommandPool(Constructor constructor, std::size_t capacity = DefaultCapacity)
+        : mConstructor(std::move(constructor)), mBlockSize(0), mCapacity(capacity), mIsClosed(false)
+        {
+            if (!mConstructor)
+                throw NullError("RenderCommandPool", "RenderCommandPool", "Null constructor passed.");
+        }
+
+        //! @brief Destructor.
+        ~RenderCommandPool()
+        {
+            close();
+        }
+
+        //! @brief Returns a free command, or constructs one for renderer.
+        std::shared_ptr < T > acquire(Renderer& renderer)
+        {
+            T* command = nullptr;
+
+            {
+                std::lock_guard l(mMutex);
+
+                if (!mCommands.empty())
+                {
+                    command = mCommands.back();
+                    mCommands.pop_back();
+                }
+            }
+
+            if (!command)
+                command = mConstructor(renderer);
+
+            if (!command)
+                throw NullError("RenderCommandPool", "acquire", "Null command constructed.");
+
+            // If the control block cannot be allocated, the Recycler gets the command back.
+
+            return std::shared_ptr < T >(command, Recycler{ this },
+                                         BlockAllocator < T >(this->shared_from_this()));
+        }
+
+        //! @brief Destroys the free commands and control blocks.
+        void close()
+        {
+            std::vector < T* > commands;
+            std::vector < void* > blocks;
+
+            {
+                std::lock_guard l(mMutex);
+                mIsClosed = true;
+                commands.swap(mCommands);
+                blocks.swap(mBlocks);
+            }
+
+            for (T* command : commands)
+                delete command;
+
+            for (void* block : blocks)
+                ::operator delete(block);
+        }
+
+        //! @brief Returns the number of free commands.
+        std::size_t freeCount() const
+        {
+            std::lock_guard l(mMutex);
+            return mCommands.size();
+        }
+
+    private:
+
+        //! @brief Releases what the command references, and keeps it if there is room.
+        void recycle(T* command)
+        {
+            try { command->recycle(); }
+            catch (...) { delete command; return; }
+
+            {
+                std::lock_guard l(mMutex);
+
+                if (!mIsClosed && mCommands.size() < mCapacity)
+                {
+                    mCommands.push_back(command);
+                    return;
+                }
+            }
+
+            delete command;
+        }
+
+        //! @brief Returns a free control block of size bytes, or allocates one.
+        void* allocateBlock(std::size_t size)
+        {
+            {
+                std::lock_guard l(mMutex);
+
+                if (!mBlockSize)
+                    mBlockSize = size;
+
+                if (size == mBlockSize && !mBlocks.empty())
+                {
+                    void* block = mBlocks.back();
+                    mBlocks.pop_back();
+                    return block;
+                }
+            }
+
+            return ::operator new(size);
+        }
+
+        //! @brief Keeps a control block if there is room, and deallocates it otherwise.
+        void deallocateBlock(void* block, std::size_t size)
+        {
+            {
+                std::lock_guard l(mMutex);
+
+                if (!mIsClosed && size == mBlockSize && mBlocks.size() < mCapacity)
+                {
+                    mBlocks.push_back(block);
+                    return;
+                }
+            }
+
+            ::operator delete(block);
+        }
+    };
+
+    //! @brief The RenderCommandPools of a Renderer, one per command type.
+    //!
+    //! Each type gets a process wide index the first time it is used, and its pool is stored at
+    //! this index. \ref find() is then a single atomic load: no lock, no map lookup and no
+    //! dynamic cast. Types beyond \ref MaxTypes are not pooled.
+    class EXPORTED RenderCommandPools
+    {
+    public:
+
+        //! @brief The maximum number of pooled types.
+        static constexpr std::size_t MaxTypes = 64;
+
+    private:
+
+        //! @brief The pools, by type index. Null if the type has no pool.
+        std::array < std::atomic < RenderCommandPoolBase* >, MaxTypes > mSlots;
+
+        //! @brief Owns the pools, including the ones replaced.
+        std::vector < std::shared_ptr < RenderCommandPoolBase > > mPools;
+
+        //! @brief Protects mPools and the stores in mSlots.
+        std::mutex mMutex;
+
+    public:
+
+        //! @brief Constructs an empty registry.
+        RenderCommandPools();
+
+        //! @brief Closes every pool.
+        ~RenderCommandPools();
+
+        RenderCommandPools(const RenderCommandPools&) = delete;
+        RenderCommandPools& operator = (const RenderCommandPools&) = delete;
+
+        //! @brief Returns the index of type T, given the first time it is called.
+        template < typename T >
+        static std::size_t TypeIndex()
+        {
+            static const std::size_t index = NextTypeIndex();
+            return index;
+        }
+
+        //! @brief Sets the pool of type T, and closes the previous one. Returns null if T cannot
+        //! be pooled.
+        template < typename T >
+        std::shared_ptr < RenderCommandPool < T > > setPool(typename RenderCommandPool < T >::Constructor constructor)
+        {
+            const std::size_t index = TypeIndex < T >();
+
+            if (index >= MaxTypes)
+                return nullptr;
+
+            auto pool = std::make_shared < RenderCommandPool < T > >(std::move(constructor));
+
+            std::lock_guard l(mMutex);
+            RenderCommandPoolBase* previous = mSlots[index].exchange(pool.get(), std::memory_order_acq_rel);
+
+            if (previous)
+                previous->close();
+
+            mPools.push_back(pool);
+            return pool;
+        }
+
+        //! @brief Returns the pool of type T, or null.
+        template < typename T >
+        RenderCommandPool < T >* find() const
+        {
+            const std::size_t index = TypeIndex < T >();
+
+            if (index >= MaxTypes)
+                return nullptr;
+
+            return static_cast < RenderCommandPool < T >* >(mSlots[index].load(std::memory_order_acquire));
+        }
+
+        //! @brief Destroys the free commands of every pool, and stops pooling.
+        void close();
+
+    private:
+
+        //! @brief Returns the next type index.
+        static std::size_t NextTypeIndex();
+    };
+}
+
+#endif // ATL_RENDERCOMMANDPOOL_H
@@ -14,6 +14,7 @@ namespace Atl
 
     RenderHdwBuffer::RenderHdwBuffer(Renderer& rhs, const RenderHdwBufferObserverPtr& observer, const HBT& type)
     : HardwareBuffer(type), RenderObject(rhs), mObserver(observer), mRelatedIndex(0)
+    , mSourceGeneration(NoGeneration)
     {
         if (!observer)
             throw NullError("RenderHdwBuffer", "RenderHdwBuffer", "Null observer passed.");
@@ -29,6 +30,31 @@ namespace Atl
         mRelatedIndex.store(relIndex);
     }
 
+    std::uint64_t RenderHdwBuffer::sourceGeneration() const
+    {
+        return mSourceGeneration.load();
+    }
+
+    void RenderHdwBuffer::setSourceGeneration(std::uint64_t generation)
+    {
+        mSourceGeneration.store(generation);
+    }
+
+    RenderHdwBuffer& RenderHdwBuffer::backing()
+    {
+        return *this;
+    }
+
+    const RenderHdwBuffer& RenderHdwBuffer::backing() const
+    {
+        return *this;
+    }
+
+    std::size_t RenderHdwBuffer::backingOffset() const
+    {
+        return 0;
+    }
+
     // ------------------------------------------------------------------------------------
     // RenderHdwVertexBuffer
 
@@ -46,4 +72,13 @@ namespace Atl
     {
         
     }
+
+    // ------------------------------------------------------------------------------------
+    // RenderHdwUniformBuffer
+
+    RenderHdwUniformBuffer::RenderHdwUniformBuffer(Renderer& rhs, const RenderHdwBufferObserverPtr& observer)
+    : RenderHdwBuffer(rhs, observer, HBT::Uniform)
+    {
+        
+    }
 }
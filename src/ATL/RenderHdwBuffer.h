@@ -29,6 +29,10 @@ namespace Atl
         //! MemBuffer. The MemBuffer can then retrieve the buffer in the manager, with
         //! \ref RenderHdwBufferManager::findOrCreateRelated().
         std::atomic < MemBuffer::Index > mRelatedIndex;
+
+        //! @brief The generation of the related MemBuffer copied in this buffer, or
+        //! \ref HardwareBuffer::NoGeneration if never copied.
+        std::atomic < std::uint64_t > mSourceGeneration;
         
     public:
         //! @brief Constructs an empty buffer.
@@ -45,6 +49,22 @@ namespace Atl
 
         //! @brief Sets \ref mRelatedIndex.
         void setRelatedIndex(const MemBuffer::Index& relIndex);
+
+        //! @brief Returns \ref mSourceGeneration.
+        std::uint64_t sourceGeneration() const;
+
+        //! @brief Sets \ref mSourceGeneration, once the related MemBuffer is copied.
+        void setSourceGeneration(std::uint64_t generation);
+
+        //! @brief Returns the buffer of the backend holding this buffer's data. This is this
+        //! buffer, except for a RenderHdwSubBuffer which returns its block.
+        virtual RenderHdwBuffer& backing();
+
+        //! @brief Returns the buffer of the backend holding this buffer's data.
+        virtual const RenderHdwBuffer& backing() const;
+
+        //! @brief Returns the offset of this buffer's data in \ref backing(), in bytes.
+        virtual std::size_t backingOffset() const;
     };
     
     typedef std::shared_ptr < RenderHdwBuffer > RenderHdwBufferPtr;
@@ -69,6 +89,13 @@ namespace Atl
         //! @brief Constructs a RenderHdwBuffer where type is HBT::Index.
         RenderHdwIndexBuffer(Renderer& rhs, const RenderHdwBufferObserverPtr& observer);
     };
+
+    //! @brief Defines a Uniform Buffer.
+    struct EXPORTED RenderHdwUniformBuffer : public RenderHdwBuffer
+    {
+        //! @brief Constructs a RenderHdwBuffer where type is HBT::Uniform.
+        RenderHdwUniformBuffer(Renderer& rhs, const RenderHdwBufferObserverPtr& observer);
+    };
 }
 
 #endif /* RenderHdwBuffer_h */
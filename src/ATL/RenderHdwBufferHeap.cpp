@@ -0,0 +1,377 @@
+//
+//  RenderHdwBufferHeap.cpp
+//  atlre
+//
+//  Created by jacques tronconi on 27/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#include "RenderHdwBufferHeap.h"
+#include "RenderHdwBufferManager.h"
+#include "MemoryPool.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Atl
+{
+    namespace
+    {
+        //! @brief Returns the index of a HardwareBufferType in RenderHdwBufferHeap::mBlocks.
+        std::size_t IndexOf(HBT type)
+        {
+            return static_cast < std::size_t >(type);
+        }
+
+        //! @brief Copies size bytes at offset in the block's buffer to ptr.
+        void Read(RenderHdwBufferBlock& block, std::size_t offset, void* ptr, std::size_t size)
+        {
+            HardwareBufferLockGuardCst l(*block.buffer);
+            const RenderHdwBuffer& buffer = *block.buffer;
+            const char* data = static_cast < const char* >(buffer.data());
+
+            if (!data)
+                throw NullError("RenderHdwSubBuffer", "Read", "Null data for the block's buffer.");
+
+            std::memcpy(ptr, data + offset, size);
+            buffer.undata();
+        }
+    }
+
+    // ------------------------------------------------------------------------------------
+    // RenderHdwBufferBlock
+
+    RenderHdwBufferBlock::RenderHdwBufferBlock(const RenderHdwBufferPtr& rhs, std::size_t size)
+    : buffer(rhs), allocator(size)
+    {
+
+    }
+
+    // ------------------------------------------------------------------------------------
+    // RenderHdwSubBuffer
+
+    RenderHdwSubBuffer::RenderHdwSubBuffer(Renderer& rhs, const RenderHdwBufferObserverPtr& observer, const HBT& type,
+                                           RenderHdwBufferHeap& heap, const RenderHdwBufferBlockPtr& block,
+                                           TlsfAllocator::Handle handle, std::size_t size)
+    : RenderHdwBuffer(rhs, observer, type), mHeap(heap), mBlock(block), mHandle(handle), mSize(size)
+    {
+        if (!block)
+            throw NullError("RenderHdwSubBuffer", "RenderHdwSubBuffer", "Null block passed.");
+
+        std::lock_guard l(block->mutex);
+        mOffset = block->allocator.offset(handle);
+        mCapacity = block->allocator.size(handle);
+    }
+
+    RenderHdwSubBuffer::~RenderHdwSubBuffer()
+    {
+        std::lock_guard l(mBlock->mutex);
+        mBlock->allocator.free(mHandle);
+    }
+
+    bool RenderHdwSubBuffer::isMemBuffer() const
+    {
+        return false;
+    }
+
+    std::size_t RenderHdwSubBuffer::size() const
+    {
+        return mSize.load();
+    }
+
+    void RenderHdwSubBuffer::allocate(const std::size_t& sz, const void* ptr)
+    {
+        if (sz > mCapacity)
+        {
+            // Moves to a larger range, keeping the content if ptr doesn't replace it.
+
+            std::vector < char > content(ptr ? 0 : mSize.load());
+
+            if (!content.empty())
+                Read(*mBlock, mOffset, content.data(), content.size());
+
+            auto range = mHeap.allocateRange(type(), sz);
+
+            {
+                std::lock_guard l(mBlock->mutex);
+                mBlock->allocator.free(mHandle);
+            }
+
+            mBlock = range.first;
+            mHandle = range.second;
+
+            {
+                std::lock_guard l(mBlock->mutex);
+                mOffset = mBlock->allocator.offset(mHandle);
+                mCapacity = mBlock->allocator.size(mHandle);
+            }
+
+            if (!content.empty())
+                Write(*mBlock, mOffset, content.data(), content.size());
+        }
+
+        mSize.store(sz);
+
+        if (ptr && sz)
+            Write(*mBlock, mOffset, ptr, sz);
+    }
+
+    void RenderHdwSubBuffer::lock() const
+    {
+        mMutex.lock();
+    }
+
+    void RenderHdwSubBuffer::unlock() const
+    {
+        mMutex.unlock();
+    }
+
+    void* RenderHdwSubBuffer::data()
+    {
+        HardwareBufferLockGuard l(*mBlock->buffer);
+        char* data = static_cast < char* >(mBlock->buffer->data());
+        return data ? data + mOffset : nullptr;
+    }
+
+    const void* RenderHdwSubBuffer::data() const
+    {
+        HardwareBufferLockGuard l(*mBlock->buffer);
+        const RenderHdwBuffer& buffer = *mBlock->buffer;
+        const char* data = static_cast < const char* >(buffer.data());
+        return data ? data + mOffset : nullptr;
+    }
+
+    void RenderHdwSubBuffer::undata() const
+    {
+        HardwareBufferLockGuard l(*mBlock->buffer);
+        mBlock->buffer->undata();
+    }
+
+    HardwareBufferPtr RenderHdwSubBuffer::copy() const
+    {
+        std::vector < char > content(mSize.load());
+
+        if (!content.empty())
+            Read(*mBlock, mOffset, content.data(), content.size());
+
+        return mHeap.allocate(type(), content.size(), content.empty() ? nullptr : content.data());
+    }
+
+    std::uint64_t RenderHdwSubBuffer::index() const
+    {
+        return 0;
+    }
+
+    RenderHdwBuffer& RenderHdwSubBuffer::backing()
+    {
+        return *mBlock->buffer;
+    }
+
+    const RenderHdwBuffer& RenderHdwSubBuffer::backing() const
+    {
+        return *mBlock->buffer;
+    }
+
+    std::size_t RenderHdwSubBuffer::backingOffset() const
+    {
+        return mOffset;
+    }
+
+    void RenderHdwSubBuffer::Write(RenderHdwBufferBlock& block, std::size_t offset, const void* ptr, std::size_t size)
+    {
+        HardwareBufferLockGuard l(*block.buffer);
+        char* data = static_cast < char* >(block.buffer->data());
+
+        if (!data)
+            throw NullError("RenderHdwSubBuffer", "Write", "Null data for the block's buffer.");
+
+        std::memcpy(data + offset, ptr, size);
+        block.buffer->undata();
+    }
+
+    // ------------------------------------------------------------------------------------
+    // RenderHdwBufferHeap
+
+    RenderHdwBufferHeap::RenderHdwBufferHeap(RenderHdwBufferManager& manager, MemoryPool& pool, const RenderHdwBufferObserverPtr& observer)
+    : mManager(manager), mPool(pool), mObserver(observer)
+    {
+        mBlocks[IndexOf(HBT::Uniform)].alignment = 256;
+    }
+
+    void RenderHdwBufferHeap::setBlockSize(HBT type, std::size_t size)
+    {
+        std::lock_guard l(mMutex);
+        mBlocks[IndexOf(type)].blockSize = size;
+    }
+
+    std::size_t RenderHdwBufferHeap::blockSize(HBT type) const
+    {
+        std::lock_guard l(mMutex);
+        return mBlocks[IndexOf(type)].blockSize;
+    }
+
+    void RenderHdwBufferHeap::setAlignment(HBT type, std::size_t alignment)
+    {
+        if (!alignment || (alignment & (alignment - 1)))
+            throw OutOfRange("RenderHdwBufferHeap", "setAlignment", "Alignment %i is not a power of two.",
+                             static_cast < int >(alignment));
+
+        std::lock_guard l(mMutex);
+        mBlocks[IndexOf(type)].alignment = std::max(alignment, TlsfAllocator::Granularity);
+    }
+
+    std::size_t RenderHdwBufferHeap::alignment(HBT type) const
+    {
+        std::lock_guard l(mMutex);
+        return mBlocks[IndexOf(type)].alignment;
+    }
+
+    bool RenderHdwBufferHeap::isSuballocated(HBT type, std::size_t size) const
+    {
+        std::lock_guard l(mMutex);
+        const std::size_t blockSize = mBlocks[IndexOf(type)].blockSize;
+        return blockSize && size <= blockSize / 2;
+    }
+
+    RenderHdwBufferPtr RenderHdwBufferHeap::allocate(HBT type, std::size_t size, const void* ptr)
+    {
+        auto range = allocateRange(type, size);
+        RenderHdwBufferPtr buffer;
+
+        try
+        {
+            buffer = std::make_shared < RenderHdwSubBuffer >(mManager.renderer(), mObserver, type, *this,
+                                                             range.first, range.second, size);
+        }
+
+        catch (...)
+        {
+            std::lock_guard l(range.first->mutex);
+            range.first->allocator.free(range.second);
+            throw;
+        }
+
+        if (ptr && size)
+            buffer->allocate(size, ptr);
+
+        return buffer;
+    }
+
+    std::pair < RenderHdwBufferBlockPtr, TlsfAllocator::Handle > RenderHdwBufferHeap::allocateRange(HBT type, std::size_t size)
+    {
+        std::size_t blockSize = 0;
+        std::size_t alignment = 0;
+
+        {
+            std::lock_guard l(mMutex);
+            Blocks& blocks = mBlocks[IndexOf(type)];
+            alignment = blocks.alignment;
+
+            for (const RenderHdwBufferBlockPtr& block : blocks.blocks)
+            {
+                std::lock_guard ll(block->mutex);
+                TlsfAllocator::Handle handle = block->allocator.allocate(size, alignment);
+
+                if (handle != TlsfAllocator::Null)
+                    return { block, handle };
+            }
+
+            // A buffer larger than a block gets a block of its own.
+
+            blockSize = std::max(blocks.blockSize, size + alignment);
+            blockSize = (blockSize + TlsfAllocator::Granularity - 1) & ~(TlsfAllocator::Granularity - 1);
+        }
+
+        // The budget is checked for the whole block. Unused buffers and empty blocks are
+        // released first if it is exceeded. The block's buffer is counted by the observer.
+
+        if (!mPool.isAvailable(0, blockSize))
+            mManager.removeUnusedBuffers();
+
+        if (!mPool.isAvailable(0, blockSize))
+            throw NotEnoughMemory("RenderHdwBufferHeap", "allocateRange", "Memory limit reached for a block of %i bytes.",
+                                  static_cast < int >(blockSize));
+
+        RenderHdwBufferPtr buffer = mManager.make(type);
+
+        if (!buffer)
+            throw NullError("RenderHdwBufferHeap", "allocateRange", "Null RenderHdwBuffer created for a block.");
+
+        buffer->allocate(blockSize);
+        RenderHdwBufferBlockPtr block = std::make_shared < RenderHdwBufferBlock >(buffer, blockSize);
+
+        TlsfAllocator::Handle handle = TlsfAllocator::Null;
+
+        {
+            std::lock_guard l(block->mutex);
+            handle = block->allocator.allocate(size, alignment);
+        }
+
+        if (handle == TlsfAllocator::Null)
+            throw NotEnoughMemory("RenderHdwBufferHeap", "allocateRange", "Cannot allocate %i bytes in a new block.",
+                                  static_cast < int >(size));
+
+        std::lock_guard l(mMutex);
+        mBlocks[IndexOf(type)].blocks.push_back(block);
+        return { block, handle };
+    }
+
+    std::size_t RenderHdwBufferHeap::trim()
+    {
+        std::vector < RenderHdwBufferBlockPtr > released;
+        std::size_t bytes = 0;
+
+        {
+            std::lock_guard l(mMutex);
+
+            for (Blocks& blocks : mBlocks)
+            {
+                auto it = std::remove_if(blocks.blocks.begin(), blocks.blocks.end(), [&](const RenderHdwBufferBlockPtr& block)
+                {
+                    // Only the heap holds the block, and no range is left in it.
+
+                    if (block.use_count() != 1)
+                        return false;
+
+                    std::lock_guard ll(block->mutex);
+
+                    if (!block->allocator.isEmpty())
+                        return false;
+
+                    bytes += block->allocator.stats().capacity;
+                    released.push_back(block);
+                    return true;
+                });
+
+                blocks.blocks.erase(it, blocks.blocks.end());
+            }
+        }
+
+        // The blocks are destroyed here, out of the lock.
+
+        released.clear();
+        return bytes;
+    }
+
+    RenderHdwBufferHeapStats RenderHdwBufferHeap::stats(HBT type) const
+    {
+        RenderHdwBufferHeapStats stats;
+        std::lock_guard l(mMutex);
+
+        for (const RenderHdwBufferBlockPtr& block : mBlocks[IndexOf(type)].blocks)
+        {
+            std::lock_guard ll(block->mutex);
+            TlsfStats blockStats = block->allocator.stats();
+
+            stats.blocks++;
+            stats.capacity += blockStats.capacity;
+            stats.used += blockStats.used;
+            stats.free += blockStats.free;
+            stats.largestFree = std::max(stats.largestFree, blockStats.largestFree);
+            stats.allocations += blockStats.allocations;
+            stats.freeRanges += blockStats.freeBlocks;
+        }
+
+        return stats;
+    }
+}
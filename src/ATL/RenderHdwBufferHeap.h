@@ -0,0 +1,245 @@
+//
+//  RenderHdwBufferHeap.h
+//  atlre
+//
+//  Created by jacques tronconi on 27/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#ifndef ATL_RENDERHDWBUFFERHEAP_H
+#define ATL_RENDERHDWBUFFERHEAP_H
+
+#include "RenderHdwBuffer.h"
+#include "TlsfAllocator.h"
+
+#include <array>
+#include <mutex>
+#include <vector>
+
+namespace Atl
+{
+    class MemoryPool;
+    class RenderHdwBufferHeap;
+    class RenderHdwBufferManager;
+
+    //! @brief A large RenderHdwBuffer of the backend, from which RenderHdwSubBuffers are
+    //! allocated. Its buffer reports its size to the manager's observer, like any buffer made
+    //! by the manager.
+    struct RenderHdwBufferBlock
+    {
+        //! @brief The buffer of the backend.
+        RenderHdwBufferPtr buffer;
+
+        //! @brief The ranges allocated in buffer.
+        TlsfAllocator allocator;
+
+        //! @brief Protects allocator.
+        std::mutex mutex;
+
+        //! @brief Constructs a block of size bytes, already allocated in buffer.
+        RenderHdwBufferBlock(const RenderHdwBufferPtr& buffer, std::size_t size);
+    };
+
+    //! @brief Pointer to a RenderHdwBufferBlock.
+    typedef std::shared_ptr < RenderHdwBufferBlock > RenderHdwBufferBlockPtr;
+
+    //! @brief A RenderHdwBuffer which is a range of a RenderHdwBufferBlock.
+    //!
+    //! \ref backing() returns the block's buffer and \ref backingOffset() the range's offset:
+    //! the backend binds them instead of this buffer. \ref allocate() reuses the range when the
+    //! new size fits in it, and moves the content to a new range otherwise. The range returns
+    //! to the block when the buffer is destroyed.
+    //!
+    //! \ref lock() only locks this buffer. The block's buffer is locked while \ref data() and
+    //! \ref undata() access it, so the backend must allow several data() on a block before
+    //! undata(), like a persistently mapped buffer.
+    class EXPORTED RenderHdwSubBuffer : public RenderHdwBuffer
+    {
+        //! @brief The heap which allocated this buffer.
+        RenderHdwBufferHeap& mHeap;
+
+        //! @brief The block where the range lies.
+        RenderHdwBufferBlockPtr mBlock;
+
+        //! @brief The range in the block.
+        TlsfAllocator::Handle mHandle;
+
+        //! @brief The offset of the range in the block.
+        std::size_t mOffset;
+
+        //! @brief The size of the range, which may be larger than mSize.
+        std::size_t mCapacity;
+
+        //! @brief The size of this buffer.
+        std::atomic < std::size_t > mSize;
+
+        //! @brief Locked by \ref lock().
+        mutable std::mutex mMutex;
+
+    public:
+
+        //! @brief Constructs a buffer from a range allocated by heap.
+        RenderHdwSubBuffer(Renderer& rhs, const RenderHdwBufferObserverPtr& observer, const HBT& type,
+                           RenderHdwBufferHeap& heap, const RenderHdwBufferBlockPtr& block,
+                           TlsfAllocator::Handle handle, std::size_t size);
+
+        //! @brief Returns the range to its block.
+        ~RenderHdwSubBuffer();
+
+        //! @brief Returns false.
+        bool isMemBuffer() const;
+
+        //! @brief Returns the size of this buffer.
+        std::size_t size() const;
+
+        //! @brief Resizes this buffer, in its range if it fits, and copies ptr if not null.
+        //! @note You should use \ref lock() before, as the range may change.
+        void allocate(const std::size_t& sz, const void* ptr = nullptr);
+
+        //! @brief Locks this buffer.
+        void lock() const;
+
+        //! @brief Unlocks this buffer.
+        void unlock() const;
+
+        //! @brief Returns the range in the block's buffer.
+        void* data();
+
+        //! @brief Returns the range in the block's buffer.
+        const void* data() const;
+
+        //! @brief Releases the block's buffer data.
+        void undata() const;
+
+        //! @brief Allocates a copy of this buffer from the heap.
+        pointer_type copy() const;
+
+        //! @brief Returns zero.
+        std::uint64_t index() const;
+
+        //! @brief Returns the block's buffer.
+        RenderHdwBuffer& backing();
+
+        //! @brief Returns the block's buffer.
+        const RenderHdwBuffer& backing() const;
+
+        //! @brief Returns the offset of the range in the block's buffer.
+        std::size_t backingOffset() const;
+
+    private:
+
+        //! @brief Copies size bytes of ptr at offset in the block's buffer.
+        static void Write(RenderHdwBufferBlock& block, std::size_t offset, const void* ptr, std::size_t size);
+    };
+
+    //! @brief The counters of the blocks of one HardwareBufferType.
+    struct RenderHdwBufferHeapStats
+    {
+        //! @brief Number of blocks.
+        std::size_t blocks = 0;
+
+        //! @brief Bytes in the blocks.
+        std::size_t capacity = 0;
+
+        //! @brief Bytes allocated in the blocks, alignment included.
+        std::size_t used = 0;
+
+        //! @brief Bytes free in the blocks.
+        std::size_t free = 0;
+
+        //! @brief The largest free range of a block.
+        std::size_t largestFree = 0;
+
+        //! @brief Number of RenderHdwSubBuffers.
+        std::size_t allocations = 0;
+
+        //! @brief Number of free ranges.
+        std::size_t freeRanges = 0;
+
+        //! @brief Returns the part of the free bytes which are not in the largest free range.
+        double fragmentation() const
+        {
+            return free ? 1.0 - static_cast < double >(largestFree) / static_cast < double >(free) : 0.0;
+        }
+    };
+
+    //! @brief Allocates RenderHdwSubBuffers from large blocks of the backend.
+    //!
+    //! Each HardwareBufferType has its own blocks, its block size and its alignment. The heap
+    //! is disabled for a type until \ref setBlockSize() is called: the backend enables it once
+    //! it binds \ref RenderHdwBuffer::backing() at \ref RenderHdwBuffer::backingOffset().
+    //! Buffers larger than half a block are not sub-allocated.
+    //!
+    //! The budget of the manager's MemoryPool is checked once per block instead of once per
+    //! buffer, and the block's buffer is counted in it through the manager's observer. The
+    //! RenderHdwSubBuffers are not counted. Empty blocks are released by \ref trim().
+    class EXPORTED RenderHdwBufferHeap
+    {
+        //! @brief The blocks of a type.
+        struct Blocks
+        {
+            //! @brief The blocks.
+            std::vector < RenderHdwBufferBlockPtr > blocks;
+
+            //! @brief The size of a block, or zero if disabled.
+            std::size_t blockSize = 0;
+
+            //! @brief The alignment of the ranges.
+            std::size_t alignment = TlsfAllocator::Granularity;
+        };
+
+        //! @brief The manager which creates the blocks.
+        RenderHdwBufferManager& mManager;
+
+        //! @brief The pool whose budget is checked before creating a block.
+        MemoryPool& mPool;
+
+        //! @brief The observer given to the RenderHdwSubBuffers.
+        RenderHdwBufferObserverPtr mObserver;
+
+        //! @brief The blocks, by HardwareBufferType.
+        std::array < Blocks, 4 > mBlocks;
+
+        //! @brief Protects mBlocks.
+        mutable std::mutex mMutex;
+
+    public:
+
+        //! @brief Constructs a disabled heap.
+        RenderHdwBufferHeap(RenderHdwBufferManager& manager, MemoryPool& pool, const RenderHdwBufferObserverPtr& observer);
+
+        //! @brief Sets the size of the blocks of a type, or zero to disable the heap for this type.
+        //! The blocks already created keep their size.
+        void setBlockSize(HBT type, std::size_t size);
+
+        //! @brief Returns the size of the blocks of a type, zero if disabled.
+        std::size_t blockSize(HBT type) const;
+
+        //! @brief Sets the alignment of the ranges of a type, a power of two. The defaults are 16
+        //! bytes, and 256 for HBT::Uniform which is the usual alignment of a uniform block.
+        void setAlignment(HBT type, std::size_t alignment);
+
+        //! @brief Returns the alignment of the ranges of a type.
+        std::size_t alignment(HBT type) const;
+
+        //! @brief Returns true if a buffer of size bytes and of type is sub-allocated.
+        bool isSuballocated(HBT type, std::size_t size) const;
+
+        //! @brief Allocates a buffer of size bytes, and copies ptr in it if not null. A block
+        //! large enough is created if \ref isSuballocated() is false.
+        //! @throw NotEnoughMemory if a new block exceeds the budget.
+        RenderHdwBufferPtr allocate(HBT type, std::size_t size, const void* ptr = nullptr);
+
+        //! @brief Allocates a range of size bytes for a buffer of type.
+        //! @throw NotEnoughMemory if a new block exceeds the budget.
+        std::pair < RenderHdwBufferBlockPtr, TlsfAllocator::Handle > allocateRange(HBT type, std::size_t size);
+
+        //! @brief Releases the empty blocks. Returns the number of bytes released.
+        std::size_t trim();
+
+        //! @brief Returns the counters of the blocks of a type.
+        RenderHdwBufferHeapStats stats(HBT type) const;
+    };
+}
+
+#endif // ATL_RENDERHDWBUFFERHEAP_H
@@ -7,6 +7,9 @@
 
 #include "RenderHdwBufferManager.h"
 
+#include <map>
+#include <optional>
+
 namespace Atl
 {
     namespace details
@@ -20,6 +23,7 @@ namespace Atl
         {
             { HBT::Vertex,  typeid(RenderHdwVertexBuffer) },
             { HBT::Index,   typeid(RenderHdwIndexBuffer) },
+            { HBT::Uniform, typeid(RenderHdwUniformBuffer) },
             { HBT::Misc,    typeid(RenderHdwBuffer) }
         };
     }
@@ -43,6 +47,7 @@ namespace Atl
     RenderHdwBufferManager::RenderHdwBufferManager(Renderer& rhs, std::size_t maxSize)
     : RenderObjectManager(rhs), mPool(maxSize)
     , mObserver(std::make_shared < ThisRenderHdwBufferObserver >(*this))
+    , mHeap(*this, mPool, mObserver), mTriesFreeOnLow(true)
     {
         
     }
@@ -52,8 +57,42 @@ namespace Atl
         return mFactory.construct(type, renderer(), mObserver);
     }
     
+    RenderHdwBufferPtr RenderHdwBufferManager::make(HBT type)
+    {
+        auto it = details::HBTToTIdx.find(type);
+
+        if (it == details::HBTToTIdx.end() || !it->second.has_value())
+            throw RenderHdwBufferTypeNotSupported("RenderHdwBufferManager", "make", "HardwareBuffer type %i is not supported.", static_cast < int >(type));
+
+        return make(it->second.value());
+    }
+
+    RenderHdwBufferPtr RenderHdwBufferManager::allocate(HBT type, std::size_t size, const void* data)
+    {
+        if (mHeap.isSuballocated(type, size))
+            return mHeap.allocate(type, size, data);
+
+        if (!isSizeAvailable(size) && mTriesFreeOnLow)
+            removeUnusedBuffers();
+
+        if (!isSizeAvailable(size))
+            throw NotEnoughMemory("RenderHdwBufferManager", "allocate", "Memory limit reached for %i bytes.",
+                                  static_cast < int >(size));
+
+        RenderHdwBufferPtr hdwBuffer = make(type);
+
+        if (!hdwBuffer)
+            throw NullError("RenderHdwBufferManager", "allocate", "Null RenderHdwBuffer created.");
+
+        hdwBuffer->allocate(size, data);
+        return hdwBuffer;
+    }
+    
     void RenderHdwBufferManager::add(const RenderHdwBufferPtr& buffer)
     {
+        if (!buffer)
+            throw NullError("RenderHdwBufferManager", "add", "Null RenderHdwBuffer passed.");
+
         RenderObjectManager::add(buffer);
     }
     
@@ -64,6 +103,14 @@ namespace Atl
 
     RenderHdwBufferPtr RenderHdwBufferManager::findRelated(const MemBuffer::Index& index) const
     {
+        {
+            std::lock_guard l(mRelatedMutex);
+            auto it = mRelated.find(index);
+
+            if (it != mRelated.end())
+                return it->second.buffer;
+        }
+
         std::lock_guard l(mMutex);
 
         for (const RenderHdwBufferPtr& buffer : mObjects)
@@ -87,24 +134,79 @@ namespace Atl
 
         if (!hdwBuffer)
         {
-            const std::size_t sizeNeeded = buffer->size();
-
-            if (!isSizeAvailable(sizeNeeded))
-                throw NotEnoughMemory("RenderHdwBufferManager", "findOrCreateRelated", "Memory limit reached for %i bytes.", sizeNeeded);
+            // The source is read as const, so a MappedMemBuffer is uploaded from its mapping.
 
+            const std::size_t sizeNeeded = buffer->size();
+            const MemBuffer& source = *buffer;
             HardwareBufferLockGuard l(*buffer);
-            
-            std::optional < std::type_index > buffType = details::HBTToTIdx[buffer->type()];
-            if (!buffType.has_value())
-                throw RenderHdwBufferTypeNotSupported("RenderHdwBufferManager", "findOrCreateRelated", "HardwareBuffer type %i is not supported.", static_cast < int >(buffer->type()));
-            
-            hdwBuffer = make(buffType.value());
-            hdwBuffer->allocate(sizeNeeded, buffer->data());
+            hdwBuffer = allocate(buffer->type(), sizeNeeded, source.data());
+            hdwBuffer->setRelatedIndex(buffer->index());
+            hdwBuffer->setSourceGeneration(buffer->generation());
             buffer->undata();
 
             add(hdwBuffer);
+
+            std::lock_guard lr(mRelatedMutex);
+            mRelated[buffer->index()] = Related { hdwBuffer, hdwBuffer->sourceGeneration(), UploadToken() };
+        }
+
+        return hdwBuffer;
+    }
+
+    RenderHdwBufferPtr RenderHdwBufferManager::findOrQueueRelated(const MemBufferPtr& buffer, UploadQueue& queue, UploadToken& token)
+    {
+        if (!buffer)
+            throw NullError("RenderHdwBufferManager", "findOrQueueRelated", "Null MemBuffer.");
+
+        token = UploadToken();
+
+        // MemBuffer::size() takes the buffer's mutex, so it is read before locking.
+
+        const MemBuffer::Index index = buffer->index();
+        const std::uint64_t generation = buffer->generation();
+        const std::size_t size = buffer->size();
+
+        std::lock_guard l(mRelatedMutex);
+        auto it = mRelated.find(index);
+
+        if (it != mRelated.end() && it->second.generation == generation && it->second.buffer->size() == size)
+        {
+            token = it->second.token;
+            return it->second.buffer;
+        }
+
+        // The latest buffer may be drawn by a frame in flight, so it is not written. A related
+        // buffer only held by this manager is not: it is reused, and receives the dirty ranges
+        // if it has the same size.
+
+        const RenderHdwBuffer* latest = it != mRelated.end() ? it->second.buffer.get() : nullptr;
+        RenderHdwBufferPtr hdwBuffer;
+
+        {
+            std::lock_guard ll(mMutex);
+
+            for (const RenderHdwBufferPtr& candidate : mObjects)
+            {
+                if (candidate && candidate.get() != latest && candidate->relatedIndex() == index &&
+                    candidate.use_count() == 1)
+                {
+                    hdwBuffer = candidate;
+
+                    if (candidate->size() == size)
+                        break;
+                }
+            }
+        }
+
+        if (!hdwBuffer)
+        {
+            hdwBuffer = allocate(buffer->type(), size);
+            hdwBuffer->setRelatedIndex(index);
+            add(hdwBuffer);
         }
 
+        token = queue.enqueue(buffer, hdwBuffer);
+        mRelated[index] = Related { hdwBuffer, generation, token };
         return hdwBuffer;
     }
 
@@ -113,19 +215,8 @@ namespace Atl
         if (!buffer)
             throw NullError("RenderHdwBufferManager", "copy", "Null RenderHdwBuffer.");
 
-        const std::size_t sizeNeeded = buffer->size();
-
-        if (!isSizeAvailable(sizeNeeded))
-                throw NotEnoughMemory("RenderHdwBufferManager", "copy", "Memory limit reached for %i bytes.", sizeNeeded);
-        
         HardwareBufferLockGuard l(*buffer);
-        
-        std::optional < std::type_index > buffType = details::HBTToTIdx[buffer->type()];
-        if (!buffType.has_value())
-            throw RenderHdwBufferTypeNotSupported("RenderHdwBufferManager", "copy", "HardwareBuffer type %i is not supported.", static_cast < int >(buffer->type()));
-        
-        RenderHdwBufferPtr hdwBuffer = make(buffType.value());
-        hdwBuffer->allocate(sizeNeeded, buffer->data());
+        RenderHdwBufferPtr hdwBuffer = allocate(buffer->type(), buffer->size(), buffer->data());
         buffer->undata();
 
         add(hdwBuffer);
@@ -134,6 +225,20 @@ namespace Atl
 
     void RenderHdwBufferManager::removeUnusedBuffers()
     {
+        // The latest buffer of a MemBuffer no cache draws is only held here and by mObjects.
+
+        {
+            std::lock_guard l(mRelatedMutex);
+
+            for (auto it = mRelated.begin(); it != mRelated.end();)
+            {
+                if (it->second.buffer.use_count() == 2)
+                    it = mRelated.erase(it);
+                else
+                    ++it;
+            }
+        }
+
         RenderHdwBufferList buffers;
         { 
             std::lock_guard l(mMutex);
@@ -145,6 +250,28 @@ namespace Atl
             if (buffer.use_count() == 2) // This one plus the object stored.
                 remove(buffer);
         }
+
+        mHeap.trim();
+    }
+
+    RenderHdwBufferHeap& RenderHdwBufferManager::heap()
+    {
+        return mHeap;
+    }
+
+    const RenderHdwBufferHeap& RenderHdwBufferManager::heap() const
+    {
+        return mHeap;
+    }
+
+    MemoryPool& RenderHdwBufferManager::pool()
+    {
+        return mPool;
+    }
+
+    const MemoryPool& RenderHdwBufferManager::pool() const
+    {
+        return mPool;
     }
 
     void RenderHdwBufferManager::onMemoryLow(MemoryPool&)
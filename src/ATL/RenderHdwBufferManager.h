@@ -11,6 +11,8 @@
 #include "RenderHdwBuffer.h"
 #include "RenderObjectManager.h"
 #include "MemoryPool.h"
+#include "RenderHdwBufferHeap.h"
+#include "UploadQueue.h"
 
 namespace Atl
 {
@@ -19,6 +21,18 @@ namespace Atl
     { using Error::Error; };
     
     //! @brief A Manager for all RenderHdwBuffer.
+    //!
+    //! Buffers are created with \ref allocate(), which sub-allocates small buffers from the
+    //! \ref RenderHdwBufferHeap when the backend enabled it for their type, and creates a
+    //! dedicated buffer otherwise. The MemoryPool counts every buffer created with \ref make(),
+    //! dedicated buffers and heap blocks alike, through the observer the manager gives them:
+    //! the buffers report their size changes, including the reallocations of an upload, and
+    //! their release.
+    //!
+    //! \ref findOrQueueRelated() never queues an update into a buffer which a frame may be
+    //! drawing: a MemBuffer may have several related buffers, one per version still in use,
+    //! and each new generation is copied into a related buffer used nowhere else, or into a
+    //! new one. \ref removeUnusedBuffers() releases the spare ones.
     class RenderHdwBufferManager :
     public RenderObjectManager <
     RenderHdwBuffer,
@@ -50,9 +64,32 @@ namespace Atl
         //! @brief The observer we allocate for this manager.
         RenderHdwBufferObserverPtr mObserver;
 
+        //! @brief The heap for small buffers.
+        RenderHdwBufferHeap mHeap;
+
         //! @brief Boolean true if low memory means we tries to auto free unused buffers. Default
         //! value is true.
         std::atomic < bool > mTriesFreeOnLow;
+
+        //! @brief The buffer receiving the latest generation of a MemBuffer.
+        struct Related
+        {
+            //! @brief The buffer.
+            RenderHdwBufferPtr buffer;
+
+            //! @brief The generation copied, or being copied, in buffer.
+            std::uint64_t generation;
+
+            //! @brief The token of the copy, or an invalid token.
+            UploadToken token;
+        };
+
+        //! @brief The latest related buffer of each MemBuffer, by index.
+        std::unordered_map < MemBuffer::Index, Related > mRelated;
+
+        //! @brief Protects mRelated, and serializes \ref findOrQueueRelated(). Recursive, as
+        //! an allocation low on memory calls \ref removeUnusedBuffers().
+        mutable std::recursive_mutex mRelatedMutex;
         
     public:
         
@@ -63,30 +100,61 @@ namespace Atl
         
         //! @brief Constructs a RenderHdwBuffer from its type.
         RenderHdwBufferPtr make(const std::type_index& type);
+
+        //! @brief Constructs an empty RenderHdwBuffer for a HardwareBufferType.
+        //! @throw RenderHdwBufferTypeNotSupported if no class is registered for this type.
+        RenderHdwBufferPtr make(HBT type);
+
+        //! @brief Constructs a RenderHdwBuffer of size bytes and copies data in it if not
+        //! null. The buffer is sub-allocated from \ref heap() if it is enabled for this type
+        //! and size, otherwise a dedicated buffer is created.
+        //! @note The buffer is not added to this manager.
+        //! @throw NotEnoughMemory if the budget is exceeded, after removing the unused buffers
+        //! if \ref mTriesFreeOnLow is true.
+        RenderHdwBufferPtr allocate(HBT type, std::size_t size, const void* data = nullptr);
         
         //! @brief Adds a RenderHdwBuffer to this manager.
-        //! No assertion is done on the RenderHdwBuffer size. The only check for size
-        //! is done from the Observer registered in \ref make(). A buffer that doesn't hold
-        //! this manager observer will not have its memory managed by this manager's pool.
         void add(const RenderHdwBufferPtr& buffer);
         
         //! @brief Returns true if given size is available in this pool.
         bool isSizeAvailable(std::size_t sz) const;
 
-        //! @brief Finds a \ref RenderHdwBuffer related to a \ref MemBuffer index. If none
-        //! were found, returns nullptr.
+        //! @brief Finds the latest \ref RenderHdwBuffer related to a \ref MemBuffer index. If
+        //! none were found, returns nullptr.
         RenderHdwBufferPtr findRelated(const MemBuffer::Index& index) const;
 
         //! @brief Tries to find a \ref RenderHdwBuffer related to a \ref MemBuffer
         //! index. If not found, tries to create it from the \ref MemBuffer given.
         RenderHdwBufferPtr findOrCreateRelated(const MemBufferPtr& buffer);
 
+        //! @brief Tries to find a \ref RenderHdwBuffer related to a \ref MemBuffer index. If
+        //! not found, allocates it without copying the MemBuffer, and queues the copy in queue.
+        //! A buffer found is updated the same way if it doesn't hold the MemBuffer's
+        //! generation: only the dirty ranges are then copied.
+        //! @param token Set to the token of the copy, or to an invalid token if the buffer is
+        //! up to date.
+        RenderHdwBufferPtr findOrQueueRelated(const MemBufferPtr& buffer, UploadQueue& queue, UploadToken& token);
+
         //! @brief Creates the copy of a \ref RenderHdwBuffer.
         RenderHdwBufferPtr copy(const RenderHdwBufferPtr& buffer);
 
-        //! @brief Removes all RenderHdwBuffers that aren't used anywhere.
+        //! @brief Removes all RenderHdwBuffers that aren't used anywhere, including the latest
+        //! related buffers of the MemBuffers no cache draws, then releases the heap's empty
+        //! blocks.
         void removeUnusedBuffers();
 
+        //! @brief Returns the heap for small buffers.
+        RenderHdwBufferHeap& heap();
+
+        //! @brief Returns the heap for small buffers.
+        const RenderHdwBufferHeap& heap() const;
+
+        //! @brief Returns the MemoryPool of this manager.
+        MemoryPool& pool();
+
+        //! @brief Returns the MemoryPool of this manager.
+        const MemoryPool& pool() const;
+
         //! @brief Launched when MemoryPool is low on memory.
         //! If called, and \ref mTriesFreeOnLow(), this manager tries to remove unused buffers
         //! with \ref removeUnusedBuffers().
@@ -17,7 +17,8 @@ namespace Atl
     //! This interface is merely used by RenderHdwBufferManager to follow the size changes
     //! of its buffers. A buffer can use this observer to know if a new size is available,
     //! for example when allocating more size. The RenderHdwBuffer must also notifiate
-    //! its size changes with \ref change() function.
+    //! its size changes with \ref change() function, and change(size, 0) when it is
+    //! released.
     class RenderHdwBufferObserver
     {
     public:
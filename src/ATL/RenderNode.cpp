@@ -8,73 +8,63 @@
 #include "RenderNode.h"
 #include "RenderCommand.h"
 #include "Renderer.h"
+#include "JobSystem.h"
+#include "Transformation.h"
+#include "Material.h"
+#include "Camera.h"
 
 namespace Atl
 {
     RenderNode::RenderNode(const Node::Shared& parent, 
         const std::size_t& maxChildren,
         const std::size_t& maxRenderables)
-    : Node(parent, maxChildren), mMaxRenderables(maxRenderables), mRenderRenderablesFirst(false)
+    : Node(parent, maxChildren), mMaxRenderables(maxRenderables), mRenderRenderablesFirst(false), mIsStatic(false),
+    mHasAABB(false), mHasSubtreeAABB(false), mIsSubtreeBounded(true), mSubtreeDirty(true), mAABBVersion(0), mStructureVersion(0),
+    mIsBundled(false)
     {
         mTasks = std::make_shared < RenderTaskContainer >();
         if (!mTasks) 
             throw NullError("RenderNode", "RenderNode", "Cannot allocate RenderTaskContainer.");
     }
 
-    std::future < void > RenderNode::build(Renderer& renderer)
+    void RenderNode::buildSync(Renderer& renderer)
     {
-        return std::async(std::launch::async, [this, &renderer]()
-        {
-            // Sends our WillBuild event right now, and wait for completion.
+        // Sends our WillBuild event right now, and wait for completion.
 
-            send(&Listener::onRenderNodeWillBuild, *this, renderer);
+        notify(&Listener::onRenderNodeWillBuild, *this, renderer);
 
+        {
+            std::lock_guard l(mMutex);
+            mTasks->clear();
+
+            for (const RenderablePtr& renderable : mRenderables)
             {
-                std::lock_guard l(mMutex);
-                mTasks->clear();
+                addRenderTask(renderable);
+            }
 
-                for (const RenderablePtr& renderable : mRenderables)
-                {
-                    mTasks->add(renderable);
-                }
+            // Finally, clean our node.
+
+            Node::clean();
+        }
 
-                // Finally, clean our node.
+        // The tasks changed, so every Bundle must be recorded again.
 
-                Node::clean();
-            }
+        invalidateBundles();
 
-            // Sends our DidBuild event here.
+        // Sends our DidBuild event here.
 
-            send(&Listener::onRenderNodeDidBuild, *this, renderer);
-        });
+        notify(&Listener::onRenderNodeDidBuild, *this, renderer);
     }
 
-    std::future < void > RenderNode::render(RenderCommand& cmd) const
+    void RenderNode::renderSync(RenderCommand& cmd) const
     {
-        return std::async(std::launch::async, [this, &cmd]()
-        {
-            // If mOwnRenderCommand is true, we have to render everything into our own sub command
-            // for the RenderCommand not to be impacted. This is the case by default, and derived
-            // classes (like MaterialRenderNode) renders directly in the passed command (but are
-            // ordered nodes).
-
-            if (mOwnRenderCommand && (!mOwnCommand || &(mOwnCommand->renderer()) != &(cmd.renderer())))
-            {
-                const_cast < RenderNode& >(*this).mOwnCommand = 
-                    cmd.renderer().newCommand < RenderCommand >();
+        RenderCommand& target = prepareRenderSync(cmd);
+        std::uint64_t variant = 0;
 
-                if (!mOwnCommand)
-                    throw NullError("RenderNode", "render", "Null RenderCommand created.");
-            }
-
-            if (Node::isTouched())
-                const_cast < RenderNode& >(*this).build(cmd.renderer()).get();
-
-            if (!mOwnRenderCommand)
-                mTasks->render(cmd).get();
-            else
-                mTasks->render(*mOwnCommand).get();
-        });
+        if (mIsBundled && bundleVariant(variant))
+            renderBundle(target, variant);
+        else
+            recordSync(target, variant);
     }
     
     std::size_t RenderNode::size(Renderer& rhs) const
@@ -114,6 +104,8 @@ namespace Atl
             TimeTouchable::touch();
         }
 
+        updateAABB();
+
         send(&Listener::onRenderNodeDidAddRenderable, *this, (const Renderable&)*rhs);
     }
 
@@ -139,6 +131,8 @@ namespace Atl
                 TimeTouchable::touch();
             }
 
+            updateAABB();
+
             // Now send our events. NOTES: We cannot have any null Renderable 
             // in the list because if we had one, and exception would have been
             // thrown so just send the events.
@@ -170,6 +164,8 @@ namespace Atl
             TimeTouchable::touch();
         }
 
+        updateAABB();
+
         send(&Listener::onRenderNodeDidAddRenderable, *this, (const Renderable&)*rhs);
     }
 
@@ -195,6 +191,8 @@ namespace Atl
             TimeTouchable::touch();
         }
 
+        updateAABB();
+
         for (const RenderablePtr& renderable : rhs)
             send(&Listener::onRenderNodeDidAddRenderable, *this, (const Renderable&)*renderable);
     }
@@ -218,6 +216,8 @@ namespace Atl
             TimeTouchable::touch();
         }
 
+        updateAABB();
+
         send(&Listener::onRenderNodeDidRemoveRenderable, *this, (const Renderable&)*removed);
     }
 
@@ -243,6 +243,8 @@ namespace Atl
             TimeTouchable::touch();
         }
 
+        updateAABB();
+
         if (removed)
             send(&Listener::onRenderNodeDidRemoveRenderable, *this, (const Renderable&)*rhs);
     }
@@ -263,6 +265,8 @@ namespace Atl
             TimeTouchable::touch();
         }
 
+        updateAABB();
+
         for (const RenderablePtr& rhs : renderables)
             events.push_back(send(&Listener::onRenderNodeDidRemoveRenderable, *this, (const Renderable&)*rhs));
     }
@@ -316,7 +320,7 @@ namespace Atl
 
     bool RenderNode::hasAABB() const
     {
-        return false;
+        return mHasAABB;
     }
 
     AABB RenderNode::aabb() const
@@ -325,90 +329,511 @@ namespace Atl
         return mAABB;
     }
 
-    bool RenderNode::isVisible() const
+    void RenderNode::setAABB(const AABB& rhs)
     {
-        return mIsVisible;
+        {
+            std::lock_guard l(mMutex);
+            mAABB = rhs;
+            mHasAABB = true;
+        }
+
+        mAABBVersion++;
+        invalidateSubtreeAABB();
     }
 
-    void RenderNode::setVisible(bool rhs)
+    void RenderNode::resetAABB()
     {
-        mIsVisible = rhs;
+        if (!mHasAABB.exchange(false))
+            return;
+
+        mAABBVersion++;
+        invalidateSubtreeAABB();
     }
 
-    std::future < void > RenderNode::render(RenderCommand& command, const Frustum& frustum) const
+    bool RenderNode::localAABB(AABB&) const
+    {
+        return false;
+    }
+
+    rmat4x4 RenderNode::worldMatrix() const
     {
-        return std::async(std::launch::async, [this, &command, &frustum]()
         {
-            // We render this node only if visible.
+            std::lock_guard l(mMutex);
 
-            if (!isVisible())
-                return;
+            for (const RenderablePtr& renderable : mRenderables)
+            {
+                const Transformation* transformation = dynamic_cast < const Transformation* >(renderable.get());
+
+                if (transformation)
+                    return transformation->matrix();
+            }
+        }
+
+        Shared parent = std::dynamic_pointer_cast < RenderNode >(Node::parent());
+
+        if (parent)
+            return parent->worldMatrix();
+
+        return glm::identity < rmat4x4 >();
+    }
+
+    void RenderNode::updateAABB()
+    {
+        // The renderables may have changed, and whether we are bounded with them.
+
+        invalidateSubtreeAABB();
+
+        AABB local;
+
+        if (localAABB(local))
+            setAABB(local.transformed(worldMatrix()));
+        else
+            resetAABB();
+
+        Node::ChildList children;
+
+        {
+            std::lock_guard l(Node::mMutex);
+            children = Node::mChildren;
+        }
+
+        for (const Node::Shared& node : children)
+        {
+            Shared renderNode = std::dynamic_pointer_cast < RenderNode >(node);
+
+            if (renderNode)
+                renderNode->updateAABB();
+        }
+    }
+
+    bool RenderNode::hasSubtreeAABB() const
+    {
+        updateSubtreeAABB();
+
+        std::lock_guard l(mMutex);
+        return mHasSubtreeAABB;
+    }
 
-            // If mOwnRenderCommand is true, we have to render everything into our own sub command
-            // for the RenderCommand not to be impacted. This is the case by default, and derived
-            // classes (like MaterialRenderNode) renders directly in the passed command (but are
-            // ordered nodes).
+    AABB RenderNode::subtreeAABB() const
+    {
+        updateSubtreeAABB();
+
+        std::lock_guard l(mMutex);
+        return mSubtreeAABB;
+    }
+
+    bool RenderNode::isSubtreeBounded() const
+    {
+        updateSubtreeAABB();
+
+        std::lock_guard l(mMutex);
+        return mIsSubtreeBounded;
+    }
+
+    bool RenderNode::isBounded() const
+    {
+        if (hasAABB())
+            return true;
+
+        std::lock_guard l(mMutex);
+
+        for (const RenderablePtr& renderable : mRenderables)
+        {
+            const Renderable* ptr = renderable.get();
+
+            if (!dynamic_cast < const Transformation* >(ptr) &&
+                !dynamic_cast < const Material* >(ptr) &&
+                !dynamic_cast < const Camera* >(ptr))
+                return false;
+        }
+
+        return true;
+    }
+
+    std::uint32_t RenderNode::aabbVersion() const
+    {
+        return mAABBVersion;
+    }
+
+    std::uint32_t RenderNode::structureVersion() const
+    {
+        return mStructureVersion;
+    }
+
+    void RenderNode::touchStructure()
+    {
+        mStructureVersion++;
+
+        Shared parent = std::dynamic_pointer_cast < RenderNode >(Node::parent());
+
+        if (parent)
+            parent->touchStructure();
+    }
+
+    void RenderNode::invalidateSubtreeAABB()
+    {
+        // If we already are dirty, our parents are dirty too.
+
+        if (mSubtreeDirty.exchange(true))
+            return;
 
-            if (mOwnRenderCommand && (!mOwnCommand || &(mOwnCommand->renderer()) != &(command.renderer())))
+        Shared parent = std::dynamic_pointer_cast < RenderNode >(Node::parent());
+
+        if (parent)
+            parent->invalidateSubtreeAABB();
+    }
+
+    void RenderNode::updateSubtreeAABB() const
+    {
+        // The flag is cleared before computing, so an invalidation happening meanwhile is 
+        // not lost. No lock is held while computing the children, as invalidation goes from
+        // the children to the parents.
+
+        if (!mSubtreeDirty.exchange(false))
+            return;
+
+        AABB bounds;
+        bool hasBounds = hasAABB();
+        bool bounded = isBounded();
+
+        if (hasBounds)
+            bounds = aabb();
+
+        Node::ChildList children;
+
+        {
+            std::lock_guard l(Node::mMutex);
+            children = Node::mChildren;
+        }
+
+        for (const Node::Shared& node : children)
+        {
+            if (!bounded)
+                break;
+
+            const RenderNode* child = dynamic_cast < const RenderNode* >(node.get());
+
+            if (!child)
+                continue;
+
+            // A child drawing outside of any AABB may be visible wherever our AABB is, so we
+            // can't be culled either.
+
+            if (!child->isSubtreeBounded())
             {
-                const_cast < RenderNode& >(*this).mOwnCommand = 
-                    command.renderer().newCommand < RenderCommand >();
+                bounded = false;
+                break;
+            }
 
-                if (!mOwnCommand)
-                    throw NullError("RenderNode", "render", "Null RenderCommand created.");
+            if (!child->hasSubtreeAABB())
+                continue;
+
+            if (!hasBounds)
+            {
+                bounds = child->subtreeAABB();
+                hasBounds = true;
             }
 
-            if (mCullOnFrustum)
+            else
             {
-                // Now we have to check if this node is visible for the Frustum. If we have no AABB, then
-                // we consider this node as always visible for the Frustrum.
+                bounds.merge(child->subtreeAABB());
+            }
+        }
 
-                bool isFrustumVisible = hasAABB();
+        std::lock_guard l(mMutex);
+        mSubtreeAABB = bounds;
+        mHasSubtreeAABB = hasBounds && bounded;
+        mIsSubtreeBounded = bounded;
+    }
+
+    void RenderNode::addChild(const Node::Shared& child)
+    {
+        Node::addChild(child);
 
-                if (isFrustumVisible)
-                    isFrustumVisible = frustum.isBoxVisible(mAABB.min, mAABB.max);
+        // The child may inherit our matrix, so its AABB is computed again.
 
-                if (!isFrustumVisible)
-                    return;
-            }
+        Shared renderNode = std::dynamic_pointer_cast < RenderNode >(child);
+
+        if (renderNode)
+            renderNode->updateAABB();
+
+        invalidateSubtreeAABB();
+        touchStructure();
+    }
+
+    void RenderNode::removeChild(const Node::Shared& child)
+    {
+        Node::removeChild(child);
+        invalidateSubtreeAABB();
+        touchStructure();
+    }
+
+    void RenderNode::removeChildAt(unsigned int idx)
+    {
+        Node::removeChildAt(idx);
+        invalidateSubtreeAABB();
+        touchStructure();
+    }
+
+    void RenderNode::removeAllChildren()
+    {
+        Node::removeAllChildren();
+        invalidateSubtreeAABB();
+        touchStructure();
+    }
+
+    std::size_t RenderNode::selectLOD(const Camera&, Real, Real) const
+    {
+        return 0;
+    }
+
+    void RenderNode::renderLODSync(RenderCommand& command, std::size_t) const
+    {
+        renderSync(command);
+    }
+
+    void RenderNode::renderPartsSync(RenderCommand& command, const Frustum&, std::size_t lod) const
+    {
+        renderLODSync(command, lod);
+    }
+
+    RenderCommand& RenderNode::prepareRenderSync(RenderCommand& cmd) const
+    {
+        // If mOwnRenderCommand is true, we have to render everything into our own sub command
+        // for the RenderCommand not to be impacted. This is the case by default, and derived
+        // classes (like MaterialRenderNode) renders directly in the passed command (but are
+        // ordered nodes).
+
+        if (mOwnRenderCommand && (!mOwnCommand || &(mOwnCommand->renderer()) != &(cmd.renderer())))
+        {
+            const_cast < RenderNode& >(*this).mOwnCommand = 
+                cmd.renderer().newCommand < RenderCommand >();
+
+            if (!mOwnCommand)
+                throw NullError("RenderNode", "render", "Null RenderCommand created.");
+        }
+
+        if (Node::isTouched())
+            const_cast < RenderNode& >(*this).buildSync(cmd.renderer());
+
+        return !mOwnRenderCommand ? cmd : *mOwnCommand;
+    }
+
+    bool RenderNode::isVisible() const
+    {
+        return mIsVisible;
+    }
 
-            // Now we know that we are visible. We have to render our renderables and our children, 
-            // first depending on mRenderRenderablesFirst. 
+    void RenderNode::setVisible(bool rhs)
+    {
+        mIsVisible = rhs;
+    }
 
-            if (mRenderRenderablesFirst)
+    bool RenderNode::isStatic() const
+    {
+        return mIsStatic;
+    }
+
+    void RenderNode::setStatic(bool rhs)
+    {
+        mIsStatic = rhs;
+    }
+
+    bool RenderNode::isBundled() const
+    {
+        return mIsBundled;
+    }
+
+    void RenderNode::setBundled(bool rhs)
+    {
+        mIsBundled = rhs;
+
+        if (!rhs)
+            invalidateBundles();
+    }
+
+    void RenderNode::invalidateBundles() const
+    {
+        std::lock_guard l(mBundlesMutex);
+        mBundles.clear();
+    }
+
+    std::size_t RenderNode::bundlesCount() const
+    {
+        std::lock_guard l(mBundlesMutex);
+        return mBundles.size();
+    }
+
+    bool RenderNode::bundleVariant(std::uint64_t& variant) const
+    {
+        variant = 0;
+        return true;
+    }
+
+    void RenderNode::recordSync(RenderCommand& command, std::uint64_t) const
+    {
+        mTasks->renderSync(command);
+    }
+
+    void RenderNode::renderBundle(RenderCommand& command, std::uint64_t variant) const
+    {
+        Renderer& renderer = command.renderer();
+        const auto key = std::make_pair(static_cast < const Renderer* >(&renderer), variant);
+
+        // Touch counts are read before recording, so a renderable touched while we record is
+        // recorded again at the next render.
+
+        std::vector < std::uint64_t > touchCounts;
+
+        {
+            std::lock_guard l(mMutex);
+            touchCounts.reserve(mRenderables.size());
+
+            for (const RenderablePtr& renderable : mRenderables)
             {
-                if (!mOwnRenderCommand)
-                    render(command);
-                else
-                    render(*mOwnCommand);
+                const Touchable* touchable = dynamic_cast < const Touchable* >(renderable.get());
+                touchCounts.push_back(touchable ? touchable->touchCount() : 0);
             }
+        }
 
-            if (mRenderChildren)
+        // A Bundle recorded while some uploads were pending is recorded again once one of them
+        // is done, as the caches waiting for it may draw now. The count is read before isIdle(),
+        // so an upload done in between is seen by the next render.
+
+        const UploadQueue& uploadQueue = renderer.uploadQueue();
+        const std::uint64_t completedCount = uploadQueue.completedCount();
+        const std::uint64_t uploads = uploadQueue.isIdle() ? NoUploads : completedCount;
+
+        RenderCommandPtr bundle;
+
+        {
+            std::lock_guard l(mBundlesMutex);
+            auto it = mBundles.find(key);
+
+            if (it != mBundles.end() && it->second.touchCounts == touchCounts &&
+                (it->second.uploads == NoUploads || it->second.uploads == completedCount))
+                bundle = it->second.command;
+        }
+
+        if (!bundle)
+        {
+            // A new command is recorded rather than the previous one reset, as the previous one
+            // may still be held by a command waiting to be rendered.
+
+            bundle = renderer.newCommand < RenderCommand >();
+
+            if (!bundle)
+                throw NullError("RenderNode", "renderBundle", "Null RenderCommand created.");
+
+            recordSync(*bundle, variant);
+
+            std::lock_guard l(mBundlesMutex);
+            mBundles[key] = Bundle { bundle, std::move(touchCounts), uploads };
+        }
+
+        command.addSubCommand(bundle);
+    }
+
+    void RenderNode::renderSync(RenderCommand& command, const Frustum& frustum) const
+    {
+        renderCulledSync(command, frustum, Frustum::AllPlanes);
+    }
+
+    void RenderNode::addRenderTask(const RenderablePtr& renderable)
+    {
+        mTasks->add(renderable);
+    }
+
+    void RenderNode::renderCulledSync(RenderCommand& command, const Frustum& frustum, Frustum::PlaneMask mask) const
+    {
+        // We render this node only if visible.
+
+        if (!isVisible())
+            return;
+
+        // If mOwnRenderCommand is true, we have to render everything into our own sub command
+        // for the RenderCommand not to be impacted. This is the case by default, and derived
+        // classes (like MaterialRenderNode) renders directly in the passed command (but are
+        // ordered nodes).
+
+        if (mOwnRenderCommand && (!mOwnCommand || &(mOwnCommand->renderer()) != &(command.renderer())))
+        {
+            const_cast < RenderNode& >(*this).mOwnCommand = 
+                command.renderer().newCommand < RenderCommand >();
+
+            if (!mOwnCommand)
+                throw NullError("RenderNode", "render", "Null RenderCommand created.");
+        }
+
+        bool isFrustumVisible = true;
+
+        if (mCullOnFrustum && mask)
+        {
+            // Now we have to check if this node is visible for the Frustum. The subtree AABB is tested 
+            // first: if it is outside, neither this node nor its children are rendered. Planes it is 
+            // fully inside of are removed from the mask, so our children don't test them again. If 
+            // we have no AABB, then we consider this node as always visible for the Frustrum.
+
+            if (isSubtreeCulledFromFrustum(frustum, mask))
+                return;
+
+            if (mask && hasAABB())
             {
-                std::lock_guard l(Node::mMutex);
+                Frustum::PlaneMask nodeMask = mask;
+                const AABB box = aabb();
+                isFrustumVisible = frustum.isBoxVisible(box.min, box.max, nodeMask);
+            }
+        }
 
-                for (const Node::Shared& node : Node::mChildren)
-                {
-                    Shared renderNode = std::dynamic_pointer_cast < RenderNode >(node);
+        // Now we know that we are visible. We have to render our renderables and our children, 
+        // first depending on mRenderRenderablesFirst. 
+
+        if (mRenderRenderablesFirst && isFrustumVisible)
+        {
+            if (!mOwnRenderCommand)
+                renderSync(command);
+            else
+                renderSync(*mOwnCommand);
+        }
 
-                    if (!renderNode)
-                        throw NullError("RenderNode", "render", "Null RenderNode cast.");
+        if (mRenderChildren)
+        {
+            // Children are copied so we do not hold our mutex while rendering the whole
+            // subtree, which may take some time.
 
-                    if (!mOwnRenderCommand)
-                        renderNode->render(command, frustum);
-                    else
-                        renderNode->render(*mOwnCommand, frustum);
-                }
+            Node::ChildList children;
+
+            {
+                std::lock_guard l(Node::mMutex);
+                children = Node::mChildren;
             }
 
-            if (!mRenderRenderablesFirst)
+            for (const Node::Shared& node : children)
             {
+                Shared renderNode = std::dynamic_pointer_cast < RenderNode >(node);
+
+                if (!renderNode)
+                    throw NullError("RenderNode", "render", "Null RenderNode cast.");
+
                 if (!mOwnRenderCommand)
-                    render(command);
+                    renderNode->renderCulledSync(command, frustum, mask);
                 else
-                    render(*mOwnCommand);
+                    renderNode->renderCulledSync(*mOwnCommand, frustum, mask);
             }
-        });
+        }
+
+        if (!mRenderRenderablesFirst && isFrustumVisible)
+        {
+            if (!mOwnRenderCommand)
+                renderSync(command);
+            else
+                renderSync(*mOwnCommand);
+        }
+    }
+
+    std::future < void > RenderNode::render(RenderCommand& command, const Frustum& frustum) const
+    {
+        return JobSystem::Get().async([this, &command, &frustum](){ renderSync(command, frustum); });
     }
 
     void RenderNode::setOwnRenderCommand(bool rhs)
@@ -450,6 +875,18 @@ namespace Atl
             return false;
 
         std::lock_guard l(mMutex);
-        return frustum.isBoxVisible(mAABB.min, mAABB.max);
+        return !frustum.isBoxVisible(mAABB.min, mAABB.max);
+    }
+
+    bool RenderNode::isSubtreeCulledFromFrustum(const Frustum& frustum, Frustum::PlaneMask& mask) const
+    {
+        if (!isVisible())
+            return true;
+
+        if (!mask || !hasSubtreeAABB())
+            return false;
+
+        const AABB box = subtreeAABB();
+        return !frustum.isBoxVisible(box.min, box.max, mask);
     }
 }
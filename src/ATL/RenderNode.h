@@ -17,9 +17,13 @@
 #include "AABB.h"
 #include "RenderCommand.h"
 
+#include <map>
+#include <vector>
+
 namespace Atl
 {
     class RenderNode;
+    class Camera;
 
     //! @brief Error launched when maximum number of renderables is reached.
     struct EXPORTED RenderNodeMaxRenderables : public Error 
@@ -92,6 +96,10 @@ namespace Atl
         //! @brief True if this RenderNode is visible, false otherwise. Default is true.
         std::atomic < bool > mIsVisible;
 
+        //! @brief True if this RenderNode never moves nor changes, so it may be merged with
+        //! others by a StaticBatcher. Default is false.
+        std::atomic < bool > mIsStatic;
+
         //! @brief True if this RenderNode renders everything into its own RenderCommand.
         std::atomic < bool > mOwnRenderCommand;
 
@@ -101,6 +109,32 @@ namespace Atl
         //! @brief The RenderNode AABB, if applicable.
         AABB mAABB;
 
+        //! @brief True if mAABB is relevant. Set by \ref setAABB().
+        std::atomic < bool > mHasAABB;
+
+        //! @brief The AABB containing this node and all its children, updated lazily by 
+        //! \ref subtreeAABB() when mSubtreeDirty is true.
+        mutable AABB mSubtreeAABB;
+
+        //! @brief True if mSubtreeAABB is relevant, i.e. if at least one node in the subtree
+        //! has an AABB and the subtree is bounded.
+        mutable bool mHasSubtreeAABB;
+
+        //! @brief False if a node in the subtree draws something without an AABB. Such a
+        //! subtree has no AABB, and is never culled.
+        mutable bool mIsSubtreeBounded;
+
+        //! @brief True if mSubtreeAABB must be computed again. When a node is dirty, all its
+        //! parents are dirty too.
+        mutable std::atomic < bool > mSubtreeDirty;
+
+        //! @brief Incremented each time mAABB changes, so a SceneBVH can refit only the moved
+        //! nodes.
+        std::atomic < std::uint32_t > mAABBVersion;
+
+        //! @brief Incremented each time a child is added or removed in this subtree.
+        std::atomic < std::uint32_t > mStructureVersion;
+
         //! @brief Boolean true if this RenderNode should cull its children/renderables 
         //! on a Frustum basis, false otherwise. On false, the RenderNode will use the basic
         //! render/build system to render its renderables, but its children will still 
@@ -113,6 +147,33 @@ namespace Atl
         //! @brief The mutex.
         mutable std::mutex mMutex;
 
+        //! @brief A RenderCommand recorded by \ref renderSync(), and the \ref Touchable::touchCount()
+        //! of each renderable when it was recorded (zero for renderables which aren't Touchable).
+        struct Bundle
+        {
+            RenderCommandPtr command;
+            std::vector < std::uint64_t > touchCounts;
+
+            //! @brief The Renderer's UploadQueue::completedCount() if some uploads were pending
+            //! when the Bundle was recorded, as the caches waiting for them drew nothing, or
+            //! NoUploads.
+            std::uint64_t uploads;
+        };
+
+        //! @brief Bundle::uploads of a Bundle recorded with no upload pending.
+        static constexpr std::uint64_t NoUploads = ~std::uint64_t(0);
+
+        //! @brief True if \ref renderSync() records the renderables once in a Bundle, and adds
+        //! this Bundle to the next commands as long as the node and its renderables are not
+        //! touched. Default is false.
+        std::atomic < bool > mIsBundled;
+
+        //! @brief The Bundles, by Renderer and by variant. \see bundleVariant().
+        mutable std::map < std::pair < const Renderer*, std::uint64_t >, Bundle > mBundles;
+
+        //! @brief Protects mBundles.
+        mutable std::mutex mBundlesMutex;
+
     public:
         ATL_SHAREABLE(RenderNode)
 
@@ -138,7 +199,7 @@ namespace Atl
         //! @brief Builds the RenderTaskContainer.
         //! The RenderTaskContainer is filled only with the Renderables in this node, 
         //! not the children. For children rendering, please see \ref render(command, frustum).
-        virtual std::future < void > build(Renderer&);
+        virtual void buildSync(Renderer&);
 
         //! @brief Renders all tasks in this RenderNode.
         //! If this RenderNode has been touched, it rebuilds the RenderTaskContainer. The
@@ -146,7 +207,7 @@ namespace Atl
         //! added/removed, or if a child has been touched.
         //! @note The RenderTaskContainer is filled only with the Renderables in this node, 
         //! not the children. For children rendering, please see \ref render(command, frustum).
-        virtual std::future < void > render(RenderCommand& cmd) const;
+        virtual void renderSync(RenderCommand& cmd) const;
         
         //! @brief Returns the sum of all renderables' size() function for a Renderer.
         virtual std::size_t size(Renderer& rhs) const;
@@ -227,16 +288,125 @@ namespace Atl
         //! by \ref hasAABB().
         virtual AABB aabb() const;
 
+        //! @brief Sets \ref mAABB, in world space, and invalidates the subtree AABB of this
+        //! node and its parents.
+        virtual void setAABB(const AABB& rhs);
+
+        //! @brief Removes \ref mAABB: \ref hasAABB() returns false until the next \ref setAABB().
+        virtual void resetAABB();
+
+        //! @brief Returns the AABB of this node's renderables, in model space. Returns false if
+        //! the renderables have no bounds, which is the default. ModelRenderNode returns the
+        //! bounds of its Model.
+        virtual bool localAABB(AABB& result) const;
+
+        //! @brief Returns the matrix applied to this node's renderables. This is the matrix of the
+        //! first Transformation in this node's renderables or, if there is none, the one of its 
+        //! nearest parent, as it is still bound when this node renders. Defaults to identity.
+        virtual rmat4x4 worldMatrix() const;
+
+        //! @brief Computes \ref mAABB again from \ref localAABB() and \ref worldMatrix(), and
+        //! does the same for children as they may inherit our matrix. This is done automatically
+        //! when renderables or children are added or removed, and by MovableRenderNode when the
+        //! Transformation changes. Call it when a Model's vertexes are modified after being added.
+        virtual void updateAABB();
+
+        //! @brief Returns true if at least one node in this subtree has an AABB, and the
+        //! subtree is bounded. \see isSubtreeBounded().
+        virtual bool hasSubtreeAABB() const;
+
+        //! @brief Returns the AABB containing this node and all its children. Nodes without
+        //! AABB which are bounded draw nothing, and don't contribute to it. Weither this AABB
+        //! is relevant or not is given by \ref hasSubtreeAABB().
+        virtual AABB subtreeAABB() const;
+
+        //! @brief Returns true if every node in this subtree is bounded. \see isBounded().
+        virtual bool isSubtreeBounded() const;
+
+        //! @brief Returns true if everything this node draws is inside its AABB. A node which
+        //! is not bounded makes the subtree of all its parents unbounded, so they are never
+        //! culled. Default returns true if the node has an AABB, or if its renderables only
+        //! change the state (Transformations, Materials and Cameras).
+        virtual bool isBounded() const;
+
+        //! @brief Returns \ref mAABBVersion.
+        std::uint32_t aabbVersion() const;
+
+        //! @brief Returns \ref mStructureVersion. A RenderScene compares the version of its root
+        //! to know if its SceneBVH must be built again.
+        std::uint32_t structureVersion() const;
+
+        //! @brief Marks the subtree AABB of this node and of its parents to be computed again.
+        //! Called when the AABB or the children of a node change.
+        virtual void invalidateSubtreeAABB();
+
+        //! @brief Adds a child and invalidates the subtree AABB. \see Node::addChild().
+        virtual void addChild(const Node::Shared& child);
+
+        //! @brief Removes a child and invalidates the subtree AABB. \see Node::removeChild().
+        virtual void removeChild(const Node::Shared& child);
+
+        //! @brief Removes a child and invalidates the subtree AABB. \see Node::removeChildAt().
+        virtual void removeChildAt(unsigned int idx);
+
+        //! @brief Removes all children and invalidates the subtree AABB. 
+        //! \see Node::removeAllChildren().
+        virtual void removeAllChildren();
+
+        //! @brief Chooses the level of detail to render for the given Camera, and returns it.
+        //! Called by the RenderTechnique before rendering the node, with the projected size of
+        //! the node's AABB. The level is then given to \ref renderLODSync(), so cameras rendered
+        //! concurrently don't share it. Returns zero by default.
+        //! \see Model::selectLOD().
+        virtual std::size_t selectLOD(const Camera& camera, Real screenSize, Real hysteresis) const;
+
+        //! @brief Renders the node like \ref renderSync(), at a level of detail returned by
+        //! \ref selectLOD(). Calls renderSync() by default.
+        virtual void renderLODSync(RenderCommand& command, std::size_t lod) const;
+
+        //! @brief Renders the node like \ref renderLODSync(), but a node made of several parts
+        //! may skip the ones outside the Frustum. Called by the RenderTechnique instead of
+        //! renderLODSync() when it culls the nodes. Calls renderLODSync() by default.
+        //! \see StaticBatchRenderNode::renderPartsSync().
+        virtual void renderPartsSync(RenderCommand& command, const Frustum& frustum, std::size_t lod = 0) const;
+
         //! @brief Returns \ref mIsVisible.
         virtual bool isVisible() const;
 
         //! @brief Sets \ref mIsVisible.
         virtual void setVisible(bool rhs);
 
+        //! @brief Returns \ref mIsStatic.
+        virtual bool isStatic() const;
+
+        //! @brief Sets \ref mIsStatic.
+        virtual void setStatic(bool rhs);
+
+        //! @brief Returns \ref mIsBundled.
+        virtual bool isBundled() const;
+
+        //! @brief Sets \ref mIsBundled. Disabling it removes the Bundles.
+        //! Only the Touchable renderables are watched: a node whose other renderables change
+        //! must call \ref invalidateBundles().
+        virtual void setBundled(bool rhs);
+
+        //! @brief Removes the Bundles, so the next \ref renderSync() records them again.
+        virtual void invalidateBundles() const;
+
+        //! @brief Returns the number of Bundles.
+        virtual std::size_t bundlesCount() const;
+
         //! @brief Renders the RenderNode and its children only if the given \ref Frustrum
         //! doesn't cull the node. 
         //! At the contrary of render(command), this version renders the renderables AND the 
         //! children, if this node is visible, in the frustum (not culled).
+        //! Culling is hierarchical: the subtree AABB is tested first, and children are only
+        //! tested against the planes their parent's subtree AABB intersects.
+        virtual void renderSync(RenderCommand& command, const Frustum& frustrum) const;
+
+        using Renderable::render;
+
+        //! @brief Asynchroneously calls \ref renderSync(command, frustum) through the JobSystem.
         virtual std::future < void > render(RenderCommand& command, const Frustum& frustrum) const;
 
         //! @brief Sets \ref mOwnRenderCommand.
@@ -304,6 +474,48 @@ namespace Atl
         //! This function calls \ref Frustum::isBoxVisible() if this RenderNode has an
         //! AABB. If not, returns false.
         bool isCulledFromFrustum(const Frustum& frustum) const;
+
+        //! @brief Returns true if the RenderNode and all its children are culled from given 
+        //! frustum. The subtree AABB is tested only against the planes in mask, and the planes
+        //! it is fully inside of are removed from mask for the children (\see 
+        //! Frustum::isBoxVisible()). If the subtree has no AABB, returns false.
+        bool isSubtreeCulledFromFrustum(const Frustum& frustum, Frustum::PlaneMask& mask) const;
+
+    protected:
+
+        //! @brief Adds the task rendering a renderable to \ref mTasks. Called by \ref buildSync()
+        //! for each renderable, with mMutex locked. Default adds the renderable itself.
+        virtual void addRenderTask(const RenderablePtr& renderable);
+
+        //! @brief Creates \ref mOwnCommand if needed and builds the node if it is touched.
+        //! Returns the command where the renderables must be rendered.
+        RenderCommand& prepareRenderSync(RenderCommand& command) const;
+
+        //! @brief Renders the RenderNode and its children, testing only the planes in mask.
+        //! \see renderSync(command, frustum).
+        virtual void renderCulledSync(RenderCommand& command, const Frustum& frustum, 
+                                      Frustum::PlaneMask mask) const;
+
+        //! @brief Computes \ref mSubtreeAABB if it is dirty.
+        void updateSubtreeAABB() const;
+
+        //! @brief Increments \ref mStructureVersion of this node and of all its parents.
+        void touchStructure();
+
+        //! @brief Returns the variant of the Bundle to render, when what the renderables record
+        //! depends on the node's state, or false if the node can't be rendered from a Bundle
+        //! right now. Default sets variant to zero and returns true.
+        virtual bool bundleVariant(std::uint64_t& variant) const;
+
+        //! @brief Records the renderables of the given variant into a command. Called by
+        //! \ref renderSync() and when recording a Bundle. Default renders \ref mTasks.
+        virtual void recordSync(RenderCommand& command, std::uint64_t variant) const;
+
+        //! @brief Adds the Bundle for the command's Renderer and the given variant to the
+        //! command, recording it first with \ref recordSync() if it doesn't exist, if a
+        //! renderable was touched, or if it was recorded while uploads were pending and one of
+        //! them is done.
+        void renderBundle(RenderCommand& command, std::uint64_t variant) const;
     };
 
     //! @brief Pointer to a RenderNode.
@@ -6,6 +6,7 @@
 //
 
 #include "RenderScene.h"
+#include "JobSystem.h"
 
 namespace Atl
 {
@@ -24,7 +25,7 @@ namespace Atl
     // RenderScene
 
     RenderScene::RenderScene(const std::string& name, const RenderNodePtr& root, const CameraPtr& camera, const RenderTechniquePtr& technique)
-    : Resource(name), mRoot(root), mTechnique(technique), mCamera(camera)
+    : Resource(name), mRoot(root), mTechnique(technique), mCamera(camera), mBVHRebuildInterval(120), mBVHRefits(0)
     {
 
     }
@@ -70,42 +71,53 @@ namespace Atl
         send(&Listener::onRenderSceneDidSetCamera, *this, (const Camera&)*camera);
     }
     
-    std::future < void > RenderScene::build(Renderer& renderer)
+    void RenderScene::buildSync(Renderer&)
     {
-        return std::async(std::launch::async, [this, &renderer](){});
+
     }
     
-    std::future < void > RenderScene::render(RenderCommand& command) const
+    void RenderScene::renderSync(RenderCommand& command) const
     {
-        return std::async(std::launch::async, [this, &command]()
+        if (!isTouched())
+            return;
+        
+        std::lock_guard l(mMutex);
+        
+        if (!mCamera)
+            throw NullError("RenderScene", "render", "RenderScene %s has no Camera.", name().data());
+        
+        RenderTechniquePtr technique = std::atomic_load(&mTechnique);
+        
+        if (!technique)
         {
-            if (!isTouched())
-                return;
-            
-            std::lock_guard l(mMutex);
+            std::vector < bool > shouldRender =
+            send(&Listener::onRenderSceneShouldRenderNoTechnique, *this).get();
             
-            if (!mCamera)
-                throw NullError("RenderScene", "render", "RenderScene %s has no Camera.", name().data());
-            
-            RenderTechniquePtr technique = std::atomic_load(&mTechnique);
-            
-            if (!technique)
-            {
-                std::vector < bool > shouldRender =
-                send(&Listener::onRenderSceneShouldRenderNoTechnique, *this).get();
-                
-                if (std::find(shouldRender.begin(), shouldRender.end(), true) == shouldRender.end())
-                    return;
-                
-                Frustum frustum(mCamera->matrix());
-                mRoot->render(command, frustum);
-                clean();
+            if (std::find(shouldRender.begin(), shouldRender.end(), true) == shouldRender.end())
                 return;
-            }
             
-            technique->render(command, *mRoot, *mCamera);
+            Frustum frustum(mCamera->matrix());
+            mRoot->renderSync(command, frustum);
             clean();
-        });
+            return;
+        }
+        
+        // The technique queries the visible nodes from our octree or our BVH instead of walking 
+        // the tree.
+        
+        if (mOctree)
+        {
+            updateOctree();
+            technique->render(command, *mOctree, *mCamera);
+        }
+        
+        else
+        {
+            updateBVH();
+            technique->render(command, *mBVH, *mCamera);
+        }
+        
+        clean();
     }
     
     RenderTechniquePtr RenderScene::technique() const
@@ -118,4 +130,91 @@ namespace Atl
         std::atomic_store(&mTechnique, rhs);
         touch();
     }
+    
+    SceneBVHPtr RenderScene::bvh() const
+    {
+        std::lock_guard l(mMutex);
+        return mBVH;
+    }
+    
+    void RenderScene::setBVHRebuildInterval(std::size_t refits)
+    {
+        mBVHRebuildInterval = refits;
+    }
+    
+    std::size_t RenderScene::bvhRebuildInterval() const
+    {
+        return mBVHRebuildInterval;
+    }
+    
+    void RenderScene::setOctree(const LooseOctreePtr& octree)
+    {
+        {
+            std::lock_guard l(mMutex);
+            mOctree = octree;
+        }
+        
+        touch();
+    }
+    
+    LooseOctreePtr RenderScene::octree() const
+    {
+        std::lock_guard l(mMutex);
+        return mOctree;
+    }
+    
+    void RenderScene::updateOctree() const
+    {
+        RenderNodePtr root = std::atomic_load(&mRoot);
+        
+        const bool isStructureChanged = mOctree->root() != root.get() || 
+            (root && mOctree->structureVersion() != root->structureVersion());
+        
+        if (isStructureChanged)
+            mOctree->build(root);
+        else
+            mOctree->sync();
+    }
+    
+    void RenderScene::updateBVH() const
+    {
+        RenderNodePtr root = std::atomic_load(&mRoot);
+        
+        // A BVH rebuilt in the background replaces ours only if the tree didn't change
+        // meanwhile. It is then refitted like ours would have been.
+        
+        if (mPendingBVH.valid() && mPendingBVH.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+        {
+            SceneBVHPtr rebuilt = mPendingBVH.get();
+            
+            if (rebuilt && mBVH && rebuilt->root() == mBVH->root() && rebuilt->structureVersion() == mBVH->structureVersion())
+                mBVH = rebuilt;
+        }
+        
+        const bool isStructureChanged = !mBVH || mBVH->root() != root.get() || 
+            (root && mBVH->structureVersion() != root->structureVersion());
+        
+        if (isStructureChanged || !mBVH->refit())
+        {
+            SceneBVHPtr built = SceneBVH::New();
+            built->build(root);
+            
+            mBVH = built;
+            mBVHRefits = 0;
+            return;
+        }
+        
+        // Refits degrade the hierarchy: after some of them, a copy is rebuilt in the background
+        // with the current bounds, without walking the tree again.
+        
+        const std::size_t interval = mBVHRebuildInterval;
+        
+        if (interval && ++mBVHRefits >= interval && !mPendingBVH.valid())
+        {
+            mBVHRefits = 0;
+            
+            SceneBVHPtr copy = SceneBVH::New(*mBVH);
+            mPendingBVH = JobSystem::Get().async([copy](){ copy->rebuild(); return copy; });
+        }
+    }
 }
@@ -90,6 +90,25 @@ namespace Atl
         //! Tree should always cull its nodes.
         CameraPtr mCamera;
         
+        //! @brief The BVH over mRoot's tree, queried by the technique. It is built again when
+        //! the tree's structure changes, and refitted every frame otherwise.
+        mutable SceneBVHPtr mBVH;
+        
+        //! @brief A copy of mBVH being rebuilt in the background, if valid.
+        mutable std::future < SceneBVHPtr > mPendingBVH;
+        
+        //! @brief Number of refits before mBVH is rebuilt in the background. Zero disables
+        //! background rebuilds. Default is 120.
+        std::atomic < std::size_t > mBVHRebuildInterval;
+        
+        //! @brief Number of refits since the last build.
+        mutable std::size_t mBVHRefits;
+        
+        //! @brief An optional LooseOctree over mRoot's tree. If not null, it is queried by the
+        //! technique instead of mBVH, and moved nodes are only moved to their new cell every
+        //! frame. It is meant for large scenes where most nodes move.
+        LooseOctreePtr mOctree;
+        
     public:
         ATL_SHAREABLE(RenderScene)
         
@@ -127,10 +146,10 @@ namespace Atl
         virtual void setCamera(const CameraPtr& camera);
         
         //! @brief Does nothing.
-        virtual std::future < void > build(Renderer& renderer);
+        virtual void buildSync(Renderer& renderer);
         
         //! @brief Renders the scene using the selected Technique.
-        virtual std::future < void > render(RenderCommand& command) const;
+        virtual void renderSync(RenderCommand& command) const;
         
         //! @brief Returns \ref mTechnique.
         virtual RenderTechniquePtr technique() const;
@@ -138,12 +157,40 @@ namespace Atl
         //! @brief Sets \ref mTechnique.
         virtual void setTechnique(const RenderTechniquePtr& technique);
         
+        //! @brief Returns \ref mBVH, as updated by the last render. May be null. The BVH is
+        //! refitted by each render, so it must not be used while the scene renders.
+        virtual SceneBVHPtr bvh() const;
+        
+        //! @brief Sets \ref mBVHRebuildInterval.
+        virtual void setBVHRebuildInterval(std::size_t refits);
+        
+        //! @brief Returns \ref mBVHRebuildInterval.
+        virtual std::size_t bvhRebuildInterval() const;
+        
+        //! @brief Sets \ref mOctree. A null octree makes the scene use its BVH again. The
+        //! octree is filled by the next render, and must not be shared with another scene.
+        virtual void setOctree(const LooseOctreePtr& octree);
+        
+        //! @brief Returns \ref mOctree. It is updated by each render, so it must not be used
+        //! while the scene renders.
+        virtual LooseOctreePtr octree() const;
+        
         //! @brief Returns always zero.
         virtual inline std::size_t size(Renderer&) const { return 0; }
 
         //! @brief Returns always zero: a RenderScene has no real size, only the 
         //! RenderNodes in it has the size.
         virtual inline std::size_t usedSize() const { return 0; }
+        
+    protected:
+        
+        //! @brief Builds or refits \ref mBVH for the current tree. Must be called with mMutex
+        //! locked.
+        virtual void updateBVH() const;
+        
+        //! @brief Builds \ref mOctree for the current tree, or moves the entries of the moved
+        //! nodes. Must be called with mMutex locked.
+        virtual void updateOctree() const;
     };
 }
 
@@ -152,30 +152,27 @@ namespace Atl
         TimeTouchable::touch();
     }
 
-    std::future < void > RenderSceneGroup::render(RenderCommand& command) const
+    void RenderSceneGroup::renderSync(RenderCommand& command) const
     {
-        return std::async(std::launch::async, [this, &command]()
-        {
-            if (!isTouched())
-                return;
+        if (!isTouched())
+            return;
 
-            std::lock_guard l(mMutex);
-            LockableGuard ll(command);
+        std::lock_guard l(mMutex);
+        LockableGuard ll(command);
 
-            for (auto const& pair : mCommandForScene)
-            {
-                const RenderScene& scene = sceneAt(pair.second);
-                RenderCommand& subcommand = const_cast < RenderCommand& >(commandAt(pair.first));
+        for (auto const& pair : mCommandForScene)
+        {
+            const RenderScene& scene = sceneAt(pair.second);
+            RenderCommand& subcommand = const_cast < RenderCommand& >(commandAt(pair.first));
 
-                if (!scene.isTouched())
-                    continue;
+            if (!scene.isTouched())
+                continue;
 
-                subcommand.removeAllSubCommands();
-                scene.render(subcommand);
+            subcommand.removeAllSubCommands();
+            scene.renderSync(subcommand);
 
-                command.addSubCommand(subcommand.shared_from_this());
-            }
-        });
+            command.addSubCommand(subcommand.shared_from_this());
+        }
     }
 
     std::size_t RenderSceneGroup::makeCommand(Renderer& renderer)
@@ -155,10 +155,10 @@ namespace Atl
         //! RenderCommand is left as-is.
         //! When rendering into the RenderCommand, the RenderCommand is locked and 
         //! cleared to ensure everything is empty.
-        virtual std::future < void > render(RenderCommand& command) const;
+        virtual void renderSync(RenderCommand& command) const;
 
         //! @brief Does nothing.
-        virtual std::future < void > build(Renderer&) { return {}; }
+        virtual void buildSync(Renderer&) {}
 
         //! @brief Always return zero.
         virtual std::size_t size(Renderer&) const { return 0; }
@@ -0,0 +1,146 @@
+//
+//  RenderStateTracker.cpp
+//  atlre
+//
+//  Created by jacques tronconi on 24/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#include "RenderStateTracker.h"
+
+#include <cstring>
+
+namespace Atl
+{
+    std::size_t RenderStateStats::skipped() const
+    {
+        return uniformsSkipped + buffersSkipped + vertexesSkipped + pipelinesSkipped;
+    }
+
+    RenderStateTracker::RenderStateTracker()
+    : mPipeline(nullptr), mVertexes(nullptr), mIndexes(nullptr), mIsIndexesValid(false)
+    {
+
+    }
+
+    void RenderStateTracker::reset()
+    {
+        invalidate();
+        mStats = RenderStateStats();
+    }
+
+    void RenderStateTracker::invalidate()
+    {
+        for (auto& pair : mUniforms)
+            pair.second.isValid = false;
+
+        for (auto& pair : mBindings)
+            pair.second.isValid = false;
+
+        mPipeline = nullptr;
+        mVertexes = nullptr;
+        mIndexes = nullptr;
+        mIsIndexesValid = false;
+    }
+
+    void RenderStateTracker::invalidateUniform(int index)
+    {
+        auto it = mUniforms.find(static_cast < std::int32_t >(index));
+
+        if (it != mUniforms.end())
+            it->second.isValid = false;
+    }
+
+    bool RenderStateTracker::bindPipeline(const RenderPipeline* pipeline)
+    {
+        if (pipeline && pipeline == mPipeline)
+        {
+            mStats.pipelinesSkipped++;
+            return false;
+        }
+
+        for (auto& pair : mUniforms)
+            pair.second.isValid = false;
+
+        mPipeline = pipeline;
+        mStats.pipelinesBound++;
+        return true;
+    }
+
+    bool RenderStateTracker::setUniform(int index, ShaderVariableType type, const void* value, std::size_t size)
+    {
+        Uniform& uniform = mUniforms[static_cast < std::int32_t >(index)];
+
+        if (uniform.isValid
+            && uniform.type == type
+            && uniform.value.size() == size
+            && (!size || !std::memcmp(uniform.value.data(), value, size)))
+        {
+            mStats.uniformsSkipped++;
+            return false;
+        }
+
+        const char* bytes = static_cast < const char* >(value);
+
+        uniform.type = type;
+        uniform.value.assign(bytes, bytes + size);
+        uniform.isValid = true;
+
+        mStats.uniformsSet++;
+        return true;
+    }
+
+    bool RenderStateTracker::bindBuffer(std::uint32_t slot, const RenderHdwBuffer* buffer, std::size_t offset, std::size_t size)
+    {
+        Binding& binding = mBindings[slot];
+
+        if (binding.isValid
+            && binding.buffer == buffer
+            && binding.offset == offset
+            && binding.size == size)
+        {
+            mStats.buffersSkipped++;
+            return false;
+        }
+
+        binding.buffer = buffer;
+        binding.offset = offset;
+        binding.size = size;
+        binding.isValid = true;
+
+        mStats.buffersBound++;
+        return true;
+    }
+
+    bool RenderStateTracker::bindVertexes(const VertexInfos* infos)
+    {
+        if (infos && infos == mVertexes)
+        {
+            mStats.vertexesSkipped++;
+            return false;
+        }
+
+        mVertexes = infos;
+        mStats.vertexesBound++;
+        return true;
+    }
+
+    bool RenderStateTracker::bindIndexes(const IndexBufferData* indexes)
+    {
+        if (mIsIndexesValid && indexes == mIndexes)
+        {
+            mStats.vertexesSkipped++;
+            return false;
+        }
+
+        mIndexes = indexes;
+        mIsIndexesValid = true;
+        mStats.vertexesBound++;
+        return true;
+    }
+
+    const RenderStateStats& RenderStateTracker::stats() const
+    {
+        return mStats;
+    }
+}
@@ -0,0 +1,133 @@
+//
+//  RenderStateTracker.h
+//  atlre
+//
+//  Created by jacques tronconi on 24/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#ifndef ATL_RENDERSTATETRACKER_H
+#define ATL_RENDERSTATETRACKER_H
+
+#include "Platform.h"
+#include "ShaderVariable.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace Atl
+{
+    class RenderPipeline;
+    class RenderHdwBuffer;
+    class VertexInfos;
+    class IndexBufferData;
+
+    //! @brief Counts the state changes seen by a RenderStateTracker since its last reset.
+    struct EXPORTED RenderStateStats
+    {
+        //! @brief Number of uniforms set, and of uniforms skipped because they held the same value.
+        std::size_t uniformsSet = 0;
+        std::size_t uniformsSkipped = 0;
+
+        //! @brief Number of buffers bound to a slot, and of binds skipped.
+        std::size_t buffersBound = 0;
+        std::size_t buffersSkipped = 0;
+
+        //! @brief Number of vertexes or indexes bound, and of binds skipped.
+        std::size_t vertexesBound = 0;
+        std::size_t vertexesSkipped = 0;
+
+        //! @brief Number of pipelines bound, and of binds skipped.
+        std::size_t pipelinesBound = 0;
+        std::size_t pipelinesSkipped = 0;
+
+        //! @brief Returns the number of state changes skipped.
+        std::size_t skipped() const;
+    };
+
+    //! @brief Remembers the state bound by a CommandBuffer while it is rendered.
+    //!
+    //! Every function returns true if the state changed, and must then be applied by the
+    //! caller, or false if it is already bound. The state is unknown after \ref reset(), so the
+    //! first change of each state is always applied. Uniforms belong to the bound pipeline and
+    //! are forgotten when it changes.
+    //!
+    //! The tracker only knows what goes through it: a command changing the state on its own
+    //! must be followed by \ref invalidate() or \ref invalidateUniform().
+    class EXPORTED RenderStateTracker
+    {
+        //! @brief The value of a uniform.
+        struct Uniform
+        {
+            ShaderVariableType type;
+            std::vector < char > value;
+            bool isValid;
+        };
+
+        //! @brief A range of buffer bound to a slot.
+        struct Binding
+        {
+            const RenderHdwBuffer* buffer;
+            std::size_t offset;
+            std::size_t size;
+            bool isValid;
+        };
+
+        //! @brief The uniforms by index. Entries are invalidated rather than removed, so their
+        //! memory is reused from one frame to another.
+        std::unordered_map < std::int32_t, Uniform > mUniforms;
+
+        //! @brief The buffers by slot.
+        std::unordered_map < std::uint32_t, Binding > mBindings;
+
+        //! @brief The bound pipeline, or null.
+        const RenderPipeline* mPipeline;
+
+        //! @brief The bound vertexes, or null.
+        const VertexInfos* mVertexes;
+
+        //! @brief The bound indexes, or null.
+        const IndexBufferData* mIndexes;
+
+        //! @brief False while mIndexes is unknown, as null is a valid binding.
+        bool mIsIndexesValid;
+
+        //! @brief The counters.
+        RenderStateStats mStats;
+
+    public:
+
+        //! @brief Constructs a tracker with an unknown state.
+        RenderStateTracker();
+
+        //! @brief Forgets the state and resets the counters.
+        void reset();
+
+        //! @brief Forgets the state but keeps the counters.
+        void invalidate();
+
+        //! @brief Forgets the value of a uniform.
+        void invalidateUniform(int index);
+
+        //! @brief Binds a pipeline. Forgets the uniforms if it changed.
+        bool bindPipeline(const RenderPipeline* pipeline);
+
+        //! @brief Sets a uniform. Returns false if it already holds the same value.
+        bool setUniform(int index, ShaderVariableType type, const void* value, std::size_t size);
+
+        //! @brief Binds size bytes of a buffer, from offset, to a slot.
+        bool bindBuffer(std::uint32_t slot, const RenderHdwBuffer* buffer, std::size_t offset, std::size_t size);
+
+        //! @brief Binds the vertexes of a draw.
+        bool bindVertexes(const VertexInfos* infos);
+
+        //! @brief Binds the indexes of a draw. Null unbinds them.
+        bool bindIndexes(const IndexBufferData* indexes);
+
+        //! @brief Returns the counters since the last reset.
+        const RenderStateStats& stats() const;
+    };
+}
+
+#endif // ATL_RENDERSTATETRACKER_H
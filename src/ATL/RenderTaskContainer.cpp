@@ -7,6 +7,7 @@
 
 #include "RenderTaskContainer.h"
 #include "Error.h"
+#include "ParallelRecorder.h"
 
 namespace Atl
 {
@@ -20,7 +21,7 @@ namespace Atl
 
         mOrderedTasks.push_back([weak](RenderCommand& command){ 
             if (!weak.expired())
-                return weak.lock()->render(command).get(); 
+                return weak.lock()->renderSync(command); 
         });
     }
 
@@ -40,7 +41,7 @@ namespace Atl
 
         mUnorderedTasks.push_back([weak](RenderCommand& command){ 
             if (!weak.expired())
-                return weak.lock()->render(command).get(); 
+                return weak.lock()->renderSync(command); 
         });
     }
 
@@ -50,38 +51,61 @@ namespace Atl
         mUnorderedTasks.push_back(function);
     }
 
-    std::future < void > RenderTaskContainer::build(Renderer&)
+    void RenderTaskContainer::buildSync(Renderer&)
     {
-        return {};
+
     }
 
-    std::future < void > RenderTaskContainer::render(RenderCommand& command) const
+    void RenderTaskContainer::renderSync(RenderCommand& command) const
     {
-        return std::async(std::launch::async, [this, &command]() 
+        // Tasks are copied so the mutex is not held while we wait for them, as the waiting
+        // thread may execute a job needing this container.
+
+        RenderTaskFunctionList unorderedTasks;
+        RenderTaskFunctionList orderedTasks;
+
         {
-            typedef std::future < void > TaskResult;
-            typedef std::vector < TaskResult > TaskResultList;
-            TaskResultList tasksResults;
             std::lock_guard l(mMutex);
+            unorderedTasks = mUnorderedTasks;
+            orderedTasks = mOrderedTasks;
+        }
+
+        // Launches the unordered tasks first, each one recording in its own command. Only
+        // those tasks go through the JobSystem, the ordered ones are executed on the calling
+        // thread.
+
+        ParallelRecorder recorder;
 
-            // Launches the unordered tasks first.
+        if (!unorderedTasks.empty())
+        {
+            recorder.launch(command.renderer(), unorderedTasks.size(), [&unorderedTasks](RenderCommand& subCommand, std::size_t idx){
+                unorderedTasks[idx](subCommand);
+            });
+        }
 
-            for (const RenderTaskFunction& fun : mUnorderedTasks)
-            {
-                TaskResult result = std::async(std::launch::async, [&fun, &command](){ fun(command); });
-                tasksResults.push_back(std::move(result));
-            }
+        // Launches every ordered tasks. Unordered tasks reference our local lists, so they
+        // are always waited before an error is thrown back.
 
-            // Launches every ordered tasks.
+        std::exception_ptr error;
 
-            for (const RenderTaskFunction& fun : mOrderedTasks)
+        try
+        {
+            for (const RenderTaskFunction& fun : orderedTasks)
                 fun(command);
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
 
-            // Now wait for all unordered tasks.
+        // Now wait for all unordered tasks, and add their commands after the ordered ones, in
+        // the order the tasks were added.
 
-            for (TaskResult& result : tasksResults)
-                result.get();
-        });
+        try { recorder.merge(command); }
+        catch (...) { if (!error) error = std::current_exception(); }
+
+        if (error)
+            std::rethrow_exception(error);
     }
 
     std::size_t RenderTaskContainer::size(Renderer&) const
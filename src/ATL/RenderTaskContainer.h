@@ -25,8 +25,11 @@ namespace Atl
     //! multiple Render functions. 
     //! Render Functions are separated into *ordered* and *unordered* tasks. The *ordered*
     //! tasks are called one by one, waiting for the previous one to finish. The *unordered*
-    //! ones are called all at the same time wrapped into std::async(), and are waited 
-    //! at the end of this container's \ref render() function.
+    //! ones are all submitted at the same time to the JobSystem, and are waited 
+    //! at the end of this container's \ref render() function. Each unordered task records in
+    //! its own RenderCommand, and those commands are added after the ordered tasks in the order
+    //! the tasks were added (\see ParallelRecorder), so the result doesn't depend on which task
+    //! finishes first.
     class EXPORTED RenderTaskContainer : public Renderable
     {
         //! @brief Holds ordered rendering task.
@@ -71,10 +74,10 @@ namespace Atl
         //! This function should build only cache data related to this object. We shouldn't call
         //! renderable's build functions here if we have some renderables in the Render Functions,
         //! so we don't have to store them.
-        std::future < void > build(Renderer&);
+        void buildSync(Renderer&);
 
         //! @brief Renders all Render Functions.
-        std::future < void > render(RenderCommand& command) const;
+        void renderSync(RenderCommand& command) const;
 
         //! @brief Always return zero, as this object has no cache.
         std::size_t size(Renderer&) const;
@@ -6,28 +6,336 @@
 //
 
 #include "RenderTechnique.h"
+#include "Material.h"
+#include "ParallelRecorder.h"
+
+#include <algorithm>
 
 namespace Atl
 {
+    RenderTechnique::RenderTechnique(): mLODScale(1), mLODHysteresis(Real(0.1)), mInstancing(false), mNodesPerJob(0)
+    {
+        
+    }
+    
     void RenderTechnique::render(RenderCommand& command, const RenderNode& node, const Camera& camera) const
     {
-        NodesMap nodes;
+        std::unique_ptr < RenderLists > lists = acquireLists();
+        DrawList& nodes = lists->nodes;
+        
         Frustum frustum(camera.matrix());
         
-        std::size_t nodesAdded = sort(node, camera, frustum, nodes);
+        std::size_t nodesAdded = sort(node, camera, frustum, Frustum::AllPlanes, nodes);
+        
+        // Subtrees fully outside or inside the frustum have been handled while traversing the tree.
+        // The remaining nodes with an AABB are culled at once, on contiguous arrays of bounds.
+        
+        nodes.cull(frustum);
+        
         send(&Listener::onTechniqueDidSortNodes, *this, (std::size_t)nodesAdded);
         
-        // Now we have our list of nodes, we can render them one by one by calling only RenderNode::render() on
-        // them, as we only want their list of renderables without any child.
+        // Now we have our list of nodes, we can sort them by key and render them one by one by calling 
+        // only RenderNode::renderSync() on them, as we only want their list of renderables without any child.
+        
+        nodes.sort();
+        
+        renderNodes(command, nodes, camera, frustum);
+        
+        releaseLists(std::move(lists));
+    }
+    
+    template < typename Index >
+    void RenderTechnique::renderIndex(RenderCommand& command, const Index& index, const Camera& camera) const
+    {
+        std::unique_ptr < RenderLists > lists = acquireLists();
+        std::vector < std::uint32_t >& visible = lists->visible;
+        DrawList& nodes = lists->nodes;
+        
+        Frustum frustum(camera.matrix());
+        
+        OcclusionCullerPtr occlusion = std::atomic_load(&mOcclusionCuller);
         
-        std::for_each(nodes.begin(), nodes.end(), [&command](auto& pair)
+        if (isCullingNodes())
+            index.query(frustum, visible);
+        else
         {
-            auto& list = pair.second;
+            index.queryAll(visible);
+            occlusion = nullptr;
+        }
+        
+        // Occluders are rasterized once the frustum is known, and the nodes they hide never
+        // reach the DrawList.
+        
+        if (occlusion)
+            occlusion->update(camera.matrix());
+        
+        for (std::uint32_t idx : visible)
+        {
+            const SceneBVH::Entry& entry = index.entryAt(idx);
+            std::uint64_t key = 0;
             
-            std::for_each(list.begin(), list.end(), [&command](auto& rhs)
-            {
-                rhs->render(command);
-            });
+            if (occlusion && entry.hasBounds && occlusion->isOccluded(entry.bounds))
+                continue;
+            
+            if (makeEntryKey(entry, camera, key))
+                nodes.add(key, entry.node);
+        }
+        
+        send(&Listener::onTechniqueDidSortNodes, *this, (std::size_t)nodes.size());
+        
+        nodes.sort();
+        
+        renderNodes(command, nodes, camera, frustum);
+        
+        releaseLists(std::move(lists));
+    }
+    
+    void RenderTechnique::renderNodes(RenderCommand& command, const DrawList& nodes, const Camera& camera, const Frustum& frustum) const
+    {
+        const std::size_t nodesPerJob = mNodesPerJob;
+        
+        if (!nodesPerJob || nodes.size() <= nodesPerJob)
+        {
+            renderRange(command, nodes, 0, nodes.size(), camera, frustum);
+            return;
+        }
+        
+        // Each range is recorded in its own command, and the commands are merged in the
+        // DrawList's order, whichever job finishes first.
+        
+        const std::size_t jobsCount = (nodes.size() + nodesPerJob - 1) / nodesPerJob;
+        ParallelRecorder recorder;
+        
+        recorder.launch(command.renderer(), jobsCount, [this, &nodes, &camera, &frustum, nodesPerJob](RenderCommand& subCommand, std::size_t idx)
+        {
+            const std::size_t first = idx * nodesPerJob;
+            renderRange(subCommand, nodes, first, std::min(first + nodesPerJob, nodes.size()), camera, frustum);
         });
+        
+        recorder.merge(command);
+    }
+    
+    void RenderTechnique::renderRange(RenderCommand& command, const DrawList& nodes, std::size_t first, std::size_t last,
+                                      const Camera& camera, const Frustum& frustum) const
+    {
+        const bool isInstancing = mInstancing;
+        const bool isCulling = isCullingNodes();
+        
+        std::unique_ptr < InstanceBatcher > batcher;
+        std::uint64_t batchState = 0;
+        
+        if (isInstancing)
+            batcher = acquireBatcher();
+        
+        for (std::size_t i = first; i < last; ++i)
+        {
+            const RenderNode& rhs = *nodes.nodeAt(i);
+            const std::uint64_t key = nodes.keyAt(i);
+            
+            const std::size_t lod = selectLOD(rhs, camera);
+            
+            if (batcher)
+            {
+                // The groups are drawn before the first node of another pass, pipeline or
+                // material, so they keep their place in the DrawList's order. Transparent
+                // nodes are never instanced, as they must be blended back to front.
+                
+                if (i == first || DrawKey::State(key) != batchState)
+                {
+                    batcher->flush(command);
+                    batchState = DrawKey::State(key);
+                }
+                
+                if (!DrawKey::IsTransparent(key) && batcher->add(rhs, lod))
+                    continue;
+            }
+            
+            if (isCulling)
+                rhs.renderPartsSync(command, frustum, lod);
+            else
+                rhs.renderLODSync(command, lod);
+        }
+        
+        if (batcher)
+        {
+            batcher->flush(command);
+            releaseBatcher(std::move(batcher));
+        }
+    }
+    
+    std::unique_ptr < InstanceBatcher > RenderTechnique::acquireBatcher() const
+    {
+        std::lock_guard l(mBatchersMutex);
+        
+        if (mBatchers.empty())
+            return std::make_unique < InstanceBatcher >();
+        
+        std::unique_ptr < InstanceBatcher > batcher = std::move(mBatchers.back());
+        mBatchers.pop_back();
+        return batcher;
+    }
+    
+    void RenderTechnique::releaseBatcher(std::unique_ptr < InstanceBatcher > batcher) const
+    {
+        std::lock_guard l(mBatchersMutex);
+        mBatchers.push_back(std::move(batcher));
+    }
+    
+    std::unique_ptr < RenderTechnique::RenderLists > RenderTechnique::acquireLists() const
+    {
+        std::lock_guard l(mListsMutex);
+        
+        if (mLists.empty())
+            return std::make_unique < RenderLists >();
+        
+        std::unique_ptr < RenderLists > lists = std::move(mLists.back());
+        mLists.pop_back();
+        return lists;
+    }
+    
+    void RenderTechnique::releaseLists(std::unique_ptr < RenderLists > lists) const
+    {
+        lists->nodes.clear();
+        lists->visible.clear();
+        
+        std::lock_guard l(mListsMutex);
+        mLists.push_back(std::move(lists));
+    }
+    
+    void RenderTechnique::render(RenderCommand& command, const SceneBVH& bvh, const Camera& camera) const
+    {
+        renderIndex(command, bvh, camera);
+    }
+    
+    void RenderTechnique::render(RenderCommand& command, const LooseOctree& octree, const Camera& camera) const
+    {
+        renderIndex(command, octree, camera);
+    }
+    
+    void RenderTechnique::setOcclusionCuller(const OcclusionCullerPtr& culler)
+    {
+        std::atomic_store(&mOcclusionCuller, culler);
+    }
+    
+    OcclusionCullerPtr RenderTechnique::occlusionCuller() const
+    {
+        return std::atomic_load(&mOcclusionCuller);
+    }
+    
+    void RenderTechnique::setLODScale(Real scale)
+    {
+        mLODScale = scale;
+    }
+    
+    Real RenderTechnique::lodScale() const
+    {
+        return mLODScale;
+    }
+    
+    void RenderTechnique::setLODHysteresis(Real hysteresis)
+    {
+        mLODHysteresis = hysteresis;
+    }
+    
+    Real RenderTechnique::lodHysteresis() const
+    {
+        return mLODHysteresis;
+    }
+    
+    void RenderTechnique::setInstancing(bool value)
+    {
+        mInstancing = value;
+    }
+    
+    bool RenderTechnique::isInstancing() const
+    {
+        return mInstancing;
+    }
+    
+    void RenderTechnique::setNodesPerJob(std::size_t count)
+    {
+        mNodesPerJob = count;
+    }
+    
+    std::size_t RenderTechnique::nodesPerJob() const
+    {
+        return mNodesPerJob;
+    }
+    
+    std::uint64_t RenderTechnique::makeKey(const RenderNode& node, Real distance) const
+    {
+        std::uint32_t material = 0;
+        bool isTransparent = false;
+        
+        const std::size_t count = node.renderablesCount();
+        
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const Material* asMaterial = dynamic_cast < const Material* >(&node.renderableAt(i));
+            
+            if (asMaterial)
+            {
+                material = static_cast < std::uint32_t >(asMaterial->index());
+                isTransparent = asMaterial->isTransparent();
+                break;
+            }
+        }
+        
+        return DrawKey::Make(0, 0, material, DrawKey::Depth(distance), isTransparent);
+    }
+    
+    bool RenderTechnique::makeEntryKey(const SceneBVH::Entry& entry, const Camera& camera, std::uint64_t& key) const
+    {
+        key = makeKey(*entry.node, Distance(entry, camera));
+        return true;
+    }
+    
+    bool RenderTechnique::isCullingNodes() const
+    {
+        return true;
+    }
+    
+    Real RenderTechnique::Distance(const RenderNode& node, const Camera& camera)
+    {
+        if (!node.hasAABB())
+            return INFINITY;
+        
+        AABB bbox = node.aabb();
+        return glm::length(camera.distance(bbox.center()));
+    }
+    
+    Real RenderTechnique::Distance(const SceneBVH::Entry& entry, const Camera& camera)
+    {
+        if (!entry.hasBounds)
+            return INFINITY;
+        
+        return glm::length(camera.distance(entry.bounds.center()));
+    }
+    
+    std::size_t RenderTechnique::selectLOD(const RenderNode& node, const Camera& camera) const
+    {
+        if (!node.hasAABB())
+            return 0;
+        
+        return node.selectLOD(camera, ScreenSize(node.aabb(), camera, mLODScale), mLODHysteresis);
+    }
+    
+    Real RenderTechnique::ScreenSize(const AABB& bounds, const Camera& camera, Real scale)
+    {
+        const Real radius = glm::length(bounds.max - bounds.min) * Real(0.5);
+        const Real distance = glm::length(camera.distance(bounds.center()));
+        
+        if (distance <= radius)
+            return INFINITY;
+        
+        return radius * scale / distance;
+    }
+    
+    void RenderTechnique::AddNode(DrawList& nodes, std::uint64_t key, const RenderNodePtr& node, bool cull)
+    {
+        if (cull && node && node->hasAABB())
+            nodes.add(key, node, node->aabb());
+        else
+            nodes.add(key, node);
     }
 }
@@ -15,6 +15,11 @@
 #include "Camera.h"
 #include "Frustum.h"
 #include "Resource.h"
+#include "DrawList.h"
+#include "SceneBVH.h"
+#include "LooseOctree.h"
+#include "OcclusionCuller.h"
+#include "InstanceBatcher.h"
 
 namespace Atl
 {
@@ -39,10 +44,57 @@ namespace Atl
         public std::enable_shared_from_this < RenderTechnique >,
         public Emitter
     {
+        //! @brief An optional OcclusionCuller. If not null, the nodes queried from a SceneBVH or
+        //! a LooseOctree are tested against it before being added to the DrawList.
+        OcclusionCullerPtr mOcclusionCuller;
+        
+        //! @brief Scale applied to the projected size of the nodes before selecting their level
+        //! of detail. Default is 1. \see ScreenSize().
+        std::atomic < Real > mLODScale;
+        
+        //! @brief Relative margin around levels of detail thresholds. Default is 0.1.
+        std::atomic < Real > mLODHysteresis;
+        
+        //! @brief True if the nodes are drawn with instancing. Default is false, as the Renderer's
+        //! shaders must read the model matrix from the instance attributes. \see InstanceBatcher.
+        std::atomic < bool > mInstancing;
+        
+        //! @brief Number of nodes recorded by each job when the DrawList is recorded in parallel.
+        //! Zero, the default, records every node on the calling thread.
+        std::atomic < std::size_t > mNodesPerJob;
+        
+        //! @brief InstanceBatchers not used by a job, kept so their groups' memory is reused
+        //! from one frame to another.
+        mutable std::vector < std::unique_ptr < InstanceBatcher > > mBatchers;
+        
+        //! @brief Protects mBatchers.
+        mutable std::mutex mBatchersMutex;
+        
+        //! @brief The lists filled by a call to render().
+        struct RenderLists
+        {
+            //! @brief The nodes to render.
+            DrawList nodes;
+            
+            //! @brief The entries returned by a SceneBVH or a LooseOctree query.
+            std::vector < std::uint32_t > visible;
+        };
+        
+        //! @brief RenderLists not used by a call to render(), kept so their memory is reused
+        //! from one frame to another. A call takes its own lists, as another render() may run
+        //! on the same thread while it waits for its jobs.
+        mutable std::vector < std::unique_ptr < RenderLists > > mLists;
+        
+        //! @brief Protects mLists.
+        mutable std::mutex mListsMutex;
+        
     public:
         //! @brief The RenderTechnique's listener.
         typedef RenderTechniqueListener Listener;
         
+        //! @brief Constructs the technique.
+        RenderTechnique();
+        
         //! @brief Default destructor.
         virtual ~RenderTechnique() = default;
         
@@ -52,21 +104,139 @@ namespace Atl
         //! @param camera The Camera from where we want to render the node.
         virtual void render(RenderCommand& command, const RenderNode& node, const Camera& camera) const;
         
-    protected:
+        //! @brief Renders the visible nodes of a SceneBVH into a command.
+        //! Instead of walking the RenderNode tree, the BVH is queried for the nodes in the 
+        //! Camera's Frustum (or for all visible nodes if \ref isCullingNodes() is false), and 
+        //! each of them gets its DrawKey from \ref makeEntryKey().
+        //! @param command The command where to render the nodes.
+        //! @param bvh The SceneBVH holding the nodes to render.
+        //! @param camera The Camera from where we want to render the nodes.
+        virtual void render(RenderCommand& command, const SceneBVH& bvh, const Camera& camera) const;
+        
+        //! @brief Renders the visible nodes of a LooseOctree into a command, the same way as
+        //! for a SceneBVH.
+        //! @param command The command where to render the nodes.
+        //! @param octree The LooseOctree holding the nodes to render.
+        //! @param camera The Camera from where we want to render the nodes.
+        virtual void render(RenderCommand& command, const LooseOctree& octree, const Camera& camera) const;
+        
+        //! @brief Sets \ref mOcclusionCuller. Its occluders are rasterized from the Camera at
+        //! each render, so it must not be shared by techniques rendering at the same time.
+        virtual void setOcclusionCuller(const OcclusionCullerPtr& culler);
+        
+        //! @brief Returns \ref mOcclusionCuller.
+        virtual OcclusionCullerPtr occlusionCuller() const;
+        
+        //! @brief Sets \ref mLODScale. The Camera has no projection, so this should be 
+        //! cot(fovY / 2) for thresholds to be fractions of the viewport's height.
+        virtual void setLODScale(Real scale);
+        
+        //! @brief Returns \ref mLODScale.
+        virtual Real lodScale() const;
+        
+        //! @brief Sets \ref mLODHysteresis.
+        virtual void setLODHysteresis(Real hysteresis);
+        
+        //! @brief Returns \ref mLODHysteresis.
+        virtual Real lodHysteresis() const;
+        
+        //! @brief Sets \ref mInstancing.
+        virtual void setInstancing(bool value);
         
-        //! @brief Defines a sorted map of nodes, by distance (usually from the camera).
-        typedef std::map < Real, RenderableList > NodesMap;
+        //! @brief Returns \ref mInstancing.
+        virtual bool isInstancing() const;
         
-        //! @brief Sort a node and its children into the NodesMap.
-        //! This function should either add the node to the map, or reject it if it doesn't meet the
-        //! requirements.
+        //! @brief Sets \ref mNodesPerJob. When the DrawList holds more nodes, it is split into
+        //! ranges of count nodes, each recorded in its own RenderCommand by a job, and the
+        //! commands are merged in the DrawList's order. Nodes are then rendered from any thread,
+        //! and instancing groups only the nodes of a same range.
+        virtual void setNodesPerJob(std::size_t count);
+        
+        //! @brief Returns \ref mNodesPerJob.
+        virtual std::size_t nodesPerJob() const;
+        
+    protected:
+        
+        //! @brief Sort a node and its children into the DrawList.
+        //! This function should either add the node to the list with its DrawKey, or reject it if
+        //! it doesn't meet the requirements. The list is sorted by \ref render() once every nodes
+        //! have been added.
         //! @param node The node to filter.
         //! @param camera The camera from which we filter the node.
         //! @param frustum The Frustum from which we filter the node. This Frustum is computed at first
         //! so we don't have to recalculate it.
-        //! @param nodes The nodes map where we out the filtered node.
-        //! @return The number of nodes we have added to the map.
-        virtual std::size_t sort(const RenderNode& node, const Camera& camera, const Frustum& frustum, NodesMap& nodes) const = 0;
+        //! @param mask The planes of the Frustum the parent's subtree AABB intersects, given to
+        //! \ref RenderNode::isSubtreeCulledFromFrustum(). Starts with Frustum::AllPlanes.
+        //! @param nodes The list where we put the filtered node.
+        //! @return The number of nodes we have added to the list.
+        virtual std::size_t sort(const RenderNode& node, const Camera& camera, const Frustum& frustum, Frustum::PlaneMask mask, DrawList& nodes) const = 0;
+        
+        //! @brief Returns the DrawKey for a node at the given distance.
+        //! The default key groups opaque nodes by Material, front to back, and draws transparent
+        //! nodes back to front after them. The Material is the first Material renderable found
+        //! in the node, if any.
+        virtual std::uint64_t makeKey(const RenderNode& node, Real distance) const;
+        
+        //! @brief Returns the DrawKey for a SceneBVH entry, or false if the entry must not be 
+        //! rendered. The default implementation returns \ref makeKey() with the entry's distance.
+        virtual bool makeEntryKey(const SceneBVH::Entry& entry, const Camera& camera, std::uint64_t& key) const;
+        
+        //! @brief Returns true if nodes outside the Frustum are not rendered, which is the
+        //! default.
+        virtual bool isCullingNodes() const;
+        
+        //! @brief Returns the distance between the camera and the center of the node's AABB, or
+        //! INFINITY if the node has no AABB.
+        static Real Distance(const RenderNode& node, const Camera& camera);
+        
+        //! @brief Returns the distance between the camera and the center of the entry's AABB, or
+        //! INFINITY if the entry has no AABB.
+        static Real Distance(const SceneBVH::Entry& entry, const Camera& camera);
+        
+        //! @brief Selects the level of detail of a node about to be rendered for a Camera, from
+        //! the projected size of its AABB, and returns it. Nodes without AABB are rendered at
+        //! level zero.
+        virtual std::size_t selectLOD(const RenderNode& node, const Camera& camera) const;
+        
+        //! @brief Returns the projected size of the bounding sphere of an AABB, which is its
+        //! radius divided by its distance to the camera, times scale. Returns INFINITY if the
+        //! camera is inside the sphere.
+        static Real ScreenSize(const AABB& bounds, const Camera& camera, Real scale);
+        
+        //! @brief Adds a node to the list. If culling is requested and the node has an AABB, the
+        //! node is added with its bounds so it is culled in batch by \ref DrawList::cull().
+        static void AddNode(DrawList& nodes, std::uint64_t key, const RenderNodePtr& node, bool cull = true);
+        
+    private:
+        
+        //! @brief Renders the sorted nodes of a DrawList, after selecting their level of detail
+        //! and, when \ref isCullingNodes(), rendering them with \ref RenderNode::renderPartsSync()
+        //! so they skip their parts outside the Frustum.
+        //! When \ref isInstancing(), the opaque nodes accepted by an InstanceBatcher are drawn
+        //! one DrawInstancedCommand per group, after the other nodes of their DrawKey state and
+        //! before the next state. When the list holds more than
+        //! \ref nodesPerJob() nodes, the ranges are recorded in parallel by a ParallelRecorder.
+        void renderNodes(RenderCommand& command, const DrawList& nodes, const Camera& camera, const Frustum& frustum) const;
+        
+        //! @brief Renders the nodes of a DrawList in [first, last).
+        void renderRange(RenderCommand& command, const DrawList& nodes, std::size_t first, std::size_t last,
+                         const Camera& camera, const Frustum& frustum) const;
+        
+        //! @brief Takes an InstanceBatcher from mBatchers, or creates one.
+        std::unique_ptr < InstanceBatcher > acquireBatcher() const;
+        
+        //! @brief Gives back an InstanceBatcher to mBatchers.
+        void releaseBatcher(std::unique_ptr < InstanceBatcher > batcher) const;
+        
+        //! @brief Takes empty RenderLists from mLists, or creates them.
+        std::unique_ptr < RenderLists > acquireLists() const;
+        
+        //! @brief Clears and gives back RenderLists to mLists.
+        void releaseLists(std::unique_ptr < RenderLists > lists) const;
+        
+        //! @brief Renders the visible entries of a SceneBVH or a LooseOctree.
+        template < typename Index >
+        void renderIndex(RenderCommand& command, const Index& index, const Camera& camera) const;
     };
 }
 
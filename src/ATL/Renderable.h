@@ -11,6 +11,7 @@
 #include "Platform.h"
 #include "Emitter.h"
 #include "Error.h"
+#include "JobSystem.h"
 
 #include <future>
 
@@ -58,12 +59,27 @@ namespace Atl
         //! The RenderCommand must be filled accordingly, for the Renderer to be able
         //! to draw this object. This function can be used in another thread as the
         //! rendering thread, because no drawing API call are involved in this function.
-        virtual std::future < void > render(RenderCommand& to) const = 0;
+        //! The work is done on the calling thread: this is the path to use when traversing
+        //! a whole scene, as it involves no shared state nor synchronization per object.
+        virtual void renderSync(RenderCommand& to) const = 0;
         
         //! @brief Should build the object to be ready for drawing.
         //! This function should creates all intermediary objects needed to fill correctly
-        //! the RenderCommand provided by the given Renderer.
-        virtual std::future < void > build(Renderer& rhs) = 0;
+        //! the RenderCommand provided by the given Renderer. The work is done on the calling
+        //! thread.
+        virtual void buildSync(Renderer& rhs) = 0;
+        
+        //! @brief Asynchroneously renders the object into the RenderCommand.
+        //! By default, submits \ref renderSync() to the JobSystem.
+        virtual std::future < void > render(RenderCommand& to) const {
+            return JobSystem::Get().async([this, &to](){ renderSync(to); });
+        }
+        
+        //! @brief Asynchroneously builds the object.
+        //! By default, submits \ref buildSync() to the JobSystem.
+        virtual std::future < void > build(Renderer& rhs) {
+            return JobSystem::Get().async([this, &rhs](){ buildSync(rhs); });
+        }
         
         //! @brief Returns, in bytes, the memory used on the GPU RAM for this cache and for
         //! the given renderer.
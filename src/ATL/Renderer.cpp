@@ -7,6 +7,7 @@
 
 #include "Renderer.h"
 #include "Module.h"
+#include "JobSystem.h"
 
 namespace Atl
 {
@@ -14,12 +15,17 @@ namespace Atl
     // Renderer
 
     Renderer::Renderer(Manager& manager, const std::string& name)
-    : TResource(manager, name), mSurfaces(*this), mBuffManager(*this)
+    : TResource(manager, name), mSurfaces(*this), mBuffManager(*this), mTransientRing(mBuffManager)
     {
         RendererLoaderDb::Get().addLoader("", std::make_shared < ModuleRendererLoader >());
         setCommandConstructor<RenderCommand, RenderCommand>();
     }
     
+    void Renderer::closeCommandPools()
+    {
+        mCommandPools.close();
+    }
+    
     bool Renderer::areAllSurfacesClosed() const
     {
         std::atomic_flag isClosed;
@@ -51,32 +57,54 @@ namespace Atl
     
     std::future < void > Renderer::render(RenderTarget& target, RenderCommand& command)
     {
-        return std::async(std::launch::async, [&target, &command]()
+        const std::uint64_t frame = mTransientRing.endFrame();
+        
+        return JobSystem::Get().async([this, &target, &command, frame]()
         {
-            LockableGuard l(target);
-            target.bind();
-
-            command.prepare();
-            command.render();
-            command.finish();
+            TransientFrameGuard g(mTransientRing, frame);
+            submit(target, command);
         });
     }
 
     std::future < void > Renderer::render(RenderTarget& target, RenderPass& pass)
     {
-        return std::async(std::launch::async, [&target, &pass]()
+        const std::uint64_t frame = mTransientRing.endFrame();
+        
+        return JobSystem::Get().async([this, &target, &pass, frame]()
         {
-            LockableGuard l(target);
-            target.bind();
-            
-            RenderPipelinePtr pipeline = pass.pipeline();
-            RenderCommandPtr command = pass.command();
+            TransientFrameGuard g(mTransientRing, frame);
+            submit(target, *pass.command(), pass.pipeline().get());
+        });
+    }
+
+    void Renderer::submit(RenderTarget& target, RenderCommand& command, RenderPipeline* pipeline)
+    {
+        LockableGuard l(target);
+        target.bind();
 
+        mUploadQueue.nextFrame();
+
+        if (CommandCapturePtr capture = this->capture())
+            capture->capture(command, pipeline);
+
+        if (pipeline)
             pipeline->bind();
-            command->prepare();
-            command->render();
-            command->finish();
-        });
+
+        command.prepare();
+        command.render();
+        command.finish();
+    }
+    
+    void Renderer::setCapture(const CommandCapturePtr& capture)
+    {
+        std::lock_guard l(mMutex);
+        mCapture = capture;
+    }
+
+    CommandCapturePtr Renderer::capture() const
+    {
+        std::lock_guard l(mMutex);
+        return mCapture;
     }
     
     RenderHdwBufferPtr Renderer::newHdwBuffer(const std::type_index& type, std::size_t sz)
@@ -13,11 +13,15 @@
 
 #include "RenderWindow.h"
 #include "RenderHdwBufferManager.h"
+#include "TransientRing.h"
+#include "UploadQueue.h"
 #include "RenderHdwBuffer.h"
 #include "RenderPipeline.h"
 #include "RenderPass.h"
 #include "RenderCommand.h"
+#include "RenderCommandPool.h"
 #include "RenderCacheFactory.h"
+#include "CommandCapture.h"
 
 namespace Atl
 {
@@ -83,12 +87,21 @@ namespace Atl
         //! @brief The RenderCommand factory.
         RenderCommandFactory mCommandFactory;
         
+        //! @brief The pools of the commands registered with \ref setCommandConstructor().
+        RenderCommandPools mCommandPools;
+        
         //! @brief The surface's manager.
         RenderSurfaceManager mSurfaces;
         
         //! @brief The RenderHdwBuffer manager.
         RenderHdwBufferManager mBuffManager;
 
+        //! @brief The ring for the dynamic data of the frames.
+        TransientRing mTransientRing;
+
+        //! @brief The queue uploading the MemBuffers into RenderHdwBuffers.
+        UploadQueue mUploadQueue;
+
         //! @brief The RenderPipeline manager.
         RenderPipelineManager mPipelineManager;
 
@@ -98,6 +111,9 @@ namespace Atl
         //! @brief The Pass Manager.
         RenderPassManager mPassManager;
         
+        //! @brief The capture writing the rendered commands, or null.
+        CommandCapturePtr mCapture;
+        
     public:
         
         //! @brief Constructs a new Renderer.
@@ -114,9 +130,14 @@ namespace Atl
         
         //! @brief Creates a new command of type T. This type must be registered
         //! previously by the renderer's module.
+        //! Types registered with \ref setCommandConstructor() are taken from their pool, without
+        //! lock nor cast, and go back to it when released. Others go through the factory.
         template < typename T >
-        auto newCommand()
+        std::shared_ptr < T > newCommand()
         {
+            if (RenderCommandPool < T >* pool = mCommandPools.find < T >())
+                return pool->acquire(*this);
+            
             auto cmd = mCommandFactory.construct(typeid(T), *this);
             return std::dynamic_pointer_cast < T >(cmd);
         }
@@ -130,15 +151,33 @@ namespace Atl
         //! @brief Makes a Constructor for a derived class of RenderCommandBase.
         //! This function is a helper that creates a lambda for a derived class of
         //! the RenderCommandBase. This enables a Renderer's Module to register its
-        //! custom render commands.
+        //! custom render commands. The commands are recycled through a RenderCommandPool, which
+        //! the factory uses too.
         template < typename T, typename Derived >
         void setCommandConstructor()
         {
-            mCommandFactory.setConstructor(typeid(T), [](Renderer& rhs){
-                return std::make_shared < Derived >(rhs);
+            auto pool = mCommandPools.setPool < T >([](Renderer& rhs) -> T* {
+                return new Derived(rhs);
+            });
+            
+            if (!pool)
+            {
+                mCommandFactory.setConstructor(typeid(T), [](Renderer& rhs){
+                    return std::make_shared < Derived >(rhs);
+                });
+                return;
+            }
+            
+            mCommandFactory.setConstructor(typeid(T), [pool](Renderer& rhs){
+                return RenderCommandBasePtr(pool->acquire(rhs));
             });
         }
         
+        //! @brief Destroys the commands kept by the pools, and stops pooling. The Renderer does it
+        //! when destroyed, but a derived Renderer should do it first in its destructor, while
+        //! the commands can still be destroyed.
+        void closeCommandPools();
+        
         //! @brief Returns true if all surfaces are closed.
         bool areAllSurfacesClosed() const;
         
@@ -152,10 +191,27 @@ namespace Atl
         std::future < RenderWindowPtr > newWindow(const std::string& name, const Params& params);
         
         //! @brief Renders a command into a target.
+        //! The ranges allocated in \ref transientRing() until now belong to this frame, and are
+        //! retired once it is rendered. \ref uploadQueue() starts a new frame before the command
+        //! is rendered.
+        //! \see FramePipeline to record the next frame while this one is rendered.
         std::future < void > render(RenderTarget& target, RenderCommand& command);
 
         //! @brief Renders a RenderPass into a RenderTarget.
         std::future < void > render(RenderTarget& target, RenderPass& pass);
+
+        //! @brief Submits a command on the calling thread: binds the target, starts a new frame
+        //! of \ref uploadQueue(), captures the command and renders it. Used by \ref render() and
+        //! FramePipeline, which retire the frame of \ref transientRing() themselves.
+        //! @param pipeline The pipeline bound before the command, or null.
+        void submit(RenderTarget& target, RenderCommand& command, RenderPipeline* pipeline = nullptr);
+        
+        //! @brief Sets the capture writing each command rendered by \ref submit(), or null to
+        //! stop capturing. \see CommandReplay to submit the captured frames again.
+        void setCapture(const CommandCapturePtr& capture);
+        
+        //! @brief Returns \ref mCapture.
+        CommandCapturePtr capture() const;
         
         //! @brief Returns always Zero.
         inline std::size_t usedSize() const { return 0; }
@@ -182,6 +238,16 @@ namespace Atl
         //! @brief Returns the \ref RenderHdwBufferManager for this Renderer.
         const RenderHdwBufferManager& hdwBufferManager() const;
 
+        //! @brief Returns \ref mTransientRing.
+        inline TransientRing& transientRing() { return mTransientRing; }
+        //! @brief Returns \ref mTransientRing.
+        inline const TransientRing& transientRing() const { return mTransientRing; }
+
+        //! @brief Returns \ref mUploadQueue.
+        inline UploadQueue& uploadQueue() { return mUploadQueue; }
+        //! @brief Returns \ref mUploadQueue.
+        inline const UploadQueue& uploadQueue() const { return mUploadQueue; }
+
         //! @brief Returns \ref mPipelineManager.
         inline RenderPipelineManager& pipelineManager() { return mPipelineManager; }
         //! @brief Returns \ref mPipelineManager.
@@ -0,0 +1,413 @@
+//
+//  SceneBVH.cpp
+//  atlre
+//
+//  Created by jacques tronconi on 18/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#include "SceneBVH.h"
+
+#include <algorithm>
+
+namespace Atl
+{
+    //! @brief Depth after which nodes are split at the median instead of with the SAH, so
+    //! degenerated scenes can't make the hierarchy too deep.
+    static constexpr unsigned MaxSAHDepth = 48;
+
+    //! @brief Returns half the surface area of a box.
+    static Real HalfArea(const AABB& box)
+    {
+        const rvec3 extent = box.max - box.min;
+        return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+    }
+
+    //! @brief Returns the component of v on the given axis.
+    static Real Component(const rvec3& v, int axis)
+    {
+        return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+    }
+
+    SceneBVH::SceneBVH(): mRoot(nullptr), mStructureVersion(0)
+    {
+
+    }
+
+    void SceneBVH::build(const RenderNodePtr& root)
+    {
+        mEntries.clear();
+        mRoot = root.get();
+
+        if (!root)
+        {
+            rebuild();
+            return;
+        }
+
+        // The version is read before walking the tree, so a change happening meanwhile makes
+        // the next comparison fail.
+
+        mStructureVersion = root->structureVersion();
+        Collect(root, mEntries);
+
+        rebuild();
+    }
+
+    void SceneBVH::rebuild()
+    {
+        mIndices.clear();
+        mUnbounded.clear();
+        mNodes.clear();
+
+        for (std::uint32_t i = 0; i < mEntries.size(); ++i)
+        {
+            if (mEntries[i].hasBounds)
+                mIndices.push_back(i);
+            else
+                mUnbounded.push_back(i);
+        }
+
+        if (mIndices.empty())
+            return;
+
+        mNodes.reserve(2 * mIndices.size());
+        mNodes.push_back(BVHNode{ AABB(), 0, 0 });
+
+        buildNode(0, 0, static_cast < std::uint32_t >(mIndices.size()), 0);
+    }
+
+    bool SceneBVH::refit()
+    {
+        bool isChanged = false;
+
+        for (Entry& entry : mEntries)
+        {
+            const std::uint32_t version = entry.node->aabbVersion();
+
+            if (version == entry.version)
+                continue;
+
+            const bool hasBounds = entry.node->hasAABB();
+
+            if (hasBounds != entry.hasBounds)
+                return false;
+
+            entry.version = version;
+
+            if (hasBounds)
+                entry.bounds = entry.node->aabb();
+
+            isChanged = true;
+        }
+
+        if (isChanged)
+            updateBounds();
+
+        return true;
+    }
+
+    void SceneBVH::query(const Frustum& frustum, std::vector < std::uint32_t >& visible) const
+    {
+        for (std::uint32_t idx : mUnbounded)
+        {
+            if (IsEntryVisible(mEntries, idx))
+                visible.push_back(idx);
+        }
+
+        if (!mNodes.empty())
+            queryNode(0, frustum, Frustum::AllPlanes, visible);
+    }
+
+    void SceneBVH::queryAll(std::vector < std::uint32_t >& visible) const
+    {
+        for (std::uint32_t idx = 0; idx < mEntries.size(); ++idx)
+        {
+            if (IsEntryVisible(mEntries, idx))
+                visible.push_back(idx);
+        }
+    }
+
+    const SceneBVH::Entry& SceneBVH::entryAt(std::size_t idx) const
+    {
+        if (idx >= mEntries.size())
+            throw OutOfRange("SceneBVH", "entryAt", "Index %i out of range.", (int)idx);
+
+        return mEntries[idx];
+    }
+
+    std::size_t SceneBVH::size() const
+    {
+        return mEntries.size();
+    }
+
+    const RenderNode* SceneBVH::root() const
+    {
+        return mRoot;
+    }
+
+    std::uint32_t SceneBVH::structureVersion() const
+    {
+        return mStructureVersion;
+    }
+
+    void SceneBVH::Collect(const RenderNodePtr& root, std::vector < Entry >& entries)
+    {
+        if (!root)
+            throw NullError("SceneBVH", "Collect", "Null root passed.");
+
+        std::uint32_t order = 0;
+        Collect(root, NoParent, order, entries);
+    }
+
+    bool SceneBVH::IsEntryVisible(const std::vector < Entry >& entries, std::uint32_t idx)
+    {
+        while (idx != NoParent)
+        {
+            const Entry& entry = entries[idx];
+
+            if (!entry.node->isVisible())
+                return false;
+
+            idx = entry.parent;
+        }
+
+        return true;
+    }
+
+    void SceneBVH::Collect(const RenderNodePtr& node, std::uint32_t parent, std::uint32_t& order,
+                           std::vector < Entry >& entries)
+    {
+        const std::uint32_t index = static_cast < std::uint32_t >(entries.size());
+
+        Entry entry;
+        entry.node = node;
+        entry.version = node->aabbVersion();
+        entry.hasBounds = node->hasAABB();
+        entry.bounds = entry.hasBounds ? node->aabb() : AABB();
+        entry.order = 0;
+        entry.parent = parent;
+
+        entries.push_back(entry);
+
+        const bool isRenderRenderablesFirst = node->renderRenderablesFirst();
+
+        if (isRenderRenderablesFirst)
+            entries[index].order = order++;
+
+        std::size_t childrenCount = node->childrenCount();
+
+        for (unsigned i = 0; i < childrenCount; ++i)
+        {
+            RenderNodePtr child = std::dynamic_pointer_cast < RenderNode >(node->childAt(i).shared_from_this());
+
+            if (!child)
+                throw NullError("SceneBVH", "Collect", "Node isn't castable to RenderNode.");
+
+            Collect(child, index, order, entries);
+        }
+
+        if (!isRenderRenderablesFirst)
+            entries[index].order = order++;
+    }
+
+    void SceneBVH::buildNode(std::uint32_t index, std::uint32_t first, std::uint32_t count, unsigned depth)
+    {
+        const std::uint32_t last = first + count;
+
+        AABB bounds = mEntries[mIndices[first]].bounds;
+        AABB centroids{ bounds.center(), bounds.center() };
+
+        for (std::uint32_t i = first + 1; i < last; ++i)
+        {
+            const AABB& box = mEntries[mIndices[i]].bounds;
+            bounds.merge(box);
+            centroids.merge(AABB{ box.center(), box.center() });
+        }
+
+        mNodes[index].bounds = bounds;
+
+        if (count <= MaxLeafEntries)
+        {
+            mNodes[index].first = first;
+            mNodes[index].count = count;
+            return;
+        }
+
+        // Splits on the axis where centroids are the most spread.
+
+        const rvec3 extent = centroids.max - centroids.min;
+        const int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+        const Real axisMin = Component(centroids.min, axis);
+        const Real axisExtent = Component(extent, axis);
+
+        std::uint32_t middle = first;
+
+        if (axisExtent > 0 && depth < MaxSAHDepth)
+        {
+            // Binned SAH: entries are put in BinsCount bins by centroid, and we keep the split
+            // between two bins minimizing count * area on both sides.
+
+            const Real scale = BinsCount / axisExtent;
+
+            auto binOf = [&](std::uint32_t idx)
+            {
+                const Real position = Component(mEntries[idx].bounds.center(), axis);
+                const std::uint32_t bin = static_cast < std::uint32_t >((position - axisMin) * scale);
+                return std::min(bin, BinsCount - 1);
+            };
+
+            std::uint32_t binCounts[BinsCount] = { 0 };
+            AABB binBounds[BinsCount];
+
+            for (std::uint32_t i = first; i < last; ++i)
+            {
+                const std::uint32_t bin = binOf(mIndices[i]);
+
+                if (!binCounts[bin])
+                    binBounds[bin] = mEntries[mIndices[i]].bounds;
+                else
+                    binBounds[bin].merge(mEntries[mIndices[i]].bounds);
+
+                binCounts[bin]++;
+            }
+
+            // leftCosts[i] is the cost of bins [0, i], computed from the left.
+
+            Real leftCosts[BinsCount];
+            std::uint32_t leftCount = 0;
+            AABB leftBounds;
+
+            for (std::uint32_t i = 0; i < BinsCount; ++i)
+            {
+                if (binCounts[i])
+                {
+                    if (!leftCount)
+                        leftBounds = binBounds[i];
+                    else
+                        leftBounds.merge(binBounds[i]);
+
+                    leftCount += binCounts[i];
+                }
+
+                leftCosts[i] = leftCount ? leftCount * HalfArea(leftBounds) : 0;
+            }
+
+            // Then from the right, splitting between bin i - 1 and bin i.
+
+            std::uint32_t bestSplit = 0;
+            Real bestCost = 0;
+            std::uint32_t rightCount = 0;
+            AABB rightBounds;
+
+            for (std::uint32_t i = BinsCount - 1; i > 0; --i)
+            {
+                if (binCounts[i])
+                {
+                    if (!rightCount)
+                        rightBounds = binBounds[i];
+                    else
+                        rightBounds.merge(binBounds[i]);
+
+                    rightCount += binCounts[i];
+                }
+
+                if (!rightCount || rightCount == count)
+                    continue;
+
+                const Real cost = leftCosts[i - 1] + rightCount * HalfArea(rightBounds);
+
+                if (!bestSplit || cost < bestCost)
+                {
+                    bestSplit = i;
+                    bestCost = cost;
+                }
+            }
+
+            if (bestSplit)
+            {
+                auto it = std::partition(mIndices.begin() + first, mIndices.begin() + last,
+                                         [&](std::uint32_t idx){ return binOf(idx) < bestSplit; });
+
+                middle = static_cast < std::uint32_t >(it - mIndices.begin());
+            }
+        }
+
+        // Falls back to a median split if the SAH couldn't separate the entries.
+
+        if (middle == first || middle == last)
+        {
+            middle = first + count / 2;
+
+            std::nth_element(mIndices.begin() + first, mIndices.begin() + middle, mIndices.begin() + last,
+                             [&](std::uint32_t lhs, std::uint32_t rhs)
+            {
+                return Component(mEntries[lhs].bounds.center(), axis) < Component(mEntries[rhs].bounds.center(), axis);
+            });
+        }
+
+        const std::uint32_t children = static_cast < std::uint32_t >(mNodes.size());
+
+        mNodes.push_back(BVHNode{ AABB(), 0, 0 });
+        mNodes.push_back(BVHNode{ AABB(), 0, 0 });
+
+        mNodes[index].first = children;
+        mNodes[index].count = 0;
+
+        buildNode(children, first, middle - first, depth + 1);
+        buildNode(children + 1, middle, last - middle, depth + 1);
+    }
+
+    void SceneBVH::updateBounds()
+    {
+        for (std::size_t i = mNodes.size(); i-- > 0;)
+        {
+            BVHNode& node = mNodes[i];
+
+            if (node.count)
+            {
+                node.bounds = mEntries[mIndices[node.first]].bounds;
+
+                for (std::uint32_t j = node.first + 1; j < node.first + node.count; ++j)
+                    node.bounds.merge(mEntries[mIndices[j]].bounds);
+            }
+
+            else
+            {
+                node.bounds = mNodes[node.first].bounds;
+                node.bounds.merge(mNodes[node.first + 1].bounds);
+            }
+        }
+    }
+
+    void SceneBVH::queryNode(std::uint32_t index, const Frustum& frustum, Frustum::PlaneMask mask,
+                             std::vector < std::uint32_t >& visible) const
+    {
+        const BVHNode& node = mNodes[index];
+
+        // A box fully inside the frustum clears the mask, and its content isn't tested anymore.
+
+        if (mask && !frustum.isBoxVisible(node.bounds.min, node.bounds.max, mask))
+            return;
+
+        if (!node.count)
+        {
+            queryNode(node.first, frustum, mask, visible);
+            queryNode(node.first + 1, frustum, mask, visible);
+            return;
+        }
+
+        for (std::uint32_t i = node.first; i < node.first + node.count; ++i)
+        {
+            const std::uint32_t idx = mIndices[i];
+            const Entry& entry = mEntries[idx];
+            Frustum::PlaneMask entryMask = mask;
+
+            if (mask && !frustum.isBoxVisible(entry.bounds.min, entry.bounds.max, entryMask))
+                continue;
+
+            if (IsEntryVisible(mEntries, idx))
+                visible.push_back(idx);
+        }
+    }
+}
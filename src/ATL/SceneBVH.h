@@ -0,0 +1,172 @@
+//
+//  SceneBVH.h
+//  atlre
+//
+//  Created by jacques tronconi on 18/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#ifndef ATL_SCENEBVH_H
+#define ATL_SCENEBVH_H
+
+#include "Platform.h"
+#include "RenderNode.h"
+#include "Frustum.h"
+#include "AABB.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace Atl
+{
+    class SceneBVH;
+
+    //! @brief Pointer to a SceneBVH.
+    typedef std::shared_ptr < SceneBVH > SceneBVHPtr;
+
+    //! @brief A Bounding Volume Hierarchy over the world AABB of every RenderNode in a tree.
+    //!
+    //! The BVH is built once from the RenderNode tree with a binned Surface Area Heuristic,
+    //! and stored as a flat array of nodes. When nodes move, \ref refit() only reloads the
+    //! AABB of the nodes whose \ref RenderNode::aabbVersion() changed and updates the bounds
+    //! of the BVH nodes, without changing the hierarchy. As the quality of the hierarchy
+    //! decreases with refits, the RenderScene rebuilds it periodically in the background.
+    //!
+    //! The query functions return the visible RenderNodes without walking the logical tree:
+    //! a RenderNode is visible if it and all its parents are visible. RenderNodes without
+    //! AABB are always returned.
+    class EXPORTED SceneBVH
+    {
+    public:
+
+        //! @brief Index of the parent of a root entry.
+        static constexpr std::uint32_t NoParent = 0xFFFFFFFF;
+
+        //! @brief Maximum number of entries in a leaf.
+        static constexpr std::uint32_t MaxLeafEntries = 4;
+
+        //! @brief Number of bins used to evaluate the SAH on each axis.
+        static constexpr std::uint32_t BinsCount = 12;
+
+        //! @brief A RenderNode in the BVH.
+        struct Entry
+        {
+            //! @brief The RenderNode.
+            RenderNodePtr node;
+
+            //! @brief The world AABB of the node, if hasBounds is true.
+            AABB bounds;
+
+            //! @brief True if the node has an AABB.
+            bool hasBounds;
+
+            //! @brief The \ref RenderNode::aabbVersion() when bounds was read.
+            std::uint32_t version;
+
+            //! @brief Position of the node in the traversal of the tree. A node is placed
+            //! before its children if \ref RenderNode::renderRenderablesFirst() is true, after
+            //! them otherwise.
+            std::uint32_t order;
+
+            //! @brief Index of the parent's entry, or NoParent.
+            std::uint32_t parent;
+        };
+
+    private:
+
+        //! @brief A node of the hierarchy. Leaves have a non zero count of entries starting at
+        //! first in mIndices. Inner nodes have a zero count, and their children are at first
+        //! and first + 1 in mNodes.
+        struct BVHNode
+        {
+            AABB bounds;
+            std::uint32_t first;
+            std::uint32_t count;
+        };
+
+        //! @brief Every RenderNode of the tree.
+        std::vector < Entry > mEntries;
+
+        //! @brief Index of the entries with an AABB, ordered by leaf.
+        std::vector < std::uint32_t > mIndices;
+
+        //! @brief Index of the entries without AABB.
+        std::vector < std::uint32_t > mUnbounded;
+
+        //! @brief The hierarchy. The root is the first node, and children are always stored
+        //! after their parent.
+        std::vector < BVHNode > mNodes;
+
+        //! @brief The root RenderNode, used only to compare with the scene's root.
+        const RenderNode* mRoot;
+
+        //! @brief The \ref RenderNode::structureVersion() of the root when built.
+        std::uint32_t mStructureVersion;
+
+    public:
+        ATL_SHAREABLE(SceneBVH)
+
+        //! @brief Constructs an empty BVH.
+        SceneBVH();
+
+        //! @brief Default copy constructor. Used to rebuild a copy in the background.
+        SceneBVH(const SceneBVH&) = default;
+
+        //! @brief Collects every RenderNode in the tree and builds the hierarchy.
+        void build(const RenderNodePtr& root);
+
+        //! @brief Builds the hierarchy again from the current entries. The RenderNode tree
+        //! is not walked, so this can be done in the background on a copy.
+        void rebuild();
+
+        //! @brief Reloads the AABB of the moved RenderNodes and updates the bounds of the
+        //! hierarchy. Returns false if a RenderNode gained or lost its AABB, in which case
+        //! the BVH must be built again.
+        bool refit();
+
+        //! @brief Adds to visible the index of every visible entry whose AABB is in the
+        //! frustum, and every visible entry without AABB.
+        void query(const Frustum& frustum, std::vector < std::uint32_t >& visible) const;
+
+        //! @brief Adds to visible the index of every visible entry.
+        void queryAll(std::vector < std::uint32_t >& visible) const;
+
+        //! @brief Returns the entry at given index.
+        const Entry& entryAt(std::size_t idx) const;
+
+        //! @brief Returns the number of entries.
+        std::size_t size() const;
+
+        //! @brief Returns the root RenderNode the BVH has been built from.
+        const RenderNode* root() const;
+
+        //! @brief Returns the \ref RenderNode::structureVersion() of the root when built.
+        std::uint32_t structureVersion() const;
+
+        //! @brief Adds an entry for root and each of its children to entries. Parents are
+        //! added before their children.
+        static void Collect(const RenderNodePtr& root, std::vector < Entry >& entries);
+
+        //! @brief Returns true if the node of the entry at idx and all its parents are visible.
+        static bool IsEntryVisible(const std::vector < Entry >& entries, std::uint32_t idx);
+
+    private:
+
+        //! @brief Adds an entry for node and its children.
+        static void Collect(const RenderNodePtr& node, std::uint32_t parent, std::uint32_t& order,
+                            std::vector < Entry >& entries);
+
+        //! @brief Builds the BVH node at index from count entries in mIndices, starting at
+        //! first.
+        void buildNode(std::uint32_t index, std::uint32_t first, std::uint32_t count, unsigned depth);
+
+        //! @brief Computes the bounds of every BVH node from the entries, children first.
+        void updateBounds();
+
+        //! @brief Adds the visible entries of the BVH node at index.
+        void queryNode(std::uint32_t index, const Frustum& frustum, Frustum::PlaneMask mask,
+                       std::vector < std::uint32_t >& visible) const;
+    };
+}
+
+#endif // ATL_SCENEBVH_H
@@ -6,6 +6,7 @@
 //
 
 #include "ShaderVariableCommand.h"
+#include "CommandBuffer.h"
 
 namespace Atl
 {
@@ -21,6 +22,12 @@ namespace Atl
         mVariable = rhs;
     }
 
+    void ShaderVariableCommand::recycle()
+    {
+        std::lock_guard l(mMutex);
+        mVariable = ShaderVariable();
+    }
+
     void ShaderVariableCommand::setVariableValue(const void* value)
     {
         std::lock_guard l(mMutex);
@@ -56,4 +63,22 @@ namespace Atl
         std::lock_guard l(mMutex);
         return mVariable.valueSize();
     }
+
+    void ShaderVariableCommand::recordTo(CommandBuffer& buffer) const
+    {
+        int index = -1;
+
+        {
+            std::lock_guard l(mMutex);
+            index = mVariable.index();
+
+            if (!mVariable.isTexture() && index >= 0)
+            {
+                buffer.setUniform(index, mVariable.type(), mVariable.value(), mVariable.valueSize());
+                return;
+            }
+        }
+
+        buffer.addCachedCommand(const_cast < ShaderVariableCommand& >(*this), index);
+    }
 }
\ No newline at end of file
@@ -13,6 +13,8 @@
 
 namespace Atl
 {
+    class CommandBuffer;
+
     //! @brief A RenderCommand to bind a ShaderVariable.
     //! This command binds a ShaderVariable into the current context. The current binding is
     //! render API specific (\see GLShaderVariableCommand). This command is optimized for 
@@ -37,6 +39,9 @@ namespace Atl
         //! @brief Changes the ShaderVariable in this command.
         void setShaderVariable(const ShaderVariable& rhs);
 
+        //! @brief Resets the variable, which may hold a Texture.
+        virtual void recycle();
+
         //! @brief Changes the value inside the current variable.
         //! The value must corresponds to the type and size registered in the variable. If
         //! you are not sure of those values, please check \ref ShaderVariable::type() and
@@ -59,6 +64,11 @@ namespace Atl
 
         //! @brief Returns the size of the value in \ref ShaderVariable.
         std::size_t variableValueSize() const;
+
+        //! @brief Records the variable in a CommandBuffer. Values are copied in a
+        //! SetUniformPacket; textures and variables without index record this command itself,
+        //! which must then stay alive until the buffer is rendered.
+        void recordTo(CommandBuffer& buffer) const;
     };
 
     //! @brief Pointer for a \ref ShaderVariableCommand.
@@ -0,0 +1,221 @@
+//
+//  StaticBatch.cpp
+//  atlre
+//
+//  Created by jacques tronconi on 22/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#include "StaticBatch.h"
+#include "SubModelRenderCache.h"
+
+#include <algorithm>
+
+namespace Atl
+{
+    StaticBatch::StaticBatch(const SubModelPtr& subModel, std::vector < std::uint32_t > indexes, std::vector < Range > ranges)
+    : mSubModel(subModel), mIndexes(std::move(indexes)), mRanges(std::move(ranges)), mUses(0)
+    {
+        if (!mSubModel)
+            throw NullError("StaticBatch", "StaticBatch", "Null SubModel passed.");
+
+        std::size_t next = 0;
+
+        for (const Range& range : mRanges)
+        {
+            if (range.first != next || range.first + range.count > mIndexes.size())
+                throw OutOfRange("StaticBatch", "StaticBatch", "Range [%i, %i) doesn't follow the previous one.",
+                                 (int)range.first, (int)(range.first + range.count));
+
+            next = range.first + range.count;
+
+            if (&range == &mRanges.front())
+                mBounds = range.bounds;
+            else
+                mBounds.merge(range.bounds);
+        }
+
+        mDrawIndexes = std::make_shared < MemBuffer >(HBT::Index);
+        const std::size_t count = writeIndexes(std::vector < bool >(mRanges.size(), true), *mDrawIndexes);
+
+        SubModelLockGuard l(*mSubModel);
+        mSubModel->indexes().setBuffer(mDrawIndexes);
+        mSubModel->indexes().setType(IndexType::UInt);
+        mSubModel->indexes().setElementsCount(count);
+    }
+
+    void StaticBatch::renderSync(RenderCommand& to) const
+    {
+        if (mIndexes.empty())
+            return;
+
+        notify(&RenderableListener::onRenderableWillRender, (const Renderable&)*this, to);
+        mSubModel->renderSync(to);
+        notify(&RenderableListener::onRenderableDidRender, (const Renderable&)*this, to);
+    }
+
+    void StaticBatch::renderSync(RenderCommand& to, const Frustum& frustum) const
+    {
+        // The visibility is local to this call, so renders for other Cameras don't change it.
+
+        std::vector < bool > visible(mRanges.size(), false);
+        std::size_t visibleCount = 0;
+
+        for (std::size_t i = 0; i < mRanges.size(); ++i)
+        {
+            if (frustum.isBoxVisible(mRanges[i].bounds.min, mRanges[i].bounds.max))
+            {
+                visible[i] = true;
+                ++visibleCount;
+            }
+        }
+
+        if (!visibleCount)
+            return;
+
+        if (visibleCount == mRanges.size())
+        {
+            renderSync(to);
+            return;
+        }
+
+        // A new view draws nothing until its indexes are uploaded, so every range is drawn
+        // meanwhile: this is the only other view always kept.
+
+        SubModelPtr subModel = viewSync(visible)->subModel;
+        SubModelRenderCachePtr cache = std::dynamic_pointer_cast < SubModelRenderCache >(subModel->cacheSync(to.renderer()));
+
+        if (cache && !cache->isUploaded())
+            subModel = mSubModel;
+
+        notify(&RenderableListener::onRenderableWillRender, (const Renderable&)*this, to);
+        subModel->renderSync(to);
+        notify(&RenderableListener::onRenderableDidRender, (const Renderable&)*this, to);
+    }
+
+    void StaticBatch::buildSync(Renderer& rhs)
+    {
+        notify(&RenderableListener::onRenderableWillBuild, (Renderable&)*this, rhs);
+        mSubModel->buildSync(rhs);
+        notify(&RenderableListener::onRenderableDidBuild, (Renderable&)*this, rhs);
+    }
+
+    std::size_t StaticBatch::size(Renderer& rhs) const
+    {
+        return mSubModel->size(rhs);
+    }
+
+    SubModelPtr StaticBatch::subModel() const
+    {
+        return mSubModel;
+    }
+
+    const std::vector < std::uint32_t >& StaticBatch::indexes() const
+    {
+        return mIndexes;
+    }
+
+    std::size_t StaticBatch::rangesCount() const
+    {
+        return mRanges.size();
+    }
+
+    const StaticBatch::Range& StaticBatch::rangeAt(std::size_t idx) const
+    {
+        if (idx >= mRanges.size())
+            throw OutOfRange("StaticBatch", "rangeAt", "Index %i out of range.", (int)idx);
+
+        return mRanges[idx];
+    }
+
+    const AABB& StaticBatch::aabb() const
+    {
+        return mBounds;
+    }
+
+    StaticBatch::ViewPtr StaticBatch::viewSync(const std::vector < bool >& visible) const
+    {
+        std::lock_guard l(mMutex);
+        ++mUses;
+
+        for (const ViewPtr& view : mViews)
+        {
+            if (view->visible == visible)
+            {
+                view->lastUse = mUses;
+                return view;
+            }
+        }
+
+        // A view shares the VertexBufferBinding of the merged geometry, so its vertexes are
+        // uploaded once per Renderer. Its indexes are written once.
+
+        VertexInfosPtr infos;
+
+        {
+            SubModelLockGuard ls(*mSubModel);
+            const VertexInfos& merged = mSubModel->vertexInfos();
+            infos = VertexInfos::New(merged.declaration(), merged.binding(), merged.baseVertex(), merged.vertexesCount());
+        }
+
+        MemBufferPtr indexes = std::make_shared < MemBuffer >(HBT::Index);
+        const std::size_t count = writeIndexes(visible, *indexes);
+        SubModelPtr subModel = SubModel::New(mSubModel->model(), infos, mSubModel->material());
+
+        {
+            SubModelLockGuard ls(*subModel);
+            subModel->indexes().setBuffer(indexes);
+            subModel->indexes().setType(IndexType::UInt);
+            subModel->indexes().setElementsCount(count);
+        }
+
+        ViewPtr view = std::make_shared < View >(View { visible, subModel, mUses });
+
+        // The least recently drawn view is dropped. A render still drawing it holds it.
+
+        if (mViews.size() >= ViewsCapacity)
+        {
+            auto oldest = std::min_element(mViews.begin(), mViews.end(), [](const ViewPtr& lhs, const ViewPtr& rhs)
+            {
+                return lhs->lastUse < rhs->lastUse;
+            });
+
+            *oldest = view;
+        }
+
+        else
+            mViews.push_back(view);
+
+        return view;
+    }
+
+    std::size_t StaticBatch::writeIndexes(const std::vector < bool >& visible, MemBuffer& buffer) const
+    {
+        // Ranges follow each other, so visible neighbours are copied as a single run.
+
+        std::vector < std::uint32_t > indexes;
+        std::size_t i = 0;
+
+        while (i < mRanges.size())
+        {
+            if (!visible[i])
+            {
+                ++i;
+                continue;
+            }
+
+            const std::size_t first = mRanges[i].first;
+            std::size_t last = first + mRanges[i].count;
+
+            while (++i < mRanges.size() && visible[i])
+                last = mRanges[i].first + mRanges[i].count;
+
+            indexes.insert(indexes.end(), mIndexes.begin() + first, mIndexes.begin() + last);
+        }
+
+        HardwareBufferLockGuard l(buffer);
+        buffer.allocate(indexes.size() * sizeof(std::uint32_t), indexes.empty() ? nullptr : indexes.data());
+
+        return indexes.size();
+    }
+}
@@ -0,0 +1,157 @@
+//
+//  StaticBatch.h
+//  atlre
+//
+//  Created by jacques tronconi on 22/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#ifndef ATL_STATICBATCH_H
+#define ATL_STATICBATCH_H
+
+#include "Platform.h"
+#include "Renderable.h"
+#include "SubModel.h"
+#include "Frustum.h"
+#include "AABB.h"
+
+#include <vector>
+
+namespace Atl
+{
+    class RenderNode;
+    class StaticBatch;
+
+    //! @brief Pointer to a StaticBatch.
+    typedef std::shared_ptr < StaticBatch > StaticBatchPtr;
+
+    //! @brief A list of StaticBatch.
+    typedef std::vector < StaticBatchPtr > StaticBatchList;
+
+    //! @brief The geometry of several RenderNodes merged by a StaticBatcher in a single SubModel,
+    //! in world space, drawn with one DrawIndexedArraysCommand.
+    //!
+    //! The indexes of each merged node are kept as a range, with the world AABB of its vertexes.
+    //! \ref renderSync(to, frustum) drops the ranges outside the Frustum it is given, so each
+    //! Camera and Renderer culls the batch on its own. The visible ranges are drawn from a view:
+    //! a SubModel sharing the merged vertexes, whose index buffer holds the indexes of these
+    //! ranges only. The views are kept for their set of visible ranges, so a static level mostly
+    //! draws the views of the previous frame, and indexes are uploaded only when a Camera sees
+    //! a new set. A view is never rewritten: a new set gets a new view, and beyond
+    //! \ref ViewsCapacity sets the least recently drawn view is dropped, while the renders
+    //! drawing it keep it alive. Until the indexes of a new view are uploaded, every range is
+    //! drawn instead.
+    class EXPORTED StaticBatch : public Renderable
+    {
+    public:
+
+        //! @brief The indexes of a merged node.
+        struct Range
+        {
+            //! @brief The node whose geometry is in this range.
+            std::weak_ptr < RenderNode > node;
+
+            //! @brief The world AABB of the vertexes of this range.
+            AABB bounds;
+
+            //! @brief The first index of this range in \ref indexes().
+            std::uint32_t first;
+
+            //! @brief The number of indexes in this range.
+            std::uint32_t count;
+        };
+
+        //! @brief The maximum number of views kept by a batch.
+        static constexpr std::size_t ViewsCapacity = 4;
+
+    private:
+
+        //! @brief The ranges drawn for a Camera. Only lastUse changes once created.
+        struct View
+        {
+            //! @brief True for each range drawn by this view.
+            const std::vector < bool > visible;
+
+            //! @brief The merged vertexes, with the indexes of the visible ranges.
+            const SubModelPtr subModel;
+
+            //! @brief The value of mUses when this view was last drawn. Protected by mMutex.
+            std::uint64_t lastUse;
+        };
+
+        //! @brief A pointer to a View, which keeps it while it is drawn.
+        typedef std::shared_ptr < View > ViewPtr;
+
+        //! @brief Protects mViews and mUses.
+        mutable std::mutex mMutex;
+
+        //! @brief The merged geometry, drawing every range.
+        SubModelPtr mSubModel;
+
+        //! @brief The index buffer of mSubModel.
+        MemBufferPtr mDrawIndexes;
+
+        //! @brief Every index, range after range.
+        std::vector < std::uint32_t > mIndexes;
+
+        //! @brief The ranges, in the order of their indexes.
+        std::vector < Range > mRanges;
+
+        //! @brief The views drawing a part of the ranges, at most ViewsCapacity.
+        mutable std::vector < ViewPtr > mViews;
+
+        //! @brief The number of views drawn, used to find the least recently drawn one.
+        mutable std::uint64_t mUses;
+
+        //! @brief The union of the ranges bounds.
+        AABB mBounds;
+
+    public:
+        ATL_SHAREABLE(StaticBatch)
+
+        //! @brief Constructs a batch.
+        //! @param subModel The merged geometry. Its IndexBufferData is replaced by the batch's
+        //! one, of type IndexType::UInt.
+        //! @param indexes Every index, range after range, already rebased on the merged vertexes.
+        //! @param ranges The ranges in indexes. They must follow each other.
+        StaticBatch(const SubModelPtr& subModel, std::vector < std::uint32_t > indexes, std::vector < Range > ranges);
+
+        //! @brief Renders every range.
+        virtual void renderSync(RenderCommand& to) const;
+
+        //! @brief Renders the ranges whose bounds are in the Frustum, if any.
+        void renderSync(RenderCommand& to, const Frustum& frustum) const;
+
+        //! @brief Builds the SubModel.
+        virtual void buildSync(Renderer& rhs);
+
+        //! @brief Returns the size of the SubModel's buffers.
+        virtual std::size_t size(Renderer& rhs) const;
+
+        //! @brief Returns the merged geometry, drawing every range.
+        SubModelPtr subModel() const;
+
+        //! @brief Returns every index of the batch.
+        const std::vector < std::uint32_t >& indexes() const;
+
+        //! @brief Returns the number of ranges.
+        std::size_t rangesCount() const;
+
+        //! @brief Returns the range at given index.
+        const Range& rangeAt(std::size_t idx) const;
+
+        //! @brief Returns the world AABB of every range.
+        const AABB& aabb() const;
+
+    private:
+
+        //! @brief Returns the view drawing the visible ranges, creating it if no view draws them.
+        //! A view created beyond ViewsCapacity replaces the least recently drawn one.
+        ViewPtr viewSync(const std::vector < bool >& visible) const;
+
+        //! @brief Writes the indexes of the visible ranges in a buffer, and returns their number.
+        std::size_t writeIndexes(const std::vector < bool >& visible, MemBuffer& buffer) const;
+    };
+}
+
+#endif // ATL_STATICBATCH_H
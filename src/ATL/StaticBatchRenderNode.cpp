@@ -0,0 +1,62 @@
+//
+//  StaticBatchRenderNode.cpp
+//  atlre
+//
+//  Created by jacques tronconi on 22/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#include "StaticBatchRenderNode.h"
+
+namespace Atl
+{
+    StaticBatchRenderNode::StaticBatchRenderNode(const Node::Shared& node,
+        const StaticBatchPtr& batch,
+        const std::size_t& maxChildren,
+        const std::size_t& maxRenderables)
+    : RenderNode(node, maxChildren, maxRenderables), mBatch(batch)
+    {
+        if (!batch)
+            throw NullError("StaticBatchRenderNode", "StaticBatchRenderNode", "Null StaticBatch passed.");
+
+        addRenderable(batch);
+    }
+
+    StaticBatchPtr StaticBatchRenderNode::batch() const
+    {
+        return mBatch;
+    }
+
+    bool StaticBatchRenderNode::localAABB(AABB& result) const
+    {
+        if (!mBatch->rangesCount())
+            return false;
+
+        result = mBatch->aabb();
+        return true;
+    }
+
+    void StaticBatchRenderNode::renderPartsSync(RenderCommand& command, const Frustum& frustum, std::size_t) const
+    {
+        RenderCommand& target = prepareRenderSync(command);
+        RenderableList renderables;
+
+        {
+            std::lock_guard l(mMutex);
+            renderables = mRenderables;
+        }
+
+        for (const RenderablePtr& renderable : renderables)
+        {
+            if (renderable == mBatch)
+                mBatch->renderSync(target, frustum);
+            else if (renderable)
+                renderable->renderSync(target);
+        }
+    }
+
+    bool StaticBatchRenderNode::bundleVariant(std::uint64_t&) const
+    {
+        return false;
+    }
+}
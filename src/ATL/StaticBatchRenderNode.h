@@ -0,0 +1,66 @@
+//
+//  StaticBatchRenderNode.h
+//  atlre
+//
+//  Created by jacques tronconi on 22/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#ifndef ATL_STATICBATCHRENDERNODE_H
+#define ATL_STATICBATCHRENDERNODE_H
+
+#include "RenderNode.h"
+#include "StaticBatch.h"
+
+namespace Atl
+{
+    //! @brief Defines a RenderNode with a StaticBatch.
+    //! The batch's vertexes are already in world space, so this node must not be transformed by
+    //! a Transformation of its own or of its parents. The RenderTechnique renders it with
+    //! \ref renderPartsSync(), which draws only the batch's ranges in its Frustum.
+    class EXPORTED StaticBatchRenderNode : virtual public RenderNode
+    {
+        //! @brief The StaticBatch in this node.
+        StaticBatchPtr mBatch;
+
+    public:
+        ATL_SHAREABLE(StaticBatchRenderNode)
+
+        //! @brief Constructs a new StaticBatchRenderNode.
+        //! @param node The node's parent. \see Node::Node.
+        //! @param batch The batch for this node.
+        //! @param maxChildren Maximum number of children in this node. Default value
+        //! is zero, meaning unlimited.
+        //! @param maxRenderables Maximum number of renderables in this node. Default 
+        //! value is zero, meaning unlimited.
+        StaticBatchRenderNode(const Node::Shared& node,
+            const StaticBatchPtr& batch,
+            const std::size_t& maxChildren = 0,
+            const std::size_t& maxRenderables = 0);
+
+        //! @brief Destructs the node.
+        virtual ~StaticBatchRenderNode() = default;
+
+        //! @brief Returns the batch in this Node.
+        virtual StaticBatchPtr batch() const;
+
+        //! @brief Returns the AABB of the batch.
+        virtual bool localAABB(AABB& result) const;
+
+        //! @brief Renders the ranges of the batch in the Frustum, and the other renderables
+        //! normally. The batch has no levels of detail, so lod is ignored.
+        //! \see StaticBatch::renderSync(to, frustum).
+        virtual void renderPartsSync(RenderCommand& command, const Frustum& frustum, std::size_t lod = 0) const;
+
+    protected:
+
+        //! @brief Returns false, as \ref renderPartsSync() draws another view of the batch for
+        //! each Frustum.
+        virtual bool bundleVariant(std::uint64_t& variant) const;
+    };
+
+    //! @brief Pointer to StaticBatchRenderNode.
+    typedef std::shared_ptr < StaticBatchRenderNode > StaticBatchRenderNodePtr;
+}
+
+#endif // ATL_STATICBATCHRENDERNODE_H
@@ -0,0 +1,450 @@
+//
+//  StaticBatcher.cpp
+//  atlre
+//
+//  Created by jacques tronconi on 22/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#include "StaticBatcher.h"
+#include "ModelRenderNode.h"
+#include "Transformation.h"
+
+#include <limits>
+#include <map>
+#include <set>
+
+namespace Atl
+{
+    namespace
+    {
+        //! @brief Returns a string equal for two declarations with the same elements.
+        std::string Signature(const VertexDeclaration& declaration)
+        {
+            std::string result;
+
+            for (unsigned i = 0; i < declaration.elementsCount(); ++i)
+            {
+                const VertexElement& element = declaration.findElement(i);
+
+                result += std::to_string(element.source()) + ':' + std::to_string(element.offset()) + ':'
+                        + std::to_string(static_cast < int >(element.type())) + ':' + element.meaning() + ';';
+            }
+
+            return result;
+        }
+
+        //! @brief Returns the sources used by a declaration.
+        std::set < unsigned short > Sources(const VertexDeclaration& declaration)
+        {
+            std::set < unsigned short > result;
+
+            for (unsigned i = 0; i < declaration.elementsCount(); ++i)
+                result.insert(declaration.findElement(i).source());
+
+            return result;
+        }
+
+        //! @brief Returns true if a position element of this type can be transformed.
+        bool IsTransformable(VertexElementType type)
+        {
+            return type == VertexElementType::Float3 || type == VertexElementType::Float4
+                || type == VertexElementType::Double3 || type == VertexElementType::Double4;
+        }
+
+        //! @brief Transforms count positions of Components values of type T, the first one at
+        //! data, and each one stride bytes after the previous one. Returns their bounds.
+        template < typename T, unsigned Components >
+        AABB TransformPositions(char* data, std::size_t stride, std::size_t count, const rmat4x4& matrix)
+        {
+            const Real maximum = std::numeric_limits < Real >::max();
+            rvec3 minp(maximum, maximum, maximum);
+            rvec3 maxp(-maximum, -maximum, -maximum);
+
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                T* position = reinterpret_cast < T* >(data + i * stride);
+                const Real w = Components > 3 ? (Real)position[3] : Real(1);
+                const rvec4 value = matrix * rvec4((Real)position[0], (Real)position[1], (Real)position[2], w);
+
+                position[0] = (T)value.x;
+                position[1] = (T)value.y;
+                position[2] = (T)value.z;
+
+                if constexpr (Components > 3)
+                    position[3] = (T)value.w;
+
+                const rvec3 point(value.x, value.y, value.z);
+                minp = glm::min(minp, point);
+                maxp = glm::max(maxp, point);
+            }
+
+            return AABB{ minp, maxp };
+        }
+
+        //! @brief Transforms count normals of three floats by the inverse transpose of matrix,
+        //! and normalizes them.
+        void TransformNormals(char* data, std::size_t stride, std::size_t count, const rmat4x4& matrix)
+        {
+            const rmat4x4 normalMatrix = glm::transpose(glm::inverse(matrix));
+
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                float* normal = reinterpret_cast < float* >(data + i * stride);
+                const rvec4 value = normalMatrix * rvec4(normal[0], normal[1], normal[2], 0);
+                rvec3 result(value.x, value.y, value.z);
+
+                if (glm::length(result) > 0)
+                    result = glm::normalize(result);
+
+                normal[0] = (float)result.x;
+                normal[1] = (float)result.y;
+                normal[2] = (float)result.z;
+            }
+        }
+
+        //! @brief Appends count indexes of type T at data to result, plus base.
+        template < typename T >
+        void AppendIndexes(const char* data, std::size_t count, std::uint32_t base, std::vector < std::uint32_t >& result)
+        {
+            const T* indexes = reinterpret_cast < const T* >(data);
+
+            for (std::size_t i = 0; i < count; ++i)
+                result.push_back(base + static_cast < std::uint32_t >(indexes[i]));
+        }
+
+        //! @brief Returns the size of an index.
+        std::size_t IndexSize(IndexType type)
+        {
+            switch (type)
+            {
+                case IndexType::UChar: return sizeof(std::uint8_t);
+                case IndexType::UShort: return sizeof(std::uint16_t);
+                default: return sizeof(std::uint32_t);
+            }
+        }
+    }
+
+    bool StaticBatcher::add(const RenderNodePtr& node)
+    {
+        ModelRenderNodePtr modelNode = std::dynamic_pointer_cast < ModelRenderNode >(node);
+
+        if (!modelNode)
+            return false;
+
+        ModelPtr model = modelNode->model();
+
+        if (!model)
+            return false;
+
+        // The merged geometry is drawn without the node, so nothing else may be rendered with it.
+
+        const std::size_t renderablesCount = node->renderablesCount();
+
+        for (std::size_t i = 0; i < renderablesCount; ++i)
+        {
+            const Renderable& renderable = node->renderableAt(i);
+
+            if (&renderable != model.get() && !dynamic_cast < const Transformation* >(&renderable))
+                return false;
+        }
+
+        const SubModelList subModels = model->subModels();
+        std::vector < Source > sources;
+
+        for (const SubModelPtr& subModel : subModels)
+        {
+            if (!subModel)
+                continue;
+
+            SubModelLockGuard l(*subModel);
+
+            const VertexInfos& infos = subModel->vertexInfos();
+            VertexDeclarationPtr declaration = infos.declaration();
+            VertexBufferBindingPtr binding = infos.binding();
+
+            if (!infos.vertexesCount())
+                continue;
+
+            if (!declaration || !binding)
+                return false;
+
+            MaterialPtr material = subModel->material();
+
+            if (material && material->isTransparent())
+                return false;
+
+            try
+            {
+                if (!IsTransformable(declaration->findElement(SubModel::PositionMeaning).type()))
+                    return false;
+            }
+
+            catch(OutOfRange const&)
+            {
+                return false;
+            }
+
+            for (unsigned short source : Sources(*declaration))
+            {
+                if (!binding->isBufferBound(source) || !binding->bufferAt(source))
+                    return false;
+            }
+
+            sources.push_back(Source{ node, subModel, rmat4x4() });
+        }
+
+        const rmat4x4 matrix = node->worldMatrix();
+
+        for (Source& source : sources)
+        {
+            source.matrix = matrix;
+            mSources.push_back(source);
+        }
+
+        return true;
+    }
+
+    std::size_t StaticBatcher::addTree(const RenderNodePtr& root)
+    {
+        if (!root)
+            throw NullError("StaticBatcher", "addTree", "Null root passed.");
+
+        std::size_t count = root->isStatic() && add(root) ? 1 : 0;
+        const std::size_t childrenCount = root->childrenCount();
+
+        for (unsigned i = 0; i < childrenCount; ++i)
+        {
+            RenderNodePtr child = std::dynamic_pointer_cast < RenderNode >(root->childAt(i).shared_from_this());
+
+            if (!child)
+                throw NullError("StaticBatcher", "addTree", "Node isn't castable to RenderNode.");
+
+            count += addTree(child);
+        }
+
+        return count;
+    }
+
+    StaticBatchList StaticBatcher::build(Model& owner)
+    {
+        // Groups keep the order of the sources, so the ranges of a node follow each other.
+
+        std::map < std::pair < std::string, const Material* >, std::size_t > groupsIndex;
+        std::vector < std::vector < std::size_t > > groups;
+
+        for (std::size_t i = 0; i < mSources.size(); ++i)
+        {
+            const SubModel& subModel = *mSources[i].subModel;
+            MaterialPtr material = subModel.material();
+
+            auto key = std::make_pair(Signature(*subModel.vertexInfos().declaration()), (const Material*)material.get());
+            auto it = groupsIndex.find(key);
+
+            if (it == groupsIndex.end())
+            {
+                it = groupsIndex.emplace(key, groups.size()).first;
+                groups.emplace_back();
+            }
+
+            groups[it->second].push_back(i);
+        }
+
+        StaticBatchList batches;
+        batches.reserve(groups.size());
+
+        for (const std::vector < std::size_t >& group : groups)
+            batches.push_back(merge(owner, group));
+
+        mSources.clear();
+        return batches;
+    }
+
+    std::vector < StaticBatchRenderNodePtr > StaticBatcher::buildNodes(Model& owner, const RenderNodePtr& parent)
+    {
+        if (!parent)
+            throw NullError("StaticBatcher", "buildNodes", "Null parent passed.");
+
+        std::vector < StaticBatchRenderNodePtr > nodes;
+
+        for (const StaticBatchPtr& batch : build(owner))
+        {
+            StaticBatchRenderNodePtr node = StaticBatchRenderNode::New(parent, batch);
+
+            if (MaterialPtr material = batch->subModel()->material())
+                node->insertRenderable(0, material);
+
+            parent->addChild(node);
+            nodes.push_back(node);
+        }
+
+        return nodes;
+    }
+
+    void StaticBatcher::clear()
+    {
+        mSources.clear();
+    }
+
+    std::size_t StaticBatcher::sourcesCount() const
+    {
+        return mSources.size();
+    }
+
+    StaticBatchPtr StaticBatcher::merge(Model& owner, const std::vector < std::size_t >& sources) const
+    {
+        const SubModel& front = *mSources[sources.front()].subModel;
+
+        VertexDeclarationPtr declaration = front.vertexInfos().declaration();
+        const VertexElement position = declaration->findElement(SubModel::PositionMeaning);
+
+        VertexElement normal;
+        bool hasNormal = false;
+
+        try
+        {
+            normal = declaration->findElement(NormalMeaning);
+            hasNormal = normal.type() == VertexElementType::Float3 || normal.type() == VertexElementType::Float4;
+        }
+
+        catch(OutOfRange const&)
+        {
+            hasNormal = false;
+        }
+
+        std::map < unsigned short, std::vector < char > > vertexes;
+
+        for (unsigned short source : Sources(*declaration))
+            vertexes[source];
+
+        std::vector < std::uint32_t > indexes;
+        std::vector < StaticBatch::Range > ranges;
+        std::size_t vertexesCount = 0;
+
+        for (std::size_t idx : sources)
+        {
+            const Source& source = mSources[idx];
+            SubModelLockGuard l(*source.subModel);
+
+            const VertexInfos& infos = source.subModel->vertexInfos();
+            const std::size_t count = infos.vertexesCount();
+
+            // Copies the vertexes of each source after the previous ones.
+
+            for (auto& pair : vertexes)
+            {
+                const std::size_t stride = declaration->vertexSizeForSource(pair.first);
+                const std::size_t offset = infos.baseVertex() * stride;
+
+                HardwareBufferPtr buffer = infos.binding()->bufferAt(pair.first);
+                const std::size_t bufferSize = buffer->size();
+
+                if (offset + count * stride > bufferSize)
+                    throw OutOfRange("StaticBatcher", "merge", "%i vertexes don't fit in buffer of %i bytes.",
+                                     (int)count, (int)bufferSize);
+
+                HardwareBufferLockGuard bl(*buffer);
+
+                const HardwareBuffer& vertexBuffer = *buffer;
+                const char* data = reinterpret_cast < const char* >(vertexBuffer.data()) + offset;
+                pair.second.insert(pair.second.end(), data, data + count * stride);
+
+                buffer->undata();
+            }
+
+            // Then transforms them in world space.
+
+            const std::size_t positionStride = declaration->vertexSizeForSource(position.source());
+            char* positions = vertexes[position.source()].data() + vertexesCount * positionStride + position.offset();
+            AABB bounds;
+
+            switch (position.type())
+            {
+                case VertexElementType::Float3: bounds = TransformPositions < float, 3 >(positions, positionStride, count, source.matrix); break;
+                case VertexElementType::Float4: bounds = TransformPositions < float, 4 >(positions, positionStride, count, source.matrix); break;
+                case VertexElementType::Double3: bounds = TransformPositions < double, 3 >(positions, positionStride, count, source.matrix); break;
+                default: bounds = TransformPositions < double, 4 >(positions, positionStride, count, source.matrix); break;
+            }
+
+            if (hasNormal)
+            {
+                const std::size_t normalStride = declaration->vertexSizeForSource(normal.source());
+                char* normals = vertexes[normal.source()].data() + vertexesCount * normalStride + normal.offset();
+                TransformNormals(normals, normalStride, count, source.matrix);
+            }
+
+            // Indexes are rebased on the first merged vertex of this source.
+
+            const std::size_t first = indexes.size();
+            const std::uint32_t base = static_cast < std::uint32_t >(vertexesCount);
+
+            if (source.subModel->hasIndexes())
+            {
+                const IndexBufferData& indexData = source.subModel->indexes();
+                const std::size_t indexesCount = indexData.elementsCount();
+
+                HardwareBufferPtr buffer = indexData.buffer();
+
+                if (!buffer)
+                    throw NullError("StaticBatcher", "merge", "Null index buffer.");
+
+                const std::size_t bufferSize = buffer->size();
+
+                if (indexesCount * IndexSize(indexData.type()) > bufferSize)
+                    throw OutOfRange("StaticBatcher", "merge", "%i indexes don't fit in buffer of %i bytes.",
+                                     (int)indexesCount, (int)bufferSize);
+
+                HardwareBufferLockGuard bl(*buffer);
+                const HardwareBuffer& indexBuffer = *buffer;
+                const char* data = reinterpret_cast < const char* >(indexBuffer.data());
+
+                switch (indexData.type())
+                {
+                    case IndexType::UChar: AppendIndexes < std::uint8_t >(data, indexesCount, base, indexes); break;
+                    case IndexType::UShort: AppendIndexes < std::uint16_t >(data, indexesCount, base, indexes); break;
+                    default: AppendIndexes < std::uint32_t >(data, indexesCount, base, indexes); break;
+                }
+
+                buffer->undata();
+            }
+
+            else
+            {
+                for (std::size_t i = 0; i < count; ++i)
+                    indexes.push_back(base + static_cast < std::uint32_t >(i));
+            }
+
+            // Two SubModels of the same node make a single range.
+
+            const std::uint32_t indexesAdded = static_cast < std::uint32_t >(indexes.size() - first);
+
+            if (!ranges.empty() && ranges.back().node.lock() == source.node
+                && ranges.back().first + ranges.back().count == first)
+            {
+                ranges.back().count += indexesAdded;
+                ranges.back().bounds.merge(bounds);
+            }
+
+            else
+            {
+                ranges.push_back(StaticBatch::Range{ source.node, bounds, static_cast < std::uint32_t >(first), indexesAdded });
+            }
+
+            vertexesCount += count;
+        }
+
+        VertexBufferBindingPtr binding = VertexBufferBinding::New();
+
+        for (auto& pair : vertexes)
+        {
+            MemBufferPtr buffer = std::make_shared < MemBuffer >(HBT::Vertex);
+            buffer->allocate(pair.second.size(), pair.second.data());
+            binding->set(pair.first, buffer);
+        }
+
+        VertexInfosPtr infos = VertexInfos::New(declaration, binding, 0, vertexesCount);
+        SubModelPtr subModel = SubModel::New(owner, infos, front.material());
+
+        return StaticBatch::New(subModel, std::move(indexes), std::move(ranges));
+    }
+}
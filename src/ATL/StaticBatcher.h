@@ -0,0 +1,95 @@
+//
+//  StaticBatcher.h
+//  atlre
+//
+//  Created by jacques tronconi on 22/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#ifndef ATL_STATICBATCHER_H
+#define ATL_STATICBATCHER_H
+
+#include "Platform.h"
+#include "StaticBatchRenderNode.h"
+#include "Model.h"
+
+#include <vector>
+
+namespace Atl
+{
+    class StaticBatcher;
+
+    //! @brief Pointer to a StaticBatcher.
+    typedef std::shared_ptr < StaticBatcher > StaticBatcherPtr;
+
+    //! @brief Merges the geometry of static ModelRenderNodes into StaticBatches, at load time.
+    //!
+    //! SubModels with the same VertexDeclaration (same elements, offsets and types) and the
+    //! same Material go in the same batch. Their vertexes are copied in one MemBuffer per source,
+    //! with the \ref SubModel::PositionMeaning and \ref NormalMeaning elements transformed by
+    //! the node's world matrix, and their indexes are rebased on the merged vertexes in one
+    //! IndexType::UInt buffer. SubModels without indexes get one index per vertex.
+    //!
+    //! The merged nodes are not modified: they are usually removed from the scene, or hidden,
+    //! once their batches are added to it.
+    class EXPORTED StaticBatcher
+    {
+    public:
+
+        //! @brief The meaning of the VertexElement transformed as a normal. The element must be
+        //! a Float3 or Float4 element.
+        static constexpr const char* NormalMeaning = "normal";
+
+    private:
+
+        //! @brief A SubModel to merge, and the matrix of its node.
+        struct Source
+        {
+            RenderNodePtr node;
+            SubModelPtr subModel;
+            rmat4x4 matrix;
+        };
+
+        //! @brief The SubModels added since the last build, node after node.
+        std::vector < Source > mSources;
+
+    public:
+        ATL_SHAREABLE(StaticBatcher)
+
+        //! @brief Constructs an empty batcher.
+        StaticBatcher() = default;
+
+        //! @brief Adds the SubModels of a node's Model, at level 0. Returns false if the node is
+        //! not a ModelRenderNode, if it has other renderables than its Model and Transformations,
+        //! or if one of its SubModels has a transparent Material or a position element which
+        //! can't be transformed.
+        bool add(const RenderNodePtr& node);
+
+        //! @brief Adds every node of a tree whose \ref RenderNode::isStatic() is true. Returns
+        //! the number of nodes added.
+        std::size_t addTree(const RenderNodePtr& root);
+
+        //! @brief Merges the added SubModels and removes them from the batcher.
+        //! @param owner The Model the merged SubModels are created for. They are not added to it.
+        StaticBatchList build(Model& owner);
+
+        //! @brief Merges the added SubModels, and adds a StaticBatchRenderNode for each batch to
+        //! parent. The node renders the batch's Material before the batch.
+        //! @param owner The Model the merged SubModels are created for. They are not added to it.
+        //! @param parent The node where to add the batches. It must not be transformed.
+        std::vector < StaticBatchRenderNodePtr > buildNodes(Model& owner, const RenderNodePtr& parent);
+
+        //! @brief Removes the added SubModels.
+        void clear();
+
+        //! @brief Returns the number of SubModels added since the last build.
+        std::size_t sourcesCount() const;
+
+    private:
+
+        //! @brief Merges the sources at given indexes in mSources into a batch.
+        StaticBatchPtr merge(Model& owner, const std::vector < std::size_t >& sources) const;
+    };
+}
+
+#endif // ATL_STATICBATCHER_H
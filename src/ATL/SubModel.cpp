@@ -8,24 +8,97 @@
 #include "SubModel.h"
 #include "SubModelRenderCache.h"
 
+#include <limits>
+
+#if !defined(ATL_REAL_AS_DOUBLE)
+#   if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#       define ATL_SUBMODEL_SSE
+#       include <emmintrin.h>
+#   endif
+#endif
+
 namespace Atl
 {
+    namespace
+    {
+        //! @brief Computes the bounds of count positions of Components values of type T, the
+        //! first one at data, and each one stride bytes after the previous one. Missing 
+        //! components are zero.
+        template < typename T, unsigned Components >
+        AABB ReducePositions(const char* data, std::size_t stride, std::size_t count)
+        {
+            const Real maximum = std::numeric_limits < Real >::max();
+            rvec3 minp(maximum, maximum, maximum);
+            rvec3 maxp(-maximum, -maximum, -maximum);
+
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                const T* position = reinterpret_cast < const T* >(data + i * stride);
+                rvec3 value((Real)position[0], (Real)position[1], 0);
+
+                if constexpr (Components > 2)
+                    value.z = (Real)position[2];
+
+                minp = glm::min(minp, value);
+                maxp = glm::max(maxp, value);
+            }
+
+            return AABB{ minp, maxp };
+        }
+
+#if defined(ATL_SUBMODEL_SSE)
+        //! @brief SSE version of ReducePositions() for Float3 and Float4 positions. The fourth
+        //! lane is ignored: Float3 positions are loaded with two loads so we never read past
+        //! the end of the buffer.
+        template < unsigned Components >
+        AABB ReducePositionsSSE(const char* data, std::size_t stride, std::size_t count)
+        {
+            __m128 minp = _mm_set1_ps(std::numeric_limits < float >::max());
+            __m128 maxp = _mm_set1_ps(-std::numeric_limits < float >::max());
+
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                const float* position = reinterpret_cast < const float* >(data + i * stride);
+                __m128 value;
+
+                if (Components == 4)
+                    value = _mm_loadu_ps(position);
+                else
+                    value = _mm_movelh_ps(_mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast < const __m64* >(position)),
+                                          _mm_load_ss(position + 2));
+
+                minp = _mm_min_ps(minp, value);
+                maxp = _mm_max_ps(maxp, value);
+            }
+
+            alignas(16) float minValues[4];
+            alignas(16) float maxValues[4];
+            _mm_store_ps(minValues, minp);
+            _mm_store_ps(maxValues, maxp);
+
+            return AABB{ rvec3(minValues[0], minValues[1], minValues[2]), 
+                         rvec3(maxValues[0], maxValues[1], maxValues[2]) };
+        }
+#endif
+    }
+
     SubModel::SubModel(Model& model)
-    : mModel(model)
+    : mModel(model), mHasAABB(false), mAABBDirty(true)
     {
         mVertexInfos = VertexInfos::New();
         mIndexes = IndexBufferData::New();
     }
     
     SubModel::SubModel(Model& model, const VertexInfosPtr& vBuffers, const MaterialPtr& material)
-    : mModel(model), mVertexInfos(vBuffers), mMaterial(material), mIndexes(nullptr)
+    : mModel(model), mVertexInfos(vBuffers), mMaterial(material), mIndexes(nullptr),
+    mHasAABB(false), mAABBDirty(true)
     {
         mIndexes = IndexBufferData::New();
         if (!vBuffers) throw NullError("SubModel", "SubModel", "Null VertexInfos Pointer.");
     }
     
     SubModel::SubModel(Model& model, const SubModel& rhs)
-    : mModel(model)
+    : mModel(model), mHasAABB(false), mAABBDirty(true)
     {
         SubModelLockGuard l(const_cast < SubModel& >(rhs));
         mVertexInfos = rhs.mVertexInfos;
@@ -39,6 +112,9 @@ namespace Atl
         std::swap(mVertexInfos, rhs.mVertexInfos);
         std::swap(mMaterial, rhs.mMaterial);
         std::swap(mIndexes, rhs.mIndexes);
+
+        mAABBDirty = true;
+        rhs.mAABBDirty = true;
     }
     
     void SubModel::setMaterial(const MaterialPtr& material)
@@ -50,6 +126,11 @@ namespace Atl
     {
         return std::atomic_load(&mMaterial);
     }
+
+    Model& SubModel::model() const
+    {
+        return mModel;
+    }
     
     void SubModel::lock() const
     {
@@ -123,4 +204,102 @@ namespace Atl
     {
         return SubModelRenderCache::New(rhs, *this);
     }
+
+    void SubModel::touch()
+    {
+        CachedRenderable::touch();
+        mAABBDirty = true;
+    }
+
+    bool SubModel::hasAABB() const
+    {
+        updateAABB();
+
+        std::lock_guard l(mMutex);
+        return mHasAABB;
+    }
+
+    AABB SubModel::aabb() const
+    {
+        updateAABB();
+
+        std::lock_guard l(mMutex);
+        return mAABB;
+    }
+
+    void SubModel::updateAABB() const
+    {
+        // The flag is cleared with mMutex held, so a concurrent caller waits for the bounds
+        // instead of reading the previous ones.
+
+        std::lock_guard l(mMutex);
+
+        if (!mAABBDirty.exchange(false))
+            return;
+
+        mHasAABB = false;
+
+        VertexInfosPtr vertexInfos = std::atomic_load(&mVertexInfos);
+
+        if (!vertexInfos || !vertexInfos->declaration() || !vertexInfos->binding())
+            return;
+
+        VertexElement element;
+
+        try
+        {
+            element = vertexInfos->declaration()->findElement(PositionMeaning);
+        }
+
+        catch(OutOfRange const&)
+        {
+            // No position, no AABB.
+            return;
+        }
+
+        if (!vertexInfos->binding()->isBufferBound(element.source()))
+            return;
+
+        HardwareBufferPtr buffer = vertexInfos->binding()->bufferAt(element.source());
+        const std::size_t count = vertexInfos->vertexesCount();
+
+        if (!buffer || !count)
+            return;
+
+        const std::size_t stride = vertexInfos->declaration()->vertexSizeForSource(element.source());
+        const std::size_t offset = vertexInfos->baseVertex() * stride + element.offset();
+
+        // MemBuffer::size() takes the buffer's mutex, so it is read before locking.
+
+        const std::size_t bufferSize = buffer->size();
+
+        if (offset + (count - 1) * stride + element.size() > bufferSize)
+            throw OutOfRange("SubModel", "updateAABB", "%i vertexes don't fit in buffer of %i bytes.",
+                             (int)count, (int)bufferSize);
+
+        buffer->lock();
+
+        const HardwareBuffer& source = *buffer;
+        const char* data = reinterpret_cast < const char* >(source.data()) + offset;
+        mHasAABB = true;
+
+        switch (element.type())
+        {
+#if defined(ATL_SUBMODEL_SSE)
+            case VertexElementType::Float3: mAABB = ReducePositionsSSE < 3 >(data, stride, count); break;
+            case VertexElementType::Float4: mAABB = ReducePositionsSSE < 4 >(data, stride, count); break;
+#else
+            case VertexElementType::Float3: mAABB = ReducePositions < float, 3 >(data, stride, count); break;
+            case VertexElementType::Float4: mAABB = ReducePositions < float, 4 >(data, stride, count); break;
+#endif
+            case VertexElementType::Float2: mAABB = ReducePositions < float, 2 >(data, stride, count); break;
+            case VertexElementType::Double2: mAABB = ReducePositions < double, 2 >(data, stride, count); break;
+            case VertexElementType::Double3: mAABB = ReducePositions < double, 3 >(data, stride, count); break;
+            case VertexElementType::Double4: mAABB = ReducePositions < double, 4 >(data, stride, count); break;
+            default: mHasAABB = false; break;
+        }
+
+        buffer->undata();
+        buffer->unlock();
+    }
 }
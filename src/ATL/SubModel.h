@@ -14,6 +14,9 @@
 #include "RenderCommand.h"
 #include "IndexBufferData.h"
 #include "Material.h"
+#include "AABB.h"
+
+#include <algorithm>
 
 namespace Atl
 {
@@ -63,9 +66,22 @@ namespace Atl
         
         //! @brief Holds the data for indexes.
         IndexBufferDataPtr mIndexes;
+
+        //! @brief The bounds of the \ref PositionMeaning element, in model space.
+        mutable AABB mAABB;
+
+        //! @brief True if mAABB is relevant.
+        mutable bool mHasAABB;
+
+        //! @brief True if mAABB must be computed again. Set by \ref touch().
+        mutable std::atomic < bool > mAABBDirty;
         
     public:
         ATL_SHAREABLE(SubModel)
+
+        //! @brief The meaning of the VertexElement used to compute the AABB. The element must
+        //! be a Float2, Float3, Float4, Double2, Double3 or Double4 element.
+        static constexpr const char* PositionMeaning = "position";
         
         //! @brief Constructs an empty SubModel.
         //! @param model The Model for which this SubModel is for.
@@ -102,6 +118,9 @@ namespace Atl
         
         //! @brief Returns the Material used with this SubModel.
         MaterialPtr material() const;
+
+        //! @brief Returns the Model this SubModel is for.
+        Model& model() const;
         
         //! @brief Locks the SubModel in order to work on data.
         void lock() const;
@@ -161,6 +180,23 @@ namespace Atl
 
         //! @brief Creates a new SubModelRenderCache. 
         virtual RenderCachePtr < SubModel > makeNewCache(Renderer& rhs);
+
+        //! @brief Touches the caches and marks the AABB to be computed again.
+        virtual void touch();
+
+        //! @brief Returns true if this SubModel has a \ref PositionMeaning element with at 
+        //! least one vertex.
+        bool hasAABB() const;
+
+        //! @brief Returns the bounds of the \ref PositionMeaning element, in model space.
+        //! The bounds are computed the first time they are needed after a \ref touch(), 
+        //! with SIMD instructions when the positions are floats.
+        AABB aabb() const;
+
+    protected:
+
+        //! @brief Computes \ref mAABB if it is dirty.
+        void updateAABB() const;
         
     public:
         
@@ -184,45 +220,75 @@ namespace Atl
          */
 
         //! @brief Iterates through Vertex Elements in a SubModel.
+        //!
+        //! The buffer is locked by \ref bufferElement() and unlocked by \ref undata(), or when
+        //! the iterator is destroyed. The elements accessed with \ref data() are marked dirty in
+        //! the buffer by \ref undata(), as one range from the first to the last of them, so
+        //! the render caches upload only this range. A copy of an iterator doesn't unlock the
+        //! buffer, but marks its own elements.
         template < typename T >
         class VertexElementIterator
         {
             std::string mName;
             SubModel& mSubModel;
-            char *mStart, *mEnd, *mCurr;
+            char *mBase, *mStart, *mEnd, *mCurr;
             size_t mStride;
+            size_t mElementSize;
             HardwareBufferPtr mBuffer;
+
+            //! @brief The range of the elements accessed with data(), or null.
+            char *mWrittenBegin, *mWrittenEnd;
+
+            //! @brief True if this iterator must unlock mBuffer.
+            bool mOwnsLock;
             
         public:
             
             VertexElementIterator(const std::string& name, SubModel& subModel)
-            : mName(name), mSubModel(subModel)
+            : mName(name), mSubModel(subModel), mWrittenBegin(nullptr), mWrittenEnd(nullptr), mOwnsLock(false)
             {
-                char* data = nullptr;
-                size_t offset, stride, count;
+                void* data = nullptr;
+                size_t offset = 0, stride = 0, count = 0;
                 HardwareBufferPtr buffer;
                 mSubModel.bufferElement(name, data, offset, stride, count, buffer);
                 
                 if (!buffer || !data || !count)
                 {
-                    mStart = mEnd = mCurr = nullptr;
-                    mStride = 0;
+                    // bufferElement() locks the buffer whenever it returns one.
+
+                    if (buffer)
+                    {
+                        buffer->undata();
+                        buffer->unlock();
+                    }
+
+                    mBase = mStart = mEnd = mCurr = nullptr;
+                    mStride = mElementSize = 0;
                     return;
                 }
                 
-                mStart = data;
-                mEnd = data + stride * count;
+                mBase = static_cast < char* >(data) - offset;
+                mStart = static_cast < char* >(data);
+                mEnd = mStart + stride * count;
                 mCurr = mStart;
                 mStride = stride;
+                mElementSize = std::max(sizeof(T), mSubModel.vertexInfos().declaration()->findElement(name).size());
                 mBuffer = buffer;
+                mOwnsLock = true;
             }
             
             VertexElementIterator(const VertexElementIterator& rhs)
-            : mName(rhs.mName), mSubModel(rhs.mSubModel), mStart(rhs.mStart), mEnd(rhs.mEnd),
-            mCurr(rhs.mCurr), mStride(rhs.mStride), mBuffer(rhs.mBuffer)
+            : mName(rhs.mName), mSubModel(rhs.mSubModel), mBase(rhs.mBase), mStart(rhs.mStart), mEnd(rhs.mEnd),
+            mCurr(rhs.mCurr), mStride(rhs.mStride), mElementSize(rhs.mElementSize), mBuffer(rhs.mBuffer),
+            mWrittenBegin(nullptr), mWrittenEnd(nullptr), mOwnsLock(false)
             {
                 
             }
+
+            ~VertexElementIterator()
+            {
+                undata();
+            }
             
             VertexElementIterator& next()
             {
@@ -252,14 +318,38 @@ namespace Atl
             
             void undata()
             {
-                if (mBuffer)
+                if (!mBuffer)
+                    return;
+
+                if (mWrittenBegin)
+                    mBuffer->markDirty(mWrittenBegin - mBase, mWrittenEnd - mWrittenBegin);
+
+                if (mOwnsLock)
                 {
                     mBuffer->undata();
+                    mBuffer->unlock();
                 }
+
+                mBuffer = nullptr;
             }
             
             T* data()
             {
+                if (mBuffer && mCurr != mEnd)
+                {
+                    if (!mWrittenBegin)
+                    {
+                        mWrittenBegin = mCurr;
+                        mWrittenEnd = mCurr + mElementSize;
+                    }
+
+                    else
+                    {
+                        mWrittenBegin = std::min(mWrittenBegin, mCurr);
+                        mWrittenEnd = std::max(mWrittenEnd, mCurr + mElementSize);
+                    }
+                }
+
                 return reinterpret_cast < T* >(mCurr);
             }
         };
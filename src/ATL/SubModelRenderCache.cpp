@@ -7,182 +7,256 @@
 
 #include "SubModelRenderCache.h"
 #include "SubModel.h"
+#include "CommandBuffer.h"
+#include "TransientRing.h"
+
+#include <algorithm>
 
 namespace Atl
 {
     SubModelRenderCache::SubModelRenderCache(Renderer& renderer, SubModel& subModel)
     : RenderCache(renderer, subModel)
     {
-        mIndexData = nullptr;
-        mInfos = nullptr;
-        mDrawVertexes = nullptr;
-        mDrawIndexed = nullptr;
+        mDrawn = nullptr;
+        mBuilt = nullptr;
     }
 
-    std::future < void > SubModelRenderCache::build(Renderer& rhs)
+    void SubModelRenderCache::buildSync(Renderer& rhs)
     {
-        return std::async(std::launch::async, [this, &rhs]()
+        if (!isFrom(rhs))
+            throw RenderableInvalidRenderer("SubModelRenderCache", "build", "Invalid Renderer.");
+
+        notify(&Listener::onRenderableWillBuild, (Renderable&)*this, rhs);
+
+        // The new version is built aside, and published at the end: renderSync() may be called
+        // by another thread meanwhile. The builds themselves are serialized by the SubModel.
+
+        std::shared_ptr < Version > version = std::make_shared < Version >();
+        UploadToken token;
+
+        // A new version of the IndexBufferData and the VertexInfos is built each time: a
+        // CommandBuffer of a frame still in flight may point to the previous one.
+
+        IndexBufferDataPtr indexData;
+
+        if (mOwner.hasIndexes())
         {
-            if (!isFrom(rhs))
-                throw RenderableInvalidRenderer("SubModelRenderCache", "build", "Invalid Renderer.");
+            const IndexBufferData& indexes = mOwner.indexes();
 
-            send(&Listener::onRenderableWillBuild, (Renderable&)*this, rhs).get();
+            HardwareBufferPtr memBuffer = indexes.buffer();
+            MemBufferPtr asMemBuffer = std::dynamic_pointer_cast < MemBuffer >(memBuffer);
+            RenderHdwBufferPtr hdwBuffer;
 
-            // First, takes the Indexed data set.
+            if (asMemBuffer)
+            {
+                hdwBuffer = rhs.hdwBufferManager().findOrQueueRelated(asMemBuffer, rhs.uploadQueue(), token);
 
-            if (mOwner.hasIndexes())
+                if (!hdwBuffer)
+                    throw NullError("SubModelRenderCache", "build", "Null RenderHdwBuffer for MemBuffer %i.", asMemBuffer->index());
+
+                addUpload(*version, token);
+            }
+
+            else  
             {
-                const IndexBufferData& indexes = mOwner.indexes();
+                hdwBuffer = std::dynamic_pointer_cast < RenderHdwBuffer >(memBuffer);
 
-                HardwareBufferPtr memBuffer = indexes.buffer();
-                MemBufferPtr asMemBuffer = std::dynamic_pointer_cast < MemBuffer >(memBuffer);
+                if (!hdwBuffer)
+                    throw NullError("SubModelRenderCache", "build", "HardwareBuffer is not supported.");
 
-                if (asMemBuffer)
-                {
-                    // Creates the index data only if it has not been yet.
-
-                    if (!mIndexData || !(mIndexData->buffer()))
-                    {
-                        RenderHdwBufferPtr hdwBuffer = rhs.hdwBufferManager().findOrCreateRelated(asMemBuffer);
-
-                        if (!hdwBuffer)
-                            throw NullError("SubModelRenderCache", "build", "Null RenderHdwBuffer for MemBuffer %i.", asMemBuffer->index());
-                        
-                        mIndexData = IndexBufferData::New(indexes.elementsCount(), hdwBuffer, indexes.type());
-                    }
-
-                    // Else just update the buffer and infos.
-
-                    else  
-                    {
-                        mIndexData->buffer()->copy(*memBuffer);
-                        mIndexData->setElementsCount(indexes.elementsCount());
-                        mIndexData->setType(indexes.type());
-                    }
-                }
+                if (!(&hdwBuffer->renderer() == &rhs))
+                    throw RenderableInvalidRenderer("SubModelRenderCache", "build", "HardwareBuffer is from another Renderer.");
+            }
 
-                else  
-                {
-                    RenderHdwBufferPtr hdwBuffer = std::dynamic_pointer_cast < RenderHdwBuffer >(memBuffer);
+            indexData = IndexBufferData::New(indexes.elementsCount(), hdwBuffer, indexes.type());
+        }
 
-                    if (!hdwBuffer)
-                        throw NullError("SubModelRenderCache", "build", "HardwareBuffer is not supported.");
+        // Then, creates the VertexInfos.
 
-                    if (!(&hdwBuffer->renderer() == &rhs))
-                        throw RenderableInvalidRenderer("SubModelRenderCache", "build", "HardwareBuffer is from another Renderer.");
+        VertexInfosPtr infos = VertexInfos::New(
+            mOwner.vertexInfos().declaration(), 
+            VertexBufferBinding::New(),
+            mOwner.vertexInfos().baseVertex(),
+            mOwner.vertexInfos().vertexesCount());
 
-                    mIndexData->setBuffer(hdwBuffer);
-                    mIndexData->setElementsCount(indexes.elementsCount());
-                    mIndexData->setType(indexes.type());
-                }
-            }
+        VertexBufferBindingPtr memBuffers = mOwner.vertexInfos().binding();
+        VertexBufferBindingPtr hdwBuffers = infos->binding();
+
+        for (auto const& pair : memBuffers->bindings())
+        {
+            // For each Buffer Binding, we try to find the corresponding index. Each
+            // MemBuffer is associated to a unique index.
+
+            MemBufferPtr memBuffer = std::dynamic_pointer_cast < MemBuffer >(pair.second);
 
-            // Then, creates the VertexInfos.
+            if (memBuffer)
+            {
+                RenderHdwBufferPtr hdwBuffer = rhs.hdwBufferManager().findOrQueueRelated(memBuffer, rhs.uploadQueue(), token);
 
-            mInfos = VertexInfos::New(
-                mOwner.vertexInfos().declaration(), 
-                VertexBufferBinding::New(),
-                mOwner.vertexInfos().baseVertex(),
-                mOwner.vertexInfos().vertexesCount());
+                if (!hdwBuffer) 
+                    throw NullError("SubModelRenderCache", "build", "RenderHdwBuffer for MemBuffer %i is null.", static_cast < unsigned >(memBuffer->index()));
 
-            VertexBufferBindingPtr memBuffers = mOwner.vertexInfos().binding();
-            VertexBufferBindingPtr hdwBuffers = mInfos->binding();
+                addUpload(*version, token);
+
+                hdwBuffers->set(pair.first, hdwBuffer);
+            }
 
-            for (auto const& pair : memBuffers->bindings())
+            else
             {
-                // For each Buffer Binding, we try to find the corresponding index. Each
-                // MemBuffer is associated to a unique index.
+                RenderHdwBufferPtr hdwBuffer = std::dynamic_pointer_cast < RenderHdwBuffer >(pair.second);
 
-                MemBufferPtr memBuffer = std::dynamic_pointer_cast < MemBuffer >(pair.second);
+                if (!hdwBuffer)
+                    throw NullError("SubModelRenderCache", "build", "Cannot find type of HardwareBuffer.");
 
-                if (memBuffer)
+                if (!(&hdwBuffer->renderer() == &rhs))
                 {
-                    RenderHdwBufferPtr hdwBuffer = rhs.hdwBufferManager().findOrCreateRelated(memBuffer);
+                    RenderHdwBufferPtr newHdwBuffer = rhs.hdwBufferManager().copy(hdwBuffer);
 
-                    if (!hdwBuffer) 
-                        throw NullError("SubModelRenderCache", "build", "RenderHdwBuffer for MemBuffer %i is null.", static_cast < unsigned >(memBuffer->index()));
+                    if (!newHdwBuffer)
+                        throw NullError("SubModelRenderCache", "build", "Cannot copy HardwareBuffer %i.", hdwBuffer->index());
                     
-                    hdwBuffers->set(pair.first, hdwBuffer);
+                    hdwBuffer = newHdwBuffer;
                 }
 
-                else
-                {
-                    RenderHdwBufferPtr hdwBuffer = std::dynamic_pointer_cast < RenderHdwBuffer >(pair.second);
+                hdwBuffers->set(pair.first, hdwBuffer);
+            }
+        }
 
-                    if (!hdwBuffer)
-                        throw NullError("SubModelRenderCache", "build", "Cannot find type of HardwareBuffer.");
+        // Creates the RenderCommands. A command added to a frame in flight is not changed.
 
-                    if (!(&hdwBuffer->renderer() == &rhs))
-                    {
-                        RenderHdwBufferPtr newHdwBuffer = rhs.hdwBufferManager().copy(hdwBuffer);
+        version->infos = infos;
+        version->indexData = indexData;
 
-                        if (!newHdwBuffer)
-                            throw NullError("SubModelRenderCache", "build", "Cannot copy HardwareBuffer %i.", hdwBuffer->index());
-                        
-                        hdwBuffer = newHdwBuffer;
-                    }
+        if (indexData)
+        {
+            version->drawIndexed = rhs.newCommand < DrawIndexedArraysCommand >();
+            version->drawIndexed->construct(infos, indexData);
+        }
 
-                    hdwBuffers->set(pair.first, hdwBuffer);
-                }
-            }
+        else
+        {
+            version->drawVertexes = rhs.newCommand < DrawVertexArraysCommand >();
+            version->drawVertexes->construct(infos);
+        }
 
-            // Creates the RenderCommands and update them.
+        // Publishes the new version. It replaces a version built before and never drawn.
 
-            if (mIndexData)
-            {
-                if (!mDrawIndexed)
-                {
-                    mDrawVertexes = nullptr;
-                    mDrawIndexed = rhs.newCommand < DrawIndexedArraysCommand >();
-                }
-                mDrawIndexed->construct(mInfos, mIndexData);
-            }
+        {
+            std::lock_guard l(mMutex);
+            mBuilt = version;
+        }
+
+        notify(&Listener::onRenderableDidBuild, (Renderable&)*this, rhs);
+    }
+
+    void SubModelRenderCache::renderSync(RenderCommand& cmd) const
+    {
+        notify(&Listener::onRenderableWillRender, (const Renderable&)*this, cmd);
 
-            else 
+        // Nothing is drawn until a version is uploaded. A version whose uploads are pending
+        // is drawn once they are done, the previous one meanwhile.
+
+        if (VersionPtr version = drawnVersion())
+        {
+            if (CommandBuffer* buffer = cmd.asCommandBuffer())
             {
-                if (!mDrawVertexes)
-                {
-                    mDrawVertexes = rhs.newCommand < DrawVertexArraysCommand >();
-                    mDrawIndexed = nullptr;
-                }
-                mDrawVertexes->construct(mInfos);
+                // The packets point to the version drawn, which the buffer keeps alive: it may
+                // be a Bundle rendered after this version is released.
+
+                buffer->retain(version);
+
+                if (version->drawIndexed)
+                    buffer->drawIndexed(*version->infos, *version->indexData);
+                else if (version->drawVertexes)
+                    buffer->draw(*version->infos);
             }
 
-            send(&Listener::onRenderableDidBuild, (Renderable&)*this, rhs).get();
-        });
+            else if (version->drawIndexed)
+                cmd.addSubCommand(version->drawIndexed);
+            else if (version->drawVertexes)
+                cmd.addSubCommand(version->drawVertexes);
+        }
+
+        notify(&Listener::onRenderableDidRender, (const Renderable&)*this, cmd);
+    }
+
+    bool SubModelRenderCache::isUploaded() const
+    {
+        return drawnVersion() != nullptr;
+    }
+
+    bool SubModelRenderCache::drawn(VertexInfosPtr& infos, IndexBufferDataPtr& indexData) const
+    {
+        if (VersionPtr version = drawnVersion())
+        {
+            infos = version->infos;
+            indexData = version->indexData;
+            return true;
+        }
+
+        return false;
     }
 
-    std::future < void > SubModelRenderCache::render(RenderCommand& cmd) const
+    SubModelRenderCache::VersionPtr SubModelRenderCache::drawnVersion() const
     {
-        return std::async(std::launch::async, [this, &cmd]()
+        std::lock_guard l(mMutex);
+
+        if (mBuilt && std::all_of(mBuilt->uploads.begin(), mBuilt->uploads.end(), UploadQueue::IsDone))
         {
-            send(&Listener::onRenderableWillRender, (const Renderable&)*this, cmd).get();
+            // The version replaced is released once the frames which may have recorded it
+            // retire. Its buffers are then reused by the next updates.
+
+            if (mDrawn)
+                mRenderer.transientRing().defer([version = mDrawn](){});
 
-            if (mDrawIndexed)
-                cmd.addSubCommand(mDrawIndexed);
-            else if (mDrawVertexes)
-                cmd.addSubCommand(mDrawVertexes);
+            mDrawn = mBuilt;
+            mBuilt = nullptr;
+        }
 
-            send(&Listener::onRenderableDidRender, (const Renderable&)*this, cmd).get();
-        });
+        return mDrawn;
+    }
+
+    void SubModelRenderCache::addUpload(Version& version, const UploadToken& token)
+    {
+        if (token.valid())
+            version.uploads.push_back(token);
     }
 
     std::size_t SubModelRenderCache::size(Renderer&) const
     {
+        VersionPtr version;
+
+        {
+            std::lock_guard l(mMutex);
+            version = mBuilt ? mBuilt : mDrawn;
+        }
+
         std::size_t total = 0;
 
-        if (mInfos && mInfos->binding())
+        if (version && version->infos && version->infos->binding())
         {
-            for (auto const& pair : mInfos->binding()->bindings())
+            for (auto const& pair : version->infos->binding()->bindings())
             {
                 if (pair.second)
                     total += pair.second->size();
             }
         }
 
-        if (mIndexData && mIndexData->buffer())
-            total += mIndexData->buffer()->size();
+        if (version && version->indexData && version->indexData->buffer())
+            total += version->indexData->buffer()->size();
 
         return total;
     }
-}
\ No newline at end of file
+
+    VertexInfosPtr SubModelRenderCache::infos() const
+    {
+        VersionPtr version = drawnVersion();
+        return version ? version->infos : nullptr;
+    }
+
+    IndexBufferDataPtr SubModelRenderCache::indexData() const
+    {
+        VersionPtr version = drawnVersion();
+        return version ? version->indexData : nullptr;
+    }
+}
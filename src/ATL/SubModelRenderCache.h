@@ -12,6 +12,7 @@
 #include "RenderCache.h"
 #include "DrawIndexedArraysCommand.h"
 #include "DrawVertexArraysCommand.h"
+#include "UploadQueue.h"
 
 namespace Atl
 {
@@ -36,25 +37,50 @@ namespace Atl
     //! VertexInfos set.
     //! - A \ref DrawIndexedArraysCommand if the SubModel has indexed data.
     //!
-    //! When rendering, the RenderCache only renders its RenderCommand, either DrawVertexArraysCommand
-    //! or DrawIndexedArraysCommand.
+    //! The MemBuffers are copied by the Renderer's \ref UploadQueue, not while building, into
+    //! buffers no frame uses. When rendering, the RenderCache only renders its RenderCommand,
+    //! either DrawVertexArraysCommand or DrawIndexedArraysCommand, once the copies are done.
+    //!
+    //! Each build creates a new version: a VertexInfos, an IndexBufferData and a draw command.
+    //! The version is drawn once its uploads are done, and the previous one is drawn until
+    //! then. The version it replaces is released through the Renderer's
+    //! TransientRing::defer(), so a frame still in flight draws the data it recorded.
     class SubModelRenderCache : public RenderCache < SubModel >
     {
-        //! @brief The IndexBufferData for this cache.
-        IndexBufferDataPtr mIndexData;
+        //! @brief A version of the data drawn by the cache, never changed once published.
+        struct Version
+        {
+            //! @brief The IndexBufferData, if the \ref SubModel has indexed data.
+            IndexBufferDataPtr indexData;
+
+            //! @brief The VertexInfos. The \ref VertexDescriptor is shared with the parent
+            //! \ref SubModel's descriptor. However the \ref VertexBufferBinding is local to
+            //! this version.
+            VertexInfosPtr infos;
+
+            //! @brief The DrawVertexArraysCommand, if the \ref SubModel has no indexed data.
+            //! Notes it is more efficient to draw indexed data.
+            DrawVertexArraysCommandPtr drawVertexes;
+
+            //! @brief The DrawIndexedArraysCommand, if the \ref SubModel has indexed data.
+            DrawIndexedArraysCommandPtr drawIndexed;
 
-        //! @brief The VertexInfos for this cache. The \ref VertexDescriptor is shared with the
-        //! parent \ref SubModel's descriptor. However the \ref VertexBufferBinding is local to 
-        //! this render cache.
-        VertexInfosPtr mInfos;
+            //! @brief The tokens of the uploads which must be done before drawing.
+            std::vector < UploadToken > uploads;
+        };
 
-        //! @brief The DrawVertexArraysCommand for this cache, if the \ref SubModel has no indexed
-        //! data. Notes it is more efficient to draw indexed data.
-        DrawVertexArraysCommandPtr mDrawVertexes;
+        //! @brief A pointer to a published Version.
+        typedef std::shared_ptr < const Version > VersionPtr;
 
-        //! @brief The \ref DrawIndexedArraysCommand for this cache, if the \ref SubModel has indexed
-        //! data ready.
-        DrawIndexedArraysCommandPtr mDrawIndexed;
+        //! @brief The version drawn, or null until a version is uploaded.
+        mutable VersionPtr mDrawn;
+
+        //! @brief The version built last, while its uploads are pending, or null.
+        mutable VersionPtr mBuilt;
+
+        //! @brief Protects mDrawn and mBuilt, as \ref renderSync() may be called while another
+        //! thread builds.
+        mutable std::mutex mMutex;
 
     public:
         ATL_SHAREABLE(SubModelRenderCache)
@@ -68,13 +94,37 @@ namespace Atl
         //! @brief Builds the RenderCache.
         //! Throws a RenderableInvalidRenderer Error if the Renderer provided is not the one registered
         //! for this cache. The SubModel is locked with SubModelLockGuard.
-        virtual std::future < void > build(Renderer& rhs);
+        virtual void buildSync(Renderer& rhs);
+
+        //! @brief Renders the \ref RenderCommandBase for the \ref SubModel. Nothing is drawn
+        //! until \ref isUploaded(). While an update is pending, the previous version is drawn.
+        virtual void renderSync(RenderCommand& command) const;
 
-        //! @brief Renders the \ref RenderCommandBase for the \ref SubModel.
-        virtual std::future < void > render(RenderCommand& command) const;
+        //! @brief Returns true once the uploads of a version are done. Rethrows the error of a
+        //! failed upload.
+        bool isUploaded() const;
+
+        //! @brief Sets infos and indexData to the ones of the version drawn, and returns true,
+        //! or returns false if no version is uploaded.
+        bool drawn(VertexInfosPtr& infos, IndexBufferDataPtr& indexData) const;
 
         //! @brief Returns the size of all buffers in this cache.
         virtual std::size_t size(Renderer&) const;
+
+        //! @brief Returns the VertexInfos drawn, or null if no version is uploaded.
+        VertexInfosPtr infos() const;
+
+        //! @brief Returns the IndexBufferData drawn, or null if no version is uploaded or if
+        //! the \ref SubModel has no indexed data.
+        IndexBufferDataPtr indexData() const;
+
+    private:
+
+        //! @brief Returns mDrawn, after replacing it with mBuilt if its uploads are done.
+        VersionPtr drawnVersion() const;
+
+        //! @brief Keeps the token of an upload the version must wait for.
+        static void addUpload(Version& version, const UploadToken& token);
     };
 
     //! @brief Defines a Pointer to the \ref SubModelRenderCache.
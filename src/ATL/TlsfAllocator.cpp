@@ -0,0 +1,327 @@
+//
+//  TlsfAllocator.cpp
+//  atlre
+//
+//  Created by jacques tronconi on 27/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#include "TlsfAllocator.h"
+#include "Error.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace Atl
+{
+    namespace
+    {
+        //! @brief Returns the index of the highest bit set in value, which is not zero.
+        unsigned HighestBit(std::uint64_t value)
+        {
+#if defined(_MSC_VER)
+            unsigned long index;
+            _BitScanReverse64(&index, value);
+            return static_cast < unsigned >(index);
+#else
+            return 63u - static_cast < unsigned >(__builtin_clzll(value));
+#endif
+        }
+
+        //! @brief Returns the index of the lowest bit set in value, which is not zero.
+        unsigned LowestBit(std::uint64_t value)
+        {
+#if defined(_MSC_VER)
+            unsigned long index;
+            _BitScanForward64(&index, value);
+            return static_cast < unsigned >(index);
+#else
+            return static_cast < unsigned >(__builtin_ctzll(value));
+#endif
+        }
+
+        //! @brief Returns size rounded up to alignment, a power of two.
+        std::size_t AlignUp(std::size_t size, std::size_t alignment)
+        {
+            return (size + alignment - 1) & ~(alignment - 1);
+        }
+    }
+
+    TlsfAllocator::TlsfAllocator(std::size_t capacity)
+    : mUnusedBlocks(Null), mFirstLevelMap(0)
+    {
+        for (auto& heads : mHeads)
+            heads.fill(Null);
+
+        mSecondLevelMaps.fill(0);
+
+        capacity &= ~(Granularity - 1);
+        mStats.capacity = capacity;
+
+        if (capacity)
+        {
+            Handle handle = newBlock();
+            mBlocks[handle].offset = 0;
+            mBlocks[handle].size = capacity;
+            insertFree(handle);
+        }
+    }
+
+    TlsfAllocator::Handle TlsfAllocator::allocate(std::size_t size, std::size_t alignment)
+    {
+        if (!size)
+            size = Granularity;
+
+        if (alignment < Granularity)
+            alignment = Granularity;
+
+        if (alignment & (alignment - 1))
+            throw OutOfRange("TlsfAllocator", "allocate", "Alignment %i is not a power of two.",
+                             static_cast < int >(alignment));
+
+        size = AlignUp(size, Granularity);
+
+        // A block of size + alignment - Granularity always holds an aligned range of size bytes.
+
+        const std::size_t needed = size + alignment - Granularity;
+        Handle handle = findFree(needed);
+
+        if (handle == Null)
+            return Null;
+
+        removeFree(handle);
+
+        // The padding before the aligned offset goes back to the free lists.
+
+        const std::size_t padding = AlignUp(mBlocks[handle].offset, alignment) - mBlocks[handle].offset;
+
+        if (padding)
+        {
+            splitAfter(handle, padding);
+
+            Handle aligned = mBlocks[handle].nextPhysical;
+            removeFree(aligned);
+            insertFree(handle);
+            handle = aligned;
+        }
+
+        if (mBlocks[handle].size > size)
+            splitAfter(handle, size);
+
+        mStats.used += mBlocks[handle].size;
+        mStats.allocations++;
+        return handle;
+    }
+
+    void TlsfAllocator::free(Handle handle)
+    {
+        if (handle == Null)
+            return;
+
+        if (handle >= mBlocks.size() || mBlocks[handle].isFree)
+            throw OutOfRange("TlsfAllocator", "free", "Invalid handle %i.", static_cast < int >(handle));
+
+        mStats.used -= mBlocks[handle].size;
+        mStats.allocations--;
+
+        // Merges with the next free block, then with the previous one.
+
+        const Handle next = mBlocks[handle].nextPhysical;
+
+        if (next != Null && mBlocks[next].isFree)
+        {
+            removeFree(next);
+            mBlocks[handle].size += mBlocks[next].size;
+            mBlocks[handle].nextPhysical = mBlocks[next].nextPhysical;
+
+            if (mBlocks[handle].nextPhysical != Null)
+                mBlocks[mBlocks[handle].nextPhysical].prevPhysical = handle;
+
+            deleteBlock(next);
+        }
+
+        const Handle prev = mBlocks[handle].prevPhysical;
+
+        if (prev != Null && mBlocks[prev].isFree)
+        {
+            removeFree(prev);
+            mBlocks[prev].size += mBlocks[handle].size;
+            mBlocks[prev].nextPhysical = mBlocks[handle].nextPhysical;
+
+            if (mBlocks[prev].nextPhysical != Null)
+                mBlocks[mBlocks[prev].nextPhysical].prevPhysical = prev;
+
+            deleteBlock(handle);
+            handle = prev;
+        }
+
+        insertFree(handle);
+    }
+
+    std::size_t TlsfAllocator::offset(Handle handle) const
+    {
+        return mBlocks.at(handle).offset;
+    }
+
+    std::size_t TlsfAllocator::size(Handle handle) const
+    {
+        return mBlocks.at(handle).size;
+    }
+
+    bool TlsfAllocator::isEmpty() const
+    {
+        return !mStats.allocations;
+    }
+
+    TlsfStats TlsfAllocator::stats() const
+    {
+        TlsfStats stats = mStats;
+
+        if (mFirstLevelMap)
+        {
+            // The largest block is in the highest non empty list.
+
+            const unsigned firstLevel = HighestBit(mFirstLevelMap);
+            const unsigned secondLevel = HighestBit(mSecondLevelMaps[firstLevel]);
+
+            for (Handle handle = mHeads[firstLevel][secondLevel]; handle != Null; handle = mBlocks[handle].nextFree)
+            {
+                if (mBlocks[handle].size > stats.largestFree)
+                    stats.largestFree = mBlocks[handle].size;
+            }
+        }
+
+        return stats;
+    }
+
+    void TlsfAllocator::Mapping(std::size_t size, unsigned& firstLevel, unsigned& secondLevel)
+    {
+        // Sizes are at least Granularity, so the highest bit is never below SecondLevelShift.
+
+        firstLevel = HighestBit(size);
+        secondLevel = static_cast < unsigned >(size >> (firstLevel - SecondLevelShift)) - SecondLevelCount;
+    }
+
+    TlsfAllocator::Handle TlsfAllocator::newBlock()
+    {
+        if (mUnusedBlocks != Null)
+        {
+            Handle handle = mUnusedBlocks;
+            mUnusedBlocks = mBlocks[handle].nextFree;
+            mBlocks[handle] = Block();
+            return handle;
+        }
+
+        mBlocks.emplace_back();
+        return static_cast < Handle >(mBlocks.size() - 1);
+    }
+
+    void TlsfAllocator::deleteBlock(Handle handle)
+    {
+        mBlocks[handle] = Block();
+        mBlocks[handle].nextFree = mUnusedBlocks;
+        mUnusedBlocks = handle;
+    }
+
+    void TlsfAllocator::insertFree(Handle handle)
+    {
+        Block& block = mBlocks[handle];
+        unsigned firstLevel, secondLevel;
+        Mapping(block.size, firstLevel, secondLevel);
+
+        block.isFree = true;
+        block.prevFree = Null;
+        block.nextFree = mHeads[firstLevel][secondLevel];
+
+        if (block.nextFree != Null)
+            mBlocks[block.nextFree].prevFree = handle;
+
+        mHeads[firstLevel][secondLevel] = handle;
+        mFirstLevelMap |= std::uint64_t(1) << firstLevel;
+        mSecondLevelMaps[firstLevel] |= 1u << secondLevel;
+
+        mStats.free += block.size;
+        mStats.freeBlocks++;
+    }
+
+    void TlsfAllocator::removeFree(Handle handle)
+    {
+        Block& block = mBlocks[handle];
+        unsigned firstLevel, secondLevel;
+        Mapping(block.size, firstLevel, secondLevel);
+
+        if (block.prevFree != Null)
+            mBlocks[block.prevFree].nextFree = block.nextFree;
+        else
+            mHeads[firstLevel][secondLevel] = block.nextFree;
+
+        if (block.nextFree != Null)
+            mBlocks[block.nextFree].prevFree = block.prevFree;
+
+        if (mHeads[firstLevel][secondLevel] == Null)
+        {
+            mSecondLevelMaps[firstLevel] &= ~(1u << secondLevel);
+
+            if (!mSecondLevelMaps[firstLevel])
+                mFirstLevelMap &= ~(std::uint64_t(1) << firstLevel);
+        }
+
+        block.isFree = false;
+        block.prevFree = Null;
+        block.nextFree = Null;
+
+        mStats.free -= block.size;
+        mStats.freeBlocks--;
+    }
+
+    TlsfAllocator::Handle TlsfAllocator::findFree(std::size_t size) const
+    {
+        // Rounds size up to the next list, so that every block found there is large enough.
+
+        const unsigned highest = HighestBit(size);
+        const std::size_t rounded = size + (std::size_t(1) << (highest - SecondLevelShift)) - 1;
+
+        if (rounded < size)
+            return Null;
+
+        unsigned firstLevel, secondLevel;
+        Mapping(rounded, firstLevel, secondLevel);
+
+        std::uint32_t secondLevelMap = mSecondLevelMaps[firstLevel] & (~0u << secondLevel);
+
+        if (!secondLevelMap)
+        {
+            const std::uint64_t firstLevelMap = firstLevel + 1 < FirstLevelCount ?
+                mFirstLevelMap & (~std::uint64_t(0) << (firstLevel + 1)) : 0;
+
+            if (!firstLevelMap)
+                return Null;
+
+            firstLevel = LowestBit(firstLevelMap);
+            secondLevelMap = mSecondLevelMaps[firstLevel];
+        }
+
+        return mHeads[firstLevel][LowestBit(secondLevelMap)];
+    }
+
+    void TlsfAllocator::splitAfter(Handle handle, std::size_t size)
+    {
+        // newBlock() may reallocate mBlocks, so no reference is taken before.
+
+        Handle remaining = newBlock();
+
+        mBlocks[remaining].offset = mBlocks[handle].offset + size;
+        mBlocks[remaining].size = mBlocks[handle].size - size;
+        mBlocks[remaining].prevPhysical = handle;
+        mBlocks[remaining].nextPhysical = mBlocks[handle].nextPhysical;
+
+        if (mBlocks[remaining].nextPhysical != Null)
+            mBlocks[mBlocks[remaining].nextPhysical].prevPhysical = remaining;
+
+        mBlocks[handle].size = size;
+        mBlocks[handle].nextPhysical = remaining;
+
+        insertFree(remaining);
+    }
+}
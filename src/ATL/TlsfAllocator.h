@@ -0,0 +1,166 @@
+//
+//  TlsfAllocator.h
+//  atlre
+//
+//  Created by jacques tronconi on 27/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#ifndef ATL_TLSFALLOCATOR_H
+#define ATL_TLSFALLOCATOR_H
+
+#include "Platform.h"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace Atl
+{
+    //! @brief The counters of a \ref TlsfAllocator.
+    struct TlsfStats
+    {
+        //! @brief The size of the range, in bytes.
+        std::size_t capacity = 0;
+
+        //! @brief The bytes allocated, padding included.
+        std::size_t used = 0;
+
+        //! @brief The bytes free.
+        std::size_t free = 0;
+
+        //! @brief The size of the largest free block.
+        std::size_t largestFree = 0;
+
+        //! @brief The number of allocations.
+        std::size_t allocations = 0;
+
+        //! @brief The number of free blocks.
+        std::size_t freeBlocks = 0;
+
+        //! @brief Returns the part of the free bytes which are not in the largest free block,
+        //! from 0 when the free space is contiguous to almost 1 when it is scattered.
+        double fragmentation() const
+        {
+            return free ? 1.0 - static_cast < double >(largestFree) / static_cast < double >(free) : 0.0;
+        }
+    };
+
+    //! @brief Allocates ranges of offsets with the Two-Level Segregated Fit algorithm.
+    //!
+    //! The allocator doesn't own any memory: it hands out offsets in [0, capacity), which the
+    //! user maps on its own storage, like a large GPU buffer. Free blocks are kept in lists by
+    //! size class: the first level is the highest bit of the size, the second level splits it
+    //! in \ref SecondLevelCount. Two bitmaps tell which lists are not empty, so \ref allocate()
+    //! and \ref free() run in constant time. Adjacent free blocks are merged when freed.
+    //!
+    //! Sizes are rounded up to \ref Granularity. This class is not thread-safe.
+    class EXPORTED TlsfAllocator
+    {
+    public:
+
+        //! @brief Identifies an allocation.
+        typedef std::uint32_t Handle;
+
+        //! @brief An invalid handle.
+        static constexpr Handle Null = ~Handle(0);
+
+        //! @brief The smallest block, and the alignment of every offset.
+        static constexpr std::size_t Granularity = 16;
+
+        //! @brief log2 of \ref SecondLevelCount.
+        static constexpr unsigned SecondLevelShift = 4;
+
+        //! @brief The number of lists per first level.
+        static constexpr unsigned SecondLevelCount = 1u << SecondLevelShift;
+
+        //! @brief The number of first levels.
+        static constexpr unsigned FirstLevelCount = 64;
+
+    private:
+
+        //! @brief A block of the range, free or allocated.
+        struct Block
+        {
+            std::size_t offset = 0;
+            std::size_t size = 0;
+
+            //! @brief The blocks before and after this one in the range.
+            Handle prevPhysical = Null;
+            Handle nextPhysical = Null;
+
+            //! @brief The blocks before and after this one in its free list.
+            Handle prevFree = Null;
+            Handle nextFree = Null;
+
+            bool isFree = false;
+        };
+
+        //! @brief The blocks. Unused entries are chained in mUnusedBlocks.
+        std::vector < Block > mBlocks;
+
+        //! @brief The entries of mBlocks not used, through Block::nextFree.
+        Handle mUnusedBlocks;
+
+        //! @brief The first free block of each list.
+        std::array < std::array < Handle, SecondLevelCount >, FirstLevelCount > mHeads;
+
+        //! @brief A bit per first level with a non empty list.
+        std::uint64_t mFirstLevelMap;
+
+        //! @brief A bit per non empty list, for each first level.
+        std::array < std::uint32_t, FirstLevelCount > mSecondLevelMaps;
+
+        //! @brief The counters, except largestFree which is computed by \ref stats().
+        TlsfStats mStats;
+
+    public:
+
+        //! @brief Constructs an allocator for capacity bytes, rounded down to Granularity.
+        TlsfAllocator(std::size_t capacity);
+
+        //! @brief Allocates size bytes aligned on alignment, a power of two.
+        //! @return The handle of the allocation, or Null if no free block is large enough.
+        Handle allocate(std::size_t size, std::size_t alignment = Granularity);
+
+        //! @brief Frees an allocation. Does nothing for Null.
+        void free(Handle handle);
+
+        //! @brief Returns the offset of an allocation.
+        std::size_t offset(Handle handle) const;
+
+        //! @brief Returns the size of an allocation, which may be larger than requested.
+        std::size_t size(Handle handle) const;
+
+        //! @brief Returns true if nothing is allocated.
+        bool isEmpty() const;
+
+        //! @brief Returns the counters.
+        TlsfStats stats() const;
+
+    private:
+
+        //! @brief Returns the first and second levels of size.
+        static void Mapping(std::size_t size, unsigned& firstLevel, unsigned& secondLevel);
+
+        //! @brief Returns a block entry.
+        Handle newBlock();
+
+        //! @brief Returns a block entry to the unused ones.
+        void deleteBlock(Handle handle);
+
+        //! @brief Adds a free block to its list.
+        void insertFree(Handle handle);
+
+        //! @brief Removes a free block from its list.
+        void removeFree(Handle handle);
+
+        //! @brief Returns a free block of at least size bytes, or Null.
+        Handle findFree(std::size_t size) const;
+
+        //! @brief Splits the end of a block after size bytes as a free block.
+        void splitAfter(Handle handle, std::size_t size);
+    };
+}
+
+#endif // ATL_TLSFALLOCATOR_H
@@ -10,7 +10,7 @@
 namespace Atl
 {
     TimeTouchable::TimeTouchable()
-    : mLastTouch(Clock::now()), mLastClean(Clock::now())
+    : mLastTouch(Clock::now()), mLastClean(Clock::now()), mTouchCount(0)
     {
         
     }
@@ -25,6 +25,7 @@ namespace Atl
     {
         mLastClean = rhs.mLastClean;
         mLastTouch = rhs.mLastTouch;
+        mTouchCount++;
         return *this;
     }
     
@@ -38,6 +39,7 @@ namespace Atl
     {
         std::lock_guard l(mMutex);
         mLastTouch = Clock::now();
+        mTouchCount++;
     }
     
     void TimeTouchable::clean() const
@@ -45,4 +47,10 @@ namespace Atl
         std::lock_guard l(mMutex);
         mLastClean = Clock::now();
     }
+    
+    std::uint64_t TimeTouchable::touchCount() const
+    {
+        std::lock_guard l(mMutex);
+        return mTouchCount;
+    }
 }
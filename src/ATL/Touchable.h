@@ -11,6 +11,7 @@
 #include "Platform.h"
 
 #include <chrono>
+#include <cstdint>
 #include <mutex>
 
 namespace Atl
@@ -32,6 +33,11 @@ namespace Atl
         
         //! @brief Notifiates the object is no more in a 'modified' state.
         virtual void clean() const = 0;
+        
+        //! @brief Returns the number of times the object has been touched. Unlike \ref isTouched(),
+        //! this is not reset by \ref clean(), so several observers can each remember the count
+        //! they have seen.
+        virtual std::uint64_t touchCount() const = 0;
     };
     
     //! @brief A default implementation of a Touchable with std::chrono.
@@ -46,6 +52,9 @@ namespace Atl
         //! @brief The last time it has been cleaned.
         mutable ClockTime mLastClean;
         
+        //! @brief The number of calls to \ref touch().
+        std::uint64_t mTouchCount;
+        
         //! @brief Internal mutex.
         mutable std::mutex mMutex;
         
@@ -71,6 +80,9 @@ namespace Atl
         
         //! @brief Updates mLastClean to the current clock value.
         void clean() const;
+        
+        //! @brief Returns mTouchCount.
+        std::uint64_t touchCount() const;
     };
 }
 
@@ -49,6 +49,7 @@ namespace Atl
         mMatrix = rhs.mMatrix;
         mName = rhs.mName;
         mCache.touchAllCaches();
+        mTouchCount++;
         return *this;
     }
 
@@ -57,6 +58,7 @@ namespace Atl
         std::lock_guard l(mMutex);
         mMatrix = glm::translate(mMatrix, rhs);
         mCache.touchAllCaches();
+        mTouchCount++;
         return *this;
     }
 
@@ -65,6 +67,7 @@ namespace Atl
         std::lock_guard l(mMutex);
         mMatrix = glm::scale(mMatrix, rhs);
         mCache.touchAllCaches();
+        mTouchCount++;
         return *this;
     }
 
@@ -73,6 +76,7 @@ namespace Atl
         std::lock_guard l(mMutex);
         mMatrix = glm::rotate(mMatrix, angle, axis);
         mCache.touchAllCaches();
+        mTouchCount++;
         return *this;
     }
 
@@ -81,93 +85,81 @@ namespace Atl
         return Transformation(name, glm::lookAt(from, to, up));
     }
 
-    std::future < void > Transformation::build(Renderer& renderer) 
+    void Transformation::buildSync(Renderer& renderer)
     {
-        return std::async(std::launch::async, [this, &renderer]()
-        {
-            std::lock_guard l(mMutex);
+        std::lock_guard l(mMutex);
 
-            // Checks if the cache has been built for given renderer.
+        // Checks if the cache has been built for given renderer.
 
-            RenderCachePtr < Transformation > cache = mCache.cacheFor(renderer);
-            
-            if (!cache)
-            {
-                // Creates our ShaderVariable.
+        RenderCachePtr < Transformation > cache = mCache.cacheFor(renderer);
+        
+        if (!cache)
+        {
+            // Creates our ShaderVariable.
 
-                ShaderVariable variable(mName, &mMatrix[0][0], SVT::MatrixR4x4, 1);
+            ShaderVariable variable(mName, &mMatrix[0][0], SVT::MatrixR4x4, 1);
 
-                // Builds a new cache for renderer.
+            // Builds a new cache for renderer.
 
-                TransformationRenderCachePtr newCache = TransformationRenderCache::New(renderer, *this);
-                newCache->command()->setShaderVariable(variable);
+            TransformationRenderCachePtr newCache = TransformationRenderCache::New(renderer, *this);
+            newCache->command()->setShaderVariable(variable);
 
-                // Registers our new cache (and cleans it at we are sure it is up to date).
+            // Registers our new cache (and cleans it at we are sure it is up to date).
 
-                mCache.addCache(newCache);
-                mCache.cleanCache(newCache);
+            mCache.addCache(newCache);
+            mCache.cleanCache(newCache);
 
-                return;
-            }
+            return;
+        }
 
-            // Sets our updated shader variable.
+        // Sets our updated shader variable.
 
-            TransformationRenderCache* pCache = reinterpret_cast < TransformationRenderCache* >(cache.get());
-            pCache->command()->setVariableValue(&mMatrix[0][0]);
+        TransformationRenderCache* pCache = reinterpret_cast < TransformationRenderCache* >(cache.get());
+        pCache->command()->setVariableValue(&mMatrix[0][0]);
 
-            // Cleans our cache.
+        // Cleans our cache.
 
-            mCache.cleanCache(cache);
-        });
+        mCache.cleanCache(cache);
     }
 
-    std::future < void > Transformation::render(RenderCommand& command) const
+    void Transformation::renderSync(RenderCommand& command) const
     {
-        return std::async(std::launch::async, [this, &command]()
-        {
-            mMutex.lock();
+        mMutex.lock();
 
-            // Checks if we have a render cache.
+        // Checks if we have a render cache.
 
-            RenderCachePtr < Transformation > cache = mCache.cacheFor(command.renderer());
+        RenderCachePtr < Transformation > cache = mCache.cacheFor(command.renderer());
 
-            if (!cache)
-            {
-                // Unlocks the mutex, rebuild the cache and relaunch this function.
-                // All async functions are waited for here.
+        if (!cache)
+        {
+            // Unlocks the mutex, rebuild the cache and relaunch this function.
 
-                mMutex.unlock();
+            mMutex.unlock();
 
-                const_cast < Transformation& >(*this)
-                .build(command.renderer()).get();
+            const_cast < Transformation& >(*this).buildSync(command.renderer());
 
-                return render(command).get();
-            }
+            return renderSync(command);
+        }
 
-            // Checks if cache is touched, in this case, rebuild it.
-            // Actually this doesn't recreate the cache, but only updates it with the new
-            // value from our matrix.
+        // Checks if cache is touched, in this case, rebuild it.
+        // Actually this doesn't recreate the cache, but only updates it with the new
+        // value from our matrix.
 
-            if (mCache.isCacheTouched(cache))
-            {
-                // Unlocks the mutex, rebuild the cache and relaunch this function.
-                // All async functions are waited for here.
+        if (mCache.isCacheTouched(cache))
+        {
+            // Unlocks the mutex, rebuild the cache and relaunch this function.
 
-                mMutex.unlock();
+            mMutex.unlock();
 
-                const_cast < Transformation& >(*this)
-                .build(command.renderer()).get();
+            const_cast < Transformation& >(*this).buildSync(command.renderer());
 
-                return render(command).get();
-            }
+            return renderSync(command);
+        }
 
-            // Renders the cache into the command.
+        // Renders the cache into the command.
 
-            cache->render(command).get();
-            mMutex.unlock();
-            
-            return;
-        });
+        mMutex.unlock();
+        cache->renderSync(command);
     }
 
     std::size_t Transformation::size(Renderer&) const
@@ -298,5 +290,30 @@ namespace Atl
         std::lock_guard l(mMutex);
         mMatrix = rhs;
         mCache.touchAllCaches();
+        mTouchCount++;
+    }
+
+    bool Transformation::isTouched() const
+    {
+        std::lock_guard l(mMutex);
+        return mCache.isAnyCacheTouched();
+    }
+
+    void Transformation::touch()
+    {
+        std::lock_guard l(mMutex);
+        mCache.touchAllCaches();
+        mTouchCount++;
+    }
+
+    void Transformation::clean() const
+    {
+        std::lock_guard l(mMutex);
+        mCache.cleanAllCaches();
+    }
+
+    std::uint64_t Transformation::touchCount() const
+    {
+        return mTouchCount;
     }
 }
@@ -10,13 +10,19 @@
 
 #include "Renderable.h"
 #include "PerRendererCache.h"
+#include "Touchable.h"
+
+#include <atomic>
 
 namespace Atl
 {
     //! @brief Holds a Transformation's matrix for a Renderable.
     //! The Transformation holds a name, that will be used to bind the Transformation 
-    //! into the rendering context.
-    class EXPORTED Transformation : public Renderable
+    //! into the rendering context. Each change of the matrix touches it, so a RenderNode
+    //! recording it in a Bundle records it again.
+    class EXPORTED Transformation : 
+        public Renderable, 
+        virtual public Touchable
     {
         //! @brief The Matrix for this transformation.
         rmat4x4 mMatrix;
@@ -29,6 +35,9 @@ namespace Atl
 
         //! @brief Holds RenderCaches for each Renderer.
         mutable PerRendererCache < Transformation > mCache;
+
+        //! @brief The number of calls to \ref touch().
+        std::atomic < std::uint64_t > mTouchCount { 0 };
         
     public:
         ATL_SHAREABLE(Transformation)
@@ -78,10 +87,10 @@ namespace Atl
         //! @brief Updates the TransformationRenderCache in this Transformation.
         //! If the RenderCache doesn't exist, creates it. If it exists, updates
         //! the cache's value with the current matrix.
-        std::future < void > build(Renderer& renderer);
+        void buildSync(Renderer& renderer);
 
         //! @brief Renders the cache in the command.
-        std::future < void > render(RenderCommand& command) const;
+        void renderSync(RenderCommand& command) const;
 
         //! @brief Returns the size of the matrix, i.e. 16 floats.
         std::size_t size(Renderer&) const;
@@ -103,6 +112,18 @@ namespace Atl
 
         //! @brief Directly changes the Matrix.
         void setMatrix(const rmat4x4& rhs);
+
+        //! @brief Returns true if a cache has not been updated since the last change.
+        bool isTouched() const;
+
+        //! @brief Touches every cache, so they are updated at the next render.
+        void touch();
+
+        //! @brief Cleans every cache.
+        void clean() const;
+
+        //! @brief Returns the number of changes of the matrix.
+        std::uint64_t touchCount() const;
     };
 
     //! @brief Pointer to a Transformation.
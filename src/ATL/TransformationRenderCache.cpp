@@ -7,6 +7,7 @@
 
 #include "TransformationRenderCache.h"
 #include "Renderer.h"
+#include "CommandBuffer.h"
 
 namespace Atl
 {
@@ -38,23 +39,23 @@ namespace Atl
         std::atomic_store(&mCommand, command);
     }
 
-    std::future < void > TransformationRenderCache::build(Renderer&)
+    void TransformationRenderCache::buildSync(Renderer&)
     {
-        return std::future < void >();
+
     }
 
-    std::future < void > TransformationRenderCache::render(RenderCommand& command) const
+    void TransformationRenderCache::renderSync(RenderCommand& command) const
     {
-        return std::async(std::launch::async, [this, &command]()
-        {
-            ShaderVariableCommandPtr subCommand = std::atomic_load(&mCommand);
+        ShaderVariableCommandPtr subCommand = std::atomic_load(&mCommand);
 
-            if (!subCommand)
-                throw NullError("TransformationRenderCache", "TransformationRenderCache", 
-                                "Null ShaderVariableCommand passed.");
+        if (!subCommand)
+            throw NullError("TransformationRenderCache", "TransformationRenderCache", 
+                            "Null ShaderVariableCommand passed.");
 
-            command.addSubCommand(std::atomic_load(&subCommand));
-        });
+        if (CommandBuffer* buffer = command.asCommandBuffer())
+            subCommand->recordTo(*buffer);
+        else
+            command.addSubCommand(subCommand);
     }
 
     std::size_t TransformationRenderCache::size(Renderer&) const
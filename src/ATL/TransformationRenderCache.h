@@ -44,10 +44,10 @@ namespace Atl
         void setCommand(const ShaderVariableCommandPtr& command);
 
         //! @brief Does nothing.
-        std::future < void > build(Renderer&);
+        void buildSync(Renderer&);
 
         //! @brief Adds the command into the RenderCommand.
-        std::future < void > render(RenderCommand& command) const;
+        void renderSync(RenderCommand& command) const;
 
         //! @brief Returns zero: no size is applicable.
         std::size_t size(Renderer&) const;
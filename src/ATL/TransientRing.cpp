@@ -0,0 +1,257 @@
+//
+//  TransientRing.cpp
+//  atlre
+//
+//  Created by jacques tronconi on 28/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#include "TransientRing.h"
+#include "RenderHdwBufferManager.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+namespace Atl
+{
+    namespace
+    {
+        //! @brief Returns the index of a HardwareBufferType in TransientRing::mRings.
+        std::size_t IndexOf(HBT type)
+        {
+            return static_cast < std::size_t >(type);
+        }
+
+        //! @brief Returns size rounded up to alignment, a power of two.
+        std::size_t AlignUp(std::size_t size, std::size_t alignment)
+        {
+            return (size + alignment - 1) & ~(alignment - 1);
+        }
+    }
+
+    TransientRing::TransientRing(RenderHdwBufferManager& manager)
+    : mManager(manager), mFrameIndex(0)
+    {
+
+    }
+
+    TransientRing::~TransientRing()
+    {
+        for (FrameMark& mark : mFrames)
+            for (Release& release : mark.releases)
+                release();
+
+        for (Release& release : mReleases)
+            release();
+
+        for (Ring& ring : mRings)
+            release(ring);
+    }
+
+    void TransientRing::setCapacity(HBT type, std::size_t capacity)
+    {
+        std::lock_guard l(mMutex);
+        Ring& ring = mRings[IndexOf(type)];
+
+        if (ring.head.load() != ring.tail.load())
+            throw TransientRingInFlight("TransientRing", "setCapacity", "%i bytes are still in flight.",
+                                        static_cast < int >(ring.head.load() - ring.tail.load()));
+
+        release(ring);
+        ring.capacity = capacity;
+    }
+
+    std::size_t TransientRing::capacity(HBT type) const
+    {
+        std::lock_guard l(mMutex);
+        return mRings[IndexOf(type)].capacity;
+    }
+
+    TransientRange TransientRing::allocate(HBT type, std::size_t size, std::size_t alignment)
+    {
+        if (!size)
+            return TransientRange();
+
+        Ring& ring = mRings[IndexOf(type)];
+        char* data = ring.data.load(std::memory_order_acquire);
+
+        if (!data)
+            data = create(type);
+
+        if (!alignment)
+            alignment = ring.alignment;
+
+        if (alignment & (alignment - 1))
+            throw OutOfRange("TransientRing", "allocate", "Alignment %i is not a power of two.",
+                             static_cast < int >(alignment));
+
+        const std::size_t capacity = ring.capacity;
+
+        if (size > capacity)
+            throw NotEnoughMemory("TransientRing", "allocate", "%i bytes requested in a ring of %i bytes.",
+                                  static_cast < int >(size), static_cast < int >(capacity));
+
+        std::uint64_t head = ring.head.load();
+        std::uint64_t begin;
+
+        do
+        {
+            // A range never wraps: if it doesn't fit before the end, it starts at zero.
+
+            const std::size_t offset = static_cast < std::size_t >(head % capacity);
+            const std::size_t aligned = AlignUp(offset, alignment);
+
+            begin = aligned + size <= capacity ? head + (aligned - offset) : head + (capacity - offset);
+
+            if (begin + size - ring.tail.load(std::memory_order_acquire) > capacity)
+                throw NotEnoughMemory("TransientRing", "allocate", "No room for %i bytes, %i bytes are in flight.",
+                                      static_cast < int >(size), static_cast < int >(head - ring.tail.load()));
+        }
+        while (!ring.head.compare_exchange_weak(head, begin + size));
+
+        TransientRange range;
+        range.buffer = ring.buffer;
+        range.offset = static_cast < std::size_t >(begin % capacity);
+        range.size = size;
+        range.data = data + range.offset;
+        return range;
+    }
+
+    TransientRange TransientRing::upload(HBT type, const void* data, std::size_t size, std::size_t alignment)
+    {
+        if (!data && size)
+            throw NullError("TransientRing", "upload", "Null data passed.");
+
+        TransientRange range = allocate(type, size, alignment);
+
+        if (range.isValid())
+            std::memcpy(range.data, data, size);
+
+        return range;
+    }
+
+    std::uint64_t TransientRing::endFrame()
+    {
+        std::lock_guard l(mMutex);
+        FrameMark mark;
+        mark.frame = mFrameIndex;
+        mark.isRetired = false;
+
+        for (std::size_t i = 0; i < mRings.size(); ++i)
+            mark.heads[i] = mRings[i].head.load();
+
+        mark.releases.swap(mReleases);
+        mFrames.push_back(std::move(mark));
+        return mFrameIndex++;
+    }
+
+    void TransientRing::retire(std::uint64_t frame)
+    {
+        std::vector < Release > releases;
+
+        {
+            std::lock_guard l(mMutex);
+
+            // The marks have consecutive indexes. A frame already released is not found.
+
+            if (mFrames.empty() || frame < mFrames.front().frame)
+                return;
+
+            const std::uint64_t idx = frame - mFrames.front().frame;
+
+            if (idx >= mFrames.size())
+                return;
+
+            mFrames[static_cast < std::size_t >(idx)].isRetired = true;
+
+            // The tails only move across the retired frames at the front, so a frame retired
+            // before an older one keeps its ranges until the older one retires.
+
+            while (!mFrames.empty() && mFrames.front().isRetired)
+            {
+                FrameMark& mark = mFrames.front();
+
+                for (std::size_t i = 0; i < mRings.size(); ++i)
+                    mRings[i].tail.store(mark.heads[i], std::memory_order_release);
+
+                std::move(mark.releases.begin(), mark.releases.end(), std::back_inserter(releases));
+                mFrames.pop_front();
+            }
+        }
+
+        // A release may destroy buffers, so it runs without the ring's lock.
+
+        for (Release& release : releases)
+            release();
+    }
+
+    void TransientRing::defer(Release release)
+    {
+        if (!release)
+            throw NullError("TransientRing", "defer", "Null release passed.");
+
+        std::lock_guard l(mMutex);
+        mReleases.push_back(std::move(release));
+    }
+
+    std::size_t TransientRing::inFlightSize(HBT type) const
+    {
+        const Ring& ring = mRings[IndexOf(type)];
+        return static_cast < std::size_t >(ring.head.load() - ring.tail.load());
+    }
+
+    char* TransientRing::create(HBT type)
+    {
+        std::lock_guard l(mMutex);
+        Ring& ring = mRings[IndexOf(type)];
+
+        if (char* data = ring.data.load())
+            return data;
+
+        // The capacity is a multiple of the alignment, so a range wrapping to zero is aligned.
+
+        const std::size_t alignment = mManager.heap().alignment(type);
+        const std::size_t capacity = AlignUp(std::max(ring.capacity, alignment), alignment);
+
+        // The buffer is counted in the manager's MemoryPool by its observer.
+
+        RenderHdwBufferPtr buffer = mManager.make(type);
+
+        if (!buffer)
+            throw NullError("TransientRing", "create", "Null RenderHdwBuffer created.");
+
+        char* data = nullptr;
+
+        {
+            HardwareBufferLockGuard lb(*buffer);
+            buffer->allocate(capacity);
+            data = static_cast < char* >(buffer->data());
+        }
+
+        if (!data)
+            throw NullError("TransientRing", "create", "Null data for the ring's buffer.");
+
+        ring.buffer = buffer;
+        ring.capacity = capacity;
+        ring.alignment = alignment;
+        ring.data.store(data, std::memory_order_release);
+        return data;
+    }
+
+    void TransientRing::release(Ring& ring)
+    {
+        if (!ring.data.load())
+            return;
+
+        {
+            HardwareBufferLockGuard l(*ring.buffer);
+            ring.buffer->undata();
+        }
+
+        // The head and the tail are kept, as the frames not retired refer to them.
+
+        ring.data.store(nullptr);
+        ring.buffer.reset();
+    }
+}
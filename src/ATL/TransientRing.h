@@ -0,0 +1,210 @@
+//
+//  TransientRing.h
+//  atlre
+//
+//  Created by jacques tronconi on 28/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#ifndef ATL_TRANSIENTRING_H
+#define ATL_TRANSIENTRING_H
+
+#include "RenderHdwBuffer.h"
+
+#include <array>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace Atl
+{
+    class RenderHdwBufferManager;
+
+    //! @brief Launched when a TransientRing is changed while some ranges are in flight.
+    struct TransientRingInFlight : public Error
+    { using Error::Error; };
+
+    //! @brief A range of a TransientRing, valid until the frame it was allocated in retires.
+    struct TransientRange
+    {
+        //! @brief The ring's buffer, to bind at offset.
+        RenderHdwBufferPtr buffer;
+
+        //! @brief The offset of the range in buffer.
+        std::size_t offset = 0;
+
+        //! @brief The size of the range.
+        std::size_t size = 0;
+
+        //! @brief The range in the mapped buffer, where the data is written.
+        void* data = nullptr;
+
+        //! @brief Returns true if the range is not empty.
+        bool isValid() const { return buffer && size; }
+    };
+
+    //! @brief Sub-allocates per frame ranges for dynamic data, like per draw uniforms and
+    //! dynamic vertices.
+    //!
+    //! Each HardwareBufferType has a RenderHdwBuffer used as a ring: \ref allocate() moves a
+    //! head forward with a compare and swap, so recording jobs allocate concurrently without
+    //! lock. The range is written through \ref TransientRange::data, and a command references
+    //! it with its buffer and offset, like BindBufferCommand does. Nothing is allocated nor
+    //! copied per frame, except the data itself.
+    //!
+    //! \ref endFrame() closes the ranges allocated so far in a frame and returns its index.
+    //! \ref retire() with this index, once the frame is submitted, lets the head reuse them.
+    //! FramePipeline and Renderer::render() do both for the Renderer's ring. Frames may be
+    //! retired in any order, like the render jobs of several targets, but their ranges are
+    //! reused only once every frame ended before them is retired too.
+    //!
+    //! \ref defer() keeps an object used by the frame being recorded, like the buffers a
+    //! SubModelRenderCache replaced, until the ranges of this frame are released.
+    //!
+    //! The buffers are created on first use with the alignment of RenderHdwBufferManager's
+    //! heap, and counted in its MemoryPool by the manager's observer. They stay mapped while the ring lives, so the
+    //! backend must allow several data() on a buffer before undata(), like a persistently
+    //! mapped buffer.
+    class EXPORTED TransientRing
+    {
+    public:
+
+        //! @brief The size of a ring when \ref setCapacity() was not called, in bytes.
+        static constexpr std::size_t DefaultCapacity = 4 * 1024 * 1024;
+
+        //! @brief A release deferred until a frame retires.
+        typedef std::function < void(void) > Release;
+
+    private:
+
+        //! @brief The ring of a HardwareBufferType.
+        struct Ring
+        {
+            //! @brief The buffer, or null until the first allocation.
+            RenderHdwBufferPtr buffer;
+
+            //! @brief The mapped buffer, set after buffer.
+            std::atomic < char* > data = { nullptr };
+
+            //! @brief The size of buffer, or the size requested before it is created.
+            std::size_t capacity = DefaultCapacity;
+
+            //! @brief The default alignment of the ranges.
+            std::size_t alignment = 0;
+
+            //! @brief The bytes allocated since the ring was created. The range's offset is
+            //! the head modulo capacity.
+            std::atomic < std::uint64_t > head = { 0 };
+
+            //! @brief The bytes retired since the ring was created.
+            std::atomic < std::uint64_t > tail = { 0 };
+        };
+
+        //! @brief The heads of the rings when a frame ended.
+        struct FrameMark
+        {
+            std::uint64_t frame;
+            std::array < std::uint64_t, 4 > heads;
+
+            //! @brief True once \ref retire() was called for this frame.
+            bool isRetired;
+
+            //! @brief The releases deferred while this frame was recorded.
+            std::vector < Release > releases;
+        };
+
+        //! @brief The manager creating the buffers.
+        RenderHdwBufferManager& mManager;
+
+        //! @brief The rings, by HardwareBufferType.
+        std::array < Ring, 4 > mRings;
+
+        //! @brief The frames ended whose ranges are not released, in order.
+        std::deque < FrameMark > mFrames;
+
+        //! @brief The index of the frame being allocated.
+        std::uint64_t mFrameIndex;
+
+        //! @brief The releases deferred in the frame being allocated.
+        std::vector < Release > mReleases;
+
+        //! @brief Protects the buffers' creation, mFrames, mFrameIndex and mReleases.
+        mutable std::mutex mMutex;
+
+    public:
+
+        //! @brief Constructs a ring without buffer.
+        TransientRing(RenderHdwBufferManager& manager);
+
+        //! @brief Runs the deferred releases, unmaps and releases the buffers.
+        ~TransientRing();
+
+        TransientRing(const TransientRing&) = delete;
+        TransientRing& operator = (const TransientRing&) = delete;
+
+        //! @brief Sets the size of the ring of a type. The buffer is created again on its next
+        //! allocation. Must not be called while ranges are allocated.
+        //! @throw TransientRingInFlight if some ranges of this type are not retired.
+        void setCapacity(HBT type, std::size_t capacity);
+
+        //! @brief Returns the size of the ring of a type.
+        std::size_t capacity(HBT type) const;
+
+        //! @brief Allocates a range of size bytes for the current frame.
+        //! @param alignment A power of two, or zero for the alignment of the heap for this type.
+        //! @throw NotEnoughMemory if the ranges in flight leave no room for this one.
+        TransientRange allocate(HBT type, std::size_t size, std::size_t alignment = 0);
+
+        //! @brief Allocates a range and copies size bytes of data in it.
+        TransientRange upload(HBT type, const void* data, std::size_t size, std::size_t alignment = 0);
+
+        //! @brief Ends the current frame, and returns its index for \ref retire().
+        std::uint64_t endFrame();
+
+        //! @brief Marks a frame as retired. Its ranges are released with the ones of the
+        //! frames retired after it, once the frames ended before it are retired.
+        void retire(std::uint64_t frame);
+
+        //! @brief Runs release when the current frame is retired, with the frames ended
+        //! before it.
+        void defer(Release release);
+
+        //! @brief Returns the bytes not retired for a type, alignment included.
+        std::size_t inFlightSize(HBT type) const;
+
+    private:
+
+        //! @brief Creates and maps the buffer of a ring, if not done by another thread.
+        char* create(HBT type);
+
+        //! @brief Unmaps and releases the buffer of a ring.
+        void release(Ring& ring);
+    };
+
+    //! @brief Retires a frame of a TransientRing when destroyed, even if its rendering failed.
+    struct TransientFrameGuard
+    {
+        //! @brief The ring.
+        TransientRing& ring;
+
+        //! @brief The frame to retire.
+        std::uint64_t frame;
+
+        //! @brief Constructs the guard.
+        TransientFrameGuard(TransientRing& rhs, std::uint64_t rframe)
+        : ring(rhs), frame(rframe)
+        {
+
+        }
+
+        //! @brief Retires the frame.
+        ~TransientFrameGuard()
+        {
+            ring.retire(frame);
+        }
+    };
+}
+
+#endif // ATL_TRANSIENTRING_H
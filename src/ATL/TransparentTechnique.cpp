@@ -10,7 +10,7 @@
 
 namespace Atl
 {
-    std::size_t TransparentTechnique::sort(const RenderNode& node, const Camera& camera, const Frustum& frustum, NodesMap& nodes) const
+    std::size_t TransparentTechnique::sort(const RenderNode& node, const Camera& camera, const Frustum& frustum, Frustum::PlaneMask mask, DrawList& nodes) const
     {
         try
         {
@@ -24,7 +24,7 @@ namespace Atl
                                              material.name().data());
             }
             
-            return FarthestTechnique::sort(node, camera, frustum, nodes);
+            return FarthestTechnique::sort(node, camera, frustum, mask, nodes);
         }
         
         catch(RenderNodeNoRenderable const&)
@@ -32,16 +32,39 @@ namespace Atl
             // If we don't have any Material Renderable, then we don't render
             // this Renderable but we still can render children.
             
+            if (node.isSubtreeCulledFromFrustum(frustum, mask))
+                return 0;
+            
             std::size_t childrenCount = node.childrenCount();
             std::size_t nodesAdded = 0;
             
             for (unsigned i = 0; i < childrenCount; ++i)
             {
                 const RenderNode& iNode = dynamic_cast < const RenderNode& >(node.childAt(i));
-                nodesAdded += sort(iNode, camera, frustum, nodes);
+                nodesAdded += sort(iNode, camera, frustum, mask, nodes);
             }
             
             return nodesAdded;
         }
     }
+    
+    bool TransparentTechnique::makeEntryKey(const SceneBVH::Entry& entry, const Camera& camera, std::uint64_t& key) const
+    {
+        // Children of opaque nodes are entries too, so the entry is just skipped.
+        
+        try
+        {
+            const Material& material = entry.node->findRenderable < Material >();
+            
+            if (!material.isTransparent())
+                return false;
+            
+            return FarthestTechnique::makeEntryKey(entry, camera, key);
+        }
+        
+        catch(RenderNodeNoRenderable const&)
+        {
+            return false;
+        }
+    }
 }
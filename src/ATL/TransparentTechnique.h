@@ -21,7 +21,10 @@ namespace Atl
     protected:
         ATL_SHAREABLE(TransparentTechnique)
         
-        virtual std::size_t sort(const RenderNode& node, const Camera& camera, const Frustum& frustum, NodesMap& nodes) const;
+        virtual std::size_t sort(const RenderNode& node, const Camera& camera, const Frustum& frustum, Frustum::PlaneMask mask, DrawList& nodes) const;
+        
+        //! @brief Keys only the entries with a transparent Material, from back to front.
+        virtual bool makeEntryKey(const SceneBVH::Entry& entry, const Camera& camera, std::uint64_t& key) const;
     };
 }
 
@@ -0,0 +1,449 @@
+//
+//  UploadQueue.cpp
+//  atlre
+//
+//  Created by jacques tronconi on 29/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#include "UploadQueue.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace Atl
+{
+    namespace
+    {
+        //! @brief Calls undata() on a buffer when destroyed, even if the copy failed.
+        struct UndataGuard
+        {
+            const HardwareBuffer& buffer;
+
+            ~UndataGuard()
+            {
+                buffer.undata();
+            }
+        };
+    }
+
+    UploadQueue::UploadQueue()
+    : mFrameBudget(0), mFrameBytes(0), mQueuedCount(0), mCompletedCount(0), mStop(false)
+    {
+
+    }
+
+    UploadQueue::~UploadQueue()
+    {
+        stop();
+    }
+
+    UploadToken UploadQueue::enqueue(const MemBufferPtr& source, const RenderHdwBufferPtr& destination)
+    {
+        if (!source)
+            throw NullError("UploadQueue", "enqueue", "Null MemBuffer passed.");
+
+        if (!destination)
+            throw NullError("UploadQueue", "enqueue", "Null RenderHdwBuffer passed.");
+
+        // MemBuffer::size() takes the buffer's mutex, so it is read before locking the queue.
+        // The budget counts the dirty ranges only if they are enough to update destination.
+
+        std::size_t size = source->size();
+        std::vector < HardwareBufferRange > ranges;
+
+        if (destination->size() == size && source->dirtyRangesSince(destination->sourceGeneration(), ranges))
+        {
+            size = 0;
+
+            for (const HardwareBufferRange& range : ranges)
+                size += range.size;
+        }
+
+        std::lock_guard l(mMutex);
+        auto it = mPending.find(destination.get());
+
+        // The pending transfer will copy the latest source.
+
+        if (it != mPending.end())
+        {
+            it->second.source = source;
+            it->second.size = size;
+            return it->second.token;
+        }
+
+        Transfer transfer;
+        transfer.source = source;
+        transfer.destination = destination;
+        transfer.size = size;
+        transfer.promise = std::make_shared < std::promise < void > >();
+        transfer.token = transfer.promise->get_future().share();
+
+        UploadToken token = transfer.token;
+        mPending.emplace(destination.get(), std::move(transfer));
+        mOrder.push_back(destination.get());
+        mQueuedCount++;
+
+        mCondition.notify_one();
+        return token;
+    }
+
+    void UploadQueue::setFrameBudget(std::size_t bytes)
+    {
+        {
+            std::lock_guard l(mMutex);
+            mFrameBudget = bytes;
+        }
+
+        mCondition.notify_one();
+    }
+
+    std::size_t UploadQueue::frameBudget() const
+    {
+        std::lock_guard l(mMutex);
+        return mFrameBudget;
+    }
+
+    std::size_t UploadQueue::pendingCount() const
+    {
+        std::lock_guard l(mMutex);
+        return mOrder.size();
+    }
+
+    std::uint64_t UploadQueue::completedCount() const
+    {
+        std::lock_guard l(mMutex);
+        return mCompletedCount;
+    }
+
+    bool UploadQueue::isIdle() const
+    {
+        std::lock_guard l(mMutex);
+        return mQueuedCount == mCompletedCount;
+    }
+
+    void UploadQueue::start()
+    {
+        std::lock_guard l(mMutex);
+
+        if (mWorker.joinable())
+            return;
+
+        mStop = false;
+        mWorker = std::thread([this](){ run(); });
+    }
+
+    void UploadQueue::stop()
+    {
+        {
+            std::lock_guard l(mMutex);
+
+            if (!mWorker.joinable())
+                return;
+
+            mStop = true;
+        }
+
+        mCondition.notify_all();
+        mWorker.join();
+    }
+
+    bool UploadQueue::isStarted() const
+    {
+        std::lock_guard l(mMutex);
+        return mWorker.joinable();
+    }
+
+    void UploadQueue::nextFrame()
+    {
+        bool isStarted;
+
+        {
+            std::lock_guard l(mMutex);
+            mFrameBytes = 0;
+            isStarted = mWorker.joinable();
+        }
+
+        if (isStarted)
+            mCondition.notify_one();
+        else
+            process();
+    }
+
+    std::size_t UploadQueue::process()
+    {
+        std::vector < Transfer > batch = takeBatch(false);
+        return batch.empty() ? 0 : execute(batch);
+    }
+
+    void UploadQueue::flush()
+    {
+        std::vector < Transfer > batch = takeBatch(true);
+
+        if (!batch.empty())
+            execute(batch);
+    }
+
+    bool UploadQueue::IsDone(const UploadToken& token)
+    {
+        if (!token.valid())
+            return true;
+
+        if (token.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            return false;
+
+        token.get();
+        return true;
+    }
+
+    bool UploadQueue::isAllowed(std::size_t size) const
+    {
+        // The first transfer of a frame is always allowed, so a large one doesn't wait forever.
+
+        return !mFrameBudget || !mFrameBytes || mFrameBytes + size <= mFrameBudget;
+    }
+
+    std::vector < UploadQueue::Transfer > UploadQueue::takeBatch(bool ignoreBudget)
+    {
+        std::vector < Transfer > batch;
+        std::lock_guard l(mMutex);
+
+        while (!mOrder.empty())
+        {
+            auto it = mPending.find(mOrder.front());
+
+            if (!ignoreBudget && !isAllowed(it->second.size))
+                break;
+
+            mFrameBytes += it->second.size;
+            batch.push_back(std::move(it->second));
+            mPending.erase(it);
+            mOrder.pop_front();
+        }
+
+        return batch;
+    }
+
+    std::size_t UploadQueue::execute(std::vector < Transfer >& batch)
+    {
+        std::lock_guard pl(mProcessMutex);
+
+        std::vector < Staged > staged(batch.size());
+        std::vector < std::exception_ptr > errors(batch.size());
+
+        // First, the sources are copied in the staging memory. Each one is locked only while
+        // it is copied, not while the destinations are written. A destination of the same
+        // size which already holds a generation of its source only receives the ranges
+        // modified since.
+
+        mStaging.clear();
+
+        for (std::size_t i = 0; i < batch.size(); ++i)
+        {
+            try
+            {
+                // MemBuffer::size() takes the buffer's mutex, so it is read before locking.
+
+                const HardwareBuffer& source = *batch[i].source;
+                const RenderHdwBuffer& destination = *batch[i].destination;
+                Staged& stage = staged[i];
+
+                stage.size = source.size();
+                stage.offset = mStaging.size();
+
+                HardwareBufferLockGuardCst l(source);
+                stage.generation = source.generation();
+
+                stage.isPartial = destination.size() == stage.size &&
+                    source.dirtyRangesSince(destination.sourceGeneration(), stage.ranges);
+
+                if (!stage.isPartial)
+                {
+                    stage.ranges.clear();
+
+                    if (stage.size)
+                        stage.ranges.push_back({ 0, stage.size });
+                }
+
+                if (stage.ranges.empty())
+                    continue;
+
+                const char* data = static_cast < const char* >(source.data());
+
+                if (!data)
+                    throw NullError("UploadQueue", "execute", "Null data for MemBuffer %i.",
+                                    static_cast < int >(batch[i].source->index()));
+
+                UndataGuard g { source };
+
+                for (const HardwareBufferRange& range : stage.ranges)
+                {
+                    if (range.offset + range.size > stage.size)
+                        throw OutOfRange("UploadQueue", "execute", "Dirty range %i of %i bytes out of MemBuffer %i.",
+                                         static_cast < int >(range.offset), static_cast < int >(range.size),
+                                         static_cast < int >(batch[i].source->index()));
+
+                    mStaging.insert(mStaging.end(), data + range.offset, data + range.offset + range.size);
+                }
+            }
+
+            catch (...)
+            {
+                errors[i] = std::current_exception();
+            }
+        }
+
+        // Then, the destinations are grouped by backing buffer, and by address in a group so
+        // they are always locked in the same order.
+
+        std::vector < std::size_t > order;
+
+        for (std::size_t i = 0; i < batch.size(); ++i)
+        {
+            if (!errors[i])
+                order.push_back(i);
+        }
+
+        std::sort(order.begin(), order.end(), [&batch](std::size_t lhs, std::size_t rhs)
+        {
+            const RenderHdwBuffer* lhsBacking = &batch[lhs].destination->backing();
+            const RenderHdwBuffer* rhsBacking = &batch[rhs].destination->backing();
+
+            if (lhsBacking != rhsBacking)
+                return lhsBacking < rhsBacking;
+
+            return batch[lhs].destination.get() < batch[rhs].destination.get();
+        });
+
+        for (std::size_t first = 0; first < order.size();)
+        {
+            RenderHdwBuffer& backing = batch[order[first]].destination->backing();
+            std::size_t last = first;
+
+            while (last < order.size() && &batch[order[last]].destination->backing() == &backing)
+                ++last;
+
+            // The destinations are locked before the backing buffer, like RenderHdwSubBuffer
+            // does when it moves its range.
+
+            std::vector < std::unique_lock < HardwareBuffer > > locks;
+            std::vector < std::size_t > writes;
+
+            for (std::size_t k = first; k < last; ++k)
+            {
+                const std::size_t i = order[k];
+                RenderHdwBuffer& destination = *batch[i].destination;
+                const Staged& stage = staged[i];
+
+                try
+                {
+                    locks.emplace_back(destination);
+
+                    // A range which must be resized is allocated again. A dedicated buffer is
+                    // written alone.
+
+                    if (destination.size() != stage.size && stage.isPartial)
+                        throw OutOfRange("UploadQueue", "execute", "RenderHdwBuffer resized while its dirty ranges were uploaded.");
+                    else if (destination.size() != stage.size)
+                        destination.allocate(stage.size, stage.size ? mStaging.data() + stage.offset : nullptr);
+                    else if (&destination.backing() == &destination)
+                        Write(destination, 0, stage, mStaging);
+                    else if (!stage.ranges.empty())
+                        writes.push_back(i);
+                }
+
+                catch (...)
+                {
+                    errors[i] = std::current_exception();
+                }
+            }
+
+            if (!writes.empty())
+            {
+                try
+                {
+                    HardwareBufferLockGuard l(backing);
+
+                    for (std::size_t i : writes)
+                        Write(backing, batch[i].destination->backingOffset(), staged[i], mStaging);
+                }
+
+                catch (...)
+                {
+                    for (std::size_t i : writes)
+                        errors[i] = std::current_exception();
+                }
+            }
+
+            first = last;
+        }
+
+        std::size_t bytes = 0;
+
+        for (std::size_t i = 0; i < batch.size(); ++i)
+        {
+            if (errors[i])
+            {
+                batch[i].promise->set_exception(errors[i]);
+                continue;
+            }
+
+            for (const HardwareBufferRange& range : staged[i].ranges)
+                bytes += range.size;
+
+            batch[i].destination->setSourceGeneration(staged[i].generation);
+            batch[i].promise->set_value();
+        }
+
+        // Counted once the tokens are signaled, so a reader seeing the new count sees them done.
+
+        {
+            std::lock_guard l(mMutex);
+            mCompletedCount += batch.size();
+        }
+
+        return bytes;
+    }
+
+    void UploadQueue::Write(RenderHdwBuffer& buffer, std::size_t offset, const Staged& stage, const std::vector < char >& staging)
+    {
+        if (stage.ranges.empty())
+            return;
+
+        char* data = static_cast < char* >(buffer.data());
+
+        if (!data)
+            throw NullError("UploadQueue", "Write", "Null data for a RenderHdwBuffer.");
+
+        UndataGuard g { buffer };
+
+        const char* staged = staging.data() + stage.offset;
+
+        for (const HardwareBufferRange& range : stage.ranges)
+        {
+            std::memcpy(data + offset + range.offset, staged, range.size);
+            staged += range.size;
+        }
+    }
+
+    void UploadQueue::run()
+    {
+        while (true)
+        {
+            {
+                std::unique_lock l(mMutex);
+
+                mCondition.wait(l, [this]()
+                {
+                    return mStop || (!mOrder.empty() && isAllowed(mPending.find(mOrder.front())->second.size));
+                });
+
+                if (mStop)
+                    return;
+            }
+
+            process();
+        }
+    }
+}
@@ -0,0 +1,207 @@
+//
+//  UploadQueue.h
+//  atlre
+//
+//  Created by jacques tronconi on 29/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#ifndef ATL_UPLOADQUEUE_H
+#define ATL_UPLOADQUEUE_H
+
+#include "RenderHdwBuffer.h"
+
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace Atl
+{
+    //! @brief Signaled when an upload is done, or holds its error.
+    typedef std::shared_future < void > UploadToken;
+
+    //! @brief Uploads MemBuffers into RenderHdwBuffers out of the thread building the caches.
+    //!
+    //! \ref enqueue() only records a transfer and returns its token. A transfer queued again
+    //! for the same destination before it is executed is coalesced with the pending one, and
+    //! shares its token. \ref process() executes the pending transfers as a batch: the sources
+    //! are copied in a staging memory, each one locked only for its copy, then the destinations
+    //! sharing the same backing buffer, like the ranges of a RenderHdwBufferHeap block, are
+    //! written with a single data() on this buffer.
+    //!
+    //! A destination holding a \ref RenderHdwBuffer::sourceGeneration() of its source, and of
+    //! the same size, only receives the ranges modified since, merged by
+    //! \ref HardwareBuffer::dirtyRangesSince(). Otherwise the whole source is copied.
+    //!
+    //! The transfers are executed by a dedicated worker once \ref start() is called, and
+    //! otherwise by \ref nextFrame(), which the Renderer calls before rendering each frame. The
+    //! worker must only be started if the backend allows data() on another thread than the
+    //! rendering one. With \ref setFrameBudget(), a frame executes transfers until the budget
+    //! is reached, and the others wait for the next frame.
+    //!
+    //! The destinations are written in place, and resized by allocating them again, without
+    //! waiting for the frames in flight: they must not be drawn until their token is done.
+    //! RenderHdwBufferManager::findOrQueueRelated() queues each update into a buffer no frame
+    //! uses, and a cache checks the tokens of its transfers with \ref IsDone() before drawing
+    //! the new buffers.
+    class EXPORTED UploadQueue
+    {
+        //! @brief A pending transfer.
+        struct Transfer
+        {
+            //! @brief The buffer to copy.
+            MemBufferPtr source;
+
+            //! @brief The buffer to write.
+            RenderHdwBufferPtr destination;
+
+            //! @brief The bytes to copy when queued, for the budget.
+            std::size_t size = 0;
+
+            //! @brief Signals the token.
+            std::shared_ptr < std::promise < void > > promise;
+
+            //! @brief The token returned by \ref enqueue().
+            UploadToken token;
+        };
+
+        //! @brief A transfer copied in the staging memory.
+        struct Staged
+        {
+            //! @brief The size of the source.
+            std::size_t size = 0;
+
+            //! @brief The generation of the source copied.
+            std::uint64_t generation = HardwareBuffer::NoGeneration;
+
+            //! @brief True if only the dirty ranges are copied.
+            bool isPartial = false;
+
+            //! @brief The ranges copied, one after the other from offset in the staging memory.
+            std::vector < HardwareBufferRange > ranges;
+
+            //! @brief The offset of the first range in the staging memory.
+            std::size_t offset = 0;
+        };
+
+        //! @brief The pending transfers, by destination.
+        std::unordered_map < const RenderHdwBuffer*, Transfer > mPending;
+
+        //! @brief The destinations of mPending, in the order they were queued.
+        std::deque < const RenderHdwBuffer* > mOrder;
+
+        //! @brief The bytes a frame may transfer, or zero for no limit.
+        std::size_t mFrameBudget;
+
+        //! @brief The bytes transferred in this frame.
+        std::size_t mFrameBytes;
+
+        //! @brief The transfers queued, not counting the ones coalesced.
+        std::uint64_t mQueuedCount;
+
+        //! @brief The transfers done or failed.
+        std::uint64_t mCompletedCount;
+
+        //! @brief True when the worker must exit.
+        bool mStop;
+
+        //! @brief Protects the members above.
+        mutable std::mutex mMutex;
+
+        //! @brief Wakes the worker.
+        std::condition_variable mCondition;
+
+        //! @brief The dedicated worker, if started.
+        std::thread mWorker;
+
+        //! @brief The staging memory of the batch being executed.
+        std::vector < char > mStaging;
+
+        //! @brief Serializes the batches, which share mStaging.
+        std::mutex mProcessMutex;
+
+    public:
+
+        //! @brief Constructs a queue without worker and without budget.
+        UploadQueue();
+
+        //! @brief Stops the worker. The pending transfers are dropped, and their tokens hold a
+        //! std::future_error.
+        ~UploadQueue();
+
+        UploadQueue(const UploadQueue&) = delete;
+        UploadQueue& operator = (const UploadQueue&) = delete;
+
+        //! @brief Queues the copy of source into destination, resized to source's size if needed.
+        //! Both buffers must live until the token is signaled, which enqueue() ensures by holding
+        //! them. The source must not be locked by the caller, as its size is read.
+        UploadToken enqueue(const MemBufferPtr& source, const RenderHdwBufferPtr& destination);
+
+        //! @brief Sets the bytes a frame may transfer, or zero for no limit. A transfer larger
+        //! than the budget is executed alone in a frame.
+        void setFrameBudget(std::size_t bytes);
+
+        //! @brief Returns the bytes a frame may transfer.
+        std::size_t frameBudget() const;
+
+        //! @brief Returns the number of pending transfers.
+        std::size_t pendingCount() const;
+
+        //! @brief Returns the number of transfers done or failed since the queue was created.
+        //! It changes after their tokens are signaled, so what was recorded while a transfer
+        //! was pending can be recorded again once it is done.
+        std::uint64_t completedCount() const;
+
+        //! @brief Returns true if every transfer queued is done or failed, including the ones
+        //! of a batch being executed.
+        bool isIdle() const;
+
+        //! @brief Starts the dedicated worker. Does nothing if it is already started.
+        void start();
+
+        //! @brief Stops the dedicated worker, once its batch is executed.
+        void stop();
+
+        //! @brief Returns true if the dedicated worker is started.
+        bool isStarted() const;
+
+        //! @brief Starts the budget of a new frame. Wakes the worker, or executes the transfers
+        //! allowed by the budget on the calling thread if the worker is not started.
+        void nextFrame();
+
+        //! @brief Executes the transfers allowed by the budget on the calling thread. Returns
+        //! the bytes transferred.
+        std::size_t process();
+
+        //! @brief Executes all pending transfers on the calling thread, regardless of the budget.
+        void flush();
+
+        //! @brief Returns true if the upload of token is done, false if it is pending, and
+        //! rethrows its error if it failed. An invalid token is done.
+        static bool IsDone(const UploadToken& token);
+
+    private:
+
+        //! @brief Returns true if the budget allows a transfer of size bytes in this frame.
+        //! mMutex must be locked.
+        bool isAllowed(std::size_t size) const;
+
+        //! @brief Takes the pending transfers allowed by the budget, or all of them.
+        std::vector < Transfer > takeBatch(bool ignoreBudget);
+
+        //! @brief Executes a batch and signals its tokens. Returns the bytes transferred.
+        std::size_t execute(std::vector < Transfer >& batch);
+
+        //! @brief Writes the ranges of a stage in buffer, from offset.
+        static void Write(RenderHdwBuffer& buffer, std::size_t offset, const Staged& stage, const std::vector < char >& staging);
+
+        //! @brief Runs the dedicated worker.
+        void run();
+    };
+}
+
+#endif // ATL_UPLOADQUEUE_H
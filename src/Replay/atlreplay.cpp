@@ -0,0 +1,51 @@
+//
+//  atlreplay.cpp
+//  atlre
+//
+//  Created by jacques tronconi on 27/04/2020.
+//  Copyright © 2020 Atlanti's Corporation. All rights reserved.
+//
+
+#include "NullRenderer.h"
+#include "CommandReplay.h"
+
+#include <cstdlib>
+#include <iostream>
+
+//! @brief Submits the frames of a capture file to a NullRenderer, and prints the counters of
+//! \ref Atl::CommandReplay::replay(). Usage: atlreplay <capture> [loops].
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " <capture> [loops]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const unsigned loops = argc > 2 ? static_cast < unsigned >(std::strtoul(argv[2], nullptr, 10)) : 1;
+
+    try
+    {
+        auto renderer = std::make_shared < Atl::NullRenderer >(Atl::RendererManager::Get(), "NullRenderer");
+        Atl::NullRenderTarget target(*renderer);
+        Atl::CommandReplay replay;
+
+        replay.load(argv[1]);
+        replay.prepare(*renderer);
+
+        const Atl::CommandReplayStats stats = replay.replay(target, loops ? loops : 1);
+
+        std::cout << "frames:  " << stats.frames << " (" << stats.framesPerSecond() << "/s)" << std::endl;
+        std::cout << "records: " << stats.records << " (" << stats.recordsPerSecond() << "/s)" << std::endl;
+        std::cout << "opaques: " << stats.opaques << std::endl;
+        std::cout << "seconds: " << stats.seconds << std::endl;
+    }
+
+    catch (const std::exception& error)
+    {
+        std::cerr << error.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}